@@ -0,0 +1,114 @@
+/**
+ * A persistent Jasmin assembler, driven by <code>alanc --batch</code> and
+ * <code>alanc --server</code>.
+ *
+ * Each job read from the standard input stream is a line with the name of the
+ * job and the length in bytes of its Jasmin text, followed by the text itself,
+ * which is assembled into the current directory, exactly as
+ * <code>java -jar jasmin.jar</code> would assemble a file of that name, but
+ * without the text ever being written to disk.  For every job, one line is
+ * written
+ * to the standard output stream, holding the status (0 for success, 1 for
+ * failure) and the number of bytes of diagnostic text that follow it.  The
+ * server exits when its standard input is closed.
+ *
+ * @date    2026-10-14
+ */
+
+import java.io.BufferedInputStream;
+import java.io.BufferedReader;
+import java.io.ByteArrayOutputStream;
+import java.io.DataInputStream;
+import java.io.File;
+import java.io.FileDescriptor;
+import java.io.FileOutputStream;
+import java.io.IOException;
+import java.io.OutputStream;
+import java.io.PrintStream;
+import java.io.StringReader;
+
+import jasmin.ClassFile;
+
+public class JasminServer {
+
+	public static void main(String[] args) throws IOException {
+		DataInputStream jobs;
+		OutputStream replies;
+		ByteArrayOutputStream diag;
+		PrintStream capture;
+		String line, name;
+		byte[] source, text;
+		int space, status;
+
+		jobs = new DataInputStream(new BufferedInputStream(System.in));
+		replies = new FileOutputStream(FileDescriptor.out);
+
+		while ((line = readLine(jobs)) != null) {
+			space = line.lastIndexOf(' ');
+			name = line.substring(0, space);
+			source = new byte[Integer.parseInt(line.substring(space + 1))];
+			jobs.readFully(source);
+
+			/* Jasmin reports errors on the standard streams */
+			diag = new ByteArrayOutputStream();
+			capture = new PrintStream(diag, true);
+			System.setOut(capture);
+			System.setErr(capture);
+
+			status = assemble(name, new String(source, "ISO-8859-1"), capture);
+
+			capture.flush();
+			text = diag.toByteArray();
+			replies.write((status + " " + text.length + "\n").getBytes());
+			replies.write(text);
+			replies.flush();
+		}
+	}
+
+	/* Reads a line of ASCII text up to a line feed, or returns null at the end
+	 * of the stream. */
+	private static String readLine(DataInputStream in) throws IOException {
+		StringBuilder line = new StringBuilder();
+		int c;
+
+		while ((c = in.read()) != '\n') {
+			if (c < 0) {
+				return (line.length() > 0 ? line.toString() : null);
+			}
+			line.append((char) c);
+		}
+		return line.toString();
+	}
+
+	private static int assemble(String name, String source, PrintStream diag) {
+		ClassFile cf;
+		File out;
+		FileOutputStream os;
+
+		try {
+			cf = new ClassFile();
+			cf.readJasmin(new BufferedReader(new StringReader(source)), name,
+					true);
+			if (cf.errorCount() > 0) {
+				diag.println(name + ": Found " + cf.errorCount() + " errors");
+				return 1;
+			}
+
+			out = new File(cf.getClassName() + ".class");
+			if (out.getParentFile() != null) {
+				out.getParentFile().mkdirs();
+			}
+			os = new FileOutputStream(out);
+			try {
+				cf.write(os);
+			} finally {
+				os.close();
+			}
+			return 0;
+		} catch (Exception e) {
+			diag.println(name + ": " + e);
+			return 1;
+		}
+	}
+
+}
@@ -9,8 +9,12 @@
  * which they occur.  Transient errors, for example, non-existent files, MUST
  * be reported where they occur.  There are no warnings, which is to say, all
  * errors are fatal and MUST cause compilation to terminate with an abnormal
- * error code.
+ * error code.  Compilation errors abandon only the compilation in which they
+ * occur, through the compiler context; see <code>alan_compile</code>.
  *
+ * @author  W.H.K. Bester (whkbester@cs.sun.ac.za)
+ * @date    2022-08-03
+ */
 
 #include "boolean.h"
 #include "errmsg.h"
@@ -19,11 +23,17 @@
 #include "symboltable.h"
 #include "token.h"
 
+#include "asmserver.h"
+#include "cache.h"
 #include "codegen.h"
+#include "compiler.h"
 #include "error.h"
+#include "intern.h"
+#include "stats.h"
 #include "valtypes.h"
 #include <ctype.h>
 #include <limits.h>
+#include <setjmp.h>
 #include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
@@ -31,57 +41,70 @@
 
 typedef struct variable_s Variable;
 struct variable_s {
-	char *id;       /**< variable identifier                       */
+	const char *id; /**< variable identifier                       */
 	ValType type;   /**< variable type                             */
 	SourcePos pos;  /**< variable position in the source           */
 	Variable *next; /**< pointer to the next variable in the list  */
 };
 
+/** labels that are placed at the same point in the code */
+typedef struct label_list LabelList;
+struct label_list {
+	Label label;     /**< the label                                  */
+	LabelList *next; /**< the next label of the list                 */
+};
+
+/**
+ * The result of an expression: either a value on the stack, or a test that is
+ * still to be branched on, with its operands on the stack.  A test may also
+ * have exits that jumped out of it as soon as its outcome was known, as the
+ * left operands of <code>and</code> and <code>or</code> do.
+ */
+typedef struct {
+	Boolean test;       /**< whether the result is a test              */
+	Bytecode branch;    /**< the branch taken when the test holds      */
+	LabelList *tjumps;  /**< the labels of the exits when it holds     */
+	LabelList *fjumps;  /**< the labels of the exits when it does not  */
+} Item;
+
 /* --- debugging ------------------------------------------------------------ */
 
 #ifdef DEBUG_PARSER
-void debug_start(const char *fmt, ...);
-void debug_end(const char *fmt, ...);
-void debug_info(const char *fmt, ...);
-#define DBG_start(...) debug_start(__VA_ARGS__)
-#define DBG_end(...) debug_end(__VA_ARGS__)
-#define DBG_info(...) debug_info(__VA_ARGS__)
+void debug_start(AlanCompiler *ac, const char *fmt, ...);
+void debug_end(AlanCompiler *ac, const char *fmt, ...);
+void debug_info(AlanCompiler *ac, const char *fmt, ...);
+#define DBG_start(...) debug_start(ac, __VA_ARGS__)
+#define DBG_end(...) debug_end(ac, __VA_ARGS__)
+#define DBG_info(...) debug_info(ac, __VA_ARGS__)
 #else
 #define DBG_start(...)
 #define DBG_end(...)
 #define DBG_info(...)
 #endif /* DEBUG_PARSER */
 
-/* --- global variables ----------------------------------------------------- */
-
-Token token;    /**< the lookahead token.type                */
-FILE *src_file; /**< the source code file                    */
-
-ValType return_type; /**< the return type of the current function */
-unsigned int off_counter = 0;
-int counters = 0;
-
 /* --- function prototypes: parser routines --------------------------------- */
 
-void parse_source(void);
-void parse_funcdef(void);
-void parse_body(void);
-void parse_type(ValType *type);
-void parse_vardef(void);
-void parse_statements(void);
-void parse_statement(void);
-void parse_assign(void);
-void parse_call(void);
-void parse_if(void);
-void parse_input(void);
-void parse_leave(void);
-void parse_output(void);
-void parse_while(void);
-void parse_expr(ValType *type);
-void parse_simple(ValType *type);
-void parse_term(ValType *type);
-void parse_factor(ValType *type);
-void parse_idf(ValType *type, char *id);
+void parse_source(AlanCompiler *ac);
+void parse_funcdef(AlanCompiler *ac);
+void parse_body(AlanCompiler *ac);
+void parse_type(AlanCompiler *ac, ValType *type);
+void parse_vardef(AlanCompiler *ac);
+void parse_statements(AlanCompiler *ac);
+void parse_statement(AlanCompiler *ac);
+void parse_assign(AlanCompiler *ac);
+void parse_call(AlanCompiler *ac);
+void parse_if(AlanCompiler *ac);
+void parse_input(AlanCompiler *ac);
+void parse_leave(AlanCompiler *ac);
+void parse_output(AlanCompiler *ac);
+void parse_while(AlanCompiler *ac);
+void parse_expr(AlanCompiler *ac, ValType *type);
+void parse_expr_item(AlanCompiler *ac, ValType *type, Item *x);
+void parse_simple(AlanCompiler *ac, ValType *type);
+void parse_simple_item(AlanCompiler *ac, ValType *type, Item *x);
+void parse_term(AlanCompiler *ac, ValType *type, Item *x);
+void parse_factor(AlanCompiler *ac, ValType *type, Item *x);
+void parse_idf(AlanCompiler *ac, ValType *type, char *id);
 
 /* --- helper macros -------------------------------------------------------- */
 
@@ -107,65 +130,145 @@ void parse_idf(ValType *type, char *id);
 #define IS_TYPE_TOKEN(toktype)                                                 \
 	(toktype == TOKEN_BOOLEAN || toktype == TOKEN_INTEGER)
 
+/* --- function prototypes: condition routines ------------------------------ */
+
+static void make_test(Item *x);
+static void load_item(AlanCompiler *ac, Item *x);
+static void branch_if_true(AlanCompiler *ac, Item *x);
+static void branch_if_false(AlanCompiler *ac, Item *x);
+static LabelList *add_jump(AlanCompiler *ac, LabelList *list, Bytecode op);
+static LabelList *join_labels(LabelList *a, LabelList *b);
+static void place_labels(AlanCompiler *ac, LabelList *list);
+
 /* --- function prototypes: helper routines --------------------------------- */
 
-void check_types(ValType type1, ValType type2, SourcePos *pos, ...);
+void check_types(AlanCompiler *ac, ValType type1, ValType type2,
+				 SourcePos *pos, ...);
 
-void expect(TokenType type);
-void expect_id(char **id);
+void expect(AlanCompiler *ac, TokenType type);
+void expect_id(AlanCompiler *ac, const char **id);
+void expect_known_id(AlanCompiler *ac, const char **id, IDprop **prop);
 
-IDprop *idprop(ValType type, unsigned int offset, unsigned int nparams,
-			   ValType *params);
-Variable *variable(char *id, ValType type, SourcePos pos);
+IDprop *idprop(AlanCompiler *ac, ValType type, unsigned int offset,
+			   unsigned int nparams, ValType *params);
+Variable *variable(AlanCompiler *ac, const char *id, ValType type,
+				   SourcePos pos);
 
 /* --- function prototypes: error reporting --------------------------------- */
 
-void abort_compile(Error err, ...);
-void abort_compile_pos(SourcePos *posp, Error err, ...);
+void abort_compile(AlanCompiler *ac, Error err, ...);
+void abort_compile_pos(AlanCompiler *ac, SourcePos *posp, Error err, ...);
 
-/* --- main routine --------------------------------------------------------- */
+/* --- compiler interface --------------------------------------------------- */
 
-int main(int argc, char *argv[])
+int alan_compile(AlanCompiler *ac, const char *src_name,
+		const char *jasmin_path, AsmServer *asm_server)
 {
-	char *jasmin_path;
-
-	/* set up global variables */
-	setprogname(argv[0]);
-
-	/* check command-line arguments and environment */
-	if (argc != 2) {
-		eprintf("usage: %s <filename>", getprogname());
+	CacheKey key;
+	const char *outputs[1];
+	char mode[64];
+	Boolean cached;
+
+	alan_set_source_name(ac, src_name);
+	ac->src_file = NULL;
+	ac->status = EXIT_SUCCESS;
+
+	/* errors in any unit return here, with the exit status in the context */
+	ac->can_bail = TRUE;
+	if (setjmp(ac->bail) != 0) {
+		ac->can_bail = FALSE;
+		release_code_generation(ac);
+		release_symbol_table(ac);
+		release_scanner(ac);
+		release_names(ac);
+		release_stats(ac);
+		arena_reset(ac->arena);
+		if (ac->src_file) {
+			fclose(ac->src_file);
+		}
+		return ac->status;
 	}
 
-	if ((jasmin_path = getenv("JASMIN_JAR")) == NULL) {
-		eprintf("JASMIN_JAR environment variable not set");
+	if (ac->options.stats) {
+		init_stats(ac);
 	}
 
 	/* open the source file, and report an error if it cannot be opened */
-	if ((src_file = fopen(argv[1], "r")) == NULL) {
-		eprintf("file '%s' could not be opened:", argv[1]);
+	if ((ac->src_file = fopen(src_name, "r")) == NULL) {
+		ceprintf(ac, "file '%s' could not be opened:", src_name);
+	}
+
+	/* an unchanged source need not be compiled again, but what the
+	 * optimisations did is only known from compiling it, so reports bypass
+	 * the cache */
+	cached = (ac->cache != NULL && !ac->options.report
+			&& !ac->options.inline_report);
+	if (cached) {
+		snprintf(mode, sizeof(mode), "%s -O%d --inline-limit=%d%s",
+				(jasmin_path ? "jasmin" : "class"), ac->options.optimise,
+				ac->options.inline_limit,
+				(ac->options.profile ? " --profile" : ""));
+		if (!cache_key(&key, ac->src_file, mode)) {
+			ceprintf(ac, "file '%s' could not be read:", src_name);
+		}
+		if (cache_restore(ac->cache, &key)) {
+			ac->can_bail = FALSE;
+			print_stats(ac, TRUE);
+			release_stats(ac);
+			fclose(ac->src_file);
+			ac->src_file = NULL;
+			return EXIT_SUCCESS;
+		}
 	}
-	setsrcname(argv[1]);
 
 	/* initialise all compiler units */
-	init_scanner(src_file);
-	init_symbol_table();
+	stats_phase(ac, PHASE_SCAN);
+	init_scanner(ac, ac->src_file);
+	if (ac->options.pretokenize) {
+		tokenize(ac);
+	}
+	stats_phase(ac, PHASE_PARSE);
+	init_symbol_table(ac);
 
-	// init_code_generation();
 	/* compile */
-	get_token(&token);
-	parse_source();
-
-	/* produce the object code, and assemble */
+	get_token(ac, &ac->token);
+	parse_source(ac);
+
+	/* produce the object code, either directly or through Jasmin */
+	stats_phase(ac, PHASE_EMIT);
+	if (jasmin_path) {
+		make_code_file(ac);
+		stats_phase(ac, PHASE_ASSEMBLE);
+		if (asm_server) {
+			assemble_on_server(ac, asm_server);
+		} else {
+			assemble(ac, jasmin_path);
+		}
+	} else {
+		make_class_file(ac);
+	}
+	stats_phase(ac, PHASE_NONE);
+	if (ac->options.report) {
+		report_optimisations(ac);
+	}
 
-	make_code_file();
-	assemble(jasmin_path);
+	/* keep the outputs for the next compilation of the same source */
+	if (cached) {
+		outputs[0] = get_class_path(ac);
+		cache_store(ac->cache, &key, outputs, 1);
+	}
 
 	/* release allocated resources */
-	release_code_generation();
-	fclose(src_file);
-	freeprogname();
-	freesrcname();
+	ac->can_bail = FALSE;
+	release_code_generation(ac);
+	release_symbol_table(ac);
+	release_scanner(ac);
+	release_names(ac);
+	print_stats(ac, FALSE);
+	release_stats(ac);
+	arena_reset(ac->arena);
+	fclose(ac->src_file);
+	ac->src_file = NULL;
 
 #ifdef DEBUG_PARSER
 	printf("SUCCESS!\n");
@@ -179,35 +282,35 @@ int main(int argc, char *argv[])
 /*
  * <source> = "source" <id> { <funcdef> } <body>.
  */
-void parse_source(void)
+void parse_source(AlanCompiler *ac)
 {
 	IDprop *p;
-	char *class_name, *main_name;
+	const char *class_name, *main_name;
 	main_name = "main";
 
 	DBG_start("<source>");
 
-	expect(TOKEN_SOURCE);
-	expect_id(&class_name);
-	init_code_generation();
-	set_class_name(class_name);
+	expect(ac, TOKEN_SOURCE);
+	expect_id(ac, &class_name);
+	init_code_generation(ac);
+	set_class_name(ac, class_name);
 	// printf("here: %s", class_name);
-	while (token.type == TOKEN_FUNCTION) {
-		parse_funcdef();
+	while (ac->token.type == TOKEN_FUNCTION) {
+		parse_funcdef(ac);
 	}
 	// need to initialise main
 	// unnnecessary because funcdef called for main function after source
-	p = idprop(TYPE_NONE, 0, 1, NULL);
+	p = idprop(ac, TYPE_NONE, 0, 1, NULL);
 	// open_subroutine(main_name, p);
-	init_subroutine_codegen(main_name, p);
+	ac->routine_type = TYPE_CALLABLE;
+	init_subroutine_codegen(ac, main_name, p);
 
-	parse_body();
-	gen_1(JVM_RETURN);
-	close_subroutine_codegen(counters + 1);
+	parse_body(ac);
+	gen_1(ac, JVM_RETURN);
+	close_subroutine_codegen(ac, get_variables_width(ac));
 	// list_code();
 	// close_subroutine();
 	// list_code();
-	free(class_name);
 
 	DBG_end("</source>");
 }
@@ -215,33 +318,34 @@ void parse_source(void)
 /*
  * funcdef = “function” id “(” [type id {“,” type id} ] “)” [“to” type] body
  */
-void parse_funcdef(void)
+void parse_funcdef(AlanCompiler *ac)
 {
 	IDprop *r;
-	Variable *old, *newer;
+	Variable *first, *old, *newer;
+	ValType rtype = TYPE_NONE;
 
-	char *fname, *save_fname = "";
+	const char *fname, *save_fname = "";
 	int counter = 0;
-	expect(TOKEN_FUNCTION);
+	expect(ac, TOKEN_FUNCTION);
 
-	expect_id(&fname);
+	expect_id(ac, &fname);
 	save_fname = fname;
-	expect(TOKEN_OPEN_PARENTHESIS);
-	old = NULL;
-	if (IS_TYPE_TOKEN(token.type) == TRUE) {
+	expect(ac, TOKEN_OPEN_PARENTHESIS);
+	first = old = NULL;
+	if (IS_TYPE_TOKEN(ac->token.type) == TRUE) {
 		counter += 1;
-		parse_type(&return_type);
-		expect_id(&fname);
+		parse_type(ac, &ac->return_type);
+		expect_id(ac, &fname);
 
-		old = variable(fname, return_type, position);
+		first = old = variable(ac, fname, ac->return_type, ac->position);
 
-		while (token.type == TOKEN_COMMA) {
-			get_token(&token);
-			parse_type(&return_type);
-			expect_id(&fname);
+		while (ac->token.type == TOKEN_COMMA) {
+			get_token(ac, &ac->token);
+			parse_type(ac, &ac->return_type);
+			expect_id(ac, &fname);
 			counter += 1;
 			// linked list
-			newer = variable(fname, return_type, position);
+			newer = variable(ac, fname, ac->return_type, ac->position);
 			newer->next = NULL;
 
 			while (old->next != NULL) {
@@ -253,6 +357,7 @@ void parse_funcdef(void)
 	}
 	ValType params[counter];
 	int t = 0;
+	old = first;
 	while (old) {
 		params[t] = old->type;
 		old = old->next;
@@ -262,95 +367,100 @@ void parse_funcdef(void)
 	// pass the first param which has a pointer to the others
 	// think type is var or func
 
-	expect(TOKEN_CLOSE_PARENTHESIS);
+	expect(ac, TOKEN_CLOSE_PARENTHESIS);
 
-	while (token.type == TOKEN_TO) {
-		get_token(&token);
-		parse_type(&return_type);
+	while (ac->token.type == TOKEN_TO) {
+		get_token(ac, &ac->token);
+		parse_type(ac, &rtype);
+	}
+	r = idprop(ac, (ValType) (TYPE_CALLABLE | rtype), 1, counter, params);
+	ac->routine_type = r->type;
+	open_subroutine(ac, save_fname, r);
+	for (old = first; old; old = old->next) {
+		insert_name(ac, old->id, idprop(ac, old->type, 0, 0, NULL));
 	}
-	r = idprop(TYPE_CALLABLE, 1, counter, params);
-	open_subroutine(save_fname, r);
-	init_subroutine_codegen(save_fname, r);
-	parse_body();
-	close_subroutine();
-	close_subroutine_codegen(counter);
+	init_subroutine_codegen(ac, save_fname, r);
+	parse_body(ac);
+	if (IS_PROCEDURE(r->type)) {
+		gen_1(ac, JVM_RETURN);
+	}
+	close_subroutine_codegen(ac, get_variables_width(ac));
+	close_subroutine(ac);
 }
 
 /*
  * body = “begin” {⟨vardef⟩} ⟨statements⟩ “end”
  */
-void parse_body(void)
+void parse_body(AlanCompiler *ac)
 {
-	expect(TOKEN_BEGIN);
+	expect(ac, TOKEN_BEGIN);
 
-	while (IS_TYPE_TOKEN(token.type) == TRUE) {
-		parse_vardef();
+	while (IS_TYPE_TOKEN(ac->token.type) == TRUE) {
+		parse_vardef(ac);
 	}
-	parse_statements();
-	expect(TOKEN_END);
+	parse_statements(ac);
+	expect(ac, TOKEN_END);
 }
 
 /*
  * type = ("boolean” | “integer”) [“array”]
  */
-void parse_type(ValType *type)
+void parse_type(AlanCompiler *ac, ValType *type)
 {
-	if (token.type == TOKEN_BOOLEAN) {
+	if (ac->token.type == TOKEN_BOOLEAN) {
 		*type = TYPE_BOOLEAN;
-		get_token(&token);
-		if (token.type == TOKEN_ARRAY) {
-			get_token(&token);
-			gen_newarray(T_BOOLEAN);
+		get_token(ac, &ac->token);
+		if (ac->token.type == TOKEN_ARRAY) {
+			SET_AS_ARRAY(*type);
+			get_token(ac, &ac->token);
 		}
-	} else if (token.type == TOKEN_INTEGER) {
+	} else if (ac->token.type == TOKEN_INTEGER) {
 		*type = TYPE_INTEGER;
-		expect(TOKEN_INTEGER);
+		expect(ac, TOKEN_INTEGER);
 
-		if (token.type == TOKEN_ARRAY) {
-			*type = TYPE_ARRAY;
-			get_token(&token);
-			gen_newarray(T_INT);
+		if (ac->token.type == TOKEN_ARRAY) {
+			SET_AS_ARRAY(*type);
+			get_token(ac, &ac->token);
 		}
 	} else {
-		abort_compile(ERR_TYPE_EXPECTED, token.type);
+		abort_compile(ac, ERR_TYPE_EXPECTED, ac->token.type);
 	}
 }
 
 /*
  * vardef = ⟨type⟩ ⟨id⟩ {“,” ⟨id⟩} “;”
  */
-void parse_vardef(void)
+void parse_vardef(AlanCompiler *ac)
 {
 	// type variable
 	// Variable s;
-	off_counter += 1;
-	char *vname;
-	parse_type(&return_type);
-	expect_id(&vname);
-
-	insert_name(vname, idprop(return_type, off_counter, 0, NULL));
-
-	while (token.type == TOKEN_COMMA) {
-		off_counter += 1;
-		get_token(&token);
-		expect_id(&vname);
-		insert_name(vname, idprop(return_type, off_counter, 0, NULL));
+	const char *vname;
+	parse_type(ac, &ac->return_type);
+	expect_id(ac, &vname);
+
+	/* the symbol table gives each variable its slot */
+	insert_name(ac, vname, idprop(ac, ac->return_type, 0, 0, NULL));
+
+	while (ac->token.type == TOKEN_COMMA) {
+		get_token(ac, &ac->token);
+		expect_id(ac, &vname);
+		insert_name(ac, vname, idprop(ac, ac->return_type, 0, 0, NULL));
 	}
-	expect(TOKEN_SEMICOLON);
+	expect(ac, TOKEN_SEMICOLON);
 }
 
 /*
  * statements = “relax” | ⟨statement⟩ {“;” ⟨statement⟩}
  */
-void parse_statements(void)
+void parse_statements(AlanCompiler *ac)
 {
-	if (token.type == TOKEN_RELAX) {
-		expect(TOKEN_RELAX);
+	if (ac->token.type == TOKEN_RELAX) {
+		expect(ac, TOKEN_RELAX);
 	} else {
-		parse_statement();
-		while (token.type == TOKEN_SEMICOLON) {
-			get_token(&token);
-			parse_statement();
+		parse_statement(ac);
+		while (ac->token.type == TOKEN_SEMICOLON) {
+			get_token(ac, &ac->token);
+			parse_statement(ac);
 		}
 	}
 }
@@ -358,259 +468,319 @@ void parse_statements(void)
 /*
  * statement = ⟨assign⟩ | ⟨call⟩ | ⟨if⟩ | ⟨input⟩ | ⟨leave⟩ | ⟨output⟩ | ⟨while⟩
  */
-void parse_statement(void)
+void parse_statement(AlanCompiler *ac)
 {
-	switch (token.type) {
+	gen_line(ac);
+	switch (ac->token.type) {
 		case TOKEN_ID:
-			parse_assign();
+			parse_assign(ac);
 			break;
 		case TOKEN_CALL:
-			parse_call();
+			parse_call(ac);
 			break;
 		case TOKEN_IF:
-			parse_if();
+			parse_if(ac);
 			break;
 		case TOKEN_GET:
-			parse_input();
+			parse_input(ac);
 			break;
 		case TOKEN_LEAVE:
-			parse_leave();
+			parse_leave(ac);
 			break;
 		case TOKEN_PUT:
-			parse_output();
+			parse_output(ac);
 			break;
 		case TOKEN_WHILE:
-			parse_while();
+			parse_while(ac);
 			break;
 		default:
-			abort_compile(ERR_STATEMENT_EXPECTED, token.type);
+			abort_compile(ac, ERR_STATEMENT_EXPECTED, ac->token.type);
 	}
 }
 
 /*
  * assign = ⟨id⟩ [“[” ⟨simple⟩ “]”] “:=” (⟨expr⟩ | “array” ⟨simple⟩)
  */
-void parse_assign(void)
+void parse_assign(AlanCompiler *ac)
 {
-	int tempo = 0;
 	IDprop *temp;
-	// think needa insert into symbol table here
-	char *aname;
-	expect_id(&aname);
-
-	find_name(aname, &temp);
-
-	if (token.type == TOKEN_OPEN_BRACKET) {
-		get_token(&token);
-		if (token.type == TOKEN_INTEGER) {
-			tempo = token.value;
-		}
-		parse_simple(&return_type);
-		expect(TOKEN_CLOSE_BRACKET);
+	const char *aname;
+	Boolean element = FALSE;
+
+	expect_known_id(ac, &aname, &temp);
+
+	/* the array reference and the index go below the value of an element */
+	if (ac->token.type == TOKEN_OPEN_BRACKET) {
+		get_token(ac, &ac->token);
+		gen_2(ac, JVM_ALOAD, temp->offset);
+		parse_simple(ac, &ac->return_type);
+		expect(ac, TOKEN_CLOSE_BRACKET);
+		element = TRUE;
 	}
-	expect(TOKEN_GETS);
-
-	if (STARTS_EXPR(token.type) == TRUE) {
-		parse_expr(&return_type);
-		gen_2(JVM_ISTORE, counters);
-		if (temp->type == TYPE_ARRAY) {
-			gen_2(JVM_ASTORE, tempo);
+	expect(ac, TOKEN_GETS);
+
+	if (STARTS_EXPR(ac->token.type) == TRUE) {
+		parse_expr(ac, &ac->return_type);
+		if (element) {
+			gen_1(ac, JVM_IASTORE);
+		} else if (IS_ARRAY(temp->type)) {
+			gen_2(ac, JVM_ASTORE, temp->offset);
+		} else {
+			gen_2(ac, JVM_ISTORE, temp->offset);
 		}
-		counters += 1;
 
-	} else if (token.type == TOKEN_ARRAY) {
-		expect(TOKEN_ARRAY);
-		parse_simple(&return_type);
+	} else if (ac->token.type == TOKEN_ARRAY) {
+		expect(ac, TOKEN_ARRAY);
+		parse_simple(ac, &ac->return_type);
+		gen_newarray(ac, T_INT);
+		gen_2(ac, JVM_ASTORE, temp->offset);
 
 	} else
-		abort_compile(ERR_ARRAY_ALLOCATION_OR_EXPRESSION_EXPECTED, TOKEN_ID);
+		abort_compile(ac, ERR_ARRAY_ALLOCATION_OR_EXPRESSION_EXPECTED, TOKEN_ID);
 }
 
 /*
  * call = “call” ⟨id⟩ “(” [⟨expr⟩ {“,” ⟨expr⟩}] “)”
  */
 // only procedures must originate, no return func
-void parse_call(void)
+void parse_call(AlanCompiler *ac)
 {
 	IDprop *k;
-	char *cname;
-	expect(TOKEN_CALL);
-	expect_id(&cname);
-	find_name(cname, &k);
-	gen_call(cname, k);
+	const char *cname;
+	expect(ac, TOKEN_CALL);
+	expect_known_id(ac, &cname, &k);
 	if (!IS_PROCEDURE(k->type)) {
-		abort_compile(ERR_NOT_A_PROCEDURE, "'%s' is not a procedure ", cname);
+		abort_compile(ac, ERR_NOT_A_PROCEDURE, "'%s' is not a procedure ", cname);
 	}
-	expect(TOKEN_OPEN_PARENTHESIS);
+	expect(ac, TOKEN_OPEN_PARENTHESIS);
 
-	if (STARTS_EXPR(token.type) == TRUE) {
-		parse_expr(&return_type);
+	if (STARTS_EXPR(ac->token.type) == TRUE) {
+		parse_expr(ac, &ac->return_type);
 
-		while (token.type == TOKEN_COMMA) {
-			get_token(&token);
-			parse_expr(&return_type);
+		while (ac->token.type == TOKEN_COMMA) {
+			get_token(ac, &ac->token);
+			parse_expr(ac, &ac->return_type);
 		}
 	}
-	expect(TOKEN_CLOSE_PARENTHESIS);
+	expect(ac, TOKEN_CLOSE_PARENTHESIS);
+	gen_call(ac, cname, k);
 }
 
 /*
  * if = if” ⟨expr⟩ “then” ⟨statements⟩ {“elsif” ⟨expr⟩ “then” ⟨statements⟩}
  * [“else” ⟨statements⟩] “end”.
  */
-void parse_if(void)
+void parse_if(AlanCompiler *ac)
 {
-	expect(TOKEN_IF);
-	parse_expr(&return_type);
+	Item x;
+	Label end = 0;
+
+	/* every condition jumps past its statements when it does not hold */
+	expect(ac, TOKEN_IF);
+	parse_expr_item(ac, &ac->return_type, &x);
+	branch_if_false(ac, &x);
+	place_labels(ac, x.tjumps);
 
-	expect(TOKEN_THEN);
-	parse_statements();
+	expect(ac, TOKEN_THEN);
+	parse_statements(ac);
 
-	while (token.type == TOKEN_ELSIF) {
-		get_token(&token);
-		parse_expr(&return_type);
-		expect(TOKEN_THEN);
-		parse_statements();
+	while (ac->token.type == TOKEN_ELSIF) {
+		if (end == 0) {
+			end = get_label(ac);
+		}
+		gen_2_label(ac, JVM_GOTO, end);
+		place_labels(ac, x.fjumps);
+		get_token(ac, &ac->token);
+		parse_expr_item(ac, &ac->return_type, &x);
+		branch_if_false(ac, &x);
+		place_labels(ac, x.tjumps);
+		expect(ac, TOKEN_THEN);
+		parse_statements(ac);
 	}
 
-	if (token.type == TOKEN_ELSE) {
-		get_token(&token);
-		parse_statements();
+	if (ac->token.type == TOKEN_ELSE) {
+		if (end == 0) {
+			end = get_label(ac);
+		}
+		gen_2_label(ac, JVM_GOTO, end);
+		place_labels(ac, x.fjumps);
+		x.fjumps = NULL;
+		get_token(ac, &ac->token);
+		parse_statements(ac);
 	}
-	expect(TOKEN_END);
+	place_labels(ac, x.fjumps);
+	if (end != 0) {
+		gen_label(ac, end);
+	}
+	expect(ac, TOKEN_END);
 }
 
 /*
  * input = “get” ⟨id⟩ [“[” ⟨simple⟩ “]”]
  */
-void parse_input(void)
+void parse_input(AlanCompiler *ac)
 {
-	char *iname;
-	expect(TOKEN_GET);
-	expect_id(&iname);
-
-	if (token.type == TOKEN_OPEN_BRACKET) {
-		get_token(&token);
-		parse_simple(&return_type);
-		expect(TOKEN_CLOSE_BRACKET);
+	IDprop *prop;
+	const char *iname;
+	ValType base;
+	expect(ac, TOKEN_GET);
+	expect_known_id(ac, &iname, &prop);
+	base = (IS_BOOLEAN_TYPE(prop->type) ? TYPE_BOOLEAN : TYPE_INTEGER);
+
+	if (ac->token.type == TOKEN_OPEN_BRACKET) {
+		get_token(ac, &ac->token);
+		gen_2(ac, JVM_ALOAD, prop->offset);
+		parse_simple(ac, &ac->return_type);
+		expect(ac, TOKEN_CLOSE_BRACKET);
+		gen_read(ac, base);
+		gen_1(ac, JVM_IASTORE);
+	} else {
+		gen_read(ac, base);
+		gen_2(ac, JVM_ISTORE, prop->offset);
 	}
 }
 
 /*
  * leave = “leave” [⟨expr⟩].
  */
-void parse_leave(void)
+void parse_leave(AlanCompiler *ac)
 {
-	expect(TOKEN_LEAVE);
+	expect(ac, TOKEN_LEAVE);
 
-	if (STARTS_EXPR(token.type) == TRUE) {
-		parse_expr(&return_type);
+	if (STARTS_EXPR(ac->token.type) == TRUE) {
+		parse_expr(ac, &ac->return_type);
+		gen_1(ac, (IS_ARRAY_TYPE(ac->routine_type) ? JVM_ARETURN
+				: JVM_IRETURN));
+	} else {
+		gen_1(ac, JVM_RETURN);
 	}
 }
 
 /*
  * output = “put” (⟨string⟩ | ⟨expr⟩) {“.” (⟨string⟩ | ⟨expr⟩)}
  */
-void parse_output(void)
+void parse_output(AlanCompiler *ac)
 {
-	expect(TOKEN_PUT);
-	if (token.type == TOKEN_STRING) {
-		gen_print_string(token.string);
-		get_token(&token);
-		while (token.type == TOKEN_CONCATENATE) {
-			get_token(&token);
-			if (token.type == TOKEN_STRING) {
-				gen_print_string(token.string);
-				get_token(&token);
-			} else if (STARTS_EXPR(token.type) == TRUE) {
-				parse_expr(&return_type);
-				gen_print(return_type);
+	expect(ac, TOKEN_PUT);
+	if (ac->token.type == TOKEN_STRING) {
+		gen_print_string(ac, ac->token.string);
+		get_token(ac, &ac->token);
+		while (ac->token.type == TOKEN_CONCATENATE) {
+			get_token(ac, &ac->token);
+			if (ac->token.type == TOKEN_STRING) {
+				gen_print_string(ac, ac->token.string);
+				get_token(ac, &ac->token);
+			} else if (STARTS_EXPR(ac->token.type) == TRUE) {
+				parse_expr(ac, &ac->return_type);
+				gen_print(ac, ac->return_type);
 
 			} else {
-				abort_compile(ERR_EXPRESSION_OR_STRING_EXPECTED, TOKEN_ID);
+				abort_compile(ac, ERR_EXPRESSION_OR_STRING_EXPECTED, TOKEN_ID);
 			}
 			// gen_print_string(token.string);
 		}
 
-	} else if (STARTS_EXPR(token.type) == TRUE) {
-		parse_expr(&return_type);
-		gen_print(return_type);
-		while (token.type == TOKEN_CONCATENATE) {
-			get_token(&token);
-			if (token.type == TOKEN_STRING) {
-				gen_print_string(token.string);
-				get_token(&token);
-			} else if (STARTS_EXPR(token.type) == TRUE) {
-				parse_expr(&return_type);
-				gen_print(return_type);
+	} else if (STARTS_EXPR(ac->token.type) == TRUE) {
+		parse_expr(ac, &ac->return_type);
+		gen_print(ac, ac->return_type);
+		while (ac->token.type == TOKEN_CONCATENATE) {
+			get_token(ac, &ac->token);
+			if (ac->token.type == TOKEN_STRING) {
+				gen_print_string(ac, ac->token.string);
+				get_token(ac, &ac->token);
+			} else if (STARTS_EXPR(ac->token.type) == TRUE) {
+				parse_expr(ac, &ac->return_type);
+				gen_print(ac, ac->return_type);
 			} else {
-				abort_compile(ERR_EXPRESSION_OR_STRING_EXPECTED, TOKEN_ID);
+				abort_compile(ac, ERR_EXPRESSION_OR_STRING_EXPECTED, TOKEN_ID);
 			}
 		}
 
 	} else
-		abort_compile(ERR_EXPRESSION_OR_STRING_EXPECTED, TOKEN_ID);
+		abort_compile(ac, ERR_EXPRESSION_OR_STRING_EXPECTED, TOKEN_ID);
 }
 
 /*
  * while = “while” ⟨expr⟩ “do” ⟨statements⟩ “end”
  */
-void parse_while(void)
+void parse_while(AlanCompiler *ac)
 {
 	// local var
 	ValType store_type;
-	expect(TOKEN_WHILE);
-	parse_expr(&store_type);
-	expect(TOKEN_DO);
-	parse_statements();
-	expect(TOKEN_END);
+	CodeRange cond;
+	Label test;
+	Item x;
+
+	/* the condition is moved below the body, so that every iteration takes
+	 * one branch, back to the top of the body while the condition holds */
+	expect(ac, TOKEN_WHILE);
+	test = get_label(ac);
+	gen_2_label(ac, JVM_GOTO, test);
+	gen_label(ac, test);
+	begin_code_range(ac, &cond);
+	parse_expr_item(ac, &store_type, &x);
+	branch_if_true(ac, &x);
+	end_code_range(ac, &cond);
+
+	place_labels(ac, x.tjumps);
+	expect(ac, TOKEN_DO);
+	gen_profile_loop(ac);
+	parse_statements(ac);
+	move_code_range(ac, &cond);
+	place_labels(ac, x.fjumps);
+	expect(ac, TOKEN_END);
 }
 
 /*
  * expr = ⟨simple⟩ [⟨relop⟩ ⟨simple⟩].
  */
-void parse_expr(ValType *type)
+void parse_expr(AlanCompiler *ac, ValType *type)
+{
+	Item x;
+
+	parse_expr_item(ac, type, &x);
+	load_item(ac, &x);
+}
+
+void parse_expr_item(AlanCompiler *ac, ValType *type, Item *x)
 {
 	int store = 0;
-	const char *temp;
-	ValType store_type, store_type2;
-	SourcePos *te;
+	ValType store_type2;
 	Token tempo;
 	// t1
-	parse_simple(&return_type);
-	store_type = return_type;
+	parse_simple_item(ac, &ac->return_type, x);
 
-	if (IS_RELOP(token.type) == TRUE || IS_ORDOP(token.type) == TRUE) {
-		tempo.type = token.type;
+	if (IS_RELOP(ac->token.type) == TRUE || IS_ORDOP(ac->token.type) == TRUE) {
+		tempo.type = ac->token.type;
 		*type = TYPE_BOOLEAN;
-		if (IS_RELOP(token.type) == TRUE) {
-			te = &position;
+		if (IS_RELOP(ac->token.type) == TRUE) {
 			store = 1;
-			temp = get_token_string(token.type);
 		}
-		get_token(&token);
-		parse_simple(&store_type2);
+		load_item(ac, x);
+		get_token(ac, &ac->token);
+		parse_simple(ac, &store_type2);
+
+		/* the comparison is left as a test, of which the context decides
+		 * whether it jumps or yields a value */
+		x->test = TRUE;
 		switch (tempo.type) {
 			case TOKEN_EQUAL:
-				gen_cmp(JVM_IF_ICMPEQ);
+				x->branch = JVM_IF_ICMPEQ;
 				break;
 			case TOKEN_GREATER_EQUAL:
-				gen_cmp(JVM_IF_ICMPGE);
+				x->branch = JVM_IF_ICMPGE;
 				break;
 			case TOKEN_GREATER_THAN:
-				gen_cmp(JVM_IF_ICMPGT);
+				x->branch = JVM_IF_ICMPGT;
 				break;
 			case TOKEN_LESS_EQUAL:
-				gen_cmp(JVM_IF_ICMPLE);
+				x->branch = JVM_IF_ICMPLE;
 				break;
 			case TOKEN_LESS_THAN:
-				gen_cmp(JVM_IF_ICMPLT);
-				break;
-			case TOKEN_NOT_EQUAL:
-				gen_cmp(JVM_IF_ICMPNE);
+				x->branch = JVM_IF_ICMPLT;
 				break;
-
 			default:
+				x->branch = JVM_IF_ICMPNE;
 				break;
 		}
 
@@ -619,35 +789,44 @@ void parse_expr(ValType *type)
 		}
 	} else {
 		// just a simple
-		*type = return_type;
+		*type = ac->return_type;
 	}
 }
 /*
  * simple = [“-”] ⟨term⟩ {⟨addop⟩ ⟨term⟩}
  */
-void parse_simple(ValType *type)
+void parse_simple(AlanCompiler *ac, ValType *type)
 {
-	ValType store_type;
+	Item x;
+
+	parse_simple_item(ac, type, &x);
+	load_item(ac, &x);
+}
+
+void parse_simple_item(AlanCompiler *ac, ValType *type, Item *x)
+{
+	LabelList *exits;
+	Item y;
 	int store1 = 0;
 	int store = 0;
-	if (token.type == TOKEN_MINUS) {
-		expect(TOKEN_MINUS);
+	if (ac->token.type == TOKEN_MINUS) {
+		expect(ac, TOKEN_MINUS);
 		store1 = 1;
 	}
 
 	// t1
-	parse_term(&return_type);
+	parse_term(ac, &ac->return_type, x);
 
 	if (store1 == 1) {
-		gen_1(JVM_INEG);
+		load_item(ac, x);
+		gen_1(ac, JVM_INEG);
 	}
 
-	store_type = return_type;
 	// t0=t1
-	*type = return_type;
+	*type = ac->return_type;
 
-	while (IS_ADDOP(token.type) == TRUE) {
-		switch (token.type) {
+	while (IS_ADDOP(ac->token.type) == TRUE) {
+		switch (ac->token.type) {
 			case TOKEN_MINUS:
 				store = 1;
 				break;
@@ -661,33 +840,33 @@ void parse_simple(ValType *type)
 			default:
 				break;
 		}
-		int temp1 = 0;
-		int temp2 = 0;
-		if (token.type == TOKEN_PLUS) {
-			// gen_2(JVM_IADD, token.value);
-		}
-
-		if (token.type == TOKEN_MINUS || token.type == TOKEN_PLUS) {
-			temp1 = 1;
-		}
-		if (token.type == TOKEN_PLUS) {
-			temp2 = 1;
+		/* the right operand of 'or' is skipped once the left one holds */
+		exits = NULL;
+		if (store == 3) {
+			branch_if_true(ac, x);
+			place_labels(ac, x->fjumps);
+			exits = x->tjumps;
+		} else {
+			load_item(ac, x);
 		}
 
-		get_token(&token);
+		get_token(ac, &ac->token);
 		// t2
-		parse_term(&return_type);
+		parse_term(ac, &ac->return_type, &y);
+		if (store == 3) {
+			make_test(&y);
+			y.tjumps = join_labels(y.tjumps, exits);
+			*x = y;
+			continue;
+		}
+		load_item(ac, &y);
 		switch (store) {
 			case 1:
-				gen_1(JVM_ISUB);
+				gen_1(ac, JVM_ISUB);
 				break;
 			case 2:
-				gen_1(JVM_IADD);
+				gen_1(ac, JVM_IADD);
 				break;
-			case 3:
-				gen_1(JVM_IOR);
-				break;
-
 			default:
 				break;
 		}
@@ -697,47 +876,59 @@ void parse_simple(ValType *type)
 /*
  * term = ⟨factor⟩ {⟨mulop⟩ ⟨factor⟩}
  */
-void parse_term(ValType *type)
+void parse_term(AlanCompiler *ac, ValType *type, Item *x)
 {
-	ValType store;
+	LabelList *exits;
+	Item y;
 	int temp = 0;
 	int temp2 = 0;
-	parse_factor(&return_type);
+	parse_factor(ac, &ac->return_type, x);
 
-	//
-	// t1 value
-	store = return_type;
 	// t0=t1
-	*type = return_type;
-	while (IS_MULOP(token.type) == TRUE) {
-		if (token.type == TOKEN_MULTIPLY) {
+	*type = ac->return_type;
+	while (IS_MULOP(ac->token.type) == TRUE) {
+		if (ac->token.type == TOKEN_MULTIPLY) {
 			temp2 = 1;
-		} else if (token.type == TOKEN_DIVIDE) {
+		} else if (ac->token.type == TOKEN_DIVIDE) {
 			temp2 = 2;
-		} else if (token.type == TOKEN_REMAINDER) {
+		} else if (ac->token.type == TOKEN_REMAINDER) {
 			temp2 = 3;
-		} else if (token.type == TOKEN_AND) {
+		} else if (ac->token.type == TOKEN_AND) {
 			temp2 = 4;
 		}
-		if (token.type != TOKEN_AND) {
+		if (ac->token.type != TOKEN_AND) {
 			temp = 1;
 		}
-		get_token(&token);
 
-		parse_factor(&return_type);
+		/* the right operand of 'and' is skipped once the left one fails */
+		exits = NULL;
+		if (temp2 == 4) {
+			branch_if_false(ac, x);
+			place_labels(ac, x->tjumps);
+			exits = x->fjumps;
+		} else {
+			load_item(ac, x);
+		}
+		get_token(ac, &ac->token);
+
+		parse_factor(ac, &ac->return_type, &y);
+		if (temp2 == 4) {
+			make_test(&y);
+			y.fjumps = join_labels(y.fjumps, exits);
+			*x = y;
+			continue;
+		}
+		load_item(ac, &y);
 
 		switch (temp2) {
 			case 1:
-				gen_1(JVM_IMUL);
+				gen_1(ac, JVM_IMUL);
 				break;
 			case 2:
-				gen_1(JVM_IDIV);
+				gen_1(ac, JVM_IDIV);
 				break;
 			case 3:
-				gen_1(JVM_IREM);
-				break;
-			case 4:
-				gen_1(JVM_IAND);
+				gen_1(ac, JVM_IREM);
 				break;
 			default:
 				break;
@@ -757,74 +948,183 @@ void parse_term(ValType *type)
  * factor = ⟨id⟩ [“[” ⟨simple⟩ “]” | “(” [ ⟨expr⟩ {“,” ⟨expr⟩} ] “)”] | ⟨num⟩ |
  * “(” ⟨expr⟩ “)” | “not” ⟨factor⟩ | “true” | “false”
  */
-void parse_factor(ValType *type)
+void parse_factor(AlanCompiler *ac, ValType *type, Item *x)
 {
-	SourcePos *temp;
 	IDprop *store;
-	char *fname;
+	const char *fname;
+	LabelList *exits;
 	unsigned int count_param = 0;
-	if (token.type == TOKEN_ID) {
-		expect_id(&fname);
 
+	x->test = FALSE;
+	x->tjumps = x->fjumps = NULL;
+	if (ac->token.type == TOKEN_ID) {
 		// use to check types
-		find_name(fname, &store);
-		gen_2(JVM_ILOAD, store->offset - 1);
-		if (token.type == TOKEN_OPEN_BRACKET) {
-			get_token(&token);
-			gen_2(JVM_ALOAD, token.value);
+		expect_known_id(ac, &fname, &store);
+		if (ac->token.type == TOKEN_OPEN_BRACKET) {
+			get_token(ac, &ac->token);
+			gen_2(ac, JVM_ALOAD, store->offset);
 
-			parse_simple(&return_type);
+			parse_simple(ac, &ac->return_type);
 			// check_types(return_type, TYPE_INTEGER, &position);
-			// setasarray
-			// SET_AS_ARRAY(return_type);
-			expect(TOKEN_CLOSE_BRACKET);
-			*type = TYPE_INTEGER;
-		} else if (token.type == TOKEN_OPEN_PARENTHESIS) {
-			get_token(&token);
-			if (STARTS_EXPR(token.type) == TRUE) {
-				parse_expr(&return_type);
+			expect(ac, TOKEN_CLOSE_BRACKET);
+			gen_1(ac, JVM_IALOAD);
+			*type = (IS_BOOLEAN_TYPE(store->type) ? TYPE_BOOLEAN
+					: TYPE_INTEGER);
+		} else if (ac->token.type == TOKEN_OPEN_PARENTHESIS) {
+			get_token(ac, &ac->token);
+			if (STARTS_EXPR(ac->token.type) == TRUE) {
+				parse_expr(ac, &ac->return_type);
 
 				// check_types(return_type, store->type, &position);
-				while (token.type == TOKEN_COMMA) {
-					temp = &position;
-
+				while (ac->token.type == TOKEN_COMMA) {
 					count_param += 1;
-					get_token(&token);
-					parse_expr(&return_type);
+					get_token(ac, &ac->token);
+					parse_expr(ac, &ac->return_type);
 				}
 			}
-			expect(TOKEN_CLOSE_PARENTHESIS);
+			expect(ac, TOKEN_CLOSE_PARENTHESIS);
+			gen_call(ac, fname, store);
+		} else {
+			gen_2(ac, (IS_ARRAY(store->type) ? JVM_ALOAD : JVM_ILOAD),
+					store->offset);
+			*type = store->type;
 		}
-	} else if (token.type == TOKEN_NUMBER) {
-		gen_2(JVM_LDC, token.value);
+	} else if (ac->token.type == TOKEN_NUMBER) {
+		gen_2(ac, JVM_LDC, ac->token.value);
 		// expect t0 = int
-		get_token(&token);
-		return_type = TYPE_INTEGER;
-	} else if (token.type == TOKEN_OPEN_PARENTHESIS) {
-		get_token(&token);
+		get_token(ac, &ac->token);
+		ac->return_type = TYPE_INTEGER;
+	} else if (ac->token.type == TOKEN_OPEN_PARENTHESIS) {
+		get_token(ac, &ac->token);
 		// t1
-		parse_expr(&return_type);
-		*type = return_type;
-		expect(TOKEN_CLOSE_PARENTHESIS);
-	} else if (token.type == TOKEN_NOT) {
-		get_token(&token);
+		parse_expr_item(ac, &ac->return_type, x);
+		*type = ac->return_type;
+		expect(ac, TOKEN_CLOSE_PARENTHESIS);
+	} else if (ac->token.type == TOKEN_NOT) {
+		get_token(ac, &ac->token);
 		// t1
-		parse_factor(&return_type);
-		*type = return_type;
+		parse_factor(ac, &ac->return_type, x);
+		*type = ac->return_type;
+
+		/* negation swaps the exits of the test */
+		make_test(x);
+		x->branch = get_inverse_branch(x->branch);
+		exits = x->tjumps;
+		x->tjumps = x->fjumps;
+		x->fjumps = exits;
 		// t0=t1
 
 		// t1=bool
 		// check_types(return_type, TYPE_BOOLEAN, &position, "for 'not'");
-	} else if (token.type == TOKEN_TRUE) {
+	} else if (ac->token.type == TOKEN_TRUE) {
 		*type = TYPE_BOOLEAN;
-		gen_2(JVM_LDC, 1);
-		get_token(&token);
-	} else if (token.type == TOKEN_FALSE) {
+		gen_2(ac, JVM_LDC, 1);
+		get_token(ac, &ac->token);
+	} else if (ac->token.type == TOKEN_FALSE) {
 		*type = TYPE_BOOLEAN;
-		gen_2(JVM_LDC, 0);
-		expect(TOKEN_FALSE);
+		gen_2(ac, JVM_LDC, 0);
+		expect(ac, TOKEN_FALSE);
 	} else
-		abort_compile(ERR_FACTOR_EXPECTED, token.type);
+		abort_compile(ac, ERR_FACTOR_EXPECTED, ac->token.type);
+}
+
+/* --- condition routines -------------------------------------------------- */
+
+/* Turns a value into a test of whether it is true.  */
+
+static void make_test(Item *x)
+{
+	if (!x->test) {
+		x->test = TRUE;
+		x->branch = JVM_IFNE;
+		x->tjumps = x->fjumps = NULL;
+	}
+}
+
+/* Leaves the result of an expression on the stack.  A truth value that is
+ * merely tested is already on the stack, or is negated arithmetically; any
+ * other test branches to the code that pushes its outcome.
+ */
+
+static void load_item(AlanCompiler *ac, Item *x)
+{
+	Label end;
+
+	if (!x->test) {
+		return;
+	}
+	if (x->tjumps == NULL && x->fjumps == NULL) {
+		x->test = FALSE;
+		if (x->branch == JVM_IFEQ) {
+			gen_2(ac, JVM_LDC, TRUE);
+			gen_1(ac, JVM_IXOR);
+		} else if (x->branch != JVM_IFNE) {
+			gen_cmp(ac, x->branch);
+		}
+		return;
+	}
+
+	branch_if_true(ac, x);
+	end = get_label(ac);
+	place_labels(ac, x->fjumps);
+	gen_2(ac, JVM_LDC, FALSE);
+	gen_2_label(ac, JVM_GOTO, end);
+	place_labels(ac, x->tjumps);
+	gen_2(ac, JVM_LDC, TRUE);
+	gen_label(ac, end);
+	x->test = FALSE;
+	x->tjumps = x->fjumps = NULL;
+}
+
+/* Branches to the true exits if the test holds, and falls through if not. */
+
+static void branch_if_true(AlanCompiler *ac, Item *x)
+{
+	make_test(x);
+	x->tjumps = add_jump(ac, x->tjumps, x->branch);
+}
+
+/* Branches to the false exits if the test fails, and falls through if not. */
+
+static void branch_if_false(AlanCompiler *ac, Item *x)
+{
+	make_test(x);
+	x->fjumps = add_jump(ac, x->fjumps, get_inverse_branch(x->branch));
+}
+
+/* Generates a branch to a new label, and adds the label to a list. */
+
+static LabelList *add_jump(AlanCompiler *ac, LabelList *list, Bytecode op)
+{
+	LabelList *l;
+
+	l = arena_alloc(ac->arena, sizeof(LabelList));
+	l->label = get_label(ac);
+	l->next = list;
+	gen_2_label(ac, op, l->label);
+
+	return l;
+}
+
+static LabelList *join_labels(LabelList *a, LabelList *b)
+{
+	LabelList *l;
+
+	if (a == NULL) {
+		return b;
+	}
+	for (l = a; l->next; l = l->next)
+		;
+	l->next = b;
+
+	return a;
+}
+
+static void place_labels(AlanCompiler *ac, LabelList *list)
+{
+	for (; list; list = list->next) {
+		gen_label(ac, list->label);
+	}
 }
 
 /* --- helper routines
@@ -832,10 +1132,9 @@ void parse_factor(ValType *type)
 
 #define MAX_MESSAGE_LENGTH 256
 
-void check_types(ValType found, ValType expected, SourcePos *pos, ...)
+void check_types(AlanCompiler *ac, ValType found, ValType expected,
+				 SourcePos *pos, ...)
 {
-	// disabled errors
-	exit(0);
 	char buf[MAX_MESSAGE_LENGTH], *s;
 	va_list ap;
 
@@ -846,51 +1145,69 @@ void check_types(ValType found, ValType expected, SourcePos *pos, ...)
 		vsnprintf(buf, MAX_MESSAGE_LENGTH, s, ap);
 		va_end(ap);
 		if (pos != NULL) {
-			position = *pos;
+			ac->position = *pos;
 		}
-		leprintf("incompatible types (expected %s, found %s) %s",
+		leprintf(ac, "incompatible types (expected %s, found %s) %s",
 				 get_valtype_string(expected), get_valtype_string(found), buf);
 	}
 }
 
-void expect(TokenType type)
+void expect(AlanCompiler *ac, TokenType type)
 {
-	if (token.type == type) {
-		get_token(&token);
+	if (ac->token.type == type) {
+		get_token(ac, &ac->token);
 	} else {
-		abort_compile(ERR_EXPECT, type);
+		abort_compile(ac, ERR_EXPECT, type);
 	}
 }
 
-void expect_id(char **id)
+void expect_id(AlanCompiler *ac, const char **id)
 {
-	if (token.type == TOKEN_ID) {
-		*id = strdup(token.lexeme);
-		get_token(&token);
+	if (ac->token.type == TOKEN_ID) {
+		*id = ac->token.id;
+		get_token(ac, &ac->token);
 	} else {
-		abort_compile(ERR_EXPECT, TOKEN_ID);
+		abort_compile(ac, ERR_EXPECT, TOKEN_ID);
+	}
+}
+
+void expect_known_id(AlanCompiler *ac, const char **id, IDprop **prop)
+{
+	SourcePos pos = ac->position;
+
+	expect_id(ac, id);
+	if (!find_name(ac, *id, prop)) {
+		abort_compile_pos(ac, &pos, ERR_UNKNOWN_IDENTIFIER, *id);
 	}
 }
 
-IDprop *idprop(ValType type, unsigned int offset, unsigned int nparams,
-			   ValType *params)
+IDprop *idprop(AlanCompiler *ac, ValType type, unsigned int offset,
+			   unsigned int nparams, ValType *params)
 {
 	IDprop *ip;
 
-	ip = emalloc(sizeof(IDprop));
+	/* the properties last as long as the scope in which they are made, and so
+	 * does the copy of the parameter types */
+	ip = arena_alloc(ac->scope, sizeof(IDprop));
 	ip->type = type;
+	ip->scope = 0;
 	ip->offset = offset;
 	ip->nparams = nparams;
-	ip->params = params;
+	ip->params = NULL;
+	if (params) {
+		ip->params = arena_alloc(ac->scope, nparams * sizeof(ValType));
+		memcpy(ip->params, params, nparams * sizeof(ValType));
+	}
 
 	return ip;
 }
 //
-Variable *variable(char *id, ValType type, SourcePos pos)
+Variable *variable(AlanCompiler *ac, const char *id, ValType type,
+				   SourcePos pos)
 {
 	Variable *vp;
 
-	vp = emalloc(sizeof(Variable));
+	vp = arena_alloc(ac->arena, sizeof(Variable));
 	vp->id = id;
 	vp->type = type;
 	vp->pos = pos;
@@ -902,45 +1219,37 @@ Variable *variable(char *id, ValType type, SourcePos pos)
 /* --- error handling routine
  * ----------------------------------------------- */
 
-void _abort_compile(SourcePos *posp, Error err, va_list args);
+void _abort_compile(AlanCompiler *ac, SourcePos *posp, Error err, va_list args);
 
-void abort_compile(Error err, ...)
+void abort_compile(AlanCompiler *ac, Error err, ...)
 {
-	exit(0);
 	va_list args;
 
 	va_start(args, err);
-	_abort_compile(NULL, err, args);
+	_abort_compile(ac, NULL, err, args);
 	va_end(args);
-
-	// disabled errors
-	// exit(0);
 }
 
-void abort_compile_pos(SourcePos *posp, Error err, ...)
+void abort_compile_pos(AlanCompiler *ac, SourcePos *posp, Error err, ...)
 {
-	// disabled errors
-	exit(0);
 	va_list args;
 
 	va_start(args, err);
-	_abort_compile(posp, err, args);
+	_abort_compile(ac, posp, err, args);
 	va_end(args);
 }
 
-void _abort_compile(SourcePos *posp, Error err, va_list args)
+void _abort_compile(AlanCompiler *ac, SourcePos *posp, Error err, va_list args)
 {
-	// disabled errors
-	exit(0);
 	char expstr[MAX_MESSAGE_LENGTH], *s;
 	int t;
 
 	if (posp) {
-		position = *posp;
+		ac->position = *posp;
 	}
 
 	snprintf(expstr, MAX_MESSAGE_LENGTH, "expected %%s, but found %s",
-			 get_token_string(token.type));
+			 get_token_string(ac->token.type));
 
 	switch (err) {
 		case ERR_ILLEGAL_ARRAY_OPERATION:
@@ -963,36 +1272,40 @@ void _abort_compile(SourcePos *posp, Error err, va_list args)
 	switch (err) {
 		case ERR_EXPECT:
 			t = va_arg(args, int);
-			leprintf(expstr, get_token_string(t));
+			leprintf(ac, expstr, get_token_string(t));
 			break;
 
 		case ERR_FACTOR_EXPECTED:
-			leprintf(expstr, "factor");
+			leprintf(ac, expstr, "factor");
 			break;
 
 		case ERR_UNREACHABLE:
-			leprintf("unreachable: %s", s);
+			leprintf(ac, "unreachable: %s", s);
 			break;
 
 		case ERR_TYPE_EXPECTED:
-			leprintf(expstr, "type");
+			leprintf(ac, expstr, "type");
 			break;
 
 		case ERR_STATEMENT_EXPECTED:
-			leprintf(expstr, "statement");
+			leprintf(ac, expstr, "statement");
 			break;
 
 		case ERR_ARRAY_ALLOCATION_OR_EXPRESSION_EXPECTED:
-			leprintf(expstr, "array allocation or expression");
+			leprintf(ac, expstr, "array allocation or expression");
 			break;
 
 		case ERR_EXPRESSION_OR_STRING_EXPECTED:
-			leprintf(expstr, "expression or string");
+			leprintf(ac, expstr, "expression or string");
+			break;
+
+		case ERR_UNKNOWN_IDENTIFIER:
+			leprintf(ac, "unknown identifier '%s'", s);
 			break;
 
 		default:
 			s = va_arg(args, char *);
-			leprintf("unreachable: %s", s);
+			leprintf(ac, "unreachable: %s", s);
 			break;
 	}
 }
@@ -1004,27 +1317,27 @@ void _abort_compile(SourcePos *posp, Error err, va_list args)
 
 static int indent = 0;
 
-void debug_start(const char *fmt, ...)
+void debug_start(AlanCompiler *ac, const char *fmt, ...)
 {
 	va_list ap;
 
 	va_start(ap, fmt);
-	debug_info(fmt, ap);
+	debug_info(ac, fmt, ap);
 	va_end(ap);
 	indent += 2;
 }
 
-void debug_end(const char *fmt, ...)
+void debug_end(AlanCompiler *ac, const char *fmt, ...)
 {
 	va_list ap;
 
 	indent -= 2;
 	va_start(ap, fmt);
-	debug_info(fmt, ap);
+	debug_info(ac, fmt, ap);
 	va_end(ap);
 }
 
-void debug_info(const char *fmt, ...)
+void debug_info(AlanCompiler *ac, const char *fmt, ...)
 {
 	int i;
 	char buf[MAX_MESSAGE_LENGTH], *buf_ptr;
@@ -1040,7 +1353,8 @@ void debug_info(const char *fmt, ...)
 	vsprintf(buf_ptr, fmt, ap);
 
 	buf_ptr += strlen(buf_ptr);
-	snprintf(buf_ptr, MAX_MESSAGE_LENGTH, " in line %d.\n", position.line);
+	alan_locate(ac, &ac->position);
+	snprintf(buf_ptr, MAX_MESSAGE_LENGTH, " in line %d.\n", ac->position.line);
 	fflush(stdout);
 	fputs(buf, stdout);
 	fflush(NULL);
@@ -0,0 +1,343 @@
+/**
+ * @file    alloc.c
+ * @brief   Local variable slot allocation over the IR of function bodies.
+ * @date    2026-10-14
+ */
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "alloc.h"
+#include "boolean.h"
+#include "error.h"
+#include "ir.h"
+
+/* --- type definitions and constants --------------------------------------- */
+
+/** a set of local variables, as a bit vector */
+typedef unsigned long Word;
+
+#define WORD_BITS         (sizeof(Word) * CHAR_BIT)
+#define SET_WORDS(n)      (((n) + WORD_BITS - 1) / WORD_BITS)
+#define HAS(set, v)       (((set)[(v) / WORD_BITS] >> ((v) % WORD_BITS)) & 1UL)
+#define ADD(set, v)       ((set)[(v) / WORD_BITS] |= 1UL << ((v) % WORD_BITS))
+#define REMOVE(set, v)    ((set)[(v) / WORD_BITS] &= ~(1UL << ((v) % WORD_BITS)))
+
+#define LOADS(op)         ((op) == JVM_ILOAD || (op) == JVM_ALOAD              \
+                           || (op) == JVM_IINC)
+#define STORES(op)        ((op) == JVM_ISTORE || (op) == JVM_ASTORE            \
+                           || (op) == JVM_IINC)
+
+/** the deepest loop nesting that raises the weight of an access */
+#define MAX_LOOP_WEIGHT   6
+
+/** a local variable, as it is ordered for allocation */
+typedef struct {
+	int           slot;     /**< the slot that the symbol table gave it     */
+	unsigned long weight;   /**< the accesses, weighed by loop nesting      */
+} Variable;
+
+/** the liveness of the local variables of a function */
+typedef struct {
+	int       nvars;        /**< the number of symbol-table slots           */
+	size_t    nwords;       /**< the words of one set                       */
+	Word     *use;          /**< per block, the variables loaded before
+	                             they are stored                            */
+	Word     *def;          /**< per block, the variables stored            */
+	Word     *in;           /**< per block, the variables live on entry     */
+	Word     *out;          /**< per block, the variables live on exit      */
+	Word     *conflicts;    /**< per variable, those that it interferes with */
+} Liveness;
+
+/* --- function prototypes -------------------------------------------------- */
+
+static void find_live_sets(IRfunc *fn, IRblock **blocks, Liveness *lv);
+static void find_conflicts(IRfunc *fn, IRblock **blocks, unsigned int nparams,
+		Liveness *lv);
+static void conflict(Liveness *lv, int a, int b);
+static void weigh(IRfunc *fn, IRblock **blocks, Variable *vars);
+static int by_weight(const void *a, const void *b);
+
+/* --- allocation interface ------------------------------------------------- */
+
+int allocate_slots(IRfunc *fn, unsigned int nparams, AllocStats *stats)
+{
+	IRblock *bb, **blocks;
+	IRinsn *i;
+	Liveness lv;
+	Variable *vars;
+	Word *taken;
+	int *slots, nvars, ncandidates, n, v, w, width;
+
+	ir_build_cfg(fn);
+
+	nvars = (int) nparams;
+	for (bb = fn->first; bb; bb = bb->next) {
+		for (i = bb->first; i; i = i->next) {
+			if ((LOADS(i->op) || STORES(i->op)) && i->num >= nvars) {
+				nvars = i->num + 1;
+			}
+		}
+	}
+	if (nvars == 0) {
+		return 0;
+	}
+
+	blocks = emalloc((fn->nblocks + 1) * sizeof(IRblock *));
+	for (bb = fn->first; bb; bb = bb->next) {
+		blocks[bb->id] = bb;
+	}
+
+	lv.nvars = nvars;
+	lv.nwords = SET_WORDS((size_t) nvars);
+	find_live_sets(fn, blocks, &lv);
+	find_conflicts(fn, blocks, nparams, &lv);
+
+	vars = emalloc(nvars * sizeof(Variable));
+	for (v = 0; v < nvars; v++) {
+		vars[v].slot = v;
+		vars[v].weight = 0;
+	}
+	weigh(fn, blocks, vars);
+
+	/* the parameters stay where they are passed; the others are given the
+	 * lowest slot that no variable they interfere with holds, the heaviest
+	 * first */
+	slots = emalloc(nvars * sizeof(int));
+	for (v = 0; v < nvars; v++) {
+		slots[v] = (v < (int) nparams ? v : -1);
+	}
+	qsort(vars + nparams, nvars - nparams, sizeof(Variable), by_weight);
+	taken = emalloc(lv.nwords * sizeof(Word));
+	ncandidates = nvars;
+	for (n = nparams; n < nvars; n++) {
+		v = vars[n].slot;
+		if (vars[n].weight == 0) {
+			ncandidates--;
+			continue;
+		}
+		memset(taken, 0, lv.nwords * sizeof(Word));
+		for (w = 0; w < nvars; w++) {
+			if (slots[w] >= 0 && HAS(&lv.conflicts[v * lv.nwords], w)) {
+				ADD(taken, slots[w]);
+			}
+		}
+		for (slots[v] = 0; HAS(taken, slots[v]); slots[v]++)
+			;
+	}
+
+	width = (int) nparams;
+	for (v = 0; v < nvars; v++) {
+		if (slots[v] >= width) {
+			width = slots[v] + 1;
+		}
+	}
+	for (bb = fn->first; bb; bb = bb->next) {
+		for (i = bb->first; i; i = i->next) {
+			if (LOADS(i->op) || STORES(i->op)) {
+				i->num = slots[i->num];
+			}
+		}
+	}
+
+	stats->variables += ncandidates;
+	stats->slots += width;
+
+	free(taken);
+	free(slots);
+	free(vars);
+	free(lv.use);
+	free(lv.def);
+	free(lv.in);
+	free(lv.out);
+	free(lv.conflicts);
+	free(blocks);
+
+	return width;
+}
+
+void print_alloc_stats(FILE *file, const char *prefix,
+		const AllocStats *stats)
+{
+	if (stats->variables > 0) {
+		fprintf(file, "%salloc: %lu local variables in %lu slots\n", prefix,
+				stats->variables, stats->slots);
+	}
+}
+
+/* --- utility functions ---------------------------------------------------- */
+
+/* Finds the variables that are live on entry to and exit from every block, by
+ * the usual backward iteration until nothing changes.  Visiting the blocks in
+ * reverse layout order makes most of the information flow in one pass.
+ */
+
+static void find_live_sets(IRfunc *fn, IRblock **blocks, Liveness *lv)
+{
+	IRblock *bb;
+	IRinsn *i;
+	Word *use, *def, *in, *out, *succ, w;
+	size_t k, size;
+	int n, s;
+	Boolean changed;
+
+	size = fn->nblocks * lv->nwords;
+	lv->use = emalloc((size + 1) * sizeof(Word));
+	lv->def = emalloc((size + 1) * sizeof(Word));
+	lv->in = emalloc((size + 1) * sizeof(Word));
+	lv->out = emalloc((size + 1) * sizeof(Word));
+	memset(lv->use, 0, size * sizeof(Word));
+	memset(lv->def, 0, size * sizeof(Word));
+	memset(lv->in, 0, size * sizeof(Word));
+	memset(lv->out, 0, size * sizeof(Word));
+
+	for (bb = fn->first; bb; bb = bb->next) {
+		use = &lv->use[bb->id * lv->nwords];
+		def = &lv->def[bb->id * lv->nwords];
+		for (i = bb->first; i; i = i->next) {
+			if (LOADS(i->op) && !HAS(def, i->num)) {
+				ADD(use, i->num);
+			}
+			if (STORES(i->op)) {
+				ADD(def, i->num);
+			}
+		}
+	}
+
+	do {
+		changed = FALSE;
+		for (n = (int) fn->nblocks - 1; n >= 0; n--) {
+			bb = blocks[n];
+			use = &lv->use[n * lv->nwords];
+			def = &lv->def[n * lv->nwords];
+			in = &lv->in[n * lv->nwords];
+			out = &lv->out[n * lv->nwords];
+			for (s = 0; s < 2; s++) {
+				if (bb->succ[s]) {
+					succ = &lv->in[bb->succ[s]->id * lv->nwords];
+					for (k = 0; k < lv->nwords; k++) {
+						out[k] |= succ[k];
+					}
+				}
+			}
+			for (k = 0; k < lv->nwords; k++) {
+				w = use[k] | (out[k] & ~def[k]);
+				if (w != in[k]) {
+					in[k] = w;
+					changed = TRUE;
+				}
+			}
+		}
+	} while (changed);
+}
+
+/* Finds the pairs of variables that may not share a slot: a variable that is
+ * stored interferes with every other variable that is live after the store.
+ * On entry, the parameters, and any variable that may be loaded before it is
+ * stored, are all live at once.
+ */
+
+static void find_conflicts(IRfunc *fn, IRblock **blocks, unsigned int nparams,
+		Liveness *lv)
+{
+	IRblock *bb;
+	IRinsn *i;
+	Word *live;
+	size_t size;
+	int n, v, w;
+
+	size = (size_t) lv->nvars * lv->nwords;
+	lv->conflicts = emalloc((size + 1) * sizeof(Word));
+	memset(lv->conflicts, 0, size * sizeof(Word));
+	live = emalloc(lv->nwords * sizeof(Word));
+
+	for (n = 0; n < (int) fn->nblocks; n++) {
+		bb = blocks[n];
+		memcpy(live, &lv->out[n * lv->nwords], lv->nwords * sizeof(Word));
+		for (i = bb->last; i; i = i->prev) {
+			if (STORES(i->op)) {
+				for (w = 0; w < lv->nvars; w++) {
+					if (w != i->num && HAS(live, w)) {
+						conflict(lv, i->num, w);
+					}
+				}
+				REMOVE(live, i->num);
+			}
+			if (LOADS(i->op)) {
+				ADD(live, i->num);
+			}
+		}
+	}
+
+	memcpy(live, lv->in, lv->nwords * sizeof(Word));
+	for (v = 0; v < (int) nparams; v++) {
+		ADD(live, v);
+	}
+	for (v = 0; v < lv->nvars; v++) {
+		for (w = v + 1; w < lv->nvars && HAS(live, v); w++) {
+			if (HAS(live, w)) {
+				conflict(lv, v, w);
+			}
+		}
+	}
+
+	free(live);
+}
+
+static void conflict(Liveness *lv, int a, int b)
+{
+	ADD(&lv->conflicts[a * lv->nwords], b);
+	ADD(&lv->conflicts[b * lv->nwords], a);
+}
+
+/* Counts the accesses of every variable.  A branch back to an earlier block
+ * closes a loop over the blocks in between, and every level of loop nesting
+ * makes an access count eight times as much.
+ */
+
+static void weigh(IRfunc *fn, IRblock **blocks, Variable *vars)
+{
+	IRblock *bb, *target;
+	IRinsn *i;
+	unsigned int *depth, k;
+	int s;
+
+	depth = emalloc((fn->nblocks + 1) * sizeof(unsigned int));
+	memset(depth, 0, fn->nblocks * sizeof(unsigned int));
+	for (bb = fn->first; bb; bb = bb->next) {
+		for (s = 0; s < 2; s++) {
+			target = bb->succ[s];
+			if (target && target->id <= bb->id) {
+				for (k = target->id; k <= bb->id; k++) {
+					depth[k]++;
+				}
+			}
+		}
+	}
+
+	for (k = 0; k < fn->nblocks; k++) {
+		if (depth[k] > MAX_LOOP_WEIGHT) {
+			depth[k] = MAX_LOOP_WEIGHT;
+		}
+		for (i = blocks[k]->first; i; i = i->next) {
+			if (LOADS(i->op) || STORES(i->op)) {
+				vars[i->num].weight += 1UL << (3 * depth[k]);
+			}
+		}
+	}
+
+	free(depth);
+}
+
+/* Orders variables by decreasing weight, and otherwise by their slot. */
+
+static int by_weight(const void *a, const void *b)
+{
+	const Variable *x = a, *y = b;
+
+	if (x->weight != y->weight) {
+		return (x->weight > y->weight ? -1 : 1);
+	}
+	return x->slot - y->slot;
+}
@@ -0,0 +1,56 @@
+/**
+ * @file    alloc.h
+ * @brief   Local variable slot allocation over the IR of function bodies.
+ *
+ * The symbol table gives every variable of a subroutine a slot of its own.
+ * After the other passes, a liveness analysis finds where each variable holds
+ * a value that is still to be loaded, and variables of which the live ranges
+ * do not overlap are made to share a slot.  The variables that are accessed
+ * most often, with accesses inside loops weighed more heavily, are given the
+ * lowest slots, so that the short forms of the loads and stores apply to them.
+ * The parameters keep the slots in which they are passed.  This is run at
+ * optimisation level 1 and above.
+ *
+ * @date    2026-10-14
+ */
+
+#ifndef ALLOC_H
+#define ALLOC_H
+
+#include <stdio.h>
+#include "ir.h"
+
+/** what slot allocation did */
+typedef struct {
+	unsigned long variables;  /**< the local variables, with the parameters */
+	unsigned long slots;      /**< the slots that they were given          */
+} AllocStats;
+
+/**
+ * Allocates the local variable slots of a function, and renumbers the loads
+ * and stores of the IR accordingly.
+ *
+ * @param[in]   fn
+ *     the IR of the function
+ * @param[in]   nparams
+ *     the number of local variable slots that are set on entry
+ * @param[in,out]   stats
+ *     the statistics, to which the variables and slots are added
+ * @return      the number of local variable slots that the function needs
+ */
+int allocate_slots(IRfunc *fn, unsigned int nparams, AllocStats *stats);
+
+/**
+ * Writes what slot allocation did, on one line.
+ *
+ * @param[in]   file
+ *     the output file
+ * @param[in]   prefix
+ *     the text that starts the line
+ * @param[in]   stats
+ *     the statistics
+ */
+void print_alloc_stats(FILE *file, const char *prefix,
+		const AllocStats *stats);
+
+#endif /* ALLOC_H */
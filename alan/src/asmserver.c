@@ -0,0 +1,160 @@
+/**
+ * @file    asmserver.c
+ * @brief   A persistent Jasmin assembler process.
+ * @date    2026-10-14
+ */
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "asmserver.h"
+#include "error.h"
+
+/* --- type definitions and constants --------------------------------------- */
+
+#define MAX_REPLY_LINE 64
+
+struct asmserver {
+	pid_t            pid;      /**< the process identifier of the JVM     */
+	FILE            *jobs;     /**< the stream on which jobs are sent     */
+	FILE            *replies;  /**< the stream from which replies are read */
+	pthread_mutex_t  lock;     /**< serialises the jobs of many threads   */
+};
+
+/* --- function prototypes -------------------------------------------------- */
+
+static int exchange(AsmServer *s, const char *jasm_name,
+		const unsigned char *text, size_t len, FILE *diag);
+
+/* --- assembler server interface ------------------------------------------- */
+
+AsmServer *asm_server_start(const char *jasmin_path, const char *shim_dir)
+{
+	AsmServer *s;
+	int to_server[2], from_server[2];
+	char *classpath;
+
+	if (pipe(to_server) < 0 || pipe(from_server) < 0) {
+		eprintf("Could not create pipes for the assembler server:");
+	}
+
+	classpath = emalloc(strlen(jasmin_path) + strlen(shim_dir) + 2);
+	sprintf(classpath, "%s:%s", jasmin_path, shim_dir);
+
+	s = emalloc(sizeof(AsmServer));
+	if ((s->pid = fork()) < 0) {
+		eprintf("Could not fork a new process for the assembler server");
+	} else if (s->pid == 0) {
+		if (dup2(to_server[0], STDIN_FILENO) < 0
+				|| dup2(from_server[1], STDOUT_FILENO) < 0) {
+			eprintf("Could not redirect the assembler server streams:");
+		}
+		close(to_server[0]);
+		close(to_server[1]);
+		close(from_server[0]);
+		close(from_server[1]);
+		execlp("java", "java", "-cp", classpath, ASM_SERVER_CLASS,
+				(char *) NULL);
+		eprintf("Could not exec the assembler server");
+	}
+
+	free(classpath);
+	close(to_server[0]);
+	close(from_server[1]);
+	if ((s->jobs = fdopen(to_server[1], "w")) == NULL
+			|| (s->replies = fdopen(from_server[0], "r")) == NULL) {
+		eprintf("Could not open the assembler server streams:");
+	}
+
+	/* a server that dies is reported as a failed job, not by a signal */
+	signal(SIGPIPE, SIG_IGN);
+	pthread_mutex_init(&s->lock, NULL);
+
+	return s;
+}
+
+int asm_server_assemble(AsmServer *s, const char *jasm_name,
+		const unsigned char *text, size_t len, FILE *diag)
+{
+	int status;
+
+	/* the shim assembles one job at a time, so jobs are not interleaved */
+	pthread_mutex_lock(&s->lock);
+	status = exchange(s, jasm_name, text, len, diag);
+	pthread_mutex_unlock(&s->lock);
+
+	return status;
+}
+
+void asm_server_stop(AsmServer *s)
+{
+	int status;
+
+	/* the shim exits when it reads end-of-file */
+	fclose(s->jobs);
+	fclose(s->replies);
+	if (waitpid(s->pid, &status, 0) < 0) {
+		weprintf("Error waiting for the assembler server");
+	}
+	pthread_mutex_destroy(&s->lock);
+	free(s);
+}
+
+/* --- utility functions ---------------------------------------------------- */
+
+/**
+ * Sends one job to the assembler server, and waits for its reply.
+ *
+ * @param[in]   s
+ *     the assembler server
+ * @param[in]   jasm_name
+ *     the name by which Jasmin reports the text
+ * @param[in]   text
+ *     the Jasmin text
+ * @param[in]   len
+ *     the length of the text in bytes
+ * @param[in]   diag
+ *     the stream to which the diagnostics reported by Jasmin are copied
+ * @return      <code>0</code> if the text was assembled successfully, or
+ *              <code>-1</code> otherwise
+ */
+static int exchange(AsmServer *s, const char *jasm_name,
+		const unsigned char *text, size_t len, FILE *diag)
+{
+	char line[MAX_REPLY_LINE], *reply;
+	int status;
+	unsigned long rlen;
+
+	if (fprintf(s->jobs, "%s %lu\n", jasm_name, (unsigned long) len) < 0
+			|| fwrite(text, 1, len, s->jobs) != len
+			|| fflush(s->jobs) == EOF) {
+		weprintf("Could not send '%s' to the assembler server:", jasm_name);
+		return -1;
+	}
+
+	if (fgets(line, sizeof(line), s->replies) == NULL
+			|| sscanf(line, "%d %lu", &status, &rlen) != 2) {
+		weprintf("The assembler server did not reply to '%s'", jasm_name);
+		return -1;
+	}
+
+	if (rlen > 0) {
+		reply = emalloc(rlen);
+		if (fread(reply, 1, rlen, s->replies) != rlen) {
+			free(reply);
+			weprintf("The assembler server reply for '%s' was cut short",
+					jasm_name);
+			return -1;
+		}
+		fwrite(reply, 1, rlen, diag);
+		free(reply);
+	}
+
+	return (status == 0 ? 0 : -1);
+}
+
@@ -0,0 +1,67 @@
+/**
+ * @file    asmserver.h
+ * @brief   A persistent Jasmin assembler process.
+ *
+ * Rather than starting a new Java virtual machine for every class, the
+ * assembler server keeps one JVM alive, running the small
+ * <code>JasminServer</code> shim, and sends it one job per class over a pipe.
+ * The shim reads a line with the name of a job and the length of its Jasmin
+ * text, followed by the text itself, assembles it into the current directory,
+ * and replies with a line containing a status (<code>0</code> for success) and
+ * the length of the diagnostic text that follows the line.
+ *
+ * @date    2026-10-14
+ */
+
+#ifndef ASMSERVER_H
+#define ASMSERVER_H
+
+#include <stdio.h>
+
+/** the class name of the Java shim, as built by the Makefile */
+#define ASM_SERVER_CLASS "JasminServer"
+
+/** the container structure for a running assembler process */
+typedef struct asmserver AsmServer;
+
+/**
+ * Starts an assembler process.
+ *
+ * @param[in]   jasmin_path
+ *     the path to the Jasmin JAR file
+ * @param[in]   shim_dir
+ *     the directory that contains the compiled shim class
+ * @return      a pointer to the assembler server container structure
+ */
+AsmServer *asm_server_start(const char *jasmin_path, const char *shim_dir);
+
+/**
+ * Assembles Jasmin text in the server process.  Diagnostics reported by
+ * Jasmin are copied to the specified stream.  The server may be shared by
+ * several threads, whose jobs are then assembled one after the other.
+ *
+ * @param[in]   s
+ *     the assembler server
+ * @param[in]   jasm_name
+ *     the name by which Jasmin reports the text, which has no spaces
+ * @param[in]   text
+ *     the Jasmin text
+ * @param[in]   len
+ *     the length of the text in bytes
+ * @param[in]   diag
+ *     the stream to which the diagnostics are copied
+ * @return      <code>0</code> if the text was assembled successfully, or
+ *              <code>-1</code> otherwise
+ */
+int asm_server_assemble(AsmServer *s, const char *jasm_name,
+		const unsigned char *text, size_t len, FILE *diag);
+
+/**
+ * Stops an assembler process, and releases its resources.
+ *
+ * @param[in]   s
+ *     the assembler server
+ */
+void asm_server_stop(AsmServer *s);
+
+#endif /* ASMSERVER_H */
@@ -0,0 +1,157 @@
+#!/bin/sh
+#
+# Benchmark for ALAN-2022: "make bench" runs this script.
+#
+# The corpus is generated into <benchdir>/corpus by genbench.  alanc then
+# compiles every source <runs> times with --stats, and the scanner and hash
+# table drivers run their benchmarks over the same sources.  The results go to
+# <benchdir>/results.txt, one "<metric> <value>" per line.  If
+# <benchdir>/baseline.txt exists, the results are compared with it, and a
+# metric that is worse by more than $BENCH_TOLERANCE percent (10 by default) is
+# marked.  The metrics that end in _per_sec are better when they are higher;
+# all others are better when they are lower.  "make bench-baseline" keeps the
+# last results as the baseline.
+#
+# Tokens per second are measured over the scan phase only.  Lookups per second
+# are measured over the parse phase, in which the lookups happen.  The compiler
+# is run with --pretokenize, so that scanning is timed in one piece.
+#
+
+usage="usage: sh bench.sh <bindir> <benchdir> [<runs>]"
+[ $# -ge 2 ] || { echo "$usage" >&2; exit 2; }
+
+bindir=$(cd "$1" && pwd) || exit 2
+benchdir=$2
+runs=${3:-5}
+flags=${BENCH_FLAGS:--O2}
+tolerance=${BENCH_TOLERANCE:-10}
+
+# the corpus: a file name, and the shape and size that genbench makes it with
+corpus="functions functions 1000
+body body 1000
+nesting nesting 200
+names names 20000
+strings strings 1000
+mixed mixed 10"
+
+mkdir -p "$benchdir/corpus" || exit 1
+cd "$benchdir" || exit 1
+results=results.txt
+stats=corpus/stats.jsonl
+: > "$stats"
+
+# --- generate and compile the corpus ------------------------------------------
+
+echo "$corpus" | while read -r name shape size; do
+	class=$(echo "$name" | awk '{ print toupper(substr($0, 1, 1)) \
+		substr($0, 2) }')
+	"$bindir/genbench" -c "$class" "$shape" "$size" > "corpus/$name.alan" \
+		|| exit 1
+done || exit 1
+
+for src in corpus/*.alan; do
+	i=0
+	while [ $i -lt "$runs" ]; do
+		(cd corpus && "$bindir/alanc" $flags --pretokenize --stats \
+			"$(basename "$src")" 2>> "$(basename "$stats")" > /dev/null) || {
+			echo "bench: $src did not compile" >&2
+			exit 1
+		}
+		i=$((i + 1))
+	done
+done
+
+# --- summarise the statistics -------------------------------------------------
+
+# the numbers in a line of JSON, by the name of their member, or by the names
+# of an object and of its member
+awk '
+function field(line, key) {
+	return substr(line, index(line, "\"" key "\": ") + length(key) + 4) + 0
+}
+function member(line, outer, key) {
+	return field(substr(line, index(line, "\"" outer "\": {")), key)
+}
+{
+	src = $0
+	sub(/^\{"source": "/, "", src)
+	sub(/\.alan".*/, "", src)
+	tokens += field($0, "tokens")
+	scan_us += member($0, "scan", "wall_us")
+	lookups += field($0, "lookups")
+	parse_us += member($0, "parse", "wall_us")
+	rss = member($0, "memory", "max_rss_kb")
+	if (rss > max_rss)
+		max_rss = rss
+	print src, member($0, "total", "wall_us") > "corpus/latency.txt"
+}
+END {
+	printf "tokens_per_sec %d\n", (scan_us ? tokens * 1e6 / scan_us : 0)
+	printf "lookups_per_sec %d\n", (parse_us ? lookups * 1e6 / parse_us : 0)
+	printf "peak_rss_kb %d\n", max_rss
+}' "$stats" > "$results"
+
+# the percentiles of the latencies of all compilations, and of each source, by
+# the nearest rank
+percentiles='function rank(p,   r) {
+	r = int(p * NR)
+	return (r < p * NR ? r + 1 : (r < 1 ? 1 : r))
+}
+{ v[NR] = $1 }
+END {
+	printf "%slatency_p50_us %d\n", prefix, v[rank(0.50)]
+	printf "%slatency_p90_us %d\n", prefix, v[rank(0.90)]
+	printf "%slatency_p99_us %d\n", prefix, v[rank(0.99)]
+}'
+awk '{ print $2 }' corpus/latency.txt | sort -n \
+	| awk -v prefix= "$percentiles" >> "$results"
+echo "$corpus" | while read -r name shape size; do
+	awk -v name="$name" '$1 == name { print $2 }' corpus/latency.txt | sort -n \
+		| awk -v prefix="$name." "$percentiles"
+done >> "$results"
+
+# --- the unit drivers ---------------------------------------------------------
+
+for src in corpus/*.alan; do
+	name=$(basename "$src" .alan)
+	"$bindir/testscanner" -b "$src" \
+		| awk -v name="$name" '/^scanner:/ {
+			printf "%s.scan_mtokens_per_sec %.1f\n", name, $4 }'
+done >> "$results"
+"$bindir/testhashtable" -b corpus/*.alan \
+	| awk '$1 ~ /^(fnv1a|words|shift)$/ {
+		printf "hash.%s.ns_per_hash %.1f\nhash.%s.ns_per_op %.1f\n",
+			$1, $2, $1, $3 }' >> "$results"
+
+# --- compare with the baseline ------------------------------------------------
+
+if [ ! -f baseline.txt ]; then
+	cat "$results"
+	echo "bench: no baseline; \"make bench-baseline\" keeps these results"
+	exit 0
+fi
+
+awk -v tolerance="$tolerance" '
+NR == FNR { base[$1] = $2; next }
+{
+	mark = ""
+	if (($1 in base) && base[$1] != 0) {
+		change = ($2 - base[$1]) * 100 / base[$1]
+		if ($1 ~ /_per_sec$/)
+			change = -change
+		if (change > tolerance) {
+			mark = "  worse"
+			worse++
+		} else if (change < -tolerance) {
+			mark = "  better"
+		}
+		printf "%-34s %12s %12s %+7.1f%%%s\n", $1, base[$1], $2,
+			($2 - base[$1]) * 100 / base[$1], mark
+	} else {
+		printf "%-34s %12s %12s\n", $1, "-", $2
+	}
+}
+END {
+	printf "bench: %d metrics worse than the baseline by more than %s%%\n",
+		worse, tolerance
+}' baseline.txt "$results"
@@ -0,0 +1,70 @@
+/**
+ * @file    bytecode.h
+ * @brief   The in-memory representation of generated code for ALAN-2022.
+ *
+ * The code generator records every function or procedure as a body: a flat
+ * array of labels, instructions, and operands, lowered from the intermediate
+ * representation in ir.h.  The definitions are shared by
+ * the code generator and the passes that analyse or rewrite the bodies before
+ * they are written out.
+ *
+ * @date    2026-10-14
+ */
+
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#include "jvm.h"
+#include "symboltable.h"
+
+typedef unsigned int Label;
+
+/** whether an instruction transfers control to a label */
+#define IS_BRANCH(op)                                                          \
+	((op) == JVM_GOTO || ((op) >= JVM_IFEQ && (op) <= JVM_IF_ICMPNE))
+
+/** whether control never falls through an instruction */
+#define IS_TERMINAL(op)                                                        \
+	((op) == JVM_GOTO || (op) == JVM_RETURN || (op) == JVM_IRETURN ||          \
+	 (op) == JVM_ARETURN)
+
+typedef enum {
+	CODE_LABEL = 0x0001,
+	CODE_INSTRUCTION = 0x0002,
+	CODE_OPERAND = 0x0004,
+	MASK_TYPE = 0x000f,
+	CODE_INTEGER = 0x0010,
+	CODE_ARRAY_TYPE = 0x0020,
+	CODE_STRING = 0x0040,
+	CODE_REFERENCE = 0x0080,
+	MASK_DATA_TYPE = 0x00f0
+} CodeType;
+
+typedef struct {
+	CodeType type;
+	union {
+		JVMatype atype;
+		Bytecode code;
+		Label label;
+		int num;
+		char *string;
+	};
+} Code;
+
+typedef struct body_s Body;
+struct body_s {
+	const char *name;
+	char *ref;
+	IDprop *idprop;
+	Code *code;
+	int *lines;
+	int ip;
+	int max_stack_depth;
+	int variables_width;
+	struct flow_s *flow;
+	struct ir_func *ir;
+	Body *next;
+	Body *prev;
+};
+
+#endif /* BYTECODE_H */
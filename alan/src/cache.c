@@ -0,0 +1,576 @@
+/**
+ * @file    cache.c
+ * @brief   A content-addressed cache of compiled ALAN-2022 sources.
+ * @date    2026-10-14
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+#include "boolean.h"
+#include "cache.h"
+#include "compiler.h"
+#include "error.h"
+
+/* --- type definitions and constants --------------------------------------- */
+
+/* the flags with which the compiler was built, as set by the Makefile */
+#ifndef ALAN_BUILD_FLAGS
+#define ALAN_BUILD_FLAGS ""
+#endif
+
+#define ENTRY_MAGIC    "ALANCACHE 1\n"
+#define ENTRY_EXT      ".alc"
+#define TEMP_PREFIX    "tmp."
+#define MAX_ENTRY_LINE 512
+
+/* the age, in seconds, after which a temporary file was left by a compile that
+ * did not finish, and may be removed */
+#define TEMP_MAX_AGE   3600
+
+/* the fraction of the limit down to which an outgrown cache is trimmed */
+#define TRIM_NUM       9
+#define TRIM_DEN       10
+
+struct alan_cache {
+	char            *dir;    /**< the path to the cache directory        */
+	mode_t           mode;   /**< the permissions of the files it makes  */
+	CacheStats       stats;  /**< the statistics since opening           */
+	pthread_mutex_t  lock;   /**< protects the statistics                */
+};
+
+/* an entry file, as seen when the cache is trimmed */
+typedef struct {
+	char          *path;   /**< the path to the entry file    */
+	time_t         mtime;  /**< the time at which it was used */
+	unsigned long  size;   /**< its size, in bytes            */
+} Entry;
+
+/* the state of a SHA-256 computation */
+typedef struct {
+	uint32_t       h[8];      /**< the intermediate hash value      */
+	unsigned char  buf[64];   /**< the current partial block        */
+	size_t         nbuf;      /**< the number of bytes in the block */
+	uint64_t       nbits;     /**< the total message length in bits */
+} Sha256;
+
+static const uint32_t sha256_k[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+	0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+	0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+	0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+	0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+	0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+	0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+	0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+	0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+/* --- function prototypes -------------------------------------------------- */
+
+static char *entry_path(AlanCache *c, const CacheKey *key);
+static Boolean copy_out(AlanCache *c, FILE *entry, const char *name,
+		unsigned long len);
+static Boolean copy_in(FILE *entry, const char *name);
+static unsigned long scan(AlanCache *c, Entry **entries, int *nentries);
+static void trim(AlanCache *c);
+static int by_mtime(const void *a, const void *b);
+static void sha256_init(Sha256 *s);
+static void sha256_update(Sha256 *s, const void *data, size_t n);
+static void sha256_final(Sha256 *s, unsigned char *digest);
+static void sha256_block(Sha256 *s, const unsigned char *p);
+
+/* --- cache interface ------------------------------------------------------ */
+
+AlanCache *cache_open(const char *dir, unsigned long limit)
+{
+	AlanCache *c;
+	struct stat st;
+
+	if (mkdir(dir, 0777) < 0 && errno != EEXIST) {
+		weprintf("Could not create cache directory '%s':", dir);
+		return NULL;
+	}
+	if (stat(dir, &st) < 0 || !S_ISDIR(st.st_mode)
+			|| access(dir, R_OK | W_OK | X_OK) < 0) {
+		weprintf("Could not use cache directory '%s'", dir);
+		return NULL;
+	}
+
+	c = emalloc(sizeof(AlanCache));
+	memset(c, 0, sizeof(AlanCache));
+	c->dir = estrdup(dir);
+
+	/* mkstemp makes files that only their owner may read, so entries are
+	 * given the permissions of any new file, for caches that several users
+	 * share; the umask can only be read by setting it, so it is read once,
+	 * before any worker threads are started */
+	c->mode = umask(022);
+	umask(c->mode);
+	c->mode = 0666 & ~c->mode;
+	c->stats.limit = limit;
+	c->stats.size = scan(c, NULL, NULL);
+	pthread_mutex_init(&c->lock, NULL);
+	if (c->stats.size > limit) {
+		trim(c);
+	}
+
+	return c;
+}
+
+Boolean cache_key(CacheKey *key, FILE *src_file, const char *options)
+{
+	Sha256 s;
+	char buf[BUFSIZ];
+	size_t n;
+	static const char header[] = ALAN_VERSION "\n" ALAN_BUILD_FLAGS "\n";
+
+	sha256_init(&s);
+	sha256_update(&s, header, sizeof(header));
+	sha256_update(&s, options, strlen(options) + 1);
+	while ((n = fread(buf, 1, sizeof(buf), src_file)) > 0) {
+		sha256_update(&s, buf, n);
+	}
+	if (ferror(src_file)) {
+		return FALSE;
+	}
+	rewind(src_file);
+	sha256_final(&s, key->bytes);
+
+	return TRUE;
+}
+
+Boolean cache_restore(AlanCache *c, const CacheKey *key)
+{
+	char *path, line[MAX_ENTRY_LINE], name[MAX_ENTRY_LINE];
+	unsigned long len;
+	Boolean ok;
+	FILE *entry;
+
+	path = entry_path(c, key);
+	ok = FALSE;
+	if ((entry = fopen(path, "rb")) != NULL) {
+		ok = (fgets(line, sizeof(line), entry) != NULL
+				&& strcmp(line, ENTRY_MAGIC) == 0);
+		while (ok && fgets(line, sizeof(line), entry) != NULL) {
+			ok = (sscanf(line, "F %lu %s", &len, name) == 2
+					&& copy_out(c, entry, name, len));
+		}
+		fclose(entry);
+
+		/* the modification time records the last use, for eviction */
+		if (ok) {
+			utimes(path, NULL);
+		}
+	}
+	free(path);
+
+	pthread_mutex_lock(&c->lock);
+	if (ok) {
+		c->stats.hits++;
+	} else {
+		c->stats.misses++;
+	}
+	pthread_mutex_unlock(&c->lock);
+
+	return ok;
+}
+
+void cache_store(AlanCache *c, const CacheKey *key, const char *names[],
+		int nnames)
+{
+	char *path, *temp;
+	struct stat st;
+	Boolean ok, outgrown;
+	FILE *entry;
+	int fd, i;
+
+	path = entry_path(c, key);
+	temp = emalloc(strlen(c->dir) + sizeof("/" TEMP_PREFIX "XXXXXX"));
+	sprintf(temp, "%s/" TEMP_PREFIX "XXXXXX", c->dir);
+
+	/* write a temporary file, and rename it, so readers never see half */
+	ok = FALSE;
+	if ((fd = mkstemp(temp)) >= 0 && (entry = fdopen(fd, "wb")) != NULL) {
+		ok = (fchmod(fd, c->mode) == 0 && fputs(ENTRY_MAGIC, entry) != EOF);
+		for (i = 0; ok && i < nnames; i++) {
+			ok = copy_in(entry, names[i]);
+		}
+		ok = (fclose(entry) == 0 && ok);
+		ok = (ok && stat(temp, &st) == 0 && rename(temp, path) == 0);
+	} else if (fd >= 0) {
+		close(fd);
+	}
+	if (!ok) {
+		weprintf("Could not store '%s' in the cache", path);
+		unlink(temp);
+	}
+	free(temp);
+	free(path);
+	if (!ok) {
+		return;
+	}
+
+	pthread_mutex_lock(&c->lock);
+	c->stats.stores++;
+	c->stats.size += st.st_size;
+	outgrown = (c->stats.size > c->stats.limit);
+	pthread_mutex_unlock(&c->lock);
+
+	if (outgrown) {
+		trim(c);
+	}
+}
+
+void cache_get_stats(AlanCache *c, CacheStats *stats)
+{
+	pthread_mutex_lock(&c->lock);
+	*stats = c->stats;
+	pthread_mutex_unlock(&c->lock);
+}
+
+void cache_close(AlanCache *c)
+{
+	pthread_mutex_destroy(&c->lock);
+	free(c->dir);
+	free(c);
+}
+
+/* --- entries -------------------------------------------------------------- */
+
+/**
+ * Returns the path to the entry file of a key.
+ *
+ * @param[in]   c
+ *     the cache
+ * @param[in]   key
+ *     the key
+ * @return      the newly allocated path
+ */
+static char *entry_path(AlanCache *c, const CacheKey *key)
+{
+	char *path, *p;
+	int i;
+
+	path = emalloc(strlen(c->dir) + 1 + 2 * CACHE_KEY_SIZE
+			+ sizeof(ENTRY_EXT));
+	p = path + sprintf(path, "%s/", c->dir);
+	for (i = 0; i < CACHE_KEY_SIZE; i++) {
+		p += sprintf(p, "%02x", key->bytes[i]);
+	}
+	strcpy(p, ENTRY_EXT);
+
+	return path;
+}
+
+/**
+ * Copies one output file out of an entry into the current directory.  The file
+ * is written under a temporary name, and renamed once it is complete, with the
+ * permissions of any new file.
+ *
+ * @param[in]   c
+ *     the cache
+ * @param[in]   entry
+ *     the entry file, positioned at the start of the file contents
+ * @param[in]   name
+ *     the name of the output file
+ * @param[in]   len
+ *     the length of the output file, in bytes
+ * @return      <code>TRUE</code> if the file was restored, or
+ *              <code>FALSE</code> otherwise
+ */
+static Boolean copy_out(AlanCache *c, FILE *entry, const char *name,
+		unsigned long len)
+{
+	char buf[BUFSIZ], *temp;
+	size_t n, want;
+	Boolean ok;
+	FILE *out;
+	int fd;
+
+	/* entries only ever name files in the current directory */
+	if (strchr(name, '/') != NULL) {
+		return FALSE;
+	}
+
+	temp = emalloc(strlen(name) + sizeof("." TEMP_PREFIX "XXXXXX"));
+	sprintf(temp, "." TEMP_PREFIX "%sXXXXXX", name);
+	if ((fd = mkstemp(temp)) < 0 || (out = fdopen(fd, "wb")) == NULL) {
+		if (fd >= 0) {
+			close(fd);
+			unlink(temp);
+		}
+		free(temp);
+		return FALSE;
+	}
+
+	ok = TRUE;
+	while (ok && len > 0) {
+		want = (len < sizeof(buf) ? len : sizeof(buf));
+		n = fread(buf, 1, want, entry);
+		ok = (n == want && fwrite(buf, 1, n, out) == n);
+		len -= n;
+	}
+	ok = (fclose(out) == 0 && ok);
+	ok = (ok && chmod(temp, c->mode) == 0 && rename(temp, name) == 0);
+	if (!ok) {
+		unlink(temp);
+	}
+	free(temp);
+
+	return ok;
+}
+
+/**
+ * Copies one output file from the current directory into an entry.
+ *
+ * @param[in]   entry
+ *     the entry file that is being written
+ * @param[in]   name
+ *     the name of the output file
+ * @return      <code>TRUE</code> if the file was copied, or
+ *              <code>FALSE</code> otherwise
+ */
+static Boolean copy_in(FILE *entry, const char *name)
+{
+	char buf[BUFSIZ];
+	struct stat st;
+	Boolean ok;
+	FILE *in;
+	size_t n;
+
+	if ((in = fopen(name, "rb")) == NULL) {
+		return FALSE;
+	}
+	ok = (fstat(fileno(in), &st) == 0
+			&& fprintf(entry, "F %lu %s\n", (unsigned long) st.st_size, name)
+			> 0);
+	while (ok && (n = fread(buf, 1, sizeof(buf), in)) > 0) {
+		ok = (fwrite(buf, 1, n, entry) == n);
+	}
+	ok = (ok && !ferror(in));
+	fclose(in);
+
+	return ok;
+}
+
+/* --- eviction ------------------------------------------------------------- */
+
+/**
+ * Finds the entry files of a cache, and removes the temporary files that
+ * compiles which did not finish have left behind.
+ *
+ * @param[in]   c
+ *     the cache
+ * @param[out]  entries
+ *     the newly allocated array of entries, or <code>NULL</code> if only the
+ *     total size is wanted
+ * @param[out]  nentries
+ *     the number of entries
+ * @return      the total size of the entries, in bytes
+ */
+static unsigned long scan(AlanCache *c, Entry **entries, int *nentries)
+{
+	DIR *d;
+	struct dirent *de;
+	struct stat st;
+	unsigned long total;
+	size_t len;
+	time_t stale;
+	int n, cap;
+	char *path;
+	Boolean temp;
+
+	total = 0;
+	stale = time(NULL) - TEMP_MAX_AGE;
+	n = cap = 0;
+	if (entries) {
+		*entries = NULL;
+	}
+	if ((d = opendir(c->dir)) == NULL) {
+		return 0;
+	}
+	while ((de = readdir(d)) != NULL) {
+		len = strlen(de->d_name);
+		temp = (strncmp(de->d_name, TEMP_PREFIX, strlen(TEMP_PREFIX)) == 0);
+		if (!temp && (len <= strlen(ENTRY_EXT)
+				|| strcmp(de->d_name + len - strlen(ENTRY_EXT), ENTRY_EXT))) {
+			continue;
+		}
+		path = emalloc(strlen(c->dir) + len + 2);
+		sprintf(path, "%s/%s", c->dir, de->d_name);
+		if (temp) {
+			if (stat(path, &st) == 0 && st.st_mtime < stale) {
+				unlink(path);
+			}
+			free(path);
+			continue;
+		}
+		if (stat(path, &st) < 0) {
+			free(path);
+			continue;
+		}
+		total += st.st_size;
+		if (!entries) {
+			free(path);
+			continue;
+		}
+		if (n == cap) {
+			cap = (cap ? 2 * cap : 64);
+			*entries = erealloc(*entries, cap * sizeof(Entry));
+		}
+		(*entries)[n].path = path;
+		(*entries)[n].mtime = st.st_mtime;
+		(*entries)[n].size = st.st_size;
+		n++;
+	}
+	closedir(d);
+	if (nentries) {
+		*nentries = n;
+	}
+
+	return total;
+}
+
+/**
+ * Removes the least recently used entries of a cache, until its total size is
+ * comfortably below its limit.  The directory is rescanned, since other
+ * processes may share it.
+ *
+ * @param[in]   c
+ *     the cache
+ */
+static void trim(AlanCache *c)
+{
+	Entry *entries;
+	unsigned long total, target, evicted;
+	int i, n;
+
+	total = scan(c, &entries, &n);
+	target = c->stats.limit / TRIM_DEN * TRIM_NUM;
+	qsort(entries, n, sizeof(Entry), by_mtime);
+
+	evicted = 0;
+	for (i = 0; i < n; i++) {
+		if (total > target && unlink(entries[i].path) == 0) {
+			total -= entries[i].size;
+			evicted++;
+		}
+		free(entries[i].path);
+	}
+	free(entries);
+
+	pthread_mutex_lock(&c->lock);
+	c->stats.evictions += evicted;
+	c->stats.size = total;
+	pthread_mutex_unlock(&c->lock);
+}
+
+/**
+ * Orders entries from the least to the most recently used.
+ */
+static int by_mtime(const void *a, const void *b)
+{
+	const Entry *x = a, *y = b;
+
+	return (x->mtime > y->mtime) - (x->mtime < y->mtime);
+}
+
+/* --- SHA-256 -------------------------------------------------------------- */
+
+#define ROR(x, n)  (((x) >> (n)) | ((x) << (32 - (n))))
+
+static void sha256_init(Sha256 *s)
+{
+	static const uint32_t h0[8] = {
+		0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+		0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+	};
+
+	memcpy(s->h, h0, sizeof(h0));
+	s->nbuf = 0;
+	s->nbits = 0;
+}
+
+static void sha256_update(Sha256 *s, const void *data, size_t n)
+{
+	const unsigned char *p = data;
+	size_t k;
+
+	s->nbits += (uint64_t) n * 8;
+	while (n > 0) {
+		k = 64 - s->nbuf;
+		if (k > n) {
+			k = n;
+		}
+		memcpy(s->buf + s->nbuf, p, k);
+		s->nbuf += k;
+		p += k;
+		n -= k;
+		if (s->nbuf == 64) {
+			sha256_block(s, s->buf);
+			s->nbuf = 0;
+		}
+	}
+}
+
+static void sha256_final(Sha256 *s, unsigned char *digest)
+{
+	uint64_t nbits = s->nbits;
+	unsigned char pad = 0x80, len[8];
+	int i;
+
+	sha256_update(s, &pad, 1);
+	pad = 0;
+	while (s->nbuf != 56) {
+		sha256_update(s, &pad, 1);
+	}
+	for (i = 0; i < 8; i++) {
+		len[i] = (unsigned char) (nbits >> (56 - 8 * i));
+	}
+	sha256_update(s, len, 8);
+
+	for (i = 0; i < 32; i++) {
+		digest[i] = (unsigned char) (s->h[i / 4] >> (24 - 8 * (i % 4)));
+	}
+}
+
+static void sha256_block(Sha256 *s, const unsigned char *p)
+{
+	uint32_t w[64], a, b, c, d, e, f, g, h, t1, t2;
+	int i;
+
+	for (i = 0; i < 16; i++) {
+		w[i] = (uint32_t) p[4 * i] << 24 | (uint32_t) p[4 * i + 1] << 16
+			| (uint32_t) p[4 * i + 2] << 8 | (uint32_t) p[4 * i + 3];
+	}
+	for (i = 16; i < 64; i++) {
+		w[i] = w[i - 16] + w[i - 7]
+			+ (ROR(w[i - 15], 7) ^ ROR(w[i - 15], 18) ^ (w[i - 15] >> 3))
+			+ (ROR(w[i - 2], 17) ^ ROR(w[i - 2], 19) ^ (w[i - 2] >> 10));
+	}
+
+	a = s->h[0]; b = s->h[1]; c = s->h[2]; d = s->h[3];
+	e = s->h[4]; f = s->h[5]; g = s->h[6]; h = s->h[7];
+	for (i = 0; i < 64; i++) {
+		t1 = h + (ROR(e, 6) ^ ROR(e, 11) ^ ROR(e, 25)) + ((e & f) ^ (~e & g))
+			+ sha256_k[i] + w[i];
+		t2 = (ROR(a, 2) ^ ROR(a, 13) ^ ROR(a, 22))
+			+ ((a & b) ^ (a & c) ^ (b & c));
+		h = g; g = f; f = e; e = d + t1;
+		d = c; c = b; b = a; a = t1 + t2;
+	}
+	s->h[0] += a; s->h[1] += b; s->h[2] += c; s->h[3] += d;
+	s->h[4] += e; s->h[5] += f; s->h[6] += g; s->h[7] += h;
+}
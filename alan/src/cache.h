@@ -0,0 +1,126 @@
+/**
+ * @file    cache.h
+ * @brief   A content-addressed cache of compiled ALAN-2022 sources.
+ *
+ * A compilation is identified by a SHA-256 key over the compiler version, the
+ * flags with which the compiler was built, the code generation options of the
+ * compilation, and the bytes of the source file.  The outputs of a successful
+ * compilation (the class file, and, through Jasmin, the Jasmin file) are kept
+ * in one entry file per key in the cache directory.  On a hit, the outputs are
+ * restored into the current directory, and the source need not be compiled at
+ * all.
+ *
+ * The cache is bounded in size: when it grows beyond its limit, the least
+ * recently used entries are removed, where the modification time of an entry
+ * records its last use.  Entries are written to temporary files and renamed
+ * into place, so that several processes may share one cache directory, and
+ * one cache may be shared by the threads of a process.
+ *
+ * @date    2026-10-14
+ */
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stdio.h>
+#include "boolean.h"
+
+/** the number of bytes in a cache key */
+#define CACHE_KEY_SIZE 32
+
+/** the default size limit of a cache, in bytes */
+#define CACHE_DEFAULT_LIMIT (64UL * 1024 * 1024)
+
+/** the container structure for a cache directory */
+typedef struct alan_cache AlanCache;
+
+/** the key of a compilation */
+typedef struct {
+	unsigned char bytes[CACHE_KEY_SIZE];  /**< the SHA-256 digest */
+} CacheKey;
+
+/** the statistics of a cache, since it was opened */
+typedef struct {
+	unsigned long hits;       /**< the number of compilations restored     */
+	unsigned long misses;     /**< the number of compilations not found    */
+	unsigned long stores;     /**< the number of entries stored            */
+	unsigned long evictions;  /**< the number of entries removed           */
+	unsigned long size;       /**< the total size of the entries, in bytes */
+	unsigned long limit;      /**< the size limit, in bytes                */
+} CacheStats;
+
+/**
+ * Opens a cache directory, which is created if it does not exist.
+ *
+ * @param[in]   dir
+ *     the path to the cache directory
+ * @param[in]   limit
+ *     the size limit of the cache, in bytes
+ * @return      a pointer to the cache, or <code>NULL</code> if the directory
+ *              could not be used
+ */
+AlanCache *cache_open(const char *dir, unsigned long limit);
+
+/**
+ * Computes the key of a compilation.  The source file is read to its end, and
+ * then rewound.
+ *
+ * @param[out]  key
+ *     the key of the compilation
+ * @param[in]   src_file
+ *     the source file
+ * @param[in]   options
+ *     the code generation options that affect the output
+ * @return      <code>TRUE</code> if the source file was read, or
+ *              <code>FALSE</code> otherwise
+ */
+Boolean cache_key(CacheKey *key, FILE *src_file, const char *options);
+
+/**
+ * Restores the outputs of a compilation into the current directory.
+ *
+ * @param[in]   c
+ *     the cache
+ * @param[in]   key
+ *     the key of the compilation
+ * @return      <code>TRUE</code> if the outputs were restored, or
+ *              <code>FALSE</code> if the compilation is not in the cache
+ */
+Boolean cache_restore(AlanCache *c, const CacheKey *key);
+
+/**
+ * Stores the outputs of a successful compilation, and removes the least
+ * recently used entries if the cache has outgrown its limit.  Failures are
+ * reported as warnings, since the outputs themselves are not affected.
+ *
+ * @param[in]   c
+ *     the cache
+ * @param[in]   key
+ *     the key of the compilation
+ * @param[in]   names
+ *     the names of the output files in the current directory
+ * @param[in]   nnames
+ *     the number of output files
+ */
+void cache_store(AlanCache *c, const CacheKey *key, const char *names[],
+		int nnames);
+
+/**
+ * Retrieves the statistics of a cache.
+ *
+ * @param[in]   c
+ *     the cache
+ * @param[out]  stats
+ *     the statistics
+ */
+void cache_get_stats(AlanCache *c, CacheStats *stats);
+
+/**
+ * Closes a cache, and releases its resources.
+ *
+ * @param[in]   c
+ *     the cache
+ */
+void cache_close(AlanCache *c);
+
+#endif /* CACHE_H */
@@ -0,0 +1,97 @@
+#!/bin/sh
+#
+# Run-time checks for ALAN-2022: "make check" runs this script.
+#
+# Small programs are compiled by alanc into <workdir> and run on the JVM, with
+# their output compared to what it should be.  A program that throws prints
+# the name of the exception instead of its output.  Every class is verified, so
+# that a wrong stack map frame fails the check with a VerifyError.
+#
+
+usage="usage: sh check.sh <bindir> <workdir>"
+[ $# -ge 2 ] || { echo "$usage" >&2; exit 2; }
+
+bindir=$(cd "$1" && pwd) || exit 2
+workdir=$2
+java=${JAVA:-java}
+
+mkdir -p "$workdir" || exit 1
+cd "$workdir" || exit 1
+failed=0
+
+# compiles the source on standard input as class $1
+compile() {
+	cat > "$1.alan" && "$bindir/alanc" "$1.alan" || {
+		echo "check: $1 did not compile" >&2
+		exit 1
+	}
+}
+
+# runs class $1 on input $2, and compares its output to $3
+expect() {
+	out=$(printf '%s\n' "$2" | "$java" -Xverify:all -cp . "$1" 2>&1 \
+		| sed -e '/^	at /d' \
+			-e 's/^Exception in thread "main" \([^:]*\).*/\1/')
+	if [ "$out" != "$3" ]; then
+		printf 'check: %s on "%s": expected "%s", got "%s"\n' \
+			"$1" "$2" "$3" "$out" >&2
+		failed=$((failed + 1))
+	fi
+}
+
+# --- readInt ------------------------------------------------------------------
+
+compile ReadInt <<'EOF'
+source ReadInt
+begin
+	integer n;
+	get n;
+	put n
+end
+EOF
+
+expect ReadInt "0" "0"
+expect ReadInt "  +42" "42"
+expect ReadInt "-17" "-17"
+expect ReadInt "2147483647" "2147483647"
+expect ReadInt "-2147483648" "-2147483648"
+expect ReadInt "2147483648" "java.util.InputMismatchException"
+expect ReadInt "-2147483649" "java.util.InputMismatchException"
+expect ReadInt "99999999999" "java.util.InputMismatchException"
+expect ReadInt "x" "java.util.InputMismatchException"
+expect ReadInt "" "java.util.NoSuchElementException"
+
+compile ReadTwo <<'EOF'
+source ReadTwo
+begin
+	integer a, b;
+	get a;
+	get b;
+	put a . " " . b
+end
+EOF
+
+expect ReadTwo "7 3" "7 3"
+expect ReadTwo "7
+3" "7 3"
+expect ReadTwo "7-3" "java.util.InputMismatchException"
+expect ReadTwo "12,5" "java.util.InputMismatchException"
+
+# --- readBoolean --------------------------------------------------------------
+
+compile ReadBoolean <<'EOF'
+source ReadBoolean
+begin
+	boolean p;
+	get p;
+	if p then put "yes" else put "no" end
+end
+EOF
+
+expect ReadBoolean "TRUE" "yes"
+expect ReadBoolean " false" "no"
+expect ReadBoolean "truex" "java.util.InputMismatchException"
+expect ReadBoolean "" "java.util.NoSuchElementException"
+
+[ $failed -eq 0 ] || { echo "check: $failed failed" >&2; exit 1; }
+echo "check: all passed"
@@ -0,0 +1,498 @@
+/**
+ * @file    classfile.c
+ * @brief   A writer for binary JVM class files.
+ * @date    2026-10-14
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "boolean.h"
+#include "classfile.h"
+#include "error.h"
+#include "hashtable.h"
+
+/* --- type definitions and constants --------------------------------------- */
+
+/* constant pool tags */
+#define CONSTANT_Utf8        1
+#define CONSTANT_Integer     3
+#define CONSTANT_Class       7
+#define CONSTANT_String      8
+#define CONSTANT_Fieldref    9
+#define CONSTANT_Methodref   10
+#define CONSTANT_NameAndType 12
+
+#define CLASS_MAGIC          0xcafebabeUL
+#define INITIAL_BUF_SIZE     256
+#define INITIAL_METHODS      16
+#define MAX_POOL_ENTRIES     65535
+#define MAX_UTF8_LENGTH      65535
+
+struct cfmethod {
+	unsigned int flags;        /**< the method access flags            */
+	unsigned int name;         /**< pool index of the method name      */
+	unsigned int desc;         /**< pool index of the method descriptor */
+	unsigned int max_stack;    /**< the maximum operand stack depth    */
+	unsigned int max_locals;   /**< the size of the local variable array */
+	ByteBuf      code;         /**< the bytecode                       */
+	unsigned int nhandlers;    /**< the number of exception handlers   */
+	ByteBuf      handlers;     /**< the encoded exception table        */
+	unsigned int nattrs;       /**< the number of Code attributes      */
+	ByteBuf      attrs;        /**< the encoded Code attributes        */
+};
+
+struct classfile {
+	unsigned int  flags;       /**< the class access flags             */
+	unsigned int  this_class;  /**< pool index of this class           */
+	unsigned int  super_class; /**< pool index of the superclass       */
+	unsigned int  code_attr;   /**< pool index of the "Code" string    */
+	unsigned int  pool_count;  /**< the number of pool entries, plus one */
+	ByteBuf       pool;        /**< the encoded constant pool entries  */
+	HashTab      *pool_index;  /**< maps encoded entries to pool indices */
+	unsigned int  nfields;     /**< the number of fields               */
+	ByteBuf       fields;      /**< the encoded field_info structures  */
+	unsigned int  nmethods;    /**< the number of methods              */
+	unsigned int  methods_cap; /**< the allocated number of methods    */
+	CFmethod    **methods;     /**< the methods                        */
+	unsigned int  nattrs;      /**< the number of class attributes     */
+	ByteBuf       attrs;       /**< the encoded class attributes       */
+};
+
+/* --- function prototypes -------------------------------------------------- */
+
+static unsigned int pool_entry(ClassFile *cf, int tag, const char *key,
+		const unsigned char *bytes, size_t len);
+static unsigned int pool_ref(ClassFile *cf, int tag, const char *owner,
+		const char *name, const char *desc);
+static unsigned int pool_hash(void *key, unsigned int size);
+static int pool_cmp(void *val1, void *val2);
+static void pool_free_index(void *v);
+static void bb_append(ByteBuf *b, const void *src, size_t len);
+static void bb_reserve(ByteBuf *b, size_t extra);
+
+/* --- byte buffers --------------------------------------------------------- */
+
+void bb_u1(ByteBuf *b, unsigned int v)
+{
+	bb_reserve(b, 1);
+	b->data[b->len++] = (unsigned char) (v & 0xff);
+}
+
+void bb_u2(ByteBuf *b, unsigned int v)
+{
+	bb_reserve(b, 2);
+	b->data[b->len++] = (unsigned char) ((v >> 8) & 0xff);
+	b->data[b->len++] = (unsigned char) (v & 0xff);
+}
+
+void bb_u4(ByteBuf *b, unsigned long v)
+{
+	bb_reserve(b, 4);
+	b->data[b->len++] = (unsigned char) ((v >> 24) & 0xff);
+	b->data[b->len++] = (unsigned char) ((v >> 16) & 0xff);
+	b->data[b->len++] = (unsigned char) ((v >> 8) & 0xff);
+	b->data[b->len++] = (unsigned char) (v & 0xff);
+}
+
+void bb_patch_u2(ByteBuf *b, size_t at, unsigned int v)
+{
+	b->data[at] = (unsigned char) ((v >> 8) & 0xff);
+	b->data[at + 1] = (unsigned char) (v & 0xff);
+}
+
+void bb_text(ByteBuf *b, const char *s)
+{
+	bb_append(b, s, strlen(s));
+}
+
+void bb_decimal(ByteBuf *b, long v)
+{
+	char digits[24], *d = digits + sizeof(digits);
+	unsigned long u = (v < 0 ? 0UL - (unsigned long) v : (unsigned long) v);
+
+	do {
+		*--d = (char) ('0' + u % 10);
+		u /= 10;
+	} while (u > 0);
+	if (v < 0) {
+		*--d = '-';
+	}
+	bb_append(b, d, (size_t) (digits + sizeof(digits) - d));
+}
+
+/* --- class file interface ------------------------------------------------- */
+
+ClassFile *cf_init(const char *name, const char *super, unsigned int flags)
+{
+	ClassFile *cf;
+
+	cf = emalloc(sizeof(ClassFile));
+	memset(cf, 0, sizeof(ClassFile));
+	cf->flags = flags;
+	cf->pool_count = 1;
+	if ((cf->pool_index = ht_init(0.75f, pool_hash, pool_cmp)) == NULL) {
+		eprintf("Constant pool index could not be initialised");
+	}
+	cf->methods_cap = INITIAL_METHODS;
+	cf->methods = emalloc(cf->methods_cap * sizeof(CFmethod *));
+
+	cf->this_class = cf_class(cf, name);
+	cf->super_class = cf_class(cf, super);
+	cf->code_attr = cf_utf8(cf, "Code");
+
+	return cf;
+}
+
+unsigned int cf_utf8(ClassFile *cf, const char *s)
+{
+	size_t len = strlen(s);
+
+	if (len > MAX_UTF8_LENGTH) {
+		eprintf("constant string of %lu bytes is too long for a class file",
+				(unsigned long) len);
+	}
+	return pool_entry(cf, CONSTANT_Utf8, s, (const unsigned char *) s, len);
+}
+
+unsigned int cf_class(ClassFile *cf, const char *name)
+{
+	unsigned char b[2];
+	unsigned int idx = cf_utf8(cf, name);
+
+	b[0] = (unsigned char) (idx >> 8);
+	b[1] = (unsigned char) idx;
+	return pool_entry(cf, CONSTANT_Class, name, b, 2);
+}
+
+unsigned int cf_string(ClassFile *cf, const char *s)
+{
+	unsigned char b[2];
+	unsigned int idx = cf_utf8(cf, s);
+
+	b[0] = (unsigned char) (idx >> 8);
+	b[1] = (unsigned char) idx;
+	return pool_entry(cf, CONSTANT_String, s, b, 2);
+}
+
+unsigned int cf_integer(ClassFile *cf, int v)
+{
+	char key[16];
+	unsigned char b[4];
+	unsigned long u = (unsigned long) (unsigned int) v;
+
+	sprintf(key, "%d", v);
+	b[0] = (unsigned char) (u >> 24);
+	b[1] = (unsigned char) (u >> 16);
+	b[2] = (unsigned char) (u >> 8);
+	b[3] = (unsigned char) u;
+	return pool_entry(cf, CONSTANT_Integer, key, b, 4);
+}
+
+unsigned int cf_fieldref(ClassFile *cf, const char *owner, const char *name,
+		const char *desc)
+{
+	return pool_ref(cf, CONSTANT_Fieldref, owner, name, desc);
+}
+
+unsigned int cf_methodref(ClassFile *cf, const char *owner, const char *name,
+		const char *desc)
+{
+	return pool_ref(cf, CONSTANT_Methodref, owner, name, desc);
+}
+
+void cf_add_field(ClassFile *cf, unsigned int flags, const char *name,
+		const char *desc)
+{
+	bb_u2(&cf->fields, flags);
+	bb_u2(&cf->fields, cf_utf8(cf, name));
+	bb_u2(&cf->fields, cf_utf8(cf, desc));
+	bb_u2(&cf->fields, 0);
+	cf->nfields++;
+}
+
+CFmethod *cf_begin_method(ClassFile *cf, unsigned int flags, const char *name,
+		const char *desc)
+{
+	CFmethod *m;
+
+	if (cf->nmethods == cf->methods_cap) {
+		cf->methods_cap *= 2;
+		cf->methods = erealloc(cf->methods,
+				cf->methods_cap * sizeof(CFmethod *));
+	}
+
+	m = emalloc(sizeof(CFmethod));
+	memset(m, 0, sizeof(CFmethod));
+	m->flags = flags;
+	m->name = cf_utf8(cf, name);
+	m->desc = cf_utf8(cf, desc);
+	cf->methods[cf->nmethods++] = m;
+
+	return m;
+}
+
+ByteBuf *cf_code(CFmethod *m)
+{
+	return &m->code;
+}
+
+void cf_end_method(CFmethod *m, unsigned int max_stack,
+		unsigned int max_locals)
+{
+	m->max_stack = max_stack;
+	m->max_locals = max_locals;
+}
+
+void cf_add_handler(CFmethod *m, size_t start, size_t end, size_t handler,
+		unsigned int catch_type)
+{
+	bb_u2(&m->handlers, start);
+	bb_u2(&m->handlers, end);
+	bb_u2(&m->handlers, handler);
+	bb_u2(&m->handlers, catch_type);
+	m->nhandlers++;
+}
+
+void cf_add_code_attribute(ClassFile *cf, CFmethod *m, const char *name,
+		const ByteBuf *data)
+{
+	bb_u2(&m->attrs, cf_utf8(cf, name));
+	bb_u4(&m->attrs, data->len);
+	bb_append(&m->attrs, data->data, data->len);
+	m->nattrs++;
+}
+
+void cf_add_attribute(ClassFile *cf, const char *name, const ByteBuf *data)
+{
+	bb_u2(&cf->attrs, cf_utf8(cf, name));
+	bb_u4(&cf->attrs, data->len);
+	bb_append(&cf->attrs, data->data, data->len);
+	cf->nattrs++;
+}
+
+void cf_serialise(ClassFile *cf, ByteBuf *out)
+{
+	unsigned int i;
+	CFmethod *m;
+
+	bb_u4(out, CLASS_MAGIC);
+	bb_u2(out, CLASS_MINOR_VERSION);
+	bb_u2(out, CLASS_MAJOR_VERSION);
+
+	bb_u2(out, cf->pool_count);
+	bb_append(out, cf->pool.data, cf->pool.len);
+
+	bb_u2(out, cf->flags);
+	bb_u2(out, cf->this_class);
+	bb_u2(out, cf->super_class);
+	bb_u2(out, 0);                          /* interfaces */
+
+	bb_u2(out, cf->nfields);
+	bb_append(out, cf->fields.data, cf->fields.len);
+
+	bb_u2(out, cf->nmethods);
+	for (i = 0; i < cf->nmethods; i++) {
+		m = cf->methods[i];
+		bb_u2(out, m->flags);
+		bb_u2(out, m->name);
+		bb_u2(out, m->desc);
+		bb_u2(out, 1);                      /* attributes: Code */
+		bb_u2(out, cf->code_attr);
+		bb_u4(out, 12 + m->code.len + m->handlers.len + m->attrs.len);
+		bb_u2(out, m->max_stack);
+		bb_u2(out, m->max_locals);
+		bb_u4(out, m->code.len);
+		bb_append(out, m->code.data, m->code.len);
+		bb_u2(out, m->nhandlers);           /* exception table */
+		bb_append(out, m->handlers.data, m->handlers.len);
+		bb_u2(out, m->nattrs);
+		bb_append(out, m->attrs.data, m->attrs.len);
+	}
+
+	bb_u2(out, cf->nattrs);                 /* class attributes */
+	bb_append(out, cf->attrs.data, cf->attrs.len);
+}
+
+int cf_write(ClassFile *cf, const char *path)
+{
+	FILE *file;
+	ByteBuf out = { NULL, 0, 0 };
+	int status = 0;
+
+	cf_serialise(cf, &out);
+
+	if ((file = fopen(path, "wb")) == NULL) {
+		free(out.data);
+		return -1;
+	}
+	if (fwrite(out.data, 1, out.len, file) != out.len) {
+		status = -1;
+	}
+	if (fclose(file) != 0) {
+		status = -1;
+	}
+	free(out.data);
+
+	return status;
+}
+
+void cf_free(ClassFile *cf)
+{
+	unsigned int i;
+
+	for (i = 0; i < cf->nmethods; i++) {
+		free(cf->methods[i]->code.data);
+		free(cf->methods[i]->handlers.data);
+		free(cf->methods[i]->attrs.data);
+		free(cf->methods[i]);
+	}
+	free(cf->methods);
+	free(cf->attrs.data);
+	free(cf->fields.data);
+	free(cf->pool.data);
+	ht_free(cf->pool_index, free, pool_free_index);
+	free(cf);
+}
+
+/* --- utility functions ---------------------------------------------------- */
+
+/**
+ * Returns the index of a constant pool entry, adding the entry if an equal one
+ * is not yet in the pool.  The lookup key is the tag byte followed by a string
+ * that identifies the entry uniquely among entries with the same tag.
+ *
+ * @param[in] cf    the class file.
+ * @param[in] tag   the constant pool tag.
+ * @param[in] key   the identifying string.
+ * @param[in] bytes the encoded entry, excluding the tag.
+ * @param[in] len   the number of encoded bytes.
+ * @return          the constant pool index of the entry.
+ */
+static unsigned int pool_entry(ClassFile *cf, int tag, const char *key,
+		const unsigned char *bytes, size_t len)
+{
+	char *k;
+	void *v;
+	size_t klen = strlen(key);
+	unsigned int idx;
+
+	k = emalloc(klen + 2);
+	k[0] = (char) tag;
+	memcpy(k + 1, key, klen + 1);
+
+	if (ht_search(cf->pool_index, k, &v)) {
+		free(k);
+		return (unsigned int) (size_t) v;
+	}
+
+	if (cf->pool_count >= MAX_POOL_ENTRIES) {
+		eprintf("too many constants for a class file");
+	}
+
+	bb_u1(&cf->pool, tag);
+	if (tag == CONSTANT_Utf8) {
+		bb_u2(&cf->pool, len);
+	}
+	bb_append(&cf->pool, bytes, len);
+
+	idx = cf->pool_count++;
+	if (ht_insert(cf->pool_index, k, (void *) (size_t) idx) != EXIT_SUCCESS) {
+		eprintf("Constant pool index could not be updated");
+	}
+
+	return idx;
+}
+
+/**
+ * Returns the index of a field or method reference, adding the referenced
+ * class, name-and-type, and reference entries as needed.
+ *
+ * @param[in] cf    the class file.
+ * @param[in] tag   either <code>CONSTANT_Fieldref</code> or
+ *                  <code>CONSTANT_Methodref</code>.
+ * @param[in] owner the internal name of the declaring class.
+ * @param[in] name  the member name.
+ * @param[in] desc  the member descriptor.
+ * @return          the constant pool index of the reference.
+ */
+static unsigned int pool_ref(ClassFile *cf, int tag, const char *owner,
+		const char *name, const char *desc)
+{
+	char *key;
+	unsigned char b[4];
+	unsigned int class_idx, nat_idx, name_idx, desc_idx, idx;
+
+	key = emalloc(strlen(owner) + strlen(name) + strlen(desc) + 3);
+
+	/* name and type */
+	name_idx = cf_utf8(cf, name);
+	desc_idx = cf_utf8(cf, desc);
+	sprintf(key, "%s %s", name, desc);
+	b[0] = (unsigned char) (name_idx >> 8);
+	b[1] = (unsigned char) name_idx;
+	b[2] = (unsigned char) (desc_idx >> 8);
+	b[3] = (unsigned char) desc_idx;
+	nat_idx = pool_entry(cf, CONSTANT_NameAndType, key, b, 4);
+
+	/* the reference itself */
+	class_idx = cf_class(cf, owner);
+	sprintf(key, "%s.%s %s", owner, name, desc);
+	b[0] = (unsigned char) (class_idx >> 8);
+	b[1] = (unsigned char) class_idx;
+	b[2] = (unsigned char) (nat_idx >> 8);
+	b[3] = (unsigned char) nat_idx;
+	idx = pool_entry(cf, tag, key, b, 4);
+
+	free(key);
+	return idx;
+}
+
+/* FNV-1a over the tagged key */
+static unsigned int pool_hash(void *key, unsigned int size)
+{
+	const unsigned char *s = (const unsigned char *) key;
+	unsigned long h = 2166136261UL;
+
+	while (*s) {
+		h ^= *s++;
+		h = (h * 16777619UL) & 0xffffffffUL;
+	}
+
+	return (unsigned int) (h % size);
+}
+
+static int pool_cmp(void *val1, void *val2)
+{
+	return strcmp((char *) val1, (char *) val2);
+}
+
+static void pool_free_index(void *v)
+{
+	(void) v;
+}
+
+static void bb_append(ByteBuf *b, const void *src, size_t len)
+{
+	if (len == 0) {
+		return;
+	}
+	bb_reserve(b, len);
+	memcpy(b->data + b->len, src, len);
+	b->len += len;
+}
+
+static void bb_reserve(ByteBuf *b, size_t extra)
+{
+	size_t cap;
+
+	if (b->len + extra <= b->cap) {
+		return;
+	}
+	cap = (b->cap ? b->cap : INITIAL_BUF_SIZE);
+	while (cap < b->len + extra) {
+		cap *= 2;
+	}
+	b->data = erealloc(b->data, cap);
+	b->cap = cap;
+}
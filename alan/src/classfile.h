@@ -0,0 +1,334 @@
+/**
+ * @file    classfile.h
+ * @brief   A writer for binary JVM class files.
+ *
+ * The writer keeps a constant pool, in which equal entries are shared, and a
+ * list of fields and methods.  Method code is appended byte by byte, and each
+ * method gets a <code>Code</code> attribute, which may carry further
+ * attributes of its own.  A class file is built in memory and written to disk
+ * in one go by <code>cf_write</code>.  The byte buffers also hold text, such
+ * as the Jasmin form of a class.
+ *
+ * @date    2026-10-14
+ */
+
+#ifndef CLASSFILE_H
+#define CLASSFILE_H
+
+#include <stddef.h>
+
+/* --- access flags --------------------------------------------------------- */
+
+#define ACC_PUBLIC  0x0001
+#define ACC_PRIVATE 0x0002
+#define ACC_STATIC  0x0008
+#define ACC_FINAL   0x0010
+#define ACC_SUPER   0x0020
+
+/* --- class file version --------------------------------------------------- */
+
+/* from version 51, the JVM verifies with the stack map frames alone, so a
+ * wrong frame is reported rather than verified again by inference */
+#define CLASS_MAJOR_VERSION 51
+#define CLASS_MINOR_VERSION 0
+
+/** a growable byte buffer */
+typedef struct {
+	unsigned char *data;  /**< the bytes                   */
+	size_t         len;   /**< the number of bytes in use  */
+	size_t         cap;   /**< the allocated size in bytes */
+} ByteBuf;
+
+/** the container structure for a class file under construction */
+typedef struct classfile ClassFile;
+
+/** a method under construction */
+typedef struct cfmethod CFmethod;
+
+/* --- byte buffers --------------------------------------------------------- */
+
+/**
+ * Appends a single byte to a buffer.
+ *
+ * @param[in]   b
+ *     the buffer
+ * @param[in]   v
+ *     the byte to append
+ */
+void bb_u1(ByteBuf *b, unsigned int v);
+
+/**
+ * Appends a big-endian two-byte quantity to a buffer.
+ *
+ * @param[in]   b
+ *     the buffer
+ * @param[in]   v
+ *     the value to append
+ */
+void bb_u2(ByteBuf *b, unsigned int v);
+
+/**
+ * Appends a big-endian four-byte quantity to a buffer.
+ *
+ * @param[in]   b
+ *     the buffer
+ * @param[in]   v
+ *     the value to append
+ */
+void bb_u4(ByteBuf *b, unsigned long v);
+
+/**
+ * Overwrites a big-endian two-byte quantity at the specified offset.
+ *
+ * @param[in]   b
+ *     the buffer
+ * @param[in]   at
+ *     the offset of the first byte to overwrite
+ * @param[in]   v
+ *     the value to write
+ */
+void bb_patch_u2(ByteBuf *b, size_t at, unsigned int v);
+
+/**
+ * Appends a string, without its terminating null character, to a buffer.
+ *
+ * @param[in]   b
+ *     the buffer
+ * @param[in]   s
+ *     the string to append
+ */
+void bb_text(ByteBuf *b, const char *s);
+
+/**
+ * Appends the decimal digits of an integer to a buffer, after a minus sign if
+ * the integer is negative.
+ *
+ * @param[in]   b
+ *     the buffer
+ * @param[in]   v
+ *     the integer to append
+ */
+void bb_decimal(ByteBuf *b, long v);
+
+/* --- class file interface ------------------------------------------------- */
+
+/**
+ * Initialises a new class file.
+ *
+ * @param[in]   name
+ *     the internal (slash-separated) name of the class
+ * @param[in]   super
+ *     the internal name of the superclass
+ * @param[in]   flags
+ *     the class access flags
+ * @return      a pointer to the class file container structure
+ */
+ClassFile *cf_init(const char *name, const char *super, unsigned int flags);
+
+/**
+ * Returns the constant pool index of a <code>CONSTANT_Utf8</code> entry.
+ *
+ * @param[in]   cf
+ *     the class file
+ * @param[in]   s
+ *     the (ASCII) string
+ * @return      the constant pool index
+ */
+unsigned int cf_utf8(ClassFile *cf, const char *s);
+
+/**
+ * Returns the constant pool index of a <code>CONSTANT_Class</code> entry.
+ *
+ * @param[in]   cf
+ *     the class file
+ * @param[in]   name
+ *     the internal name of the class
+ * @return      the constant pool index
+ */
+unsigned int cf_class(ClassFile *cf, const char *name);
+
+/**
+ * Returns the constant pool index of a <code>CONSTANT_String</code> entry.
+ *
+ * @param[in]   cf
+ *     the class file
+ * @param[in]   s
+ *     the string value, without escape sequences
+ * @return      the constant pool index
+ */
+unsigned int cf_string(ClassFile *cf, const char *s);
+
+/**
+ * Returns the constant pool index of a <code>CONSTANT_Integer</code> entry.
+ *
+ * @param[in]   cf
+ *     the class file
+ * @param[in]   v
+ *     the integer value
+ * @return      the constant pool index
+ */
+unsigned int cf_integer(ClassFile *cf, int v);
+
+/**
+ * Returns the constant pool index of a <code>CONSTANT_Fieldref</code> entry.
+ *
+ * @param[in]   cf
+ *     the class file
+ * @param[in]   owner
+ *     the internal name of the class that declares the field
+ * @param[in]   name
+ *     the field name
+ * @param[in]   desc
+ *     the field descriptor
+ * @return      the constant pool index
+ */
+unsigned int cf_fieldref(ClassFile *cf, const char *owner, const char *name,
+						 const char *desc);
+
+/**
+ * Returns the constant pool index of a <code>CONSTANT_Methodref</code> entry.
+ *
+ * @param[in]   cf
+ *     the class file
+ * @param[in]   owner
+ *     the internal name of the class that declares the method
+ * @param[in]   name
+ *     the method name
+ * @param[in]   desc
+ *     the method descriptor
+ * @return      the constant pool index
+ */
+unsigned int cf_methodref(ClassFile *cf, const char *owner, const char *name,
+						  const char *desc);
+
+/**
+ * Adds a field to the class.
+ *
+ * @param[in]   cf
+ *     the class file
+ * @param[in]   flags
+ *     the field access flags
+ * @param[in]   name
+ *     the field name
+ * @param[in]   desc
+ *     the field descriptor
+ */
+void cf_add_field(ClassFile *cf, unsigned int flags, const char *name,
+				  const char *desc);
+
+/**
+ * Starts a new method.  Bytecode is appended to the buffer returned by
+ * <code>cf_code</code> until the method is closed by
+ * <code>cf_end_method</code>.
+ *
+ * @param[in]   cf
+ *     the class file
+ * @param[in]   flags
+ *     the method access flags
+ * @param[in]   name
+ *     the method name
+ * @param[in]   desc
+ *     the method descriptor
+ * @return      a pointer to the method under construction
+ */
+CFmethod *cf_begin_method(ClassFile *cf, unsigned int flags, const char *name,
+						  const char *desc);
+
+/**
+ * Returns the code buffer of a method under construction.
+ *
+ * @param[in]   m
+ *     the method
+ * @return      a pointer to the code buffer
+ */
+ByteBuf *cf_code(CFmethod *m);
+
+/**
+ * Closes a method, and records its stack and local variable limits.
+ *
+ * @param[in]   m
+ *     the method
+ * @param[in]   max_stack
+ *     the maximum operand stack depth
+ * @param[in]   max_locals
+ *     the size of the local variable array
+ */
+void cf_end_method(CFmethod *m, unsigned int max_stack,
+				   unsigned int max_locals);
+
+/**
+ * Adds an entry to the exception table of a method.
+ *
+ * @param[in]   m
+ *     the method
+ * @param[in]   start
+ *     the offset of the first instruction that the handler covers
+ * @param[in]   end
+ *     the offset one past the last instruction that the handler covers
+ * @param[in]   handler
+ *     the offset of the handler
+ * @param[in]   catch_type
+ *     pool index of the class of the exceptions caught, or 0 for all
+ */
+void cf_add_handler(CFmethod *m, size_t start, size_t end, size_t handler,
+					unsigned int catch_type);
+
+/**
+ * Adds an attribute, such as a StackMapTable, to the Code attribute of a
+ * method.
+ *
+ * @param[in]   cf
+ *     the class file
+ * @param[in]   m
+ *     the method
+ * @param[in]   name
+ *     the attribute name
+ * @param[in]   data
+ *     the attribute contents, which are copied
+ */
+void cf_add_code_attribute(ClassFile *cf, CFmethod *m, const char *name,
+						   const ByteBuf *data);
+
+/**
+ * Adds an attribute, such as a SourceFile, to the class itself.
+ *
+ * @param[in]   cf
+ *     the class file
+ * @param[in]   name
+ *     the attribute name
+ * @param[in]   data
+ *     the attribute contents, which are copied
+ */
+void cf_add_attribute(ClassFile *cf, const char *name, const ByteBuf *data);
+
+/**
+ * Serialises the class file into a buffer.
+ *
+ * @param[in]   cf
+ *     the class file
+ * @param[out]  out
+ *     the buffer to which the class file bytes are appended
+ */
+void cf_serialise(ClassFile *cf, ByteBuf *out);
+
+/**
+ * Writes the class file to disk.
+ *
+ * @param[in]   cf
+ *     the class file
+ * @param[in]   path
+ *     the path of the output file
+ * @return      <code>0</code> if the file was written successfully, or
+ *              <code>-1</code> otherwise
+ */
+int cf_write(ClassFile *cf, const char *path);
+
+/**
+ * Releases the memory resources associated with a class file.
+ *
+ * @param[in]   cf
+ *     the class file
+ */
+void cf_free(ClassFile *cf);
+
+#endif /* CLASSFILE_H */
@@ -6,10 +6,30 @@
  */
 
 #include "codegen.h"
+#include "alloc.h"
 #include "boolean.h"
+#include "classfile.h"
+#include "compiler.h"
+#include "dataflow.h"
+#include "dead.h"
 #include "error.h"
+#include "fold.h"
+#include "hashtable.h"
+#include "inline.h"
+#include "intern.h"
+#include "ir.h"
+#include "loops.h"
+#include "peephole.h"
+#include "runtime.h"
+#include "select.h"
+#include "stats.h"
 #include "valtypes.h"
 #include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -19,469 +39,528 @@
 
 /* --- type definitions and constants --------------------------------------- */
 
-typedef enum {
-	CODE_LABEL = 0x0001,
-	CODE_INSTRUCTION = 0x0002,
-	CODE_OPERAND = 0x0004,
-	MASK_TYPE = 0x000f,
-	CODE_INTEGER = 0x0010,
-	CODE_ARRAY_TYPE = 0x0020,
-	CODE_STRING = 0x0040,
-	CODE_REFERENCE = 0x0080,
-	MASK_DATA_TYPE = 0x00f0,
-	CODE_ALLOCATED = 0x0100,
-	MASK_ALLOCATION = 0x0f00
-} CodeType;
-
 typedef struct {
 	const char *instr;
 	short pop;
 	short push;
+	JVMopcode opcode;
 } BC;
 
-typedef struct {
-	CodeType type;
-	union {
-		JVMatype atype;
-		Bytecode code;
-		Label label;
-		int num;
-		char *string;
-	};
-} Code;
-
-typedef struct body_s Body;
-struct body_s {
-	char *name;
-	IDprop *idprop;
-	Code *code;
-	int ip;
-	int max_stack_depth;
-	int variables_width;
-	Body *next;
-	Body *prev;
-};
-
-/* --- Jasmin output string literals ---------------------------------------- */
-
-char class_preamble[] =
-	".class public %s\n"
-	".super java/lang/Object\n\n"
-	".field private static final charsetName Ljava/lang/String;\n"
-	".field private static final usLocale Ljava/util/Locale;\n"
-	".field private static final scanner Ljava/util/Scanner;\n\n"
-	".method static public <clinit>()V\n"
-	".limit stack 5\n"
-	".limit locals 1 \n"
-	"\tldc	\"UTF-8\"\n"
-	"\tputstatic %s/charsetName Ljava/lang/String;\n"
-	"\tnew	java/util/Locale\n"
-	"\tdup\n"
-	"\tldc	\"en\"\n"
-	"\tldc	\"US\"\n"
-	"\tinvokespecial "
-	"java/util/Locale/<init>(Ljava/lang/String;Ljava/lang/String;)V\n"
-	"\tputstatic %s/usLocale Ljava/util/Locale;\n"
-	"\tnew	java/util/Scanner\n"
-	"\tdup\n"
-	"\tnew	java/io/BufferedInputStream\n"
-	"\tdup\n"
-	"\tgetstatic java/lang/System/in Ljava/io/InputStream;\n"
-	"\tinvokespecial"
-	" java/io/BufferedInputStream/<init>(Ljava/io/InputStream;)V\n"
-	"\tgetstatic %s/charsetName Ljava/lang/String;\n"
-	"\tinvokespecial "
-	"java/util/Scanner/<init>(Ljava/io/InputStream;Ljava/lang/String;)V\n"
-	"\tputstatic %s/scanner Ljava/util/Scanner;\n"
-	"\tgetstatic %s/scanner Ljava/util/Scanner;\n"
-	"\tgetstatic %s/usLocale Ljava/util/Locale;\n"
-	"\tinvokevirtual"
-	" java/util/Scanner/useLocale(Ljava/util/Locale;)Ljava/util/Scanner;\n"
-	"\tpop\n"
-	"\treturn\n"
-	".end method\n\n";
-
-char method_init[] = ".method public <init>()V\n"
-					 // ".limit stack 2\n"
-					 //".limit locals 1\n"
-					 "\taload 0\n"
-					 "\tinvokespecial java/lang/Object/<init>()V\n"
-					 "\treturn\n"
-					 ".end method\n\n";
-
-char method_readBoolean[] =
-	".method public static readBoolean()Z\n"
-	".limit stack 2\n"
-	".limit locals 1\n"
-	"\tgetstatic %s/scanner Ljava/util/Scanner;\n"
-	"\tinvokevirtual java/util/Scanner/next()Ljava/lang/String;\n"
-	"\tastore 0\n"
-	"\taload 0\n"
-	"\tldc	\"true\"\n"
-	"\tinvokevirtual "
-	"java/lang/String/equalsIgnoreCase(Ljava/lang/String;)Z\n"
-	"\tifeq False\n"
-	"\ticonst_1\n"
-	"\tireturn\n"
-	"False:\n"
-	"\taload 0\n"
-	"\tldc	\"false\"\n"
-	"\tinvokevirtual "
-	"java/lang/String/equalsIgnoreCase(Ljava/lang/String;)Z\n"
-	"\tifeq Exception\n"
-	"\ticonst_0\n"
-	"\tireturn\n"
-	"Exception:\n"
-	"\tnew	java/util/InputMismatchException\n"
-	"\tdup\n"
-	"\tinvokespecial java/util/InputMismatchException/<init>()V\n"
-	"\tathrow\n"
-	".end method\n\n";
-
-char method_readInt[] = ".method public static readInt()I\n"
-						".limit stack 1\n"
-						".limit locals 1\n"
-						"\tgetstatic %s/scanner Ljava/util/Scanner;\n"
-						"\tinvokevirtual java/util/Scanner/nextInt()I\n"
-						"\tireturn\n"
-						".end method\n\n";
-
-char ref_print_boolean[] = "java/io/PrintStream/print(Z)V";
-char ref_print_integer[] = "java/io/PrintStream/print(I)V";
-char ref_print_stream[] = "java/lang/System/out Ljava/io/PrintStream;";
-char ref_print_string[] = "java/io/PrintStream/print(Ljava/lang/String;)V";
-char *ref_read_boolean; /* must be set in set_class_name */
-char *ref_read_integer; /* must be set in set_class_name */
-
-#define REF_READ_BOOLEAN "/readBoolean()Z"
-#define REF_READ_INTEGER "/readInt()I"
-
 /* --- global static variables ---------------------------------------------- */
 
 static BC instruction_set[] = {
-	{"aload", 0, 1},         {"areturn", 1, 0},   {"astore", 1, 0},
-	{"getstatic", 0, 1},     {"goto", 0, 0},      {"iadd", 2, 1},
-	{"iaload", 2, 1},        {"iand", 2, 1},      {"iastore", 3, 0},
-	{"idiv", 2, 1},          {"ifeq", 1, 0},      {"if_icmpeq", 2, 0},
-	{"if_icmpge", 2, 0},     {"if_icmpgt", 2, 0}, {"if_icmple", 2, 0},
-	{"if_icmplt", 2, 0},     {"if_icmpne", 2, 0}, {"iload", 0, 1},
-	{"imul", 2, 1},          {"ineg", 1, 1},      {"invokestatic", 0, 1},
-	{"invokevirtual", 0, 0}, {"ior", 2, 1},       {"istore", 1, 0},
-	{"isub", 2, 1},          {"irem", 2, 1},      {"ireturn", 1, 0},
-	{"ixor", 2, 1},          {"ldc", 0, 1},       {"newarray", 1, 1},
-	{"return", 0, 0},        {"swap", 2, 2}};
+	{"aload", 0, 1, OP_ALOAD},                 /* typed by local variable */
+	{"areturn", 1, 0, OP_ARETURN},
+	{"astore", 1, 0, OP_ASTORE},
+	{"dup", 1, 2, OP_DUP},                     /* typed by its operand */
+	{"getstatic", 0, 1, OP_GETSTATIC},         /* depends on field type */
+	{"goto", 0, 0, OP_GOTO},
+	{"iadd", 2, 1, OP_IADD},
+	{"iaload", 2, 1, OP_IALOAD},
+	{"iand", 2, 1, OP_IAND},
+	{"iastore", 3, 0, OP_IASTORE},
+	{"idiv", 2, 1, OP_IDIV},
+	{"ifeq", 1, 0, OP_IFEQ},
+	{"ifge", 1, 0, OP_IFGE},
+	{"ifgt", 1, 0, OP_IFGT},
+	{"ifle", 1, 0, OP_IFLE},
+	{"iflt", 1, 0, OP_IFLT},
+	{"ifne", 1, 0, OP_IFNE},
+	{"if_icmpeq", 2, 0, OP_IF_ICMPEQ},
+	{"if_icmpge", 2, 0, OP_IF_ICMPGE},
+	{"if_icmpgt", 2, 0, OP_IF_ICMPGT},
+	{"if_icmple", 2, 0, OP_IF_ICMPLE},
+	{"if_icmplt", 2, 0, OP_IF_ICMPLT},
+	{"if_icmpne", 2, 0, OP_IF_ICMPNE},
+	{"iinc", 0, 0, OP_IINC},                   /* slot and increment */
+	{"iload", 0, 1, OP_ILOAD},
+	{"imul", 2, 1, OP_IMUL},
+	{"ineg", 1, 1, OP_INEG},
+	{"invokestatic", 0, 0, OP_INVOKESTATIC},   /* depends on signature */
+	{"invokevirtual", 0, 0, OP_INVOKEVIRTUAL}, /* depends on signature */
+	{"ior", 2, 1, OP_IOR},
+	{"ishl", 2, 1, OP_ISHL},
+	{"ishr", 2, 1, OP_ISHR},
+	{"istore", 1, 0, OP_ISTORE},
+	{"isub", 2, 1, OP_ISUB},
+	{"irem", 2, 1, OP_IREM},
+	{"ireturn", 1, 0, OP_IRETURN},
+	{"ixor", 2, 1, OP_IXOR},
+	{"ldc", 0, 1, OP_LDC},
+	{"newarray", 1, 1, OP_NEWARRAY},
+	{"pop", 1, 0, OP_POP},
+	{"return", 0, 0, OP_RETURN},
+	{"swap", 2, 2, OP_SWAP}};
+
+/* XXX Note: The pop and push counts are the net stack effects of instructions
+ * whose effect is fixed.  The data-flow analysis in dataflow.c works out the
+ * effects of calls and field accesses from their descriptors.
+ */
 
 static const char *java_types[] = {"boolean", "char",  "float", "double",
 								   "byte",    "short", "int",   "long"};
 
 #define NBYTECODES (sizeof(instruction_set) / sizeof(BC))
-#define INITIAL_SIZE 1024
 #define JASM_EXT ".jasmin"
-
-static char *class_name;    /**< the class name                             */
-static char *function_name; /**< the name of current function               */
-static char *jasm_name;     /**< the jasmin file name                       */
-static int code_size;       /**< the current code array size                */
-static int ip;              /**< the instruction pointer                    */
-static Body *bodies;        /**< list of function bodies                    */
-static Code *code;          /**< the generated code                         */
-static IDprop *idprop;      /**< id properties of the current function      */
-
-int stack_depth, max_stack_depth;
+#define JASM_STDIN "/dev/stdin"
+#define CLASS_EXT ".class"
+
+struct codegen_s {
+	char *class_name;       /**< the class name                             */
+	char *class_path;       /**< the class file name                        */
+	const char *function_name; /**< the name of current function            */
+	char *function_ref;     /**< the method reference of current function   */
+	char *jasm_name;        /**< the name of the Jasmin text in diagnostics */
+	ByteBuf jasm;           /**< the Jasmin text, once it has been made     */
+	Body *bodies;           /**< list of function bodies                    */
+	IRfunc *ir;             /**< the IR of the current function             */
+	IDprop *idprop;         /**< id properties of the current function      */
+	Body *last_body;        /**< the most recently closed function body     */
+	Label next_label;       /**< the next unused label                      */
+	char *ref_read_boolean; /**< set in set_class_name                      */
+	char *ref_read_integer; /**< set in set_class_name                      */
+	char *ref_write_boolean; /**< set in set_class_name                     */
+	char *ref_write_integer; /**< set in set_class_name                     */
+	char *ref_write_string; /**< set in set_class_name                      */
+	char *ref_profile_enter; /**< set in set_class_name                     */
+	char *ref_profile_exit; /**< set in set_class_name                      */
+	char *ref_profile_loop; /**< set in set_class_name                      */
+	Boolean profile;        /**< whether the calls and loops are profiled   */
+	const char *source_name; /**< the source file name, without directories */
+	ByteBuf points;         /**< the profiled points, a line each           */
+	int npoints;            /**< the number of profiled points              */
+	int function_point;     /**< the profiled point of the current function */
+	int line;               /**< the source line that starts at line_offset */
+	size_t line_offset;     /**< the offset of the last source line found   */
+	HashTab *methods;       /**< method references, by interned name        */
+	HashTab *callees;       /**< the bodies, by their method reference      */
+	InlineStats inlining;   /**< what inlining did                          */
+	DeadStats dead;         /**< what dead code elimination did             */
+	FoldStats fold;         /**< what constant folding did                  */
+	LoopStats loops;        /**< what the loop optimisations did            */
+	PeepholeStats peephole; /**< what the peephole optimiser did            */
+	SelectStats select;     /**< what instruction selection did             */
+	AllocStats alloc;       /**< what slot allocation did                   */
+};
 
 /* --- function prototypes -------------------------------------------------- */
 
-static void ensure_space(int num_instr);
-static void adjust_stack(BC *instr);
+static char *method_ref(AlanCompiler *ac, const char *fname, IDprop *idprop);
+static char *runtime_ref(const char *class_name, const char *method);
+static unsigned int runtime_uses(CodeGen *cg);
+static void runtime_program(CodeGen *cg, RTprogram *program);
+static int add_point(CodeGen *cg, const char *kind, const char *name,
+		int line);
+static void gen_profile_call(CodeGen *cg, char *ref, int point);
+static int source_line(AlanCompiler *ac);
+static void free_nothing(void *p);
+static unsigned int ref_hash(void *key, unsigned int size);
+static int ref_cmp(void *val1, void *val2);
+static void feed_assembler(AlanCompiler *ac, int to, int from);
 
 /* --- code generation interface -------------------------------------------- */
 
-void init_code_generation(void)
+void init_code_generation(AlanCompiler *ac)
 {
-	bodies = NULL;
+	if (ac->codegen == NULL) {
+		ac->codegen = emalloc(sizeof(CodeGen));
+	}
+	memset(ac->codegen, 0, sizeof(CodeGen));
+	ac->codegen->next_label = 1;
+	ac->codegen->profile = ac->options.profile;
+	ac->codegen->line = 1;
+	if ((ac->codegen->methods = ht_init(0.75f, intern_hash, intern_cmp))
+			== NULL) {
+		eprintf("Could not allocate the method references");
+	}
+	if ((ac->codegen->callees = ht_init(0.75f, ref_hash, ref_cmp)) == NULL) {
+		eprintf("Could not allocate the table of callees");
+	}
 }
 
-void init_subroutine_codegen(const char *name, IDprop *p)
+void init_subroutine_codegen(AlanCompiler *ac, const char *name, IDprop *p)
 {
-	max_stack_depth = stack_depth = 0;
-	ip = 0;
-	code = emalloc(sizeof(Code) * INITIAL_SIZE);
-	code_size = INITIAL_SIZE;
-	function_name = estrdup(name);
-	idprop = p;
+	CodeGen *cg = ac->codegen;
+
+	cg->ir = ir_new(ac->arena, cg->next_label);
+	cg->function_name = name;
+	cg->idprop = p;
+
+	/* the calls are counted on entry, and the time is taken before every
+	 * return, which gen_1 sees to */
+	if (cg->profile) {
+		cg->ir->line = source_line(ac);
+		cg->function_point = add_point(cg, "function", name, cg->ir->line);
+		gen_profile_call(cg, cg->ref_profile_enter, cg->function_point);
+	}
+
+	/* the reference is built once, while the parameter types are at hand, and
+	 * every call site shares it; should a name be defined twice, calls go to
+	 * the first definition, just as the symbol table resolves them */
+	if (strcmp(name, "main") != 0) {
+		cg->function_ref = method_ref(ac, name, p);
+		ht_insert(cg->methods, (void *) name, cg->function_ref);
+	}
 }
 
-void close_subroutine_codegen(int varwidth)
+void close_subroutine_codegen(AlanCompiler *ac, int varwidth)
 {
+	CodeGen *cg = ac->codegen;
 	Body *body;
+	InlineOptions inliner;
+	char prefix[BUFSIZ];
+	Boolean folded;
+	Phase phase;
 
-	body = emalloc(sizeof(Body));
+	phase = stats_phase(ac, PHASE_CODEGEN);
+	body = arena_alloc(ac->arena, sizeof(Body));
 
 	/* populate new body */
-	body->name = function_name;
-	body->idprop = idprop;
-	body->code = code;
-	body->ip = ip;
-	body->max_stack_depth = max_stack_depth;
+	body->name = cg->function_name;
+	body->ref = cg->function_ref;
+	body->idprop = cg->idprop;
+	body->ir = cg->ir;
 	body->variables_width = varwidth;
 
-	// link
-	// body->next
+	/* the callees are inlined before the caller is optimised as a whole */
+	if (ac->options.optimise >= 2) {
+		snprintf(prefix, sizeof(prefix), "%s: ", ac->src_name);
+		inliner.bodies = cg->callees;
+		inliner.limit = (ac->options.inline_limit > 0
+				? ac->options.inline_limit : ALAN_INLINE_LIMIT);
+		inliner.report = (!ac->options.inline_report ? NULL
+				: ac->diag ? ac->diag : stderr);
+		inliner.prefix = prefix;
+		inline_calls(body, &inliner, &cg->inlining);
+	}
 
-	// old = bodies;
+	/* folding decides branches, after which the peephole optimiser joins
+	 * blocks whose constants may then fold in turn */
+	if (ac->options.optimise >= 1) {
+		do {
+			folded = fold_constants(body->ir,
+					(body->idprop ? body->idprop->nparams : 0), &cg->fold);
+			peephole(body->ir, &cg->peephole);
+		} while (folded);
+		remove_dead_blocks(body->ir, &cg->dead);
+		if (ac->options.optimise >= 2) {
+			optimise_loops(body->ir, &body->variables_width, &cg->loops);
+		}
+		body->variables_width = allocate_slots(body->ir,
+				(body->idprop ? body->idprop->nparams : 0), &cg->alloc);
+		select_instructions(body->ir, &cg->select);
+	}
 
-	while (bodies) {
-		bodies = bodies->next;
+	/* lower the blocks into the code array from which the output is written,
+	 * with the source lines of the code if the program is profiled */
+	body->lines = NULL;
+	ir_lower(body->ir, &cg->next_label, &body->code, &body->ip,
+			(cg->profile ? &body->lines : NULL));
+
+	/* derive the exact stack and local variable limits from the code */
+	body->flow = analyse_flow(body);
+	if (body->flow->underflow) {
+		cweprintf(ac, "operand stack underflow in %s", body->name);
+	}
+	body->max_stack_depth = body->flow->max_stack;
+	body->variables_width = body->flow->nlocals;
+	stats_add_body(ac, body->name, body->ip, body->max_stack_depth,
+			body->variables_width);
+
+	/* link at the tail, so that methods are emitted in source order */
+	body->next = NULL;
+	body->prev = cg->last_body;
+	if (cg->last_body) {
+		cg->last_body->next = body;
+	} else {
+		cg->bodies = body;
 	}
-	bodies = body;
-	bodies->next = NULL;
+	cg->last_body = body;
+	if (body->ref) {
+		ht_insert(cg->callees, body->ref, body);
+	}
+
+	/* main, the only body without a method reference, is compiled last, after
+	 * which the whole call graph is known */
+	if (body->ref == NULL && ac->options.optimise >= 1) {
+		remove_dead_functions(&cg->bodies, body, &cg->dead);
+	}
+
+	cg->ir = NULL;
+	cg->function_name = NULL;
+	cg->function_ref = NULL;
+	stats_phase(ac, phase);
 }
 
-void set_class_name(char *cname)
+void report_optimisations(AlanCompiler *ac)
 {
-	size_t class_name_len;
-
-	class_name = estrdup(cname);
-	class_name_len = strlen(class_name);
+	char prefix[BUFSIZ];
+
+	snprintf(prefix, sizeof(prefix), "%s: ", ac->src_name);
+	print_inline_stats((ac->diag ? ac->diag : stderr), prefix,
+			&ac->codegen->inlining);
+	print_dead_stats((ac->diag ? ac->diag : stderr), prefix,
+			&ac->codegen->dead);
+	print_fold_stats((ac->diag ? ac->diag : stderr), prefix,
+			&ac->codegen->fold);
+	print_loop_stats((ac->diag ? ac->diag : stderr), prefix,
+			&ac->codegen->loops);
+	print_peephole_stats((ac->diag ? ac->diag : stderr), prefix,
+			&ac->codegen->peephole);
+	print_select_stats((ac->diag ? ac->diag : stderr), prefix,
+			&ac->codegen->select);
+	print_alloc_stats((ac->diag ? ac->diag : stderr), prefix,
+			&ac->codegen->alloc);
+}
 
-	jasm_name = emalloc(class_name_len + sizeof(JASM_EXT));
-	strcpy(jasm_name, class_name);
-	strncat(jasm_name, JASM_EXT, sizeof(JASM_EXT));
+const char *get_class_path(AlanCompiler *ac)
+{
+	return ac->codegen->class_path;
+}
 
-	ref_read_boolean = emalloc(class_name_len + sizeof(REF_READ_BOOLEAN));
-	strcpy(ref_read_boolean, class_name);
-	strncat(ref_read_boolean, REF_READ_BOOLEAN, sizeof(REF_READ_BOOLEAN));
+void set_class_name(AlanCompiler *ac, const char *cname)
+{
+	CodeGen *cg = ac->codegen;
+	const char *slash;
+	size_t class_name_len;
 
-	ref_read_integer = emalloc(class_name_len + sizeof(REF_READ_INTEGER));
-	strcpy(ref_read_integer, class_name);
-	strncat(ref_read_integer, REF_READ_INTEGER, sizeof(REF_READ_INTEGER));
+	cg->class_name = estrdup(cname);
+	class_name_len = strlen(cg->class_name);
+
+	cg->jasm_name = emalloc(class_name_len + sizeof(JASM_EXT));
+	strcpy(cg->jasm_name, cg->class_name);
+	strncat(cg->jasm_name, JASM_EXT, sizeof(JASM_EXT));
+
+	cg->class_path = emalloc(class_name_len + sizeof(CLASS_EXT));
+	strcpy(cg->class_path, cg->class_name);
+	strcat(cg->class_path, CLASS_EXT);
+
+	cg->ref_read_boolean = runtime_ref(cg->class_name, RT_REF_READ_BOOLEAN);
+	cg->ref_read_integer = runtime_ref(cg->class_name, RT_REF_READ_INTEGER);
+	cg->ref_write_boolean = runtime_ref(cg->class_name, RT_REF_WRITE_BOOLEAN);
+	cg->ref_write_integer = runtime_ref(cg->class_name, RT_REF_WRITE_INTEGER);
+	cg->ref_write_string = runtime_ref(cg->class_name, RT_REF_WRITE_STRING);
+	cg->ref_profile_enter = runtime_ref(cg->class_name, RT_REF_PROFILE_ENTER);
+	cg->ref_profile_exit = runtime_ref(cg->class_name, RT_REF_PROFILE_EXIT);
+	cg->ref_profile_loop = runtime_ref(cg->class_name, RT_REF_PROFILE_LOOP);
+
+	/* the source file is named as the JVM expects, without its directory */
+	cg->source_name = (ac->src_name ? ac->src_name : "");
+	if ((slash = strrchr(cg->source_name, '/')) != NULL) {
+		cg->source_name = slash + 1;
+	}
 }
 
-void assemble(const char *jasmin_path)
+void assemble(AlanCompiler *ac, const char *jasmin_path)
 {
-	int status;
+	int status, in[2], out[2];
 	pid_t pid;
 
+	/* with a diagnostic stream of its own, the output of Jasmin is captured
+	 * there, rather than being interleaved with that of other compilations */
+	if (pipe(in) < 0 || (ac->diag && pipe(out) < 0)) {
+		ceprintf(ac, "Could not create a pipe for assembler:");
+	}
+
 	if ((pid = fork()) < 0) {
-		eprintf("Could not fork a new process for assembler");
+		ceprintf(ac, "Could not fork a new process for assembler");
 	} else if (pid == 0) {
-		if (execlp("java", "java", "-jar", jasmin_path, jasm_name,
+		close(in[1]);
+		dup2(in[0], STDIN_FILENO);
+		close(in[0]);
+		if (ac->diag) {
+			close(out[0]);
+			dup2(out[1], STDOUT_FILENO);
+			dup2(out[1], STDERR_FILENO);
+			close(out[1]);
+		}
+		if (execlp("java", "java", "-jar", jasmin_path, JASM_STDIN,
 				   (char *)NULL) < 0) {
 			eprintf("Could not exec Jasmin");
 		}
 	}
 
+	close(in[0]);
+	if (ac->diag) {
+		close(out[1]);
+	}
+	feed_assembler(ac, in[1], (ac->diag ? out[0] : -1));
+
 	if (waitpid(pid, &status, 0) < 0) {
-		eprintf("Error waiting for Jasmin");
+		ceprintf(ac, "Error waiting for Jasmin");
 	} else {
 		if (WIFEXITED(status) && WEXITSTATUS(status) != EXIT_SUCCESS) {
-			eprintf("Jasmin reported failure");
+			ceprintf(ac, "Jasmin reported failure");
 		} else if (WIFSIGNALED(status) || WIFSTOPPED(status)) {
-			eprintf("Jasmin stopped or terminated abnormally");
+			ceprintf(ac, "Jasmin stopped or terminated abnormally");
 		}
 	}
 }
 
-void gen_1(Bytecode opcode)
+void assemble_on_server(AlanCompiler *ac, AsmServer *server)
 {
-	ensure_space(1);
-	code[ip].type = CODE_INSTRUCTION;
-	code[ip++].code = opcode;
+	CodeGen *cg = ac->codegen;
 
-	adjust_stack(&instruction_set[opcode]);
+	if (asm_server_assemble(server, cg->jasm_name, cg->jasm.data,
+			cg->jasm.len, (ac->diag ? ac->diag : stderr)) < 0) {
+		ceprintf(ac, "Jasmin reported failure");
+	}
 }
 
-void gen_2(Bytecode opcode, int operand)
+void gen_1(AlanCompiler *ac, Bytecode opcode)
 {
-	ensure_space(2);
-
-	code[ip].type = CODE_INSTRUCTION;
-	code[ip++].code = opcode;
+	CodeGen *cg = ac->codegen;
 
-	code[ip].type = CODE_OPERAND | CODE_INTEGER;
-	code[ip++].num = operand;
-
-	adjust_stack(&instruction_set[opcode]);
+	if (cg->profile && (opcode == JVM_RETURN || opcode == JVM_IRETURN
+			|| opcode == JVM_ARETURN)) {
+		gen_profile_call(cg, cg->ref_profile_exit, cg->function_point);
+	}
+	ir_emit(cg->ir, opcode, 0);
 }
 
-void gen_call(char *fname, IDprop *idprop)
+void gen_2(AlanCompiler *ac, Bytecode opcode, int operand)
 {
-	char *fpath;
-	unsigned int i;
-
-	ensure_space(2);
+	ir_emit(ac->codegen->ir, opcode, CODE_INTEGER)->num = operand;
+}
 
-	code[ip].type = CODE_INSTRUCTION;
-	code[ip++].code = JVM_INVOKESTATIC;
+void gen_call(AlanCompiler *ac, const char *fname, IDprop *idprop)
+{
+	CodeGen *cg = ac->codegen;
+	void *ref;
 
-	/* 6 + 2 * idprop->nparams:
-	 *  -- 1 for '\0'
-	 *  -- 2 for '(' and ')' of parameter list
-	 *  -- 1 for '.' separating class from method name
-	 *  -- 2 for return type, including possibility of array type
-	 * the multiplier of 2 includes the possibilities of array types
-	 */
-	fpath = emalloc(strlen(class_name) + strlen(fname) +
-					(6 + 2 * idprop->nparams) * sizeof(char));
-	strcpy(fpath, class_name);
-	strcat(fpath, ".");
-	strcat(fpath, fname);
-	strcat(fpath, "(");
-	for (i = 0; i < idprop->nparams; i++) {
-		if (IS_ARRAY_TYPE(idprop->params[i])) {
-			strcat(fpath, "[");
-		}
-		strcat(fpath, "I");
+	if (!ht_search(cg->methods, (void *) fname, &ref)) {
+		ref = method_ref(ac, fname, idprop);
 	}
-	strcat(fpath, ")");
-	if (IS_ARRAY_TYPE(idprop->type)) {
-		strcat(fpath, "[");
-	}
-	if (idprop->type == TYPE_CALLABLE) {
-		strcat(fpath, "V");
-	} else {
-		strcat(fpath, "I");
-	}
-
-	code[ip].type = CODE_OPERAND | CODE_REFERENCE | CODE_ALLOCATED;
-	code[ip++].string = fpath;
-
-	adjust_stack(&instruction_set[JVM_INVOKESTATIC]);
+	ir_emit(cg->ir, JVM_INVOKESTATIC, CODE_REFERENCE)->string = ref;
 }
 // used when theres an if in expr
-void gen_cmp(Bytecode opcode)
+void gen_cmp(AlanCompiler *ac, Bytecode opcode)
 {
 	int l1, l2;
 
-	/* unnecessary to adjust stack depth or to ensure space, since both are
-	 * handled in the other gen functions
-	 */
-	l1 = get_label();
-	l2 = get_label();
-	gen_2_label(opcode, l1);
-	gen_2(JVM_LDC, FALSE);
-	gen_2_label(JVM_GOTO, l2);
-	gen_label(l1);
-	gen_2(JVM_LDC, TRUE);
-	gen_label(l2);
+	l1 = get_label(ac);
+	l2 = get_label(ac);
+	gen_2_label(ac, opcode, l1);
+	gen_2(ac, JVM_LDC, FALSE);
+	gen_2_label(ac, JVM_GOTO, l2);
+	gen_label(ac, l1);
+	gen_2(ac, JVM_LDC, TRUE);
+	gen_label(ac, l2);
 }
 // a variable name
-void gen_label(Label label)
+void gen_label(AlanCompiler *ac, Label label)
 {
-	ensure_space(1);
-
-	code[ip].type = CODE_LABEL;
-	code[ip++].label = label;
+	ir_place_label(ac->codegen->ir, label);
 }
 
-void gen_2_label(Bytecode opcode, Label label)
+void gen_line(AlanCompiler *ac)
 {
-	ensure_space(2);
-	code[ip].type = CODE_INSTRUCTION;
-	code[ip++].code = opcode;
-
-	code[ip].type = CODE_LABEL;
-	code[ip++].label = label;
-
-	adjust_stack(&instruction_set[opcode]);
+	if (ac->codegen->profile) {
+		ac->codegen->ir->line = source_line(ac);
+	}
 }
 
-void gen_newarray(JVMatype atype)
+void gen_2_label(AlanCompiler *ac, Bytecode opcode, Label label)
 {
-	ensure_space(2);
-
-	code[ip].type = CODE_INSTRUCTION;
-	code[ip++].code = JVM_NEWARRAY;
-
-	code[ip].type = CODE_OPERAND | CODE_ARRAY_TYPE;
-	code[ip++].atype = atype;
-
-	adjust_stack(&instruction_set[JVM_NEWARRAY]);
+	ir_emit_branch(ac->codegen->ir, opcode, label);
 }
 
-void gen_print(ValType type)
+void gen_newarray(AlanCompiler *ac, JVMatype atype)
 {
-	ensure_space(5);
-
-	code[ip].type = CODE_INSTRUCTION;
-	code[ip++].code = JVM_GETSTATIC;
+	ir_emit(ac->codegen->ir, JVM_NEWARRAY, CODE_ARRAY_TYPE)->atype = atype;
+}
 
-	code[ip].type = CODE_OPERAND | CODE_REFERENCE;
-	code[ip++].string = ref_print_stream;
+void gen_profile_loop(AlanCompiler *ac)
+{
+	CodeGen *cg = ac->codegen;
 
-	code[ip].type = CODE_INSTRUCTION;
-	code[ip++].code = JVM_SWAP;
+	if (cg->profile) {
+		gen_profile_call(cg, cg->ref_profile_loop,
+				add_point(cg, "loop", cg->function_name, cg->ir->line));
+	}
+}
 
-	code[ip].type = CODE_INSTRUCTION;
-	code[ip++].code = JVM_INVOKEVIRTUAL;
+void gen_print(AlanCompiler *ac, ValType type)
+{
+	CodeGen *cg = ac->codegen;
+	IRinsn *i;
 
-	code[ip].type = CODE_OPERAND | CODE_REFERENCE;
+	i = ir_emit(cg->ir, JVM_INVOKESTATIC, CODE_REFERENCE);
 	if (IS_CALLABLE_TYPE(type)) {
 		SET_RETURN_TYPE(type);
 	}
 	if (type == TYPE_BOOLEAN) {
-		code[ip++].string = ref_print_boolean;
+		i->string = cg->ref_write_boolean;
 	} else if (type == TYPE_INTEGER) {
-		code[ip++].string = ref_print_integer;
+		i->string = cg->ref_write_integer;
 	} else {
 		assert(FALSE);
 	}
-
-	adjust_stack(&instruction_set[JVM_GETSTATIC]);
-	adjust_stack(&instruction_set[JVM_SWAP]);
-	adjust_stack(&instruction_set[JVM_INVOKEVIRTUAL]);
 }
 
-void gen_print_string(char *string)
+void gen_print_string(AlanCompiler *ac, char *string)
 {
-	ensure_space(6);
-
-	code[ip].type = CODE_INSTRUCTION;
-	code[ip++].code = JVM_GETSTATIC;
-
-	code[ip].type = CODE_OPERAND | CODE_REFERENCE;
-	code[ip++].string = ref_print_stream;
-
-	code[ip].type = CODE_INSTRUCTION;
-	code[ip++].code = JVM_LDC;
-
-	code[ip].type = CODE_OPERAND | CODE_STRING | CODE_ALLOCATED;
-	code[ip++].string = string;
-
-	code[ip].type = CODE_INSTRUCTION;
-	code[ip++].code = JVM_INVOKEVIRTUAL;
+	CodeGen *cg = ac->codegen;
 
-	code[ip].type = CODE_OPERAND | CODE_REFERENCE;
-	code[ip++].string = ref_print_string;
-
-	adjust_stack(&instruction_set[JVM_GETSTATIC]);
-	adjust_stack(&instruction_set[JVM_LDC]);
-	adjust_stack(&instruction_set[JVM_INVOKEVIRTUAL]);
+	ir_emit(cg->ir, JVM_LDC, CODE_STRING)->string = string;
+	ir_emit(cg->ir, JVM_INVOKESTATIC, CODE_REFERENCE)->string =
+		cg->ref_write_string;
 }
 
-void gen_read(ValType type)
+void gen_read(AlanCompiler *ac, ValType type)
 {
-	ensure_space(2);
-
-	code[ip].type = CODE_INSTRUCTION;
-	code[ip++].code = JVM_INVOKESTATIC;
+	CodeGen *cg = ac->codegen;
+	IRinsn *i;
 
-	code[ip].type = CODE_OPERAND | CODE_REFERENCE;
+	i = ir_emit(cg->ir, JVM_INVOKESTATIC, CODE_REFERENCE);
 	if (type == TYPE_BOOLEAN) {
-		code[ip++].string = ref_read_boolean;
+		i->string = cg->ref_read_boolean;
 	} else if (type == TYPE_INTEGER) {
-		code[ip++].string = ref_read_integer;
+		i->string = cg->ref_read_integer;
 	} else {
 		assert(FALSE);
 	}
+}
 
-	adjust_stack(&instruction_set[JVM_INVOKESTATIC]);
+void begin_code_range(AlanCompiler *ac, CodeRange *range)
+{
+	range->first = range->last = ac->codegen->ir->current;
+}
+
+void end_code_range(AlanCompiler *ac, CodeRange *range)
+{
+	range->last = ac->codegen->ir->current;
 }
 
-Label get_label(void)
+void move_code_range(AlanCompiler *ac, CodeRange *range)
 {
-	static Label label = 1;
-	return label++;
+	ir_move_to_end(ac->codegen->ir, range->first, range->last);
+}
+
+Label get_label(AlanCompiler *ac)
+{
+	return ac->codegen->next_label++;
+}
+
+Bytecode get_inverse_branch(Bytecode opcode)
+{
+	switch (opcode) {
+		case JVM_IFEQ:      return JVM_IFNE;
+		case JVM_IFNE:      return JVM_IFEQ;
+		case JVM_IFLT:      return JVM_IFGE;
+		case JVM_IFGE:      return JVM_IFLT;
+		case JVM_IFGT:      return JVM_IFLE;
+		case JVM_IFLE:      return JVM_IFGT;
+		case JVM_IF_ICMPEQ: return JVM_IF_ICMPNE;
+		case JVM_IF_ICMPNE: return JVM_IF_ICMPEQ;
+		case JVM_IF_ICMPLT: return JVM_IF_ICMPGE;
+		case JVM_IF_ICMPGE: return JVM_IF_ICMPLT;
+		case JVM_IF_ICMPGT: return JVM_IF_ICMPLE;
+		case JVM_IF_ICMPLE: return JVM_IF_ICMPGT;
+		default:
+			assert(!"not a conditional branch");
+			return opcode;
+	}
 }
 
 const char *get_opcode_string(Bytecode opcode)
@@ -493,110 +572,329 @@ const char *get_opcode_string(Bytecode opcode)
 	}
 }
 
+void get_stack_effect(Bytecode opcode, int *pop, int *push)
+{
+	assert((unsigned long)opcode < NBYTECODES);
+	*pop = instruction_set[opcode].pop;
+	*push = instruction_set[opcode].push;
+}
+
+JVMopcode get_opcode_value(Bytecode opcode)
+{
+	assert((unsigned long)opcode < NBYTECODES);
+	return instruction_set[opcode].opcode;
+}
+
 /* --- code dumping --------------------------------------------------------- */
 
-static void dump_code(FILE *file);
-static void dump_method(FILE *file, Body *b);
-static void dump_preamble(FILE *file, char *name);
+static const char *method_descriptor(Body *b);
+static void dump_code(CodeGen *cg, ByteBuf *out);
+static void dump_method(ByteBuf *out, Body *b);
+static int dump_short(ByteBuf *out, Code *c);
+static void dump_preamble(CodeGen *cg, ByteBuf *out);
+static void dump_label(ByteBuf *out, const char *before, Label label,
+		const char *after);
 
-void list_code(void)
+void list_code(AlanCompiler *ac)
 {
-dump_code(stdout);
+	ByteBuf out = { NULL, 0, 0 };
+
+	dump_code(ac->codegen, &out);
+	fwrite(out.data, 1, out.len, stdout);
+	free(out.data);
 }
 
-void dump_code(FILE *obj_file)
+static void dump_code(CodeGen *cg, ByteBuf *out)
 {
 	Body *b;
 
 	/* preamble */
-	dump_preamble(obj_file, class_name);
+	dump_preamble(cg, out);
 
 	/* dump the methods */
-	for (b = bodies; b; b = b->next) {
-		dump_method(obj_file, b);
+	for (b = cg->bodies; b; b = b->next) {
+		dump_method(out, b);
 	}
 }
 
-void make_code_file(void)
+void make_code_file(AlanCompiler *ac)
 {
-	FILE *obj_file;
-
-	if ((obj_file = fopen(jasm_name, "w")) == NULL) {
-		eprintf("Could not open code file:");
-	}
-
-	dump_code(obj_file);
+	CodeGen *cg = ac->codegen;
 
-	fclose(obj_file);
+	cg->jasm.len = 0;
+	dump_code(cg, &cg->jasm);
 }
 
 /* --- utility functions ---------------------------------------------------- */
 
-static void ensure_space(int num_instr)
+/**
+ * Builds the method reference of a function, that is, the class and function
+ * names with the method descriptor, in the arena of the compilation.
+ *
+ * @param[in] ac     the compiler context
+ * @param[in] fname  the name of the function
+ * @param[in] idprop the properties of the function
+ * @return           the method reference
+ */
+static char *method_ref(AlanCompiler *ac, const char *fname, IDprop *idprop)
 {
-	if (ip + num_instr > code_size) {
-		code = erealloc(code, code_size * 2 * sizeof(Code));
-		code_size *= 2;
+	CodeGen *cg = ac->codegen;
+	char *fpath;
+	unsigned int i;
+
+	/* 6 + 2 * idprop->nparams:
+	 *  -- 1 for '\0'
+	 *  -- 2 for '(' and ')' of parameter list
+	 *  -- 1 for '.' separating class from method name
+	 *  -- 2 for return type, including possibility of array type
+	 * the multiplier of 2 includes the possibilities of array types
+	 */
+	fpath = arena_alloc(ac->arena, strlen(cg->class_name) + strlen(fname) +
+						(6 + 2 * idprop->nparams) * sizeof(char));
+	strcpy(fpath, cg->class_name);
+	strcat(fpath, ".");
+	strcat(fpath, fname);
+	strcat(fpath, "(");
+	for (i = 0; i < idprop->nparams; i++) {
+		if (IS_ARRAY_TYPE(idprop->params[i])) {
+			strcat(fpath, "[");
+		}
+		strcat(fpath, "I");
+	}
+	strcat(fpath, ")");
+	if (IS_ARRAY_TYPE(idprop->type)) {
+		strcat(fpath, "[");
+	}
+	if (idprop->type == TYPE_CALLABLE) {
+		strcat(fpath, "V");
+	} else {
+		strcat(fpath, "I");
 	}
+
+	return fpath;
 }
 
 /**
- * Computes the net change in the stack depth caused by the instruction, and
- * updates the maximum stack depth if necessary.
+ * Builds the reference of a method of the run-time support, in the form in
+ * which the Jasmin output refers to it.
  *
- * @param[in] instr the instruction for which to factor in the stack effect.
+ * @param[in] class_name the name of the class
+ * @param[in] method     the method name and descriptor, after a slash
+ * @return               the method reference, which the caller must free
  */
-static void adjust_stack(BC *instr)
+static char *runtime_ref(const char *class_name, const char *method)
 {
-	stack_depth += instr->push;
-	if (stack_depth > max_stack_depth) {
-		max_stack_depth = stack_depth;
-	}
-	stack_depth -= instr->pop;
+	char *ref;
+
+	ref = emalloc(strlen(class_name) + strlen(method) + 1);
+	strcpy(ref, class_name);
+	strcat(ref, method);
+
+	return ref;
 }
 
 /**
- * Writes a method to the Jasmin output file.
+ * Finds the parts of the run-time support that the bodies call.  If they write
+ * output, or are profiled, main is renamed, so that the main of the run-time
+ * support can flush the output and write the profile however the program
+ * ends.
  *
- * @param[in] file the output file.
- * @param[in] b    the body of the method
+ * @param[in] cg the code generator
+ * @return       the parts of the run-time support that are used
  */
-static void dump_method(FILE *file, Body *b)
+static unsigned int runtime_uses(CodeGen *cg)
 {
+	Body *b;
 	int i;
-	unsigned int k;
+	unsigned int uses = 0;
 
-	if (strcmp(b->name, "main") == 0) {
-		fprintf(file, ".method public static main([Ljava/lang/String;)V\n");
-
-	} else {
-		fprintf(file, ".method public static %s(", b->name);
-		for (k = 0; k < b->idprop->nparams; k++) {
-			if (IS_ARRAY(b->idprop->params[k])) {
-				fputs("[", file);
+	for (b = cg->bodies; b; b = b->next) {
+		for (i = 0; i < b->ip; i++) {
+			if ((b->code[i].type & MASK_TYPE) != CODE_INSTRUCTION
+					|| b->code[i].code != JVM_INVOKESTATIC) {
+				continue;
+			}
+			if (b->code[i + 1].string == cg->ref_read_integer) {
+				uses |= RT_READ_INTEGER;
+			} else if (b->code[i + 1].string == cg->ref_read_boolean) {
+				uses |= RT_READ_BOOLEAN;
+			} else if (b->code[i + 1].string == cg->ref_write_integer) {
+				uses |= RT_WRITE_INTEGER;
+			} else if (b->code[i + 1].string == cg->ref_write_boolean) {
+				uses |= RT_WRITE_BOOLEAN;
+			} else if (b->code[i + 1].string == cg->ref_write_string) {
+				uses |= RT_WRITE_STRING;
 			}
-			fputs("I", file);
 		}
-		fprintf(file, ")%s%s\n", (IS_ARRAY_TYPE(b->idprop->type) ? "[" : ""),
-				(b->idprop->type == TYPE_CALLABLE ? "V" : "I"));
 	}
-	fprintf(file, ".limit stack %d\n", b->max_stack_depth);
-	fprintf(file, ".limit locals %d\n", b->variables_width);
+
+	if (cg->profile) {
+		uses |= RT_PROFILE;
+	}
+
+	for (b = cg->bodies; b; b = b->next) {
+		if (b->ref == NULL && (uses & (RT_OUTPUT | RT_PROFILE))) {
+			b->name = RT_MAIN_NAME;
+		}
+	}
+
+	return uses;
+}
+
+/**
+ * Describes the program to the run-time support: the parts of the support
+ * that it uses, and the points that are profiled, if any.
+ *
+ * @param[in]  cg      the code generator
+ * @param[out] program the description of the program
+ */
+static void runtime_program(CodeGen *cg, RTprogram *program)
+{
+	program->uses = runtime_uses(cg);
+	program->points = NULL;
+	program->npoints = 0;
+	if (cg->profile) {
+		bb_u1(&cg->points, '\0');
+		cg->points.len--;
+		program->points = (const char *) cg->points.data;
+		program->npoints = cg->npoints;
+	}
+}
+
+/**
+ * Adds a point to the profile, as a line that names it.
+ *
+ * @param[in] cg   the code generator
+ * @param[in] kind the kind of point, "function" or "loop"
+ * @param[in] name the name of the function in which it is
+ * @param[in] line the source line at which it starts
+ * @return         the number of the point
+ */
+static int add_point(CodeGen *cg, const char *kind, const char *name,
+		int line)
+{
+	bb_text(&cg->points, kind);
+	bb_u1(&cg->points, ' ');
+	bb_text(&cg->points, name);
+	bb_u1(&cg->points, ' ');
+	bb_decimal(&cg->points, line);
+	bb_u1(&cg->points, '\n');
+
+	return cg->npoints++;
+}
+
+/**
+ * Generates a call of a profiling method of the run-time support.
+ *
+ * @param[in] cg    the code generator
+ * @param[in] ref   the reference of the method
+ * @param[in] point the number of the point that it counts
+ */
+static void gen_profile_call(CodeGen *cg, char *ref, int point)
+{
+	ir_emit(cg->ir, JVM_LDC, CODE_INTEGER)->num = point;
+	ir_emit(cg->ir, JVM_INVOKESTATIC, CODE_REFERENCE)->string = ref;
+}
+
+/**
+ * Returns the line of the current token.  The source is scanned forward from
+ * the line that was found last, since the tokens come in source order.
+ *
+ * @param[in] ac the compiler context
+ * @return       the line number, or 0 if the source is not at hand
+ */
+static int source_line(AlanCompiler *ac)
+{
+	CodeGen *cg = ac->codegen;
+	const char *p, *end, *nl;
+	size_t offset = ac->position.offset;
+
+	if (ac->src_buf == NULL) {
+		return 0;
+	}
+	if (offset > ac->src_len) {
+		offset = ac->src_len;
+	}
+	if (offset < cg->line_offset) {
+		cg->line = 1;
+		cg->line_offset = 0;
+	}
+
+	p = ac->src_buf + cg->line_offset;
+	end = ac->src_buf + offset;
+	while ((nl = memchr(p, '\n', end - p)) != NULL) {
+		cg->line++;
+		p = nl + 1;
+	}
+	cg->line_offset = (size_t) (p - ac->src_buf);
+
+	return cg->line;
+}
+
+static void free_nothing(void *p)
+{
+	(void) p;
+}
+
+/* Every call site shares the method reference of its callee, so references
+ * are compared by address, as interned names are. */
+
+static unsigned int ref_hash(void *key, unsigned int size)
+{
+	return (unsigned int) (((uintptr_t) key / sizeof(void *)) % size);
+}
+
+static int ref_cmp(void *val1, void *val2)
+{
+	return (val1 != val2);
+}
+
+/**
+ * Writes a method in Jasmin.
+ *
+ * @param[in] out the buffer to which the text is appended.
+ * @param[in] b   the body of the method
+ */
+static void dump_method(ByteBuf *out, Body *b)
+{
+	int i, line = 0;
+
+	bb_text(out, ".method public static ");
+	bb_text(out, b->name);
+	bb_text(out, method_descriptor(b));
+	bb_text(out, "\n.limit stack ");
+	bb_decimal(out, b->max_stack_depth);
+	bb_text(out, "\n.limit locals ");
+	bb_decimal(out, b->variables_width);
+	bb_u1(out, '\n');
 
 	for (i = 0; i < b->ip; i++) {
 		Code c = b->code[i];
+		int k;
 
 		switch (c.type & MASK_TYPE) {
 			case CODE_LABEL:
-				fprintf(file, "L%d:\n", c.label);
+				dump_label(out, "L", c.label, ":\n");
 				break;
 			case CODE_LABEL | CODE_OPERAND:
-				fprintf(file, " L%d\n", c.label);
+				dump_label(out, " L", c.label, "\n");
 				break;
 			case CODE_INSTRUCTION:
-				fprintf(file, "\t%s", get_opcode_string(c.code));
+				if (b->lines && b->lines[i] && b->lines[i] != line) {
+					line = b->lines[i];
+					bb_text(out, ".line ");
+					bb_decimal(out, line);
+					bb_u1(out, '\n');
+				}
+				if ((k = dump_short(out, &b->code[i])) > 0) {
+					i += k;
+					break;
+				}
+				bb_u1(out, '\t');
+				bb_text(out, get_opcode_string(c.code));
 				switch (c.code) {
 					case JVM_ARETURN:
+					case JVM_DUP:
 					case JVM_IADD:
 					case JVM_IALOAD:
 					case JVM_IAND:
@@ -608,11 +906,14 @@ static void dump_method(FILE *file, Body *b)
 					case JVM_ISUB:
 					case JVM_IREM:
 					case JVM_IRETURN:
+					case JVM_ISHL:
+					case JVM_ISHR:
 					case JVM_IXOR:
+					case JVM_POP:
 					case JVM_RETURN:
 					case JVM_SWAP:
 						/* emit linefeed */
-						fprintf(file, "\n");
+						bb_u1(out, '\n');
 						break;
 					default:
 						/* no linefeed */
@@ -622,16 +923,24 @@ static void dump_method(FILE *file, Body *b)
 			case CODE_OPERAND:
 				switch (c.type & MASK_DATA_TYPE) {
 					case CODE_ARRAY_TYPE:
-						fprintf(file, " %s\n", java_types[c.atype - T_BOOLEAN]);
+						bb_u1(out, ' ');
+						bb_text(out, java_types[c.atype - T_BOOLEAN]);
+						bb_u1(out, '\n');
 						break;
 					case CODE_INTEGER:
-						fprintf(file, " %d\n", c.num);
+						bb_u1(out, ' ');
+						bb_decimal(out, c.num);
+						bb_u1(out, '\n');
 						break;
 					case CODE_REFERENCE:
-						fprintf(file, " %s\n", c.string);
+						bb_u1(out, ' ');
+						bb_text(out, c.string);
+						bb_u1(out, '\n');
 						break;
 					case CODE_STRING:
-						fprintf(file, " \"%s\"\n", c.string);
+						bb_text(out, " \"");
+						bb_text(out, c.string);
+						bb_text(out, "\"\n");
 						break;
 					default:
 						weprintf("Unknown data type for bytecode: %x\n",
@@ -646,46 +955,795 @@ static void dump_method(FILE *file, Body *b)
 
 	/* guard against a dangling label at the end of the code stream */
 	if ((b->code[b->ip - 1].type & MASK_TYPE) == CODE_LABEL) {
-		fprintf(file, "\tnop\n");
+		bb_text(out, "\tnop\n");
 	}
 
-	fprintf(file, ".end method\n\n");
+	bb_text(out, ".end method\n\n");
 }
 
 /**
- * Writes the preamble to the Jasmin output file.  The preamble consists of (i)
- * the class name and visibility specifier, (ii) the superclass, and (iii) the
- * default initialiser (constructor).
+ * Writes an instruction in a shorter form, if it has one: an integer constant
+ * that fits into the instruction, a load or store of one of the first four
+ * local variables, or an increment, of which both operands are on one line.
  *
- * @param[in] file the output file.
- * @param[in] name the name of the class.
+ * @param[in] out the buffer to which the text is appended.
+ * @param[in] c   the instruction, followed by its operands.
+ * @return        the number of operands written with the instruction, or 0
+ *                if it has no shorter form
  */
-static void dump_preamble(FILE *file, char *name)
+static int dump_short(ByteBuf *out, Code *c)
 {
-	fprintf(file, class_preamble, name, name, name, name, name, name, name);
-	fputs(method_init, file);
-	fprintf(file, method_readInt, name);
-	fprintf(file, method_readBoolean, name);
+	int n;
+
+	switch (c->code) {
+		case JVM_LDC:
+			if ((c[1].type & MASK_DATA_TYPE) != CODE_INTEGER) {
+				return 0;
+			}
+			n = c[1].num;
+			if (n == -1) {
+				bb_text(out, "\ticonst_m1\n");
+				return 1;
+			} else if (n >= 0 && n <= 5) {
+				bb_text(out, "\ticonst_");
+			} else if (n >= -128 && n <= 127) {
+				bb_text(out, "\tbipush ");
+			} else if (n >= -32768 && n <= 32767) {
+				bb_text(out, "\tsipush ");
+			} else {
+				return 0;
+			}
+			bb_decimal(out, n);
+			bb_u1(out, '\n');
+			return 1;
+		case JVM_ALOAD:
+		case JVM_ASTORE:
+		case JVM_ILOAD:
+		case JVM_ISTORE:
+			if (c[1].num > 3) {
+				return 0;
+			}
+			bb_u1(out, '\t');
+			bb_text(out, get_opcode_string(c->code));
+			bb_u1(out, '_');
+			bb_decimal(out, c[1].num);
+			bb_u1(out, '\n');
+			return 1;
+		case JVM_IINC:
+			bb_text(out, "\tiinc ");
+			bb_decimal(out, c[1].num);
+			bb_u1(out, ' ');
+			bb_decimal(out, c[2].num);
+			bb_u1(out, '\n');
+			return 2;
+		default:
+			return 0;
+	}
 }
 
-void release_code_generation(void)
+/**
+ * Writes the preamble of the Jasmin text.  The preamble consists of (i) the
+ * source file, if the program is profiled, (ii) the class name and visibility
+ * specifier, (iii) the superclass, and (iv) the run-time support that the
+ * program uses, with the default initialiser (constructor).
+ *
+ * @param[in] cg  the code generator.
+ * @param[in] out the buffer to which the text is appended.
+ */
+static void dump_preamble(CodeGen *cg, ByteBuf *out)
 {
+	RTprogram program;
+
+	runtime_program(cg, &program);
+	if (cg->profile) {
+		bb_text(out, ".source ");
+		bb_text(out, cg->source_name);
+		bb_u1(out, '\n');
+	}
+	bb_text(out, ".class public ");
+	bb_text(out, cg->class_name);
+	bb_text(out, "\n.super java/lang/Object\n\n");
+	dump_runtime(out, cg->class_name, &program);
+}
+
+/**
+ * Writes a label, between the texts that lead up to it and follow it.
+ *
+ * @param[in] out    the buffer to which the text is appended.
+ * @param[in] before the text before the label number.
+ * @param[in] label  the label.
+ * @param[in] after  the text after the label number.
+ */
+static void dump_label(ByteBuf *out, const char *before, Label label,
+		const char *after)
+{
+	bb_text(out, before);
+	bb_decimal(out, label);
+	bb_text(out, after);
+}
+
+/**
+ * Writes the Jasmin text to the standard input stream of the assembler, while
+ * copying what the assembler reports to the diagnostic stream, so that
+ * neither process can wait for the other with a full pipe.  The pipe to the
+ * assembler does not block, so that a write takes only as much as the pipe
+ * has room for.
+ *
+ * @param[in] ac   the compiler context.
+ * @param[in] to   the pipe to the assembler, which is closed at the end of
+ *                 the text.
+ * @param[in] from the pipe from the assembler, which is read to its end, or
+ *                 -1 if the assembler reports straight to the standard
+ *                 streams.
+ */
+static void feed_assembler(AlanCompiler *ac, int to, int from)
+{
+	CodeGen *cg = ac->codegen;
+	struct pollfd fds[2];
+	char buf[BUFSIZ];
+	size_t sent = 0;
+	ssize_t n;
+	nfds_t nfds;
+
+	/* an assembler that exits early is reported by its status, not by a
+	 * signal */
+	signal(SIGPIPE, SIG_IGN);
+	if (cg->jasm.len == 0) {
+		close(to);
+		to = -1;
+	} else if (fcntl(to, F_SETFL, fcntl(to, F_GETFL) | O_NONBLOCK) < 0) {
+		ceprintf(ac, "Could not write to the assembler:");
+	}
+
+	while (to >= 0 || from >= 0) {
+		nfds = 0;
+		if (to >= 0) {
+			fds[nfds].fd = to;
+			fds[nfds++].events = POLLOUT;
+		}
+		if (from >= 0) {
+			fds[nfds].fd = from;
+			fds[nfds++].events = POLLIN;
+		}
+		if (poll(fds, nfds, -1) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			ceprintf(ac, "Could not wait for the assembler:");
+		}
+
+		if (to >= 0 && fds[0].revents) {
+			n = write(to, cg->jasm.data + sent, cg->jasm.len - sent);
+			if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK
+					|| errno == EINTR)) {
+				/* the pipe filled up after poll, so wait again */
+			} else if (n < 0 || (sent += (size_t) n) == cg->jasm.len) {
+				close(to);
+				to = -1;
+			}
+		}
+		if (from >= 0 && fds[nfds - 1].revents) {
+			if ((n = read(from, buf, sizeof(buf))) > 0) {
+				fwrite(buf, 1, (size_t) n, ac->diag);
+			} else {
+				close(from);
+				from = -1;
+			}
+		}
+	}
+}
+
+/**
+ * Returns the JVM method descriptor of a function body, which is the tail of
+ * its method reference.
+ *
+ * @param[in] b the body of the method
+ * @return      the method descriptor
+ */
+static const char *method_descriptor(Body *b)
+{
+	if (b->ref == NULL) {
+		return "([Ljava/lang/String;)V";
+	}
+	return strchr(b->ref, '(');
+}
+
+/* --- class file output ---------------------------------------------------- */
+
+/** a branch whose offset must be patched once its target label is known */
+typedef struct {
+	size_t at;     /**< the offset of the branch instruction              */
+	Label label;   /**< the target label                                  */
+} Fixup;
+
+static void emit_method(ClassFile *cf, Body *b);
+static void emit_stack_map(ClassFile *cf, CFmethod *m, Flow *f, long *item_at,
+		long code_len);
+static void emit_line_numbers(ClassFile *cf, CFmethod *m, Body *b,
+		long *item_at);
+static void encode_frame(ClassFile *cf, ByteBuf *smt, VType *prev, int nprev,
+		VType *locals, int nlocals, VType *stack, int nstack, long delta);
+static void emit_vtype(ClassFile *cf, ByteBuf *smt, VType t);
+static void emit_ldc(ByteBuf *bc, unsigned int idx);
+static void emit_int(ClassFile *cf, ByteBuf *bc, int value);
+static void emit_local(ByteBuf *bc, JVMopcode op, int slot);
+static unsigned int emit_ref(ClassFile *cf, Bytecode opcode, const char *ref);
+static char *unescape(const char *s);
+
+void make_class_file(AlanCompiler *ac)
+{
+	CodeGen *cg = ac->codegen;
+	ClassFile *cf;
+	RTprogram program;
+	ByteBuf source = { NULL, 0, 0 };
 	Body *b;
 
-	/* remove Jasmin file */
+	cf = cf_init(cg->class_name, "java/lang/Object", ACC_PUBLIC | ACC_SUPER);
+
+	runtime_program(cg, &program);
+	emit_runtime(cf, cg->class_name, &program);
+	for (b = cg->bodies; b; b = b->next) {
+		emit_method(cf, b);
+	}
+	if (cg->profile) {
+		bb_u2(&source, cf_utf8(cf, cg->source_name));
+		cf_add_attribute(cf, "SourceFile", &source);
+		free(source.data);
+	}
+
+	if (cf_write(cf, cg->class_path) < 0) {
+		ceprintf(ac, "Could not write class file '%s':", cg->class_path);
+	}
+	cf_free(cf);
+}
+
+/**
+ * Translates the code array of a function body into bytecode.  Branch targets
+ * are recorded as fixups while translating, and patched once all labels in the
+ * method have been placed.
+ *
+ * @param[in] cf the class file.
+ * @param[in] b  the body of the method.
+ */
+static void emit_method(ClassFile *cf, Body *b)
+{
+	CFmethod *m;
+	ByteBuf *bc;
+	Fixup *fixups;
+	Flow *f;
+	BasicBlock *bb;
+	long *label_at, *item_at, offset, from, to;
+	char *str;
+	int i, nfixups, max_stack, slot, inc;
+	unsigned int k;
+	Label min_label, max_label;
+	Code c;
+
+	m = cf_begin_method(cf, ACC_PUBLIC | ACC_STATIC, b->name,
+			method_descriptor(b));
+	bc = cf_code(m);
+
+	/* labels are numbered across the class, so the table only covers the
+	 * range of those of this body */
+	min_label = max_label = 0;
+	for (i = 0; i < b->ip; i++) {
+		if ((b->code[i].type & MASK_TYPE) != CODE_LABEL) {
+			continue;
+		}
+		if (min_label == 0 || b->code[i].label < min_label) {
+			min_label = b->code[i].label;
+		}
+		if (b->code[i].label > max_label) {
+			max_label = b->code[i].label;
+		}
+	}
+	label_at = emalloc((max_label - min_label + 1) * sizeof(long));
+	for (k = 0; k <= max_label - min_label; k++) {
+		label_at[k] = -1;
+	}
+	fixups = emalloc((b->ip + 1) * sizeof(Fixup));
+	nfixups = 0;
+	item_at = emalloc((b->ip + 1) * sizeof(long));
+
+	for (i = 0; i < b->ip; i++) {
+		c = b->code[i];
+		item_at[i] = (long) bc->len;
+
+		if ((c.type & MASK_TYPE) == CODE_LABEL) {
+			label_at[c.label - min_label] = (long) bc->len;
+			continue;
+		}
+
+		if ((c.type & MASK_TYPE) != CODE_INSTRUCTION) {
+			weprintf("Unexpected operand in bytecode of %s: %x\n", b->name,
+					 (unsigned int)c.type);
+			continue;
+		}
+
+		switch (c.code) {
+			case JVM_ALOAD:
+			case JVM_ASTORE:
+			case JVM_ILOAD:
+			case JVM_ISTORE:
+				emit_local(bc, get_opcode_value(c.code), b->code[++i].num);
+				break;
+			case JVM_GETSTATIC:
+			case JVM_INVOKESTATIC:
+			case JVM_INVOKEVIRTUAL:
+				bb_u1(bc, get_opcode_value(c.code));
+				bb_u2(bc, emit_ref(cf, c.code, b->code[++i].string));
+				break;
+			case JVM_LDC:
+				c = b->code[++i];
+				if ((c.type & MASK_DATA_TYPE) == CODE_STRING) {
+					str = unescape(c.string);
+					emit_ldc(bc, cf_string(cf, str));
+					free(str);
+				} else {
+					emit_int(cf, bc, c.num);
+				}
+				break;
+			case JVM_IINC:
+				slot = b->code[++i].num;
+				inc = b->code[++i].num;
+				if (slot <= 0xff && inc >= -128 && inc <= 127) {
+					bb_u1(bc, OP_IINC);
+					bb_u1(bc, slot);
+					bb_u1(bc, (unsigned int) (inc & 0xff));
+				} else {
+					bb_u1(bc, OP_WIDE);
+					bb_u1(bc, OP_IINC);
+					bb_u2(bc, slot);
+					bb_u2(bc, (unsigned int) (inc & 0xffff));
+				}
+				break;
+			case JVM_NEWARRAY:
+				bb_u1(bc, OP_NEWARRAY);
+				bb_u1(bc, b->code[++i].atype);
+				break;
+			case JVM_GOTO:
+			case JVM_IFEQ:
+			case JVM_IFGE:
+			case JVM_IFGT:
+			case JVM_IFLE:
+			case JVM_IFLT:
+			case JVM_IFNE:
+			case JVM_IF_ICMPEQ:
+			case JVM_IF_ICMPGE:
+			case JVM_IF_ICMPGT:
+			case JVM_IF_ICMPLE:
+			case JVM_IF_ICMPLT:
+			case JVM_IF_ICMPNE:
+				fixups[nfixups].at = bc->len;
+				fixups[nfixups++].label = b->code[++i].label;
+				bb_u1(bc, get_opcode_value(c.code));
+				bb_u2(bc, 0);
+				break;
+			default:
+				bb_u1(bc, get_opcode_value(c.code));
+				break;
+		}
+	}
+
+	/* guard against a dangling label at the end of the code stream */
+	if (b->ip > 0 && (b->code[b->ip - 1].type & MASK_TYPE) == CODE_LABEL) {
+		bb_u1(bc, OP_NOP);
+	}
+
+	for (i = 0; i < nfixups; i++) {
+		if (fixups[i].label < min_label || fixups[i].label > max_label
+				|| label_at[fixups[i].label - min_label] < 0) {
+			eprintf("undefined label L%u in %s", fixups[i].label, b->name);
+		}
+		offset = label_at[fixups[i].label - min_label] - (long) fixups[i].at;
+		if (offset < -32768 || offset > 32767) {
+			eprintf("branch offset out of range in %s", b->name);
+		}
+		bb_patch_u2(bc, fixups[i].at + 1, (unsigned int) (offset & 0xffff));
+	}
+
+	/* the verifier cannot type unreachable code, so replace it by a stub that
+	 * only throws, as other class-file writers do
+	 */
+	f = b->flow;
+	max_stack = b->max_stack_depth;
+	for (k = 0; k < (unsigned int) f->nblocks; k++) {
+		bb = &f->blocks[k];
+		if (bb->reached) {
+			continue;
+		}
+		from = item_at[bb->start];
+		to = (k + 1 < (unsigned int) f->nblocks ?
+			  item_at[f->blocks[k + 1].start] : (long) bc->len);
+		if (to > from) {
+			memset(bc->data + from, OP_NOP, to - from - 1);
+			bc->data[to - 1] = OP_ATHROW;
+			if (max_stack < 1) {
+				max_stack = 1;
+			}
+		}
+	}
+	emit_stack_map(cf, m, f, item_at, (long) bc->len);
+	if (b->lines) {
+		emit_line_numbers(cf, m, b, item_at);
+	}
+
+	cf_end_method(m, max_stack, b->variables_width);
+
+	free(item_at);
+	free(fixups);
+	free(label_at);
+}
+
+/**
+ * Writes the StackMapTable attribute of a method: one frame at the start of
+ * every block that is a branch target or that follows an unconditional
+ * transfer of control.  Frames are written in their compressed forms where
+ * possible.
+ *
+ * @param[in] cf       the class file.
+ * @param[in] m        the method.
+ * @param[in] f        the data-flow facts of the method body.
+ * @param[in] item_at  the bytecode offset of every code item.
+ * @param[in] code_len the length of the bytecode.
+ */
+static void emit_stack_map(ClassFile *cf, CFmethod *m, Flow *f, long *item_at,
+		long code_len)
+{
+	ByteBuf smt = { NULL, 0, 0 };
+	BasicBlock *bb;
+	VType *prev, *locals, *stack, throwable;
+	int k, nprev, nlocals, nstack, nframes;
+	long offset, last;
+
+	throwable.tag = VT_OBJECT;
+	throwable.name = "java/lang/Throwable";
+
+	bb_u2(&smt, 0);
+	prev = f->entry_locals;
+	nprev = frame_locals(f, prev);
+	nframes = 0;
+	last = -1;
+
+	for (k = 0; k < f->nblocks; k++) {
+		bb = &f->blocks[k];
+		offset = item_at[bb->start];
+		if ((!bb->needs_frame && bb->reached) || offset >= code_len) {
+			continue;
+		}
+
+		if (bb->reached) {
+			locals = bb->locals;
+			stack = bb->stack;
+			nstack = bb->nstack;
+		} else {
+			locals = f->entry_locals;
+			stack = &throwable;
+			nstack = 1;
+		}
+		nlocals = frame_locals(f, locals);
 
-	unlink(jasm_name);
+		encode_frame(cf, &smt, prev, nprev, locals, nlocals, stack, nstack,
+				(nframes == 0 ? offset : offset - last - 1));
 
-	/* free bodies */
-	for (b = bodies; b; b = b->next) {
+		prev = locals;
+		nprev = nlocals;
+		last = offset;
+		nframes++;
+	}
+
+	if (nframes > 0) {
+		bb_patch_u2(&smt, 0, nframes);
+		cf_add_code_attribute(cf, m, "StackMapTable", &smt);
+	}
+	free(smt.data);
+}
+
+/**
+ * Writes the LineNumberTable attribute of a method: an entry at every
+ * instruction whose source line differs from that of the instruction before
+ * it.
+ *
+ * @param[in] cf      the class file.
+ * @param[in] m       the method.
+ * @param[in] b       the body of the method, with its source lines.
+ * @param[in] item_at the bytecode offset of every code item.
+ */
+static void emit_line_numbers(ClassFile *cf, CFmethod *m, Body *b,
+		long *item_at)
+{
+	ByteBuf lnt = { NULL, 0, 0 };
+	int i, n, line;
+
+	bb_u2(&lnt, 0);
+	for (i = n = line = 0; i < b->ip; i++) {
+		if ((b->code[i].type & MASK_TYPE) != CODE_INSTRUCTION
+				|| b->lines[i] == 0 || b->lines[i] == line) {
+			continue;
+		}
+		line = b->lines[i];
+		bb_u2(&lnt, (unsigned int) item_at[i]);
+		bb_u2(&lnt, (unsigned int) line);
+		n++;
+	}
+
+	if (n > 0) {
+		bb_patch_u2(&lnt, 0, n);
+		cf_add_code_attribute(cf, m, "LineNumberTable", &lnt);
+	}
+	free(lnt.data);
+}
+
+/**
+ * Encodes one stack map frame relative to the previous one.
+ *
+ * @param[in] cf      the class file.
+ * @param[in] smt     the buffer for the StackMapTable entries.
+ * @param[in] prev    the local variable types of the previous frame.
+ * @param[in] nprev   the number of local variable types of the previous frame.
+ * @param[in] locals  the local variable types of this frame.
+ * @param[in] nlocals the number of local variable types of this frame.
+ * @param[in] stack   the operand stack types of this frame.
+ * @param[in] nstack  the operand stack depth of this frame.
+ * @param[in] delta   the offset delta of this frame.
+ */
+static void encode_frame(ClassFile *cf, ByteBuf *smt, VType *prev, int nprev,
+		VType *locals, int nlocals, VType *stack, int nstack, long delta)
+{
+	int i, common;
+	Boolean prefix;
+
+	common = (nprev < nlocals ? nprev : nlocals);
+	prefix = TRUE;
+	for (i = 0; i < common; i++) {
+		if (!same_vtype(prev[i], locals[i])) {
+			prefix = FALSE;
+			break;
+		}
+	}
+
+	if (prefix && nlocals == nprev && nstack == 0) {
+		if (delta < 64) {
+			bb_u1(smt, delta);                      /* same_frame */
+		} else {
+			bb_u1(smt, 251);                        /* same_frame_extended */
+			bb_u2(smt, delta);
+		}
+	} else if (prefix && nlocals == nprev && nstack == 1) {
+		if (delta < 64) {
+			bb_u1(smt, 64 + delta);                 /* same_locals_1_stack_item */
+		} else {
+			bb_u1(smt, 247);
+			bb_u2(smt, delta);
+		}
+		emit_vtype(cf, smt, stack[0]);
+	} else if (prefix && nstack == 0 && nlocals < nprev &&
+			   nprev - nlocals <= 3) {
+		bb_u1(smt, 251 - (nprev - nlocals));        /* chop_frame */
+		bb_u2(smt, delta);
+	} else if (prefix && nstack == 0 && nlocals > nprev &&
+			   nlocals - nprev <= 3) {
+		bb_u1(smt, 251 + (nlocals - nprev));        /* append_frame */
+		bb_u2(smt, delta);
+		for (i = nprev; i < nlocals; i++) {
+			emit_vtype(cf, smt, locals[i]);
+		}
+	} else {
+		bb_u1(smt, 255);                            /* full_frame */
+		bb_u2(smt, delta);
+		bb_u2(smt, nlocals);
+		for (i = 0; i < nlocals; i++) {
+			emit_vtype(cf, smt, locals[i]);
+		}
+		bb_u2(smt, nstack);
+		for (i = 0; i < nstack; i++) {
+			emit_vtype(cf, smt, stack[i]);
+		}
+	}
+}
+
+static void emit_vtype(ClassFile *cf, ByteBuf *smt, VType t)
+{
+	bb_u1(smt, t.tag);
+	if (t.tag == VT_OBJECT) {
+		bb_u2(smt, cf_class(cf, t.name));
+	}
+}
+
+/**
+ * Emits an <code>ldc</code> instruction, or its wide form if the constant does
+ * not have a one-byte pool index.
+ *
+ * @param[in] bc  the code buffer.
+ * @param[in] idx the constant pool index.
+ */
+static void emit_ldc(ByteBuf *bc, unsigned int idx)
+{
+	if (idx <= 0xff) {
+		bb_u1(bc, OP_LDC);
+		bb_u1(bc, idx);
+	} else {
+		bb_u1(bc, OP_LDC_W);
+		bb_u2(bc, idx);
+	}
+}
+
+/**
+ * Emits an integer constant in the shortest form that holds it: one of the
+ * constant instructions, an immediate byte or short, or a constant pool entry.
+ *
+ * @param[in] cf    the class file.
+ * @param[in] bc    the code buffer.
+ * @param[in] value the constant.
+ */
+static void emit_int(ClassFile *cf, ByteBuf *bc, int value)
+{
+	if (value >= -1 && value <= 5) {
+		bb_u1(bc, OP_ICONST_0 + value);
+	} else if (value >= -128 && value <= 127) {
+		bb_u1(bc, OP_BIPUSH);
+		bb_u1(bc, (unsigned int) (value & 0xff));
+	} else if (value >= -32768 && value <= 32767) {
+		bb_u1(bc, OP_SIPUSH);
+		bb_u2(bc, (unsigned int) (value & 0xffff));
+	} else {
+		emit_ldc(bc, cf_integer(cf, value));
+	}
+}
+
+/**
+ * Emits a load or store of a local variable, using the one-byte forms for the
+ * first four slots, and the wide form for slots that do not fit into one byte.
+ *
+ * @param[in] bc   the code buffer.
+ * @param[in] op   the load or store opcode.
+ * @param[in] slot the local variable slot.
+ */
+static void emit_local(ByteBuf *bc, JVMopcode op, int slot)
+{
+	if (slot <= 3) {
+		switch (op) {
+			case OP_ILOAD:
+				bb_u1(bc, OP_ILOAD_0 + slot);
+				break;
+			case OP_ALOAD:
+				bb_u1(bc, OP_ALOAD_0 + slot);
+				break;
+			case OP_ISTORE:
+				bb_u1(bc, OP_ISTORE_0 + slot);
+				break;
+			default:
+				bb_u1(bc, OP_ASTORE_0 + slot);
+				break;
+		}
+	} else if (slot <= 0xff) {
+		bb_u1(bc, op);
+		bb_u1(bc, slot);
+	} else {
+		bb_u1(bc, OP_WIDE);
+		bb_u1(bc, op);
+		bb_u2(bc, slot);
+	}
+}
+
+/**
+ * Converts a Jasmin-style member reference into a constant pool entry.  Field
+ * references have the form <code>owner/name desc</code>, and method references
+ * the form <code>owner/name(params)ret</code>, where the owner may also be
+ * separated from the name by a dot.
+ *
+ * @param[in] cf     the class file.
+ * @param[in] opcode the instruction that uses the reference.
+ * @param[in] ref    the reference string.
+ * @return           the constant pool index of the reference.
+ */
+static unsigned int emit_ref(ClassFile *cf, Bytecode opcode, const char *ref)
+{
+	char *owner, *name, *desc, *sep;
+	unsigned int idx;
+
+	owner = estrdup(ref);
+	if (opcode == JVM_GETSTATIC) {
+		desc = strchr(owner, ' ');
+	} else {
+		desc = strchr(owner, '(');
+	}
+	assert(desc != NULL);
+
+	name = owner;
+	for (sep = owner; sep < desc; sep++) {
+		if (*sep == '/' || *sep == '.') {
+			name = sep;
+		}
+	}
+	assert(name != owner);
+
+	if (opcode == JVM_GETSTATIC) {
+		*desc++ = '\0';
+		*name++ = '\0';
+		idx = cf_fieldref(cf, owner, name, desc);
+	} else {
+		desc = estrdup(desc);
+		*strchr(owner, '(') = '\0';
+		*name++ = '\0';
+		idx = cf_methodref(cf, owner, name, desc);
+		free(desc);
+	}
+
+	free(owner);
+	return idx;
+}
+
+/**
+ * Replaces the escape codes in an ALAN string literal by the characters they
+ * denote.  The caller must free the returned string.
+ *
+ * @param[in] s the string literal, as returned by the scanner.
+ * @return      the unescaped string.
+ */
+static char *unescape(const char *s)
+{
+	char *t, *u;
+
+	u = t = emalloc(strlen(s) + 1);
+	while (*s) {
+		if (*s == '\\' && s[1] != '\0') {
+			s++;
+			switch (*s) {
+				case 'n':
+					*u++ = '\n';
+					break;
+				case 't':
+					*u++ = '\t';
+					break;
+				default:
+					*u++ = *s;
+					break;
+			}
+			s++;
+		} else {
+			*u++ = *s++;
+		}
+	}
+	*u = '\0';
+
+	return t;
+}
+
+void release_code_generation(AlanCompiler *ac)
+{
+	CodeGen *cg = ac->codegen;
+	Body *b;
+
+	if (cg == NULL) {
+		return;
+	}
+
+	/* free the code of the bodies; the bodies themselves, their IR, and the
+	 * strings in their code belong to the arena of the compilation */
+	for (b = cg->bodies; b; b = b->next) {
+		free_flow(b->flow);
 		free(b->code);
-		free(b);
+		free(b->lines);
 	}
+
 	/* free strings */
-	free(jasm_name);
-	free(function_name);
-	free(class_name);
-	free(ref_read_integer);
-	free(ref_read_boolean);
+	free(cg->jasm_name);
+	free(cg->jasm.data);
+	free(cg->class_path);
+	free(cg->class_name);
+	free(cg->ref_read_integer);
+	free(cg->ref_read_boolean);
+	free(cg->ref_write_integer);
+	free(cg->ref_write_boolean);
+	free(cg->ref_write_string);
+	free(cg->ref_profile_enter);
+	free(cg->ref_profile_exit);
+	free(cg->ref_profile_loop);
+	free(cg->points.data);
+	stats_add_table(ac, cg->methods);
+	ht_free(cg->methods, free_nothing, free_nothing);
+	ht_free(cg->callees, free_nothing, free_nothing);
+	free(cg);
+	ac->codegen = NULL;
 }
-
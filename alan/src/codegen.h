@@ -8,123 +8,217 @@
 #ifndef CODEGEN_H
 #define CODEGEN_H
 
+#include "asmserver.h"
+#include "bytecode.h"
+#include "error.h"
 #include "jvm.h"
 #include "symboltable.h"
 #include "token.h"
 
-typedef unsigned int Label;
+/** a run of generated code, which can be moved after the code that follows */
+typedef struct {
+	struct ir_block *first;  /**< the first block of the run */
+	struct ir_block *last;   /**< the last block of the run  */
+} CodeRange;
 
 /**
- * Assembles a Jasmin file.  The file must first be written by calling
+ * Assembles the Jasmin text of the class, which Jasmin reads from a pipe, so
+ * that no Jasmin file is written.  The text must first be made by calling
  * <code>make_code_file</code>.
  *
+ * @param[in]   ac
+ *     the compiler context
  * @param[in]   jasmin_path
  *     the path to the Jasmin JAR file
  */
-void assemble(const char *jasmin_path);
+void assemble(AlanCompiler *ac, const char *jasmin_path);
+
+/**
+ * Assembles the Jasmin text of the class in a running assembler server, which
+ * avoids the start-up cost of a new JVM.  The text must first be made by
+ * calling <code>make_code_file</code>.
+ *
+ * @param[in]   ac
+ *     the compiler context
+ * @param[in]   server
+ *     the assembler server
+ */
+void assemble_on_server(AlanCompiler *ac, AsmServer *server);
+
+/**
+ * Starts a run of code, at a label that the caller has just generated.
+ *
+ * @param[in]   ac
+ *     the compiler context
+ * @param[out]  range
+ *     the run of code
+ */
+void begin_code_range(AlanCompiler *ac, CodeRange *range);
 
 /**
  * Closes the code generation for the current function or procedure.
  *
+ * @param[in]   ac
+ *     the compiler context
  * @param[in]   varwidth
  *     the length of the local variable array, including space for parameters;
  *     should be read from the symbol table
  */
-void close_subroutine_codegen(int varwidth);
+void close_subroutine_codegen(AlanCompiler *ac, int varwidth);
 
 /**
  * Generates the code for an operation that does not have an operand.
  *
+ * @param[in]   ac
+ *     the compiler context
  * @param[in]   opcode
  *     the bytecode instruction
  */
-void gen_1(Bytecode opcode);
+void gen_1(AlanCompiler *ac, Bytecode opcode);
+
+/**
+ * Ends a run of code, after the last instruction that was generated.
+ *
+ * @param[in]   ac
+ *     the compiler context
+ * @param[in,out]   range
+ *     the run of code
+ */
+void end_code_range(AlanCompiler *ac, CodeRange *range);
 
 /**
  * Generates a label.
  *
+ * @param[in]   ac
+ *     the compiler context
  * @param[in]   label
  *     the label
  */
-void gen_label(Label label);
+void gen_label(AlanCompiler *ac, Label label);
+
+/**
+ * Attributes the code that follows to the source line of the current token,
+ * if the program is profiled.
+ *
+ * @param[in]   ac
+ *     the compiler context
+ */
+void gen_line(AlanCompiler *ac);
 
 /**
  * Generates the code for an operation with one operand.
  *
+ * @param[in]   ac
+ *     the compiler context
  * @param[in]   opcode
  *     the bytecode instruction
  * @param[in]   operand
  *     the operand
  */
-void gen_2(Bytecode opcode, int value);
+void gen_2(AlanCompiler *ac, Bytecode opcode, int value);
 
 /**
  * Generates an instruction that takes a label.
  *
+ * @param[in]   ac
+ *     the compiler context
  * @param[in]   opcode
  *     the bytecode instruction
  * @param[in]   label
  *     the label
  */
-void gen_2_label(Bytecode opcode, Label label);
+void gen_2_label(AlanCompiler *ac, Bytecode opcode, Label label);
 
 /**
  * Generates a call.
  *
+ * @param[in]   ac
+ *     the compiler context
  * @param[in]   fname
  *     the name of the function or procedure
  * @param[in]   idprop
  *     the properties of the function or procedure identifier
  */
-void gen_call(char *fname, IDprop *idprop);
+void gen_call(AlanCompiler *ac, const char *fname, IDprop *idprop);
 
 /**
  * Generates the instructions that handle comparisons, ensuring that either
  * zero or one is pushed onto the stack.
  *
+ * @param[in]   ac
+ *     the compiler context
  * @param[in]   opcode
  *     the false jump instruction
  */
-void gen_cmp(Bytecode opcode);
+void gen_cmp(AlanCompiler *ac, Bytecode opcode);
 
 /**
  * Generates the instruction that creates a new array of the specified type.
  *
+ * @param[in]   ac
+ *     the compiler context
  * @param[in]   atype
  *     the type of array items
  */
-void gen_newarray(JVMatype atype);
+void gen_newarray(AlanCompiler *ac, JVMatype atype);
+
+/**
+ * Generates the count of an iteration of a loop, if the program is profiled.
+ * The loop is named by the current source line.
+ *
+ * @param[in]   ac
+ *     the compiler context
+ */
+void gen_profile_loop(AlanCompiler *ac);
 
 /**
  * Generates the instructions for the displaying output on screen.
  *
+ * @param[in]   ac
+ *     the compiler context
  * @param[in]   type
  *     the operand type
  */
-void gen_print(ValType type);
+void gen_print(AlanCompiler *ac, ValType type);
 
 /**
  * Generates the instructions for displaying a string on screen.
  *
+ * @param[in]   ac
+ *     the compiler context
  * @param[in]   string
  *     the string to display
  */
-void gen_print_string(char *string);
+void gen_print_string(AlanCompiler *ac, char *string);
 
 /**
  * Generates the instructions for reading from standard input into a variable.
  *
+ * @param[in]   ac
+ *     the compiler context
  * @param[in]   type
  *     the operand type
  */
-void gen_read(ValType type);
+void gen_read(AlanCompiler *ac, ValType type);
 
 /**
  * Returns the next label integer.
  *
+ * @param[in]   ac
+ *     the compiler context
  * @return      the next label integer.
  */
-Label get_label(void);
+Label get_label(AlanCompiler *ac);
+
+/**
+ * Returns the branch that is taken exactly when the given conditional branch
+ * is not taken.
+ *
+ * @param[in]   opcode
+ *     the conditional branch
+ * @return      the inverse branch
+ */
+Bytecode get_inverse_branch(Bytecode opcode);
 
 /**
  * Gets a string representation (mnemonic) of an opcode.  It would
@@ -140,42 +234,120 @@ Label get_label(void);
  */
 const char *get_opcode_string(Bytecode opcode);
 
+/**
+ * Gets the fixed stack effect of an opcode.  For calls and field accesses the
+ * effect depends on the descriptor, and is not included.
+ *
+ * @param[in]   opcode
+ *     the opcode
+ * @param[out]  pop
+ *     the number of operand stack entries that the instruction pops
+ * @param[out]  push
+ *     the number of operand stack entries that the instruction pushes
+ */
+void get_stack_effect(Bytecode opcode, int *pop, int *push);
+
+/**
+ * Returns the class-file encoding of an opcode.
+ *
+ * @param[in]   opcode
+ *     the opcode for which to get the encoding
+ * @return      the JVM opcode value
+ */
+JVMopcode get_opcode_value(Bytecode opcode);
+
+/**
+ * Returns the name of the class file that the code generator writes, as set
+ * by <code>set_class_name</code>.  It is the only file written, since the
+ * Jasmin text is passed to the assembler in memory.
+ *
+ * @param[in]   ac
+ *     the compiler context
+ * @return      the name of the class file
+ */
+const char *get_class_path(AlanCompiler *ac);
+
 /**
  * Initialises the code generation unit.
+ *
+ * @param[in]   ac
+ *     the compiler context
  */
-void init_code_generation(void);
+void init_code_generation(AlanCompiler *ac);
 
 /**
  * Initialises the code array for a function or procedure.
  *
+ * @param[in]   ac
+ *     the compiler context
  * @param[in]   name
  *     the name of the function or procedure
  * @param[in]   p
  *     the properties of the function or procedure identifier
  */
-void init_subroutine_codegen(const char *name, IDprop *p);
+void init_subroutine_codegen(AlanCompiler *ac, const char *name, IDprop *p);
 
 /**
  * Prints the generated code to screen; for debugging purposes.
+ *
+ * @param[in]   ac
+ *     the compiler context
  */
-void list_code(void);
+void list_code(AlanCompiler *ac);
 
 /**
- * Opens the object file, and write the generated code to it.
+ * Moves a run of code after all of the code generated since it ended, and
+ * continues the code generation after it.
+ *
+ * @param[in]   ac
+ *     the compiler context
+ * @param[in]   range
+ *     the run of code
  */
-void make_code_file(void);
+void move_code_range(AlanCompiler *ac, CodeRange *range);
+
+/**
+ * Writes the generated code directly to a binary class file, named after the
+ * class, without going through Jasmin.
+ *
+ * @param[in]   ac
+ *     the compiler context
+ */
+void make_class_file(AlanCompiler *ac);
+
+/**
+ * Makes the Jasmin text of the generated code, in memory, for
+ * <code>assemble</code> or <code>assemble_on_server</code>.
+ *
+ * @param[in]   ac
+ *     the compiler context
+ */
+void make_code_file(AlanCompiler *ac);
+
+/**
+ * Writes what the optimisations did to the diagnostic stream.
+ *
+ * @param[in]   ac
+ *     the compiler context
+ */
+void report_optimisations(AlanCompiler *ac);
 
 /**
  * Sets the name of the class file.  This must be called after
  * <code>init_code_generation</code>, but before any other code is emitted.
  *
+ * @param[in]   ac
+ *     the compiler context
  * @param[in] cname the name of the class file
  */
-void set_class_name(char *cname);
+void set_class_name(AlanCompiler *ac, const char *cname);
 
 /**
  * Releases the resources allocated or held by the code generation unit.
+ *
+ * @param[in]   ac
+ *     the compiler context
  */
-void release_code_generation(void);
+void release_code_generation(AlanCompiler *ac);
 
 #endif /* CODEGEN_H */
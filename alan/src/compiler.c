@@ -0,0 +1,88 @@
+/**
+ * @file    compiler.c
+ * @brief   The context of one ALAN-2022 compilation.
+ * @date    2026-10-14
+ */
+
+#include <setjmp.h>
+#include <stdlib.h>
+#include <string.h>
+#include "compiler.h"
+#include "error.h"
+
+/* --- compiler context interface ------------------------------------------- */
+
+AlanCompiler *alan_new(void)
+{
+	AlanCompiler *ac;
+
+	ac = emalloc(sizeof(AlanCompiler));
+	memset(ac, 0, sizeof(AlanCompiler));
+	ac->can_bail = FALSE;
+	ac->arena = arena_new(NULL);
+
+	return ac;
+}
+
+void alan_set_source_name(AlanCompiler *ac, const char *name)
+{
+	const char *c;
+
+	if ((c = strrchr(name, '/')) == NULL) {
+		c = name;
+	} else {
+		c++;
+	}
+	free(ac->src_name);
+	ac->src_name = estrdup(c);
+}
+
+void alan_set_options(AlanCompiler *ac, const AlanOptions *options)
+{
+	ac->options = *options;
+}
+
+void alan_set_cache(AlanCompiler *ac, AlanCache *cache)
+{
+	ac->cache = cache;
+}
+
+void alan_set_diagnostic_stream(AlanCompiler *ac, FILE *diag)
+{
+	ac->diag = diag;
+}
+
+void alan_locate(AlanCompiler *ac, SourcePos *pos)
+{
+	const char *p, *end, *nl;
+
+	pos->line = 1;
+	if (ac->src_buf == NULL || pos->offset >= ac->src_len) {
+		pos->col = 0;
+		return;
+	}
+
+	p = ac->src_buf;
+	end = ac->src_buf + pos->offset;
+	while ((nl = memchr(p, '\n', end - p)) != NULL) {
+		pos->line++;
+		p = nl + 1;
+	}
+	pos->col = (int) (end - p) + 1;
+}
+
+void alan_abort(AlanCompiler *ac, int status)
+{
+	if (ac->can_bail) {
+		ac->status = status;
+		longjmp(ac->bail, 1);
+	}
+	exit(status);
+}
+
+void alan_free(AlanCompiler *ac)
+{
+	free(ac->src_name);
+	arena_free(ac->arena);
+	free(ac);
+}
@@ -0,0 +1,210 @@
+/**
+ * @file    compiler.h
+ * @brief   The context of one ALAN-2022 compilation.
+ *
+ * Every compiler unit keeps its state in an <code>AlanCompiler</code>
+ * context, which is passed explicitly to the scanner, the symbol table, the
+ * code generator, and the error-reporting routines.  Independent contexts
+ * share nothing, so that one process can compile many sources, one after the
+ * other or side by side in different threads, and the compiler can be linked
+ * into other programs as the <code>libalanc</code> library.
+ *
+ * Compilation errors do not terminate the program when a context is used
+ * through <code>alan_compile</code>: the error is reported, and the call
+ * returns the exit status that the stand-alone compiler would have used.
+ *
+ * @date    2026-10-14
+ */
+
+#ifndef COMPILER_H
+#define COMPILER_H
+
+#include <setjmp.h>
+#include <stdio.h>
+#include "asmserver.h"
+#include "boolean.h"
+#include "cache.h"
+#include "error.h"
+#include "hashtable.h"
+#include "token.h"
+#include "valtypes.h"
+
+/** the version of the compiler, which is part of every cache key */
+#define ALAN_VERSION "alanc 2022.2"
+
+/** the highest optimisation level */
+#define ALAN_MAX_OPTIMISE 2
+
+/** the most IR instructions of a function that is inlined, by default */
+#define ALAN_INLINE_LIMIT 32
+
+/** the options of a compilation, which default to zero */
+typedef struct {
+	Boolean  pretokenize;    /**< scan the whole source before parsing */
+	int      optimise;       /**< the optimisation level               */
+	Boolean  report;         /**< report what the optimisations did    */
+	int      inline_limit;   /**< the most IR instructions of a function
+	                              that is inlined, or 0 for the default */
+	Boolean  inline_report;  /**< report every inlining decision       */
+	Boolean  stats;          /**< report the time and work, as JSON    */
+	Boolean  profile;        /**< count and time the calls and loops   */
+} AlanOptions;
+
+/** the state of the code generator, which is private to codegen.c */
+typedef struct codegen_s CodeGen;
+
+/** the pool of interned identifiers, which is private to intern.c */
+typedef struct intern_pool InternPool;
+
+/** the scopes of the symbol table, which are private to symboltable.c */
+typedef struct symbol_table SymbolTable;
+
+/** the statistics of a compilation, which are defined in stats.h */
+typedef struct alan_stats AlanStats;
+
+struct alan_compiler {
+	/* error reporting */
+	char         *src_name;       /**< the source name, for diagnostics     */
+	FILE         *diag;           /**< the diagnostic stream, or stderr     */
+	SourcePos     position;       /**< the position of the current token    */
+	Boolean       can_bail;       /**< whether <code>bail</code> is set     */
+	jmp_buf       bail;           /**< the return point for fatal errors    */
+	int           status;         /**< the exit status of a failed compile  */
+
+	/* memory */
+	Arena        *arena;          /**< the objects of the compilation       */
+
+	/* options */
+	AlanOptions   options;        /**< the options of the compilation       */
+	AlanCache    *cache;          /**< the compile cache, or NULL           */
+
+	/* scanner */
+	FILE         *src_file;       /**< the source file pointer              */
+	const char   *src_buf;        /**< the source text                      */
+	size_t        src_len;        /**< the length of the source text        */
+	size_t        src_next;       /**< the offset of the next character     */
+	Boolean       src_mapped;     /**< whether the text is memory-mapped    */
+	Boolean       src_borrowed;   /**< whether the text belongs to a caller */
+	int           ch;             /**< the current source character         */
+	size_t        offset;         /**< the offset of the current character  */
+	TokenBuffer  *tokens;         /**< the tokens scanned up front, or NULL */
+	InternPool   *names;          /**< the interned identifiers             */
+
+	/* parser */
+	Token         token;          /**< the lookahead token                  */
+	ValType       return_type;    /**< the type of the current expression   */
+	ValType       routine_type;   /**< the type of the current subroutine   */
+
+	/* symbol table */
+	SymbolTable  *symbols;        /**< the names of all open scopes         */
+	Arena        *scope;          /**< the objects of the current scope     */
+
+	/* code generator */
+	CodeGen      *codegen;        /**< the code generator state             */
+
+	/* statistics */
+	AlanStats    *stats;          /**< the time and work, or NULL           */
+};
+
+/**
+ * Allocates and initialises a new compiler context.
+ *
+ * @return      a pointer to the compiler context
+ */
+AlanCompiler *alan_new(void);
+
+/**
+ * Compiles a source file into a class file in the current directory.
+ *
+ * @param[in]   ac
+ *     the compiler context
+ * @param[in]   src_name
+ *     the name of the source file
+ * @param[in]   jasmin_path
+ *     the path to the Jasmin JAR file, or <code>NULL</code> to write the class
+ *     file directly
+ * @param[in]   asm_server
+ *     the assembler server to use instead of starting Jasmin, or
+ *     <code>NULL</code>
+ * @return      <code>0</code> if the source compiled successfully, or the exit
+ *              status associated with the error otherwise
+ */
+int alan_compile(AlanCompiler *ac, const char *src_name,
+				 const char *jasmin_path, AsmServer *asm_server);
+
+/**
+ * Sets the source name that is shown in diagnostics.
+ *
+ * @param[in]   ac
+ *     the compiler context
+ * @param[in]   name
+ *     the source path, of which only the last component is kept
+ */
+void alan_set_source_name(AlanCompiler *ac, const char *name);
+
+/**
+ * Sets the options of the compilations in a context.
+ *
+ * @param[in]   ac
+ *     the compiler context
+ * @param[in]   options
+ *     the options, which are copied
+ */
+void alan_set_options(AlanCompiler *ac, const AlanOptions *options);
+
+/**
+ * Sets the cache in which compilations are looked up and stored.  A cache may
+ * be shared by many contexts.
+ *
+ * @param[in]   ac
+ *     the compiler context
+ * @param[in]   cache
+ *     the cache, or <code>NULL</code> to compile every source
+ */
+void alan_set_cache(AlanCompiler *ac, AlanCache *cache);
+
+/**
+ * Sets the stream to which diagnostics are written.  By default, they are
+ * written to the standard error stream.  Each context may have a stream of its
+ * own, so that the diagnostics of concurrent compilations are kept apart.
+ *
+ * @param[in]   ac
+ *     the compiler context
+ * @param[in]   diag
+ *     the diagnostic stream, or <code>NULL</code> for the standard error stream
+ */
+void alan_set_diagnostic_stream(AlanCompiler *ac, FILE *diag);
+
+/**
+ * Works out the line and column numbers of a source position from its offset
+ * in the source text.  This is done only when a position is reported, so that
+ * the scanner need not count lines and columns as it goes.
+ *
+ * @param[in]   ac
+ *     the compiler context
+ * @param[in,out]   pos
+ *     the source position, of which the line and column are set
+ */
+void alan_locate(AlanCompiler *ac, SourcePos *pos);
+
+/**
+ * Abandons the current compilation after a fatal error.  If the context is
+ * being used by <code>alan_compile</code>, control returns there; otherwise,
+ * the program terminates.
+ *
+ * @param[in]   ac
+ *     the compiler context
+ * @param[in]   status
+ *     the exit status
+ */
+void alan_abort(AlanCompiler *ac, int status);
+
+/**
+ * Releases the memory resources associated with a compiler context.
+ *
+ * @param[in]   ac
+ *     the compiler context
+ */
+void alan_free(AlanCompiler *ac);
+
+#endif /* COMPILER_H */
@@ -0,0 +1,574 @@
+/**
+ * @file    dataflow.c
+ * @brief   Data-flow analysis over generated function bodies.
+ * @date    2026-10-14
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "boolean.h"
+#include "codegen.h"
+#include "dataflow.h"
+#include "error.h"
+#include "valtypes.h"
+
+/* --- type definitions and constants --------------------------------------- */
+
+/** the abstract machine state while walking through a block */
+typedef struct {
+	int    nstack;   /**< the current operand stack depth */
+	VType *stack;    /**< the operand stack types         */
+	VType *locals;   /**< the local variable types        */
+} State;
+
+static const VType vt_top = {VT_TOP, NULL};
+static const VType vt_int = {VT_INTEGER, NULL};
+
+/* --- function prototypes -------------------------------------------------- */
+
+static int count_locals(Body *b);
+static void find_blocks(Flow *f, Body *b, int *block_of_label,
+		Label min_label);
+static void transfer(Flow *f, Body *b, BasicBlock *bb, State *s, int cap);
+static Boolean merge(Flow *f, BasicBlock *to, State *s);
+static void push(Flow *f, State *s, int cap, VType t);
+static VType pop(Flow *f, State *s);
+static VType desc_type(Flow *f, const char *desc, const char **next);
+static const char *type_name(Flow *f, const char *name, size_t len);
+
+/* --- data-flow interface -------------------------------------------------- */
+
+Flow *analyse_flow(Body *b)
+{
+	Flow *f;
+	State s;
+	Label min_label, max_label;
+	int *block_of_label, *worklist, nwork, i, k, cap, target;
+	Boolean *queued;
+	BasicBlock *bb;
+	Code *last;
+	unsigned int p;
+
+	f = emalloc(sizeof(Flow));
+	memset(f, 0, sizeof(Flow));
+	f->nlocals = count_locals(b);
+
+	/* the types of the parameters on entry */
+	f->entry_locals = emalloc((f->nlocals + 1) * sizeof(VType));
+	for (i = 0; i < f->nlocals; i++) {
+		f->entry_locals[i] = vt_top;
+	}
+	if (strcmp(b->name, "main") == 0) {
+		f->entry_locals[0].tag = VT_OBJECT;
+		f->entry_locals[0].name = type_name(f, "[Ljava/lang/String;", 19);
+	} else {
+		for (p = 0; p < b->idprop->nparams; p++) {
+			if (IS_ARRAY(b->idprop->params[p])) {
+				f->entry_locals[p].tag = VT_OBJECT;
+				f->entry_locals[p].name = type_name(f, "[I", 2);
+			} else {
+				f->entry_locals[p] = vt_int;
+			}
+		}
+	}
+
+	/* split into basic blocks; labels are numbered across the class, so the
+	 * table only covers the range of those of this body */
+	min_label = max_label = 0;
+	for (i = 0; i < b->ip; i++) {
+		if (!(b->code[i].type & CODE_LABEL)) {
+			continue;
+		}
+		if (min_label == 0 || b->code[i].label < min_label) {
+			min_label = b->code[i].label;
+		}
+		if (b->code[i].label > max_label) {
+			max_label = b->code[i].label;
+		}
+	}
+	block_of_label = emalloc((max_label - min_label + 1) * sizeof(int));
+	for (i = 0; i <= (int) (max_label - min_label); i++) {
+		block_of_label[i] = -1;
+	}
+	find_blocks(f, b, block_of_label, min_label);
+
+	/* every code item pushes at most one value */
+	cap = b->ip + 1;
+	s.stack = emalloc(cap * sizeof(VType));
+	s.locals = emalloc((f->nlocals + 1) * sizeof(VType));
+
+	worklist = emalloc((f->nblocks + 1) * sizeof(int));
+	queued = emalloc((f->nblocks + 1) * sizeof(Boolean));
+	for (i = 0; i < f->nblocks; i++) {
+		queued[i] = FALSE;
+	}
+
+	/* the entry block */
+	nwork = 0;
+	if (f->nblocks > 0) {
+		s.nstack = 0;
+		memcpy(s.locals, f->entry_locals, f->nlocals * sizeof(VType));
+		merge(f, &f->blocks[0], &s);
+		worklist[nwork++] = 0;
+		queued[0] = TRUE;
+	}
+
+	while (nwork > 0) {
+		k = worklist[--nwork];
+		queued[k] = FALSE;
+		bb = &f->blocks[k];
+
+		s.nstack = bb->nstack;
+		memcpy(s.stack, bb->stack, bb->nstack * sizeof(VType));
+		memcpy(s.locals, bb->locals, f->nlocals * sizeof(VType));
+		transfer(f, b, bb, &s, cap);
+
+		/* find the last instruction of the block */
+		last = NULL;
+		for (i = bb->end - 1; i >= bb->start; i--) {
+			if ((b->code[i].type & MASK_TYPE) == CODE_INSTRUCTION) {
+				last = &b->code[i];
+				break;
+			}
+		}
+
+		/* the branch target */
+		if (last && IS_BRANCH(last->code)) {
+			target = block_of_label[b->code[last - b->code + 1].label
+				- min_label];
+			if (target >= 0 && merge(f, &f->blocks[target], &s)
+				&& !queued[target]) {
+				worklist[nwork++] = target;
+				queued[target] = TRUE;
+			}
+		}
+
+		/* the fall-through successor */
+		if ((!last || !IS_TERMINAL(last->code)) && k + 1 < f->nblocks) {
+			if (merge(f, &f->blocks[k + 1], &s) && !queued[k + 1]) {
+				worklist[nwork++] = k + 1;
+				queued[k + 1] = TRUE;
+			}
+		}
+	}
+
+	free(queued);
+	free(worklist);
+	free(s.locals);
+	free(s.stack);
+	free(block_of_label);
+
+	return f;
+}
+
+int frame_locals(Flow *f, VType *locals)
+{
+	int n = f->nlocals;
+
+	while (n > 0 && locals[n - 1].tag == VT_TOP) {
+		n--;
+	}
+	return n;
+}
+
+Boolean same_vtype(VType a, VType b)
+{
+	if (a.tag != b.tag) {
+		return FALSE;
+	}
+	return (a.tag != VT_OBJECT || strcmp(a.name, b.name) == 0);
+}
+
+void free_flow(Flow *f)
+{
+	int i;
+
+	for (i = 0; i < f->nblocks; i++) {
+		free(f->blocks[i].stack);
+		free(f->blocks[i].locals);
+	}
+	for (i = 0; i < f->nnames; i++) {
+		free(f->names[i]);
+	}
+	free(f->names);
+	free(f->blocks);
+	free(f->entry_locals);
+	free(f);
+}
+
+/* --- utility functions ---------------------------------------------------- */
+
+/**
+ * Computes the size of the local variable array: it must hold the parameters
+ * and every slot that is loaded or stored, and it is never smaller than the
+ * width that the parser recorded.
+ *
+ * @param[in] b the body.
+ * @return      the number of local variable slots.
+ */
+static int count_locals(Body *b)
+{
+	int i, n;
+	Code c;
+
+	n = b->variables_width;
+	if (strcmp(b->name, "main") == 0) {
+		if (n < 1) {
+			n = 1;
+		}
+	} else if ((int) b->idprop->nparams > n) {
+		n = b->idprop->nparams;
+	}
+
+	for (i = 0; i + 1 < b->ip; i++) {
+		c = b->code[i];
+		if ((c.type & MASK_TYPE) == CODE_INSTRUCTION &&
+			(c.code == JVM_ALOAD || c.code == JVM_ASTORE ||
+			 c.code == JVM_ILOAD || c.code == JVM_ISTORE ||
+			 c.code == JVM_IINC) &&
+			b->code[i + 1].num + 1 > n) {
+			n = b->code[i + 1].num + 1;
+		}
+	}
+
+	return n;
+}
+
+/**
+ * Splits a body into basic blocks.  A block starts at the first code item, at
+ * the first of a run of labels, and after every branch or return.  All labels
+ * in a run are mapped to the same block, so that no two blocks start at the
+ * same bytecode offset.
+ *
+ * @param[in]  f              the analysis result.
+ * @param[in]  b              the body.
+ * @param[out] block_of_label maps every label to the index of its block.
+ * @param[in]  min_label      the smallest label in the body, which is at index
+ *                            0 of block_of_label.
+ */
+static void find_blocks(Flow *f, Body *b, int *block_of_label,
+		Label min_label)
+{
+	int i, j, nblocks;
+	Boolean *leader, ends;
+	Code c;
+
+	leader = emalloc((b->ip + 1) * sizeof(Boolean));
+	for (i = 0; i <= b->ip; i++) {
+		leader[i] = FALSE;
+	}
+	if (b->ip > 0) {
+		leader[0] = TRUE;
+	}
+
+	ends = FALSE;
+	for (i = 0; i < b->ip; i++) {
+		c = b->code[i];
+		if ((c.type & MASK_TYPE) == CODE_LABEL) {
+			if (i == 0 || (b->code[i - 1].type & MASK_TYPE) != CODE_LABEL) {
+				leader[i] = TRUE;
+			}
+			ends = FALSE;
+			continue;
+		}
+		if (ends) {
+			leader[i] = TRUE;
+			ends = FALSE;
+		}
+		if ((c.type & MASK_TYPE) == CODE_INSTRUCTION &&
+			(IS_BRANCH(c.code) || IS_TERMINAL(c.code))) {
+			/* the block ends after the operand, if there is one */
+			if (i + 1 < b->ip && (b->code[i + 1].type & CODE_OPERAND)) {
+				i++;
+			}
+			ends = TRUE;
+		}
+	}
+
+	nblocks = 0;
+	for (i = 0; i < b->ip; i++) {
+		if (leader[i]) {
+			nblocks++;
+		}
+	}
+
+	f->nblocks = nblocks;
+	f->blocks = emalloc((nblocks + 1) * sizeof(BasicBlock));
+	nblocks = -1;
+	for (i = 0; i < b->ip; i++) {
+		if (leader[i]) {
+			if (nblocks >= 0) {
+				f->blocks[nblocks].end = i;
+			}
+			nblocks++;
+			f->blocks[nblocks].start = i;
+			f->blocks[nblocks].reached = FALSE;
+			f->blocks[nblocks].needs_frame = FALSE;
+			f->blocks[nblocks].nstack = 0;
+			f->blocks[nblocks].stack = NULL;
+			f->blocks[nblocks].locals = NULL;
+		}
+		if ((b->code[i].type & MASK_TYPE) == CODE_LABEL) {
+			block_of_label[b->code[i].label - min_label] = nblocks;
+		}
+	}
+	if (nblocks >= 0) {
+		f->blocks[nblocks].end = b->ip;
+	}
+
+	/* frames go at branch targets, and after unconditional transfers */
+	for (i = 0; i < b->ip; i++) {
+		c = b->code[i];
+		if ((c.type & MASK_TYPE) == CODE_INSTRUCTION && IS_BRANCH(c.code) &&
+			i + 1 < b->ip
+			&& block_of_label[b->code[i + 1].label - min_label] >= 0) {
+			f->blocks[block_of_label[b->code[i + 1].label - min_label]]
+				.needs_frame = TRUE;
+		}
+	}
+	for (i = 1; i < f->nblocks; i++) {
+		for (j = f->blocks[i].start - 1; j >= f->blocks[i - 1].start; j--) {
+			if ((b->code[j].type & MASK_TYPE) == CODE_INSTRUCTION) {
+				if (IS_TERMINAL(b->code[j].code)) {
+					f->blocks[i].needs_frame = TRUE;
+				}
+				break;
+			}
+		}
+	}
+
+	free(leader);
+}
+
+/**
+ * Applies the effect of every instruction in a block to the state.
+ *
+ * @param[in]     f   the analysis result.
+ * @param[in]     b   the body.
+ * @param[in]     bb  the block.
+ * @param[in,out] s   the state on entry, which becomes the state on exit.
+ * @param[in]     cap the capacity of the stack in the state.
+ */
+static void transfer(Flow *f, Body *b, BasicBlock *bb, State *s, int cap)
+{
+	int i, npop, npush, n;
+	const char *d;
+	VType t, u;
+	Code c, operand;
+
+	for (i = bb->start; i < bb->end; i++) {
+		c = b->code[i];
+		if ((c.type & MASK_TYPE) != CODE_INSTRUCTION) {
+			continue;
+		}
+		operand = (i + 1 < b->ip ? b->code[i + 1] : c);
+
+		switch (c.code) {
+			case JVM_ALOAD:
+				push(f, s, cap, s->locals[operand.num]);
+				break;
+			case JVM_ILOAD:
+				push(f, s, cap, vt_int);
+				break;
+			case JVM_ASTORE:
+				s->locals[operand.num] = pop(f, s);
+				break;
+			case JVM_ISTORE:
+				pop(f, s);
+				s->locals[operand.num] = vt_int;
+				break;
+			case JVM_GETSTATIC:
+				d = strchr(operand.string, ' ');
+				assert(d != NULL);
+				push(f, s, cap, desc_type(f, d + 1, NULL));
+				break;
+			case JVM_INVOKESTATIC:
+			case JVM_INVOKEVIRTUAL:
+				d = strchr(operand.string, '(');
+				assert(d != NULL);
+				for (d++, n = 0; *d != ')'; n++) {
+					desc_type(f, d, &d);
+				}
+				while (n-- > 0) {
+					pop(f, s);
+				}
+				if (c.code == JVM_INVOKEVIRTUAL) {
+					pop(f, s);
+				}
+				if (d[1] != 'V') {
+					push(f, s, cap, desc_type(f, d + 1, NULL));
+				}
+				break;
+			case JVM_LDC:
+				if ((operand.type & MASK_DATA_TYPE) == CODE_STRING) {
+					t.tag = VT_OBJECT;
+					t.name = type_name(f, "java/lang/String", 16);
+					push(f, s, cap, t);
+				} else {
+					push(f, s, cap, vt_int);
+				}
+				break;
+			case JVM_NEWARRAY:
+				pop(f, s);
+				t.tag = VT_OBJECT;
+				t.name = type_name(f, operand.atype == T_BOOLEAN ? "[Z" : "[I",
+						2);
+				push(f, s, cap, t);
+				break;
+			case JVM_DUP:
+				t = pop(f, s);
+				push(f, s, cap, t);
+				push(f, s, cap, t);
+				break;
+			case JVM_SWAP:
+				t = pop(f, s);
+				u = pop(f, s);
+				push(f, s, cap, t);
+				push(f, s, cap, u);
+				break;
+			default:
+				get_stack_effect(c.code, &npop, &npush);
+				while (npop-- > 0) {
+					pop(f, s);
+				}
+				while (npush-- > 0) {
+					push(f, s, cap, vt_int);
+				}
+				break;
+		}
+	}
+}
+
+/**
+ * Merges a state into the entry state of a block.
+ *
+ * @param[in] f  the analysis result.
+ * @param[in] to the successor block.
+ * @param[in] s  the state that flows into the block.
+ * @return       <code>TRUE</code> if the entry state changed, and the block
+ *               must be (re)visited, or <code>FALSE</code> otherwise
+ */
+static Boolean merge(Flow *f, BasicBlock *to, State *s)
+{
+	int i;
+	Boolean changed;
+
+	if (!to->reached) {
+		to->reached = TRUE;
+		to->nstack = s->nstack;
+		to->stack = emalloc((s->nstack + 1) * sizeof(VType));
+		memcpy(to->stack, s->stack, s->nstack * sizeof(VType));
+		to->locals = emalloc((f->nlocals + 1) * sizeof(VType));
+		memcpy(to->locals, s->locals, f->nlocals * sizeof(VType));
+		return TRUE;
+	}
+
+	if (to->nstack != s->nstack) {
+		weprintf("inconsistent stack depth at a label (%d and %d)",
+				 to->nstack, s->nstack);
+		return FALSE;
+	}
+
+	changed = FALSE;
+	for (i = 0; i < s->nstack; i++) {
+		if (!same_vtype(to->stack[i], s->stack[i]) &&
+			to->stack[i].tag != VT_TOP) {
+			to->stack[i] = vt_top;
+			changed = TRUE;
+		}
+	}
+	for (i = 0; i < f->nlocals; i++) {
+		if (!same_vtype(to->locals[i], s->locals[i]) &&
+			to->locals[i].tag != VT_TOP) {
+			to->locals[i] = vt_top;
+			changed = TRUE;
+		}
+	}
+
+	return changed;
+}
+
+static void push(Flow *f, State *s, int cap, VType t)
+{
+	assert(s->nstack < cap);
+	s->stack[s->nstack++] = t;
+	if (s->nstack > f->max_stack) {
+		f->max_stack = s->nstack;
+	}
+}
+
+static VType pop(Flow *f, State *s)
+{
+	if (s->nstack == 0) {
+		f->underflow = TRUE;
+		return vt_top;
+	}
+	return s->stack[--s->nstack];
+}
+
+/**
+ * Converts the field descriptor at the start of a string into a verification
+ * type.  Booleans, characters, and the other small integral types are all
+ * integers to the verifier.
+ *
+ * @param[in]  f    the analysis result.
+ * @param[in]  desc the descriptor.
+ * @param[out] next if not <code>NULL</code>, receives a pointer to the
+ *                  character after the descriptor.
+ * @return          the verification type.
+ */
+static VType desc_type(Flow *f, const char *desc, const char **next)
+{
+	const char *d = desc;
+	VType t;
+
+	while (*d == '[') {
+		d++;
+	}
+	if (*d == 'L') {
+		d = strchr(d, ';');
+		assert(d != NULL);
+	}
+	d++;
+
+	if (next) {
+		*next = d;
+	}
+
+	if (*desc == '[') {
+		t.tag = VT_OBJECT;
+		t.name = type_name(f, desc, d - desc);
+	} else if (*desc == 'L') {
+		t.tag = VT_OBJECT;
+		t.name = type_name(f, desc + 1, d - desc - 2);
+	} else {
+		t = vt_int;
+	}
+
+	return t;
+}
+
+/**
+ * Returns a copy of a class name that lives as long as the analysis result,
+ * sharing copies of equal names.
+ */
+static const char *type_name(Flow *f, const char *name, size_t len)
+{
+	int i;
+	char *n;
+
+	for (i = 0; i < f->nnames; i++) {
+		if (strlen(f->names[i]) == len && strncmp(f->names[i], name, len) == 0) {
+			return f->names[i];
+		}
+	}
+
+	n = emalloc(len + 1);
+	memcpy(n, name, len);
+	n[len] = '\0';
+	f->names = erealloc(f->names, (f->nnames + 1) * sizeof(char *));
+	f->names[f->nnames++] = n;
+
+	return n;
+}
@@ -0,0 +1,98 @@
+/**
+ * @file    dataflow.h
+ * @brief   Data-flow analysis over generated function bodies.
+ *
+ * The analysis splits a body into basic blocks, and propagates the types of
+ * the operand stack and the local variables along the control-flow edges.
+ * This yields the exact maximum stack depth, the size of the local variable
+ * array, and the verification types at the start of every block, from which
+ * StackMapTable frames are written.
+ *
+ * @date    2026-10-14
+ */
+
+#ifndef DATAFLOW_H
+#define DATAFLOW_H
+
+#include "boolean.h"
+#include "bytecode.h"
+
+/** verification types, numbered as the item tags of a StackMapTable */
+typedef enum {
+	VT_TOP = 0,
+	VT_INTEGER = 1,
+	VT_OBJECT = 7
+} VTag;
+
+/** a verification type */
+typedef struct {
+	VTag        tag;    /**< the kind of type                               */
+	const char *name;   /**< the internal class name, for object types      */
+} VType;
+
+/** a basic block, with the types on entry to the block */
+typedef struct {
+	int      start;        /**< index of the first code item in the block  */
+	int      end;          /**< index one past the last code item          */
+	Boolean  reached;      /**< whether the block is reachable             */
+	Boolean  needs_frame;  /**< whether a stack map frame must be written  */
+	int      nstack;       /**< the operand stack depth on entry           */
+	VType   *stack;        /**< the operand stack types on entry           */
+	VType   *locals;       /**< the local variable types on entry          */
+} BasicBlock;
+
+/** the result of analysing one body */
+typedef struct flow_s {
+	int          nblocks;      /**< the number of basic blocks              */
+	BasicBlock  *blocks;       /**< the basic blocks, in code order         */
+	int          max_stack;    /**< the maximum operand stack depth         */
+	int          nlocals;      /**< the size of the local variable array    */
+	VType       *entry_locals; /**< the local variable types on entry       */
+	int          nnames;       /**< the number of class names below         */
+	char       **names;        /**< class names referred to by the types    */
+	Boolean      underflow;    /**< whether the operand stack underflowed   */
+} Flow;
+
+/**
+ * Analyses a function body.
+ *
+ * @param[in]   b
+ *     the body to analyse
+ * @return      a pointer to the analysis result, which must be released with
+ *              <code>free_flow</code>
+ */
+Flow *analyse_flow(Body *b);
+
+/**
+ * Returns the number of leading local variables that must be written to a
+ * frame, that is, the local variables without the trailing top types.
+ *
+ * @param[in]   f
+ *     the analysis result
+ * @param[in]   locals
+ *     the local variable types
+ * @return      the number of significant local variables
+ */
+int frame_locals(Flow *f, VType *locals);
+
+/**
+ * Tests whether two verification types are the same.
+ *
+ * @param[in]   a
+ *     the first type
+ * @param[in]   b
+ *     the second type
+ * @return      <code>TRUE</code> if the types are equal, or <code>FALSE</code>
+ *              otherwise
+ */
+Boolean same_vtype(VType a, VType b);
+
+/**
+ * Releases the memory resources associated with an analysis result.
+ *
+ * @param[in]   f
+ *     the analysis result
+ */
+void free_flow(Flow *f);
+
+#endif /* DATAFLOW_H */
@@ -0,0 +1,193 @@
+/**
+ * @file    dead.c
+ * @brief   Removal of the code that cannot run, within and across functions.
+ * @date    2026-10-14
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "boolean.h"
+#include "dataflow.h"
+#include "dead.h"
+#include "error.h"
+#include "ir.h"
+
+/* --- function prototypes -------------------------------------------------- */
+
+static int find_body(Body **order, int nbodies, const char *ref);
+static int by_ref(const void *a, const void *b);
+
+/* --- dead code interface -------------------------------------------------- */
+
+void remove_dead_blocks(IRfunc *fn, DeadStats *stats)
+{
+	IRblock *bb, *next, **work;
+	IRinsn *i;
+	Boolean *reached, *targeted;
+	unsigned int n;
+	int s;
+
+	ir_build_cfg(fn);
+
+	/* the blocks are numbered in layout order, the entry first */
+	reached = emalloc((fn->nblocks + 1) * sizeof(Boolean));
+	memset(reached, 0, fn->nblocks * sizeof(Boolean));
+	work = emalloc((fn->nblocks + 1) * sizeof(IRblock *));
+	n = 0;
+	reached[fn->first->id] = TRUE;
+	work[n++] = fn->first;
+	while (n > 0) {
+		bb = work[--n];
+		for (s = 0; s < 2; s++) {
+			if (bb->succ[s] && !reached[bb->succ[s]->id]) {
+				reached[bb->succ[s]->id] = TRUE;
+				work[n++] = bb->succ[s];
+			}
+		}
+	}
+
+	for (bb = fn->first; bb; bb = next) {
+		next = bb->next;
+		if (!reached[bb->id]) {
+			ir_unlink_block(fn, bb);
+			stats->blocks++;
+		}
+	}
+	free(work);
+	free(reached);
+	ir_build_cfg(fn);
+
+	/* with the branches of the blocks removed, some labels lose their last
+	 * reference; a block that is only fallen into needs none */
+	targeted = emalloc((fn->nblocks + 1) * sizeof(Boolean));
+	memset(targeted, 0, fn->nblocks * sizeof(Boolean));
+	for (bb = fn->first; bb; bb = bb->next) {
+		for (i = bb->first; i; i = i->next) {
+			if (i->operand == CODE_LABEL) {
+				targeted[i->target->id] = TRUE;
+			}
+		}
+	}
+	for (bb = fn->first; bb; bb = bb->next) {
+		if (bb->label && !targeted[bb->id]) {
+			bb->label = 0;
+			stats->labels++;
+		}
+	}
+	free(targeted);
+}
+
+void remove_dead_functions(Body **bodies, Body *main, DeadStats *stats)
+{
+	Body *b, **order;
+	IRblock *bb;
+	IRinsn *i;
+	Boolean *reached;
+	int *work, nbodies, n, k, c;
+
+	nbodies = 0;
+	for (b = *bodies; b; b = b->next) {
+		nbodies++;
+	}
+	order = emalloc((nbodies + 1) * sizeof(Body *));
+	reached = emalloc((nbodies + 1) * sizeof(Boolean));
+	work = emalloc((nbodies + 1) * sizeof(int));
+	for (k = 0, b = *bodies; b; b = b->next, k++) {
+		order[k] = b;
+	}
+	qsort(order, nbodies, sizeof(Body *), by_ref);
+	for (k = 0; k < nbodies; k++) {
+		reached[k] = (order[k] == main);
+		if (reached[k]) {
+			work[0] = k;
+		}
+	}
+
+	/* every call goes through the method reference of its callee, which is
+	 * shared with the body; calls to the run-time support match no body */
+	n = 1;
+	while (n > 0) {
+		b = order[work[--n]];
+		for (bb = b->ir->first; bb; bb = bb->next) {
+			for (i = bb->first; i; i = i->next) {
+				if (i->op == JVM_INVOKESTATIC
+						&& (c = find_body(order, nbodies, i->string)) >= 0
+						&& !reached[c]) {
+					reached[c] = TRUE;
+					work[n++] = c;
+				}
+			}
+		}
+	}
+
+	for (k = 0; k < nbodies; k++) {
+		if (reached[k]) {
+			continue;
+		}
+		b = order[k];
+		if (b->prev) {
+			b->prev->next = b->next;
+		} else {
+			*bodies = b->next;
+		}
+		if (b->next) {
+			b->next->prev = b->prev;
+		}
+		free_flow(b->flow);
+		free(b->code);
+		free(b->lines);
+		stats->functions++;
+	}
+
+	free(work);
+	free(reached);
+	free(order);
+}
+
+void print_dead_stats(FILE *file, const char *prefix, const DeadStats *stats)
+{
+	if (stats->functions + stats->blocks + stats->labels > 0) {
+		fprintf(file, "%sdead: %lu functions, %lu blocks, %lu labels "
+				"removed\n", prefix, stats->functions, stats->blocks,
+				stats->labels);
+	}
+}
+
+/* --- utility functions ---------------------------------------------------- */
+
+/* Returns the position of the body to which a method reference belongs, or -1
+ * for a method of the run-time support.  The bodies are ordered by the address
+ * of their reference.
+ */
+
+static int find_body(Body **order, int nbodies, const char *ref)
+{
+	int lo = 0, hi = nbodies - 1, k;
+
+	while (lo <= hi) {
+		k = lo + (hi - lo) / 2;
+		if ((uintptr_t) order[k]->ref < (uintptr_t) ref) {
+			lo = k + 1;
+		} else if ((uintptr_t) order[k]->ref > (uintptr_t) ref) {
+			hi = k - 1;
+		} else {
+			return k;
+		}
+	}
+
+	return -1;
+}
+
+/* Orders bodies by the address of their method reference, which every call
+ * site shares.
+ */
+
+static int by_ref(const void *a, const void *b)
+{
+	uintptr_t x = (uintptr_t) (*(Body * const *) a)->ref;
+	uintptr_t y = (uintptr_t) (*(Body * const *) b)->ref;
+
+	return (x > y) - (x < y);
+}
@@ -0,0 +1,67 @@
+/**
+ * @file    dead.h
+ * @brief   Removal of the code that cannot run, within and across functions.
+ *
+ * Within a function, the blocks that control cannot reach from its entry are
+ * removed, whether they follow a leave or a return, or a branch that folding
+ * decided, together with the labels that no branch refers to any more.  Once
+ * the main body has been compiled, the calls of every body make up the call
+ * graph of the program, and the functions and procedures that main cannot
+ * reach, such as those of which every call was inlined, are not written to the
+ * output.  This is run at optimisation level 1 and above.
+ *
+ * @date    2026-10-14
+ */
+
+#ifndef DEAD_H
+#define DEAD_H
+
+#include <stdio.h>
+#include "bytecode.h"
+#include "ir.h"
+
+/** what dead code elimination did */
+typedef struct {
+	unsigned long functions;  /**< the bodies that main cannot reach        */
+	unsigned long blocks;     /**< the blocks that control cannot reach     */
+	unsigned long labels;     /**< the labels that no branch refers to      */
+} DeadStats;
+
+/**
+ * Removes the blocks of a function that control cannot reach from its entry,
+ * and the labels of the blocks to which no branch jumps.
+ *
+ * @param[in]   fn
+ *     the IR of the function
+ * @param[in,out]   stats
+ *     the statistics, to which the removals are added
+ */
+void remove_dead_blocks(IRfunc *fn, DeadStats *stats);
+
+/**
+ * Unlinks the bodies that no chain of calls from main reaches, and frees their
+ * code and flow information.
+ *
+ * @param[in,out]   bodies
+ *     the first of the bodies of the program, in order, which is updated if it
+ *     is removed
+ * @param[in]   main
+ *     the body of main, which is the last
+ * @param[in,out]   stats
+ *     the statistics, to which the removals are added
+ */
+void remove_dead_functions(Body **bodies, Body *main, DeadStats *stats);
+
+/**
+ * Writes what dead code elimination did, on one line.
+ *
+ * @param[in]   file
+ *     the output file
+ * @param[in]   prefix
+ *     the text that starts the line
+ * @param[in]   stats
+ *     the statistics
+ */
+void print_dead_stats(FILE *file, const char *prefix, const DeadStats *stats);
+
+#endif /* DEAD_H */
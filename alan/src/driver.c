@@ -0,0 +1,442 @@
+/**
+ * @file    driver.c
+ * @brief   The command-line driver of the ALAN-2022 compiler.
+ *
+ * The driver compiles one source file, or, in batch and server modes, many
+ * source files in one process, each in a context of its own, through the
+ * <code>libalanc</code> interface in <code>compiler.h</code>.  With
+ * <code>-j</code>, the files of a batch are compiled by a pool of threads, and
+ * the diagnostics of every file are collected and written out in the order in
+ * which the files were named, so that the output does not depend on the
+ * scheduling of the threads.
+ *
+ * If <code>ALAN_CACHE_DIR</code> is set, compilations are looked up in, and
+ * stored into, a content-addressed cache in that directory, which is bounded
+ * by the size in <code>ALAN_CACHE_SIZE</code> (in bytes, or with a
+ * <code>K</code>, <code>M</code>, or <code>G</code> suffix).
+ *
+ * @date    2026-10-14
+ */
+
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "asmserver.h"
+#include "boolean.h"
+#include "cache.h"
+#include "compiler.h"
+#include "error.h"
+
+/* --- constants ------------------------------------------------------------ */
+
+#define USAGE                                                                  \
+	"usage: %s [<options>] <filename>\n"                                       \
+	"       %s [<options>] [-j <jobs>] --batch <filename>...\n"                \
+	"       %s [<options>] -j <jobs> <filename>...\n"                          \
+	"       %s [<options>] --server\n"                                         \
+	"options:\n"                                                               \
+	"  -O<level>      optimise, at a level from 0 (the default) to %d\n"       \
+	"  --opt-report   report what the optimisations did\n"                     \
+	"  --inline-limit=<n>\n"                                                   \
+	"                 inline functions of up to n IR instructions at -O2\n"    \
+	"  --inline-report\n"                                                      \
+	"                 report whether each call was inlined, and why\n"         \
+	"  --jasmin       assemble through Jasmin, found in $JASMIN_JAR\n"         \
+	"  --pretokenize  scan each source completely before parsing it\n"         \
+	"  --profile      count and time the calls and loops of the program,\n"    \
+	"                 which writes them to <class>.prof when it ends\n"        \
+	"  --stats        report the time and work of each source, in JSON\n"      \
+	"  --cache-stats  report the use of the cache in $ALAN_CACHE_DIR"
+
+#define USAGE_ARGS                                                             \
+	getprogname(), getprogname(), getprogname(), getprogname(),                \
+	ALAN_MAX_OPTIMISE
+
+#define CACHE_STATS                                                            \
+	"cache: %lu hits, %lu misses, %lu stored, %lu evicted, %lu of %lu bytes"
+
+/* --- type definitions ----------------------------------------------------- */
+
+/** a source file of a parallel batch */
+typedef struct {
+	const char *src_name;  /**< the name of the source file            */
+	int         status;    /**< the exit status of its compilation     */
+	char       *diag;      /**< the diagnostics collected for the file */
+	size_t      ndiag;     /**< the length of the diagnostics          */
+	Boolean     done;      /**< whether the compilation has finished   */
+} Job;
+
+/** the shared state of the worker threads of a parallel batch */
+typedef struct {
+	Job             *jobs;         /**< the source files, in order         */
+	int              njobs;        /**< the number of source files         */
+	int              next;         /**< the index of the next unclaimed job */
+	const char      *jasmin_path;  /**< the path to the Jasmin JAR file    */
+	AsmServer       *asm_server;   /**< the shared assembler, or NULL      */
+	pthread_mutex_t  lock;         /**< protects next and the done flags   */
+	pthread_cond_t   finished;     /**< signalled whenever a job is done   */
+} Pool;
+
+/* --- function prototypes -------------------------------------------------- */
+
+static int compile(const char *src_name, const char *jasmin_path,
+		AsmServer *asm_server, FILE *diag);
+static int compile_parallel(char *src_names[], int nsrc, int nthreads,
+		const char *jasmin_path, AsmServer *asm_server);
+static void *worker(void *arg);
+static AlanCache *open_cache(void);
+static void close_cache(Boolean show_stats);
+
+/* --- global variables ----------------------------------------------------- */
+
+/* the options and the compile cache shared by all compilations */
+static AlanOptions options;
+static AlanCache *cache = NULL;
+
+/* --- main routine --------------------------------------------------------- */
+
+int main(int argc, char *argv[])
+{
+	char *jasmin_path, *shim_dir, *slash, line[PATH_MAX + 2];
+	Boolean use_jasmin, batch, server, show_stats;
+	AsmServer *asm_server;
+	int i, nsrc, nfailed, nthreads, status;
+	size_t len;
+	char *jobs, *end;
+
+	/* set up global variables */
+	setprogname(argv[0]);
+
+	/* check command-line arguments and environment */
+	nsrc = 0;
+	nthreads = 0;
+	use_jasmin = batch = server = show_stats = FALSE;
+	for (i = 1; i < argc; i++) {
+		if (strncmp(argv[i], "-j", 2) == 0) {
+			if ((jobs = argv[i] + 2)[0] == '\0' && (jobs = argv[++i]) == NULL) {
+				eprintf(USAGE, USAGE_ARGS);
+			}
+			nthreads = (int) strtol(jobs, &end, 10);
+			if (*end != '\0' || nthreads < 1) {
+				eprintf("invalid number of jobs '%s'", jobs);
+			}
+		} else if (strncmp(argv[i], "-O", 2) == 0) {
+			options.optimise = (argv[i][2] == '\0' ? 1
+					: (int) strtol(argv[i] + 2, &end, 10));
+			if ((argv[i][2] != '\0' && *end != '\0') || options.optimise < 0
+					|| options.optimise > ALAN_MAX_OPTIMISE) {
+				eprintf("invalid optimisation level '%s'", argv[i] + 2);
+			}
+		} else if (strcmp(argv[i], "--opt-report") == 0) {
+			options.report = TRUE;
+		} else if (strncmp(argv[i], "--inline-limit=", 15) == 0) {
+			options.inline_limit = (int) strtol(argv[i] + 15, &end, 10);
+			if (argv[i][15] == '\0' || *end != '\0'
+					|| options.inline_limit < 1) {
+				eprintf("invalid inline limit '%s'", argv[i] + 15);
+			}
+		} else if (strcmp(argv[i], "--inline-report") == 0) {
+			options.inline_report = TRUE;
+		} else if (strcmp(argv[i], "--jasmin") == 0) {
+			use_jasmin = TRUE;
+		} else if (strcmp(argv[i], "--pretokenize") == 0) {
+			options.pretokenize = TRUE;
+		} else if (strcmp(argv[i], "--profile") == 0) {
+			options.profile = TRUE;
+		} else if (strcmp(argv[i], "--stats") == 0) {
+			options.stats = TRUE;
+		} else if (strcmp(argv[i], "--cache-stats") == 0) {
+			show_stats = TRUE;
+		} else if (strcmp(argv[i], "--batch") == 0) {
+			batch = TRUE;
+		} else if (strcmp(argv[i], "--server") == 0) {
+			server = TRUE;
+		} else if (argv[i][0] != '-') {
+			argv[++nsrc] = argv[i];
+		} else {
+			eprintf(USAGE, USAGE_ARGS);
+		}
+	}
+	if (nthreads > 0) {
+		batch = TRUE;
+	}
+	if ((batch && server) || (server && nsrc > 0)
+			|| (!server && nsrc == 0) || (!batch && !server && nsrc > 1)) {
+		eprintf(USAGE, USAGE_ARGS);
+	}
+
+	jasmin_path = NULL;
+	if (use_jasmin && (jasmin_path = getenv("JASMIN_JAR")) == NULL) {
+		eprintf("JASMIN_JAR environment variable not set");
+	}
+	cache = open_cache();
+
+	/* a single file is compiled (and assembled) as before */
+	if (!batch && !server) {
+		status = compile(argv[1], jasmin_path, NULL, NULL);
+		close_cache(show_stats);
+		freeprogname();
+		return status;
+	}
+
+	/* otherwise, one warm assembler serves all files, each of which is
+	 * compiled in a fresh context, so that errors stay contained */
+	asm_server = NULL;
+	if (use_jasmin) {
+		if ((shim_dir = getenv("ALAN_SHIM_DIR")) != NULL) {
+			shim_dir = estrdup(shim_dir);
+		} else if ((slash = strrchr(argv[0], '/')) != NULL) {
+			shim_dir = estrdup(argv[0]);
+			shim_dir[slash - argv[0]] = '\0';
+		} else {
+			shim_dir = estrdup(".");
+		}
+		asm_server = asm_server_start(jasmin_path, shim_dir);
+		free(shim_dir);
+	}
+
+	nfailed = 0;
+	if (batch && nthreads > 1) {
+		nfailed = compile_parallel(argv + 1, nsrc, nthreads, jasmin_path,
+				asm_server);
+	} else if (batch) {
+		for (i = 1; i <= nsrc; i++) {
+			if (compile(argv[i], jasmin_path, asm_server, NULL)
+					!= EXIT_SUCCESS) {
+				nfailed++;
+			}
+		}
+	} else {
+		while (fgets(line, sizeof(line), stdin) != NULL) {
+			len = strlen(line);
+			if (len > 0 && line[len - 1] == '\n') {
+				line[--len] = '\0';
+			}
+			if (len == 0) {
+				continue;
+			}
+			if (compile(line, jasmin_path, asm_server, NULL) == EXIT_SUCCESS) {
+				printf("ok %s\n", line);
+			} else {
+				printf("failed %s\n", line);
+				nfailed++;
+			}
+			fflush(stdout);
+		}
+	}
+
+	if (asm_server) {
+		asm_server_stop(asm_server);
+	}
+	close_cache(show_stats);
+	freeprogname();
+
+	return (nfailed == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+/* --- driver routines ------------------------------------------------------ */
+
+/**
+ * Compiles a single source file in a new compiler context.
+ *
+ * @param[in]   src_name
+ *     the name of the source file
+ * @param[in]   jasmin_path
+ *     the path to the Jasmin JAR file, or <code>NULL</code> to write the class
+ *     file directly
+ * @param[in]   asm_server
+ *     the assembler server to use instead of starting Jasmin, or
+ *     <code>NULL</code>
+ * @param[in]   diag
+ *     the stream for the diagnostics of the compilation, or <code>NULL</code>
+ *     for the standard error stream
+ * @return      the exit status of the compilation
+ */
+static int compile(const char *src_name, const char *jasmin_path,
+		AsmServer *asm_server, FILE *diag)
+{
+	AlanCompiler *ac;
+	int status;
+
+	ac = alan_new();
+	alan_set_options(ac, &options);
+	alan_set_cache(ac, cache);
+	alan_set_diagnostic_stream(ac, diag);
+	status = alan_compile(ac, src_name, jasmin_path, asm_server);
+	alan_free(ac);
+
+	return status;
+}
+
+/**
+ * Compiles a batch of source files on a pool of threads.  The diagnostics of
+ * each file are written to the standard error stream as one group, in the
+ * order of the files, as soon as the file and all the files before it have
+ * been compiled.
+ *
+ * @param[in]   src_names
+ *     the names of the source files
+ * @param[in]   nsrc
+ *     the number of source files
+ * @param[in]   nthreads
+ *     the maximum number of worker threads
+ * @param[in]   jasmin_path
+ *     the path to the Jasmin JAR file, or <code>NULL</code>
+ * @param[in]   asm_server
+ *     the assembler server shared by the threads, or <code>NULL</code>
+ * @return      the number of files that failed to compile
+ */
+static int compile_parallel(char *src_names[], int nsrc, int nthreads,
+		const char *jasmin_path, AsmServer *asm_server)
+{
+	Pool pool;
+	pthread_t *threads;
+	int i, nfailed;
+
+	pool.jobs = emalloc(nsrc * sizeof(Job));
+	memset(pool.jobs, 0, nsrc * sizeof(Job));
+	for (i = 0; i < nsrc; i++) {
+		pool.jobs[i].src_name = src_names[i];
+	}
+	pool.njobs = nsrc;
+	pool.next = 0;
+	pool.jasmin_path = jasmin_path;
+	pool.asm_server = asm_server;
+	pthread_mutex_init(&pool.lock, NULL);
+	pthread_cond_init(&pool.finished, NULL);
+
+	if (nthreads > nsrc) {
+		nthreads = nsrc;
+	}
+	threads = emalloc(nthreads * sizeof(pthread_t));
+	for (i = 0; i < nthreads; i++) {
+		if (pthread_create(&threads[i], NULL, worker, &pool) != 0) {
+			eprintf("Could not create a compilation thread");
+		}
+	}
+
+	/* report the files in order, while the workers carry on */
+	nfailed = 0;
+	for (i = 0; i < nsrc; i++) {
+		pthread_mutex_lock(&pool.lock);
+		while (!pool.jobs[i].done) {
+			pthread_cond_wait(&pool.finished, &pool.lock);
+		}
+		pthread_mutex_unlock(&pool.lock);
+
+		fwrite(pool.jobs[i].diag, 1, pool.jobs[i].ndiag, stderr);
+		free(pool.jobs[i].diag);
+		if (pool.jobs[i].status != EXIT_SUCCESS) {
+			nfailed++;
+		}
+	}
+
+	for (i = 0; i < nthreads; i++) {
+		pthread_join(threads[i], NULL);
+	}
+	pthread_cond_destroy(&pool.finished);
+	pthread_mutex_destroy(&pool.lock);
+	free(threads);
+	free(pool.jobs);
+
+	return nfailed;
+}
+
+/**
+ * Compiles the jobs of a pool, one after the other, until none is left,
+ * collecting the diagnostics of every job in a buffer of its own.
+ *
+ * @param[in]   arg
+ *     the pool
+ * @return      <code>NULL</code>
+ */
+static void *worker(void *arg)
+{
+	Pool *pool = arg;
+	Job *job;
+	FILE *diag;
+
+	for (;;) {
+		pthread_mutex_lock(&pool->lock);
+		job = (pool->next < pool->njobs ? &pool->jobs[pool->next++] : NULL);
+		pthread_mutex_unlock(&pool->lock);
+		if (job == NULL) {
+			break;
+		}
+
+		if ((diag = open_memstream(&job->diag, &job->ndiag)) == NULL) {
+			eprintf("Could not create a diagnostic buffer:");
+		}
+		job->status = compile(job->src_name, pool->jasmin_path,
+				pool->asm_server, diag);
+		fclose(diag);
+
+		pthread_mutex_lock(&pool->lock);
+		job->done = TRUE;
+		pthread_cond_broadcast(&pool->finished);
+		pthread_mutex_unlock(&pool->lock);
+	}
+
+	return NULL;
+}
+
+/* --- compile cache -------------------------------------------------------- */
+
+/**
+ * Opens the compile cache named by the environment, if any.
+ *
+ * @return      the cache, or <code>NULL</code> if there is none
+ */
+static AlanCache *open_cache(void)
+{
+	char *dir, *size, *end;
+	unsigned long limit;
+
+	if ((dir = getenv("ALAN_CACHE_DIR")) == NULL || dir[0] == '\0') {
+		return NULL;
+	}
+
+	limit = CACHE_DEFAULT_LIMIT;
+	if ((size = getenv("ALAN_CACHE_SIZE")) != NULL) {
+		limit = strtoul(size, &end, 10);
+		switch (*end) {
+			case 'G': limit *= 1024; /* fall through */
+			case 'M': limit *= 1024; /* fall through */
+			case 'K': limit *= 1024; end++; break;
+			default: break;
+		}
+		if (*end != '\0' || end == size) {
+			eprintf("invalid cache size '%s' in ALAN_CACHE_SIZE", size);
+		}
+	}
+
+	return cache_open(dir, limit);
+}
+
+/**
+ * Closes the compile cache, if any, and reports its statistics if asked to.
+ *
+ * @param[in]   show_stats
+ *     whether to write the statistics to the standard error stream
+ */
+static void close_cache(Boolean show_stats)
+{
+	CacheStats stats;
+
+	if (cache == NULL) {
+		if (show_stats) {
+			weprintf("no compile cache (ALAN_CACHE_DIR is not set)");
+		}
+		return;
+	}
+
+	if (show_stats) {
+		cache_get_stats(cache, &stats);
+		fprintf(stderr, CACHE_STATS "\n", stats.hits, stats.misses,
+				stats.stores, stats.evictions, stats.size, stats.limit);
+	}
+	cache_close(cache);
+	cache = NULL;
+}
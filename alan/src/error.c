@@ -11,6 +11,7 @@
 /* by Brian W. Kernighan and Rob Pike                     */
 /* Copyright (C) 1999 Lucent Technologies                 */
 
+#include "compiler.h"
 #include "error.h"
 #include <errno.h>
 #include <stdarg.h>
@@ -82,93 +83,120 @@
 
 /* --- error routines ------------------------------------------------------- */
 
-SourcePos position;
-
 #ifndef __APPLE__
 static char *pname = NULL;
 #endif
-static char *sname = NULL;
 
-static void _weprintf(const char *pre, const SourcePos *pos, const char *fmt,
+static void _weprintf(FILE *out, const char *colour, const char *pre,
+		const char *srcname, const SourcePos *pos, const char *fmt,
 		va_list args)
 {
-	int istty = isatty(2);
+	int istty = (out == stderr && isatty(2));
 	const char *ac_end = (istty ? ASCII_RESET : "");
 	const char *ac_src = (istty ? ASCII_BOLD_WHITE : "");
 	const char *ac_pos = (istty ? ASCII_BOLD_WHITE : "");
+	const char *ac_pre = (istty && colour ? colour : "");
+	const char *ac_pre_end = (istty && colour ? ASCII_RESET : "");
 	const char *progname = getprogname();
-	const char *srcname = getsrcname();
+	int errnum = errno;
 
 	fflush(stdout);
 	if (progname != NULL)
-		fprintf(stderr, "%s:", progname);
+		fprintf(out, "%s:", progname);
 	if (srcname != NULL)
-		fprintf(stderr, " %s%s:%s", ac_src, srcname, ac_end);
+		fprintf(out, " %s%s:%s", ac_src, srcname, ac_end);
 	if (pos != NULL)
-		fprintf(stderr, "%s%d:%d%s:", ac_pos, pos->line, pos->col, ac_end);
+		fprintf(out, "%s%d:%d%s:", ac_pos, pos->line, pos->col, ac_end);
 	if (pre != NULL)
-		fprintf(stderr, " %s ", pre);
+		fprintf(out, " %s%s%s ", ac_pre, pre, ac_pre_end);
 	else
-		fprintf(stderr, " ");
+		fprintf(out, " ");
 
-	vfprintf(stderr, fmt, args);
+	vfprintf(out, fmt, args);
 
 	if (fmt[0] != '\0' && fmt[strlen(fmt)-1] == ':')
-		fprintf(stderr, " %s", strerror(errno));
-	fprintf(stderr, "\n");
+		fprintf(out, " %s", strerror(errnum));
+	fprintf(out, "\n");
+}
+
+static FILE *diag_stream(AlanCompiler *ac)
+{
+	return (ac->diag != NULL ? ac->diag : stderr);
 }
 
 void eprintf(const char *fmt, ...)
 {
-	int istty = isatty(2);
 	va_list args;
-	const char *pre =
-		(istty ? ASCII_BOLD_RED "error:" ASCII_RESET : "error:");
 
 	va_start(args, fmt);
-	_weprintf(pre, NULL, fmt, args);
+	_weprintf(stderr, ASCII_BOLD_RED, "error:", NULL, NULL, fmt, args);
 	va_end(args);
 	exit(2);
 }
 
-void leprintf(const char *fmt, ...)
+void ceprintf(AlanCompiler *ac, const char *fmt, ...)
 {
-	int istty = isatty(2);
 	va_list args;
-	const char *pre =
-		(istty ? ASCII_BOLD_RED "error:" ASCII_RESET : "error:");
 
 	va_start(args, fmt);
-	_weprintf(pre, &position, fmt, args);
+	_weprintf(diag_stream(ac), ASCII_BOLD_RED, "error:", ac->src_name, NULL,
+			fmt, args);
 	va_end(args);
-	exit(2);
+	alan_abort(ac, 2);
+}
+
+void leprintf(AlanCompiler *ac, const char *fmt, ...)
+{
+	va_list args;
+
+	alan_locate(ac, &ac->position);
+	va_start(args, fmt);
+	_weprintf(diag_stream(ac), ASCII_BOLD_RED, "error:", ac->src_name,
+			&ac->position, fmt, args);
+	va_end(args);
+	alan_abort(ac, 2);
 }
 
 void weprintf(const char *fmt, ...)
 {
-	int istty = isatty(2);
 	va_list args;
-	const char *pre =
-		(istty ? ASCII_BOLD_YELLOW "warning:" ASCII_RESET : "warning:");
 
 	va_start(args, fmt);
-	_weprintf(pre, NULL, fmt, args);
+	_weprintf(stderr, ASCII_BOLD_YELLOW, "warning:", NULL, NULL, fmt, args);
+	va_end(args);
+}
+
+void cweprintf(AlanCompiler *ac, const char *fmt, ...)
+{
+	va_list args;
+
+	va_start(args, fmt);
+	_weprintf(diag_stream(ac), ASCII_BOLD_YELLOW, "warning:", ac->src_name,
+			NULL, fmt, args);
 	va_end(args);
 }
 
-void teprintf(const char *tag, const char *fmt, ...)
+void teprintf(AlanCompiler *ac, const char *tag, const char *fmt, ...)
 {
 	va_list args;
 
+	alan_locate(ac, &ac->position);
 	va_start(args, fmt);
-	_weprintf(tag, &position, fmt, args);
+	_weprintf(diag_stream(ac), NULL, tag, ac->src_name, &ac->position, fmt,
+			args);
 	va_end(args);
-	exit(3);
+	alan_abort(ac, 3);
 }
 
+/* --- memory allocation ---------------------------------------------------- */
+
+/* what the allocation functions have handed out, in each thread */
+static _Thread_local AllocCounts alloc_counts;
+
 char *estrdup(const char *s)
 {
 	char *t;
+	alloc_counts.allocated += strlen(s) + 1;
 	t = malloc((strlen(s) + 1) * sizeof(char));
 	if (t == NULL)
 		eprintf("estrdup(\"%.20s\") failed:", s);
@@ -179,6 +207,7 @@ char *estrdup(const char *s)
 char *westrdup(const char *s)
 {
 	char *t;
+	alloc_counts.allocated += strlen(s) + 1;
 	t = malloc((strlen(s) + 1) * sizeof(char));
 	if (t == NULL)
 		weprintf("estrdup(\"%.20s\") failed:", s);
@@ -190,6 +219,7 @@ void *emalloc(size_t n)
 {
 	void *p;
 
+	alloc_counts.allocated += n;
 	p = malloc(n);
 	if (p == NULL)
 		eprintf("malloc of %u bytes failed:", n);
@@ -200,6 +230,7 @@ void *wemalloc(size_t n)
 {
 	void *p;
 
+	alloc_counts.allocated += n;
 	p = malloc(n);
 	if (p == NULL)
 		weprintf("malloc of %u bytes failed:", n);
@@ -210,6 +241,8 @@ void *erealloc(void *vp, size_t n)
 {
 	void *p;
 
+	alloc_counts.allocated += n;
+	alloc_counts.reallocs++;
 	p = realloc(vp, n);
 	if (p == NULL)
 		eprintf("realloc of %u bytes failed:", n);
@@ -220,26 +253,144 @@ void *werealloc(void *vp, size_t n)
 {
 	void *p;
 
+	alloc_counts.allocated += n;
+	alloc_counts.reallocs++;
 	p = realloc(vp, n);
 	if (p == NULL)
 		weprintf("realloc of %u bytes failed:", n);
 	return p;
 }
 
-#ifndef __APPLE__
-void setprogname(char *s)
+void get_alloc_counts(AllocCounts *counts)
 {
-	char *c;
+	*counts = alloc_counts;
+}
 
-	if ((c = strrchr(s, '/')) == NULL)
-		c = s;
-	else
-		c++;
-	pname = estrdup(c);
+/* --- arenas -------------------------------------------------------------- */
+
+#define ARENA_CHUNK_SIZE 65536
+#define ARENA_ALIGN      16
+#define ARENA_ROUND(n)   (((n) + ARENA_ALIGN - 1) & ~(size_t) (ARENA_ALIGN - 1))
+
+/** a block of arena storage, which follows its header */
+typedef struct arena_chunk ArenaChunk;
+struct arena_chunk {
+	ArenaChunk *next;  /**< the chunk filled before this one, or a spare */
+	size_t      size;  /**< the number of bytes of storage               */
+};
+
+struct arena {
+	Arena      *parent; /**< the arena that lends chunks, or NULL        */
+	ArenaChunk *head;   /**< the chunk being filled                      */
+	ArenaChunk *tail;   /**< the chunk filled first                      */
+	char       *next;   /**< the next free byte of the head chunk        */
+	char       *end;    /**< the end of the head chunk                   */
+	ArenaChunk *spare;  /**< the released chunks, kept by the root arena */
+};
+
+#define CHUNK_DATA(c) ((char *) (c) + ARENA_ROUND(sizeof(ArenaChunk)))
+
+static void arena_grow(Arena *a, size_t n);
+static void arena_give_back(Arena *a);
+
+Arena *arena_new(Arena *parent)
+{
+	Arena *a;
+
+	a = emalloc(sizeof(Arena));
+	memset(a, 0, sizeof(Arena));
+	a->parent = parent;
+	return a;
 }
-#endif
 
-void setsrcname(char *s)
+void *arena_alloc(Arena *a, size_t n)
+{
+	void *p;
+
+	n = ARENA_ROUND(n ? n : 1);
+	if ((size_t) (a->end - a->next) < n)
+		arena_grow(a, n);
+	p = a->next;
+	a->next += n;
+	return p;
+}
+
+char *arena_strdup(Arena *a, const char *s)
+{
+	size_t n = strlen(s) + 1;
+
+	return memcpy(arena_alloc(a, n), s, n);
+}
+
+void arena_reset(Arena *a)
+{
+	arena_give_back(a);
+}
+
+void arena_free(Arena *a)
+{
+	ArenaChunk *c, *next;
+
+	if (a == NULL)
+		return;
+	arena_give_back(a);
+	if (a->parent == NULL) {
+		for (c = a->spare; c; c = next) {
+			next = c->next;
+			free(c);
+		}
+	}
+	free(a);
+}
+
+/* Makes a chunk of at least n bytes the head chunk, reusing a spare chunk of
+ * the root arena if it is large enough.
+ */
+
+static void arena_grow(Arena *a, size_t n)
+{
+	Arena *root;
+	ArenaChunk *c;
+	size_t size = (n > ARENA_CHUNK_SIZE ? n : ARENA_CHUNK_SIZE);
+
+	for (root = a; root->parent; root = root->parent)
+		;
+	if (root->spare && root->spare->size >= size) {
+		c = root->spare;
+		root->spare = c->next;
+	} else {
+		c = emalloc(ARENA_ROUND(sizeof(ArenaChunk)) + size);
+		c->size = size;
+	}
+
+	c->next = a->head;
+	a->head = c;
+	if (a->tail == NULL)
+		a->tail = c;
+	a->next = CHUNK_DATA(c);
+	a->end = a->next + c->size;
+}
+
+/* Hands the chunks of an arena to the spare list of the root arena, in time
+ * independent of the number of chunks, and leaves the arena empty.
+ */
+
+static void arena_give_back(Arena *a)
+{
+	Arena *root;
+
+	if (a->head) {
+		for (root = a; root->parent; root = root->parent)
+			;
+		a->tail->next = root->spare;
+		root->spare = a->head;
+	}
+	a->head = a->tail = NULL;
+	a->next = a->end = NULL;
+}
+
+#ifndef __APPLE__
+void setprogname(char *s)
 {
 	char *c;
 
@@ -247,8 +398,9 @@ void setsrcname(char *s)
 		c = s;
 	else
 		c++;
-	sname = estrdup(c);
+	pname = estrdup(c);
 }
+#endif
 
 #ifndef __APPLE__
 char *getprogname(void)
@@ -257,19 +409,9 @@ char *getprogname(void)
 }
 #endif
 
-char *getsrcname(void)
-{
-	return sname;
-}
-
 void freeprogname(void)
 {
 #ifndef __APPLE__
 	free(pname);
 #endif
 }
-
-void freesrcname(void)
-{
-	free(sname);
-}
@@ -19,13 +19,23 @@
 #ifndef ERROR_H
 #define ERROR_H
 
+#include <stddef.h>
+
 /** a place (position) in the source file */
 typedef struct {
-	int line;  /**< the line number   */
-	int col;   /**< the column number */
+	int    line;    /**< the line number                          */
+	int    col;     /**< the column number                        */
+	size_t offset;  /**< the byte offset, from which both follow */
 } SourcePos;
 
-extern SourcePos position;
+/** the context of a compilation, defined in compiler.h */
+typedef struct alan_compiler AlanCompiler;
+
+/** the memory handed out by the allocation functions of one thread */
+typedef struct {
+	unsigned long allocated;  /**< the bytes asked for, also by reallocations */
+	unsigned long reallocs;   /**< the number of reallocations                */
+} AllocCounts;
 
 /**
  * Displays an error message on the standard error stream and exit.
@@ -38,20 +48,37 @@ extern SourcePos position;
 void eprintf(const char *fmt, ...);
 
 /**
- * Displays an error message on the standard error stream, with the current
- * position prepended, and exit.
+ * Displays an error message on the diagnostic stream of a compilation, with
+ * the source name prepended, and abandon the compilation.
  *
+ * @param[in]   ac
+ *     the compiler context
  * @param[in]   fmt
  *     a printf format string
  * @param[in]   ...
  *     the variable arguments to the format string
  */
-void leprintf(const char *fmt, ...);
+void ceprintf(AlanCompiler *ac, const char *fmt, ...);
 
 /**
- * Displays an error message on the standard error stream, with a tag prepended,
- * and exit.
+ * Displays an error message on the diagnostic stream of a compilation, with
+ * the current position prepended, and abandon the compilation.
  *
+ * @param[in]   ac
+ *     the compiler context
+ * @param[in]   fmt
+ *     a printf format string
+ * @param[in]   ...
+ *     the variable arguments to the format string
+ */
+void leprintf(AlanCompiler *ac, const char *fmt, ...);
+
+/**
+ * Displays an error message on the diagnostic stream of a compilation, with a
+ * tag prepended, and abandon the compilation.
+ *
+ * @param[in]   ac
+ *     the compiler context
  * @param[in]   tag
  *     the tag to prepend to the error message
  * @param[in]   fmt
@@ -59,7 +86,7 @@ void leprintf(const char *fmt, ...);
  * @param[in]   ...
  *     the variable arguments to the format string
  */
-void teprintf(const char *tag, const char *fmt, ...);
+void teprintf(AlanCompiler *ac, const char *tag, const char *fmt, ...);
 
 /**
  * Displays a warning message on the standard error stream.
@@ -71,6 +98,19 @@ void teprintf(const char *tag, const char *fmt, ...);
  */
 void weprintf(const char *fmt, ...);
 
+/**
+ * Displays a warning message on the diagnostic stream of a compilation, with
+ * the source name prepended.
+ *
+ * @param[in]   ac
+ *     the compiler context
+ * @param[in]   fmt
+ *     a print format string
+ * @param[in]   ...
+ *     the variable arguments to the format string
+ */
+void cweprintf(AlanCompiler *ac, const char *fmt, ...);
+
 /**
  * Duplicates a string, and terminates the program with a message on the
  * standard error stream if the duplication fails.
@@ -140,47 +180,94 @@ void *erealloc(void *vp, size_t n);
 void *werealloc(void *vp, size_t n);
 
 /**
- * Frees the program name.
+ * Retrieves how much the allocation and reallocation functions have handed out
+ * in the calling thread, so that the cost of one compilation is the difference
+ * between the counts before and after it.
+ *
+ * @param[out]  counts
+ *     the counts
  */
-void freeprogname(void);
+void get_alloc_counts(AllocCounts *counts);
+
+/** a region of memory from which objects are allocated, and released at once */
+typedef struct arena Arena;
 
 /**
- * Frees the source name.
+ * Creates an arena.  A sub-arena takes its storage from the chunks that its
+ * parent has released, so that a scope that is opened and closed many times
+ * reuses the same memory.
+ *
+ * @param[in]   parent
+ *     the arena of the enclosing scope, or <code>NULL</code> for a root arena
+ * @return      a pointer to the new, empty arena
  */
-void freesrcname(void);
+Arena *arena_new(Arena *parent);
 
-#ifndef __APPLE__
 /**
- * Returns the stored program name.
+ * Allocates memory from an arena, and terminates the program with a message on
+ * the standard error stream if the arena cannot grow.  The memory is suitably
+ * aligned for any object, and remains valid until the arena is reset or freed.
  *
- * @return      the stored program name
+ * @param[in]   a
+ *     the arena
+ * @param[in]   n
+ *     the number of bytes to allocate
+ * @return      a pointer to the newly allocated memory
  */
-char *getprogname(void);
-#endif
+void *arena_alloc(Arena *a, size_t n);
+
+/**
+ * Duplicates a string into an arena.
+ *
+ * @param[in]   a
+ *     the arena
+ * @param[in]   s
+ *     the string to duplicate
+ * @return      a pointer to the copy of the string in the arena
+ */
+char *arena_strdup(Arena *a, const char *s);
 
 /**
- * Returns the stored source name.
+ * Releases everything allocated from an arena, which remains usable.  The
+ * storage is kept by the root arena for later allocations.
  *
- * @return      the stored source name
+ * @param[in]   a
+ *     the arena
  */
-char *getsrcname(void);
+void arena_reset(Arena *a);
+
+/**
+ * Releases everything allocated from an arena, as well as the arena itself.
+ * The storage of a sub-arena returns to its root arena in constant time; that
+ * of a root arena returns to the system.
+ *
+ * @param[in]   a
+ *     the arena, or <code>NULL</code>
+ */
+void arena_free(Arena *a);
+
+/**
+ * Frees the program name.
+ */
+void freeprogname(void);
 
 #ifndef __APPLE__
 /**
- * Sets the program name.
+ * Returns the stored program name.
  *
- * @param[in]   s
- *     the program name
+ * @return      the stored program name
  */
-void setprogname(char *s);
+char *getprogname(void);
 #endif
 
+#ifndef __APPLE__
 /**
- * Sets the source name.
+ * Sets the program name.
  *
  * @param[in]   s
- *     the source name
+ *     the program name
  */
-void setsrcname(char *s);
+void setprogname(char *s);
+#endif
 
 #endif /* ERROR_H */
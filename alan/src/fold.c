@@ -0,0 +1,424 @@
+/**
+ * @file    fold.c
+ * @brief   Constant folding and propagation over the IR of function bodies.
+ * @date    2026-10-14
+ */
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "boolean.h"
+#include "error.h"
+#include "fold.h"
+#include "ir.h"
+
+/* --- type definitions and constants --------------------------------------- */
+
+#define IS_CONSTANT(i)                                                         \
+	((i) != NULL && (i)->op == JVM_LDC && (i)->operand == CODE_INTEGER)
+
+/* an increment stores too, in the code of an inlined callee */
+#define IS_STORE(op)                                                           \
+	((op) == JVM_ISTORE || (op) == JVM_ASTORE || (op) == JVM_IINC)
+
+/** the assignments to a local variable slot */
+typedef struct {
+	unsigned int  nstores;  /**< the number of stores to the slot        */
+	IRblock      *bb;       /**< the block of the first store            */
+	IRinsn       *store;    /**< the first store                         */
+	Boolean       passed;   /**< whether the scan of the loads has passed
+	                             the store                               */
+} Slot;
+
+/* --- function prototypes -------------------------------------------------- */
+
+static Boolean fold_blocks(IRfunc *fn, FoldStats *stats);
+static Boolean propagate(IRfunc *fn, unsigned int nparams, FoldStats *stats);
+static int *find_dominators(IRfunc *fn, int **post);
+static Boolean dominates(const int *idom, const int *post, unsigned int a,
+		unsigned int b);
+static Boolean evaluate(Bytecode op, int a, int b, int *result);
+static Boolean compare(Bytecode op, int a, int b);
+
+/* --- folding interface ---------------------------------------------------- */
+
+Boolean fold_constants(IRfunc *fn, unsigned int nparams, FoldStats *stats)
+{
+	Boolean changed, any = FALSE;
+
+	do {
+		changed = fold_blocks(fn, stats);
+		changed = propagate(fn, nparams, stats) || changed;
+		any = any || changed;
+	} while (changed);
+
+	return any;
+}
+
+void print_fold_stats(FILE *file, const char *prefix, const FoldStats *stats)
+{
+	if (stats->folded + stats->decided + stats->propagated > 0) {
+		fprintf(file, "%sfold: %lu operations folded, %lu branches decided, "
+				"%lu loads propagated\n", prefix, stats->folded,
+				stats->decided, stats->propagated);
+	}
+}
+
+/* --- utility functions ---------------------------------------------------- */
+
+/* Folds the operations of which the operands are constants.  The operands of
+ * an operation are the instructions right before it, so that the result of
+ * one fold becomes an operand of the next in the same pass.
+ */
+
+static Boolean fold_blocks(IRfunc *fn, FoldStats *stats)
+{
+	IRblock *bb;
+	IRinsn *i, *a, *b;
+	Boolean changed = FALSE;
+	int result;
+
+	for (bb = fn->first; bb; bb = bb->next) {
+		for (i = bb->first; i; i = i->next) {
+			b = i->prev;
+			a = (b ? b->prev : NULL);
+			switch (i->op) {
+				case JVM_INEG:
+					if (!IS_CONSTANT(b)) {
+						break;
+					}
+					i->op = JVM_LDC;
+					i->operand = CODE_INTEGER;
+					i->num = (int) (0U - (unsigned int) b->num);
+					ir_unlink(bb, b);
+					stats->folded++;
+					changed = TRUE;
+					break;
+				case JVM_IFEQ:
+				case JVM_IFGE:
+				case JVM_IFGT:
+				case JVM_IFLE:
+				case JVM_IFLT:
+				case JVM_IFNE:
+					if (!IS_CONSTANT(b)) {
+						break;
+					}
+					ir_unlink(bb, b);
+					if (compare(i->op, b->num, 0)) {
+						i->op = JVM_GOTO;
+					} else {
+						ir_unlink(bb, i);
+					}
+					stats->decided++;
+					changed = TRUE;
+					break;
+				case JVM_IF_ICMPEQ:
+				case JVM_IF_ICMPGE:
+				case JVM_IF_ICMPGT:
+				case JVM_IF_ICMPLE:
+				case JVM_IF_ICMPLT:
+				case JVM_IF_ICMPNE:
+					if (!IS_CONSTANT(a) || !IS_CONSTANT(b)) {
+						break;
+					}
+					ir_unlink(bb, a);
+					ir_unlink(bb, b);
+					if (compare(i->op, a->num, b->num)) {
+						i->op = JVM_GOTO;
+					} else {
+						ir_unlink(bb, i);
+					}
+					stats->decided++;
+					changed = TRUE;
+					break;
+				default:
+					if (!IS_CONSTANT(a) || !IS_CONSTANT(b)
+							|| !evaluate(i->op, a->num, b->num, &result)) {
+						break;
+					}
+					i->op = JVM_LDC;
+					i->operand = CODE_INTEGER;
+					i->num = result;
+					ir_unlink(bb, a);
+					ir_unlink(bb, b);
+					stats->folded++;
+					changed = TRUE;
+					break;
+			}
+		}
+	}
+
+	if (changed) {
+		ir_build_cfg(fn);
+	}
+	return changed;
+}
+
+/* Replaces the loads of every variable that is assigned a constant once by the
+ * constant.  A load sees the constant only if the assignment dominates it:
+ * a load in the block of the assignment must follow it, and a load in another
+ * block must be reached through the block of the assignment alone.  A loop
+ * can carry a load that comes before the assignment in the layout, which the
+ * verifier rejects, so nothing may be assumed of the order of the code.
+ */
+
+static Boolean propagate(IRfunc *fn, unsigned int nparams, FoldStats *stats)
+{
+	IRblock *bb;
+	IRinsn *i, *c;
+	Slot *slots;
+	int nslots, n, *idom, *post;
+	Boolean changed = FALSE, any = FALSE;
+
+	/* count the stores to every slot */
+	nslots = 0;
+	for (bb = fn->first; bb; bb = bb->next) {
+		for (i = bb->first; i; i = i->next) {
+			if (IS_STORE(i->op) && i->num >= nslots) {
+				nslots = i->num + 1;
+			}
+		}
+	}
+	if (nslots == 0) {
+		return FALSE;
+	}
+	slots = emalloc(nslots * sizeof(Slot));
+	memset(slots, 0, nslots * sizeof(Slot));
+	for (bb = fn->first; bb; bb = bb->next) {
+		for (i = bb->first; i; i = i->next) {
+			if (IS_STORE(i->op) && slots[i->num].nstores++ == 0) {
+				slots[i->num].bb = bb;
+				slots[i->num].store = i;
+			}
+		}
+	}
+
+	/* forget the slots that cannot be replaced */
+	for (n = 0; n < nslots; n++) {
+		i = slots[n].store;
+		if ((unsigned int) n < nparams || slots[n].nstores != 1
+				|| i->op != JVM_ISTORE || !IS_CONSTANT(i->prev)) {
+			slots[n].store = NULL;
+		} else {
+			any = TRUE;
+		}
+	}
+	if (!any) {
+		free(slots);
+		return FALSE;
+	}
+
+	/* and those with a load that the assignment does not dominate; a load in
+	 * a block that cannot be reached never runs */
+	ir_build_cfg(fn);
+	idom = find_dominators(fn, &post);
+	for (bb = fn->first; bb; bb = bb->next) {
+		for (i = bb->first; i; i = i->next) {
+			if (i->op == JVM_ISTORE && i->num < nslots
+					&& slots[i->num].store == i) {
+				slots[i->num].passed = TRUE;
+			}
+			if (i->op != JVM_ILOAD || i->num >= nslots
+					|| (c = slots[i->num].store) == NULL
+					|| post[bb->id] < 0) {
+				continue;
+			}
+			if (slots[i->num].bb == bb ? !slots[i->num].passed
+					: !dominates(idom, post, slots[i->num].bb->id, bb->id)) {
+				slots[i->num].store = NULL;
+			}
+		}
+	}
+	free(idom);
+	free(post);
+
+	for (bb = fn->first; bb; bb = bb->next) {
+		for (i = bb->first; i; i = i->next) {
+			if (i->op == JVM_ILOAD && i->num < nslots
+					&& (c = slots[i->num].store) != NULL) {
+				i->op = JVM_LDC;
+				i->num = c->prev->num;
+				stats->propagated++;
+				changed = TRUE;
+			}
+		}
+	}
+
+	/* the assignments are not loaded any more */
+	for (n = 0; n < nslots; n++) {
+		if ((i = slots[n].store) != NULL) {
+			ir_unlink(slots[n].bb, i->prev);
+			ir_unlink(slots[n].bb, i);
+			changed = TRUE;
+		}
+	}
+
+	free(slots);
+	return changed;
+}
+
+/* Finds the immediate dominator of every block, by block id, with the
+ * iterative algorithm of Cooper, Harvey, and Kennedy.  The postorder numbers
+ * of the blocks are returned as well, with -1 for a block that cannot be
+ * reached, which has no dominator either.  The control-flow graph must be
+ * current.
+ */
+
+static int *find_dominators(IRfunc *fn, int **post)
+{
+	IRblock **order, **stack, *bb, *p;
+	unsigned int nblocks, norder, depth, k;
+	int *idom, *po, *next, d, a, b;
+	Boolean changed;
+
+	nblocks = fn->nblocks;
+	idom = emalloc((nblocks + 1) * sizeof(int));
+	po = emalloc((nblocks + 1) * sizeof(int));
+	next = emalloc((nblocks + 1) * sizeof(int));
+	order = emalloc((nblocks + 1) * sizeof(IRblock *));
+	stack = emalloc((nblocks + 1) * sizeof(IRblock *));
+	for (k = 0; k < nblocks; k++) {
+		idom[k] = po[k] = -1;
+		next[k] = 0;
+	}
+
+	/* number the blocks in postorder, depth first from the entry; next holds
+	 * the successor that a block on the stack visits next */
+	norder = depth = 0;
+	stack[depth++] = fn->first;
+	next[fn->first->id] = 0;
+	po[fn->first->id] = -2;
+	while (depth > 0) {
+		bb = stack[depth - 1];
+		if (next[bb->id] < 2) {
+			p = bb->succ[next[bb->id]++];
+			if (p && po[p->id] == -1) {
+				po[p->id] = -2;
+				stack[depth++] = p;
+			}
+		} else {
+			po[bb->id] = (int) norder;
+			order[norder++] = bb;
+			depth--;
+		}
+	}
+
+	/* the entry dominates itself; the others meet at the nearest common
+	 * dominator of their reached predecessors, in reverse postorder */
+	idom[fn->first->id] = (int) fn->first->id;
+	do {
+		changed = FALSE;
+		for (k = norder - 1; k-- > 0; ) {
+			bb = order[k];
+			d = -1;
+			for (a = 0; (unsigned int) a < bb->npreds; a++) {
+				b = (int) bb->preds[a]->id;
+				if (idom[b] < 0) {
+					continue;
+				}
+				if (d < 0) {
+					d = b;
+					continue;
+				}
+				while (d != b) {
+					while (po[d] < po[b]) {
+						d = idom[d];
+					}
+					while (po[b] < po[d]) {
+						b = idom[b];
+					}
+				}
+			}
+			if (idom[bb->id] != d) {
+				idom[bb->id] = d;
+				changed = TRUE;
+			}
+		}
+	} while (changed);
+
+	free(stack);
+	free(order);
+	free(next);
+	*post = po;
+	return idom;
+}
+
+/* Returns whether block a dominates block b, which can be reached.  The
+ * dominators of a block have larger postorder numbers than it does.
+ */
+
+static Boolean dominates(const int *idom, const int *post, unsigned int a,
+		unsigned int b)
+{
+	if (post[a] < 0) {
+		return FALSE;
+	}
+	while (post[b] < post[a]) {
+		b = (unsigned int) idom[b];
+	}
+	return a == b;
+}
+
+/* Evaluates an arithmetic or logical operation as the JVM would, and returns
+ * whether it could be evaluated.  Division by zero is left to run time.
+ */
+
+static Boolean evaluate(Bytecode op, int a, int b, int *result)
+{
+	unsigned int ua = (unsigned int) a, ub = (unsigned int) b;
+
+	switch (op) {
+		case JVM_IADD:
+			*result = (int) (ua + ub);
+			break;
+		case JVM_ISUB:
+			*result = (int) (ua - ub);
+			break;
+		case JVM_IMUL:
+			*result = (int) (ua * ub);
+			break;
+		case JVM_IDIV:
+			if (b == 0) {
+				return FALSE;
+			}
+			*result = (a == INT_MIN && b == -1 ? INT_MIN : a / b);
+			break;
+		case JVM_IREM:
+			if (b == 0) {
+				return FALSE;
+			}
+			*result = (b == -1 ? 0 : a % b);
+			break;
+		case JVM_IAND:
+			*result = a & b;
+			break;
+		case JVM_IOR:
+			*result = a | b;
+			break;
+		case JVM_IXOR:
+			*result = a ^ b;
+			break;
+		default:
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+static Boolean compare(Bytecode op, int a, int b)
+{
+	switch (op) {
+		case JVM_IFEQ:
+		case JVM_IF_ICMPEQ: return a == b;
+		case JVM_IFGE:
+		case JVM_IF_ICMPGE: return a >= b;
+		case JVM_IFGT:
+		case JVM_IF_ICMPGT: return a > b;
+		case JVM_IFLE:
+		case JVM_IF_ICMPLE: return a <= b;
+		case JVM_IFLT:
+		case JVM_IF_ICMPLT: return a < b;
+		default:            return a != b;
+	}
+}
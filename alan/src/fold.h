@@ -0,0 +1,57 @@
+/**
+ * @file    fold.h
+ * @brief   Constant folding and propagation over the IR of function bodies.
+ *
+ * Operations of which the operands are constants are evaluated at compile
+ * time, with the wrap-around arithmetic of the JVM, and comparisons of
+ * constants become unconditional jumps, or none.  A division or remainder by
+ * zero is left to throw at run time.  A local variable that is assigned a
+ * constant exactly once, and is not a parameter, is replaced by the constant
+ * wherever it is loaded, and its assignment is removed.  The two are repeated
+ * until neither changes the code.  This is run at optimisation level 1 and
+ * above, in turn with the peephole optimiser, which joins the blocks that a
+ * decided branch leaves behind, so that their constants meet.
+ *
+ * @date    2026-10-14
+ */
+
+#ifndef FOLD_H
+#define FOLD_H
+
+#include <stdio.h>
+#include "boolean.h"
+#include "ir.h"
+
+/** what constant folding and propagation did */
+typedef struct {
+	unsigned long folded;      /**< the operations evaluated               */
+	unsigned long decided;     /**< the conditional branches decided       */
+	unsigned long propagated;  /**< the loads replaced by their constant   */
+} FoldStats;
+
+/**
+ * Folds and propagates the constants of a function.
+ *
+ * @param[in]   fn
+ *     the IR of the function
+ * @param[in]   nparams
+ *     the number of local variable slots that are set on entry
+ * @param[in,out]   stats
+ *     the statistics, to which the changes are added
+ * @return  whether the code was changed
+ */
+Boolean fold_constants(IRfunc *fn, unsigned int nparams, FoldStats *stats);
+
+/**
+ * Writes what constant folding and propagation did, on one line.
+ *
+ * @param[in]   file
+ *     the output file
+ * @param[in]   prefix
+ *     the text that starts the line
+ * @param[in]   stats
+ *     the statistics
+ */
+void print_fold_stats(FILE *file, const char *prefix, const FoldStats *stats);
+
+#endif /* FOLD_H */
@@ -0,0 +1,461 @@
+/**
+ * @file    genbench.c
+ * @brief   A generator of ALAN-2022 sources of a chosen shape, for measuring
+ *          the compiler.
+ *
+ * Every source is a valid program that assigns each variable before it reads
+ * it, only divides by constants other than zero, and runs to completion, so
+ * that it also serves to check the output of the compiler.  The same shape,
+ * size, and seed always give the same source.
+ *
+ * @date    2026-10-14
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "boolean.h"
+#include "error.h"
+#include "token.h"
+
+/* --- type definitions and constants --------------------------------------- */
+
+#define USAGE                                                                  \
+	"usage: %s [-s <seed>] [-c <class>] <shape> <size>\n"                      \
+	"shapes:\n"                                                                \
+	"  functions  <size> functions, all of which main calls\n"                 \
+	"  body       a main body of <size> statements\n"                          \
+	"  nesting    if/elsif statements nested <size> deep\n"                    \
+	"  names      <size> distinct variables, over bodies of %d\n"              \
+	"  strings    <size> long strings and comments\n"                          \
+	"  mixed      all of the above, at <size> times a small program"
+
+#define NAMES_PER_BODY   256   /* the most variables of one body             */
+#define NAMES_PER_LINE   8     /* the variables defined on one line          */
+#define MAX_EXPR_DEPTH   3     /* the deepest nesting of expressions         */
+#define MAX_CONSTANT     1000  /* the largest constant in an expression      */
+#define LOOP_COUNT       10    /* the iterations of every loop               */
+#define SHORT_TEXT       8     /* the length of strings in other shapes      */
+#define LONG_TEXT        200   /* the length of strings and comments         */
+
+/** the shape of a program */
+typedef struct {
+	int functions;   /**< the functions besides main                     */
+	int statements;  /**< the statements of each body                    */
+	int variables;   /**< the variables of each body                     */
+	int depth;       /**< the nesting of the if statement in main, or 0  */
+	int text;        /**< the length of strings, and of comments, if any */
+	Boolean comments; /**< whether comments separate the statements      */
+} Plan;
+
+/** the state of the generator */
+typedef struct {
+	unsigned int seed;                       /**< the random state      */
+	unsigned long nnames;                    /**< the names made so far */
+	char vars[NAMES_PER_BODY][MAX_ID_LENGTH + 1]; /**< the variables of the
+	                                              current body          */
+	int nvars;                               /**< the number of them    */
+	int ncallable;                           /**< the functions that the
+	                                              current body may call */
+	int indent;                              /**< the current indent    */
+} Gen;
+
+/* the stems of the generated names, which a number follows */
+static const char *stems[] = {
+	"x", "count", "total_sum", "index", "elements", "tmp", "is_done",
+	"average_value", "n", "buffer_length"
+};
+
+#define NUM_STEMS (sizeof(stems) / sizeof(stems[0]))
+
+/* --- function prototypes -------------------------------------------------- */
+
+void make_plan(Plan *p, const char *shape, int size);
+void write_program(Gen *g, const Plan *p, const char *class_name);
+void write_function(Gen *g, const Plan *p, int index);
+void write_body(Gen *g, const Plan *p, int nstatements, int depth,
+		const char *result);
+void write_statement(Gen *g, const Plan *p, int level);
+void write_nest(Gen *g, const Plan *p, int depth);
+void write_assign(Gen *g);
+void write_expr(Gen *g, int depth);
+void write_cond(Gen *g);
+void write_text(Gen *g, int len, Boolean comment);
+void new_line(Gen *g);
+int pick(Gen *g, int n);
+
+/* --- main routine --------------------------------------------------------- */
+
+int main(int argc, char *argv[])
+{
+	Gen g;
+	Plan p;
+	const char *class_name = "Bench";
+	char *end;
+	int i, size;
+
+	setprogname(argv[0]);
+	memset(&g, 0, sizeof(Gen));
+	g.seed = 1;
+
+	for (i = 1; i + 2 < argc && argv[i][0] == '-'; i += 2) {
+		if (strcmp(argv[i], "-s") == 0) {
+			g.seed = (unsigned int) strtoul(argv[i + 1], &end, 10);
+			if (*end != '\0') {
+				eprintf("invalid seed '%s'", argv[i + 1]);
+			}
+		} else if (strcmp(argv[i], "-c") == 0) {
+			class_name = argv[i + 1];
+		} else {
+			break;
+		}
+	}
+	if (argc - i != 2) {
+		eprintf(USAGE, getprogname(), NAMES_PER_BODY);
+	}
+	size = (int) strtol(argv[i + 1], &end, 10);
+	if (*end != '\0' || size < 1) {
+		eprintf("invalid size '%s'", argv[i + 1]);
+	}
+
+	make_plan(&p, argv[i], size);
+	write_program(&g, &p, class_name);
+
+	freeprogname();
+	return EXIT_SUCCESS;
+}
+
+/* --- functions ------------------------------------------------------------ */
+
+/* Works out how big each part of a program of the specified shape is. */
+
+void make_plan(Plan *p, const char *shape, int size)
+{
+	p->functions = 0;
+	p->statements = 20;
+	p->variables = 8;
+	p->depth = 0;
+	p->text = SHORT_TEXT;
+	p->comments = FALSE;
+
+	if (strcmp(shape, "functions") == 0) {
+		p->functions = size;
+	} else if (strcmp(shape, "body") == 0) {
+		p->statements = size;
+	} else if (strcmp(shape, "nesting") == 0) {
+		p->depth = size;
+	} else if (strcmp(shape, "names") == 0) {
+		p->variables = (size < NAMES_PER_BODY ? size : NAMES_PER_BODY);
+		p->functions = (size - 1) / NAMES_PER_BODY;
+		p->statements = 0;
+	} else if (strcmp(shape, "strings") == 0) {
+		p->statements = size;
+		p->text = LONG_TEXT;
+		p->comments = TRUE;
+	} else if (strcmp(shape, "mixed") == 0) {
+		p->functions = 10 * size;
+		p->statements = 50;
+		p->variables = 32;
+		p->depth = 10 * size;
+		p->text = LONG_TEXT / 4;
+		p->comments = TRUE;
+	} else {
+		eprintf("unknown shape '%s'", shape);
+	}
+}
+
+/* Writes the functions, and main, which calls each of them once, and may call
+ * them again.  The functions call none, so that the running time of the
+ * program grows with its size only.
+ */
+
+void write_program(Gen *g, const Plan *p, const char *class_name)
+{
+	int i;
+
+	printf("source %s\n", class_name);
+	g->ncallable = 0;
+	for (i = 0; i < p->functions; i++) {
+		write_function(g, p, i);
+	}
+	g->ncallable = p->functions;
+	printf("\n");
+	write_body(g, p, p->statements, p->depth, NULL);
+	printf("\n");
+}
+
+/* Writes a function of two parameters that leaves an integer. */
+
+void write_function(Gen *g, const Plan *p, int index)
+{
+	printf("\nfunction f%d(integer a, integer b) to integer\n", index);
+	write_body(g, p, p->statements, 0, "a + b");
+}
+
+/* Writes a body, which defines and assigns its variables first.  A function
+ * leaves the value of its variables, and main puts it.
+ */
+
+void write_body(Gen *g, const Plan *p, int nstatements, int depth,
+		const char *result)
+{
+	int i;
+
+	g->nvars = 0;
+	printf("begin");
+	g->indent = 1;
+	for (i = 0; i < p->variables; i++) {
+		snprintf(g->vars[i], MAX_ID_LENGTH + 1, "%s%lu",
+				stems[g->nnames % NUM_STEMS], g->nnames);
+		g->nnames++;
+		if (i % NAMES_PER_LINE == 0) {
+			new_line(g);
+			printf("integer %s", g->vars[i]);
+		} else {
+			printf(", %s", g->vars[i]);
+		}
+		if (i % NAMES_PER_LINE == NAMES_PER_LINE - 1 || i + 1 == p->variables) {
+			printf(";");
+		}
+	}
+	g->nvars = p->variables;
+
+	/* every variable is assigned before any is read */
+	for (i = 0; i < g->nvars; i++) {
+		new_line(g);
+		printf("%s := %d;", g->vars[i], pick(g, MAX_CONSTANT));
+	}
+	if (depth > 0) {
+		new_line(g);
+		write_nest(g, p, depth);
+		printf(";");
+	}
+	for (i = 0; result == NULL && g->nvars > 0 && i < g->ncallable; i++) {
+		new_line(g);
+		printf("%s := f%d(%s, %d);", g->vars[i % g->nvars], i,
+				g->vars[pick(g, g->nvars)], pick(g, MAX_CONSTANT));
+	}
+	for (i = 0; i < nstatements; i++) {
+		new_line(g);
+		write_statement(g, p, 0);
+		printf(";");
+	}
+
+	new_line(g);
+	if (result) {
+		printf("leave %s", result);
+	} else {
+		printf("put \"done\\n\"");
+	}
+	for (i = 0; i < g->nvars; i++) {
+		printf(" %s %s", (result ? "+" : "."), g->vars[i]);
+	}
+	printf("\nend\n");
+}
+
+/* Writes one statement.  Loops and if statements are only written at the
+ * outer level of the body, apart from the nesting of main.
+ */
+
+void write_statement(Gen *g, const Plan *p, int level)
+{
+	int k, counter, target;
+
+	if (p->comments && pick(g, 4) == 0) {
+		write_text(g, p->text, TRUE);
+		new_line(g);
+	}
+
+	k = (g->nvars < 2 || level > 0 ? 0 : pick(g, 10));
+	if (k == 5) {
+		printf("put ");
+		write_text(g, p->text, FALSE);
+		printf(" . ");
+		write_expr(g, 0);
+		printf(" . \"\\n\"");
+	} else if (k == 6 || k == 7) {
+		printf("if ");
+		write_cond(g);
+		printf(" then");
+		g->indent++;
+		new_line(g);
+		write_statement(g, p, level + 1);
+		g->indent--;
+		new_line(g);
+		printf("elsif ");
+		write_cond(g);
+		printf(" then");
+		g->indent++;
+		new_line(g);
+		write_statement(g, p, level + 1);
+		g->indent--;
+		new_line(g);
+		printf("else");
+		g->indent++;
+		new_line(g);
+		write_statement(g, p, level + 1);
+		g->indent--;
+		new_line(g);
+		printf("end");
+	} else if (k == 8) {
+		/* the counter is only assigned by the loop itself */
+		counter = pick(g, g->nvars);
+		target = (counter + 1 + pick(g, g->nvars - 1)) % g->nvars;
+		printf("%s := 0;", g->vars[counter]);
+		new_line(g);
+		printf("while %s < %d do", g->vars[counter], LOOP_COUNT);
+		g->indent++;
+		new_line(g);
+		printf("%s := %s + %s;", g->vars[target], g->vars[target],
+				g->vars[counter]);
+		new_line(g);
+		printf("%s := %s + 1", g->vars[counter], g->vars[counter]);
+		g->indent--;
+		new_line(g);
+		printf("end");
+	} else {
+		write_assign(g);
+	}
+}
+
+/* Writes an if statement of which the first branch holds the next one. */
+
+void write_nest(Gen *g, const Plan *p, int depth)
+{
+	int d;
+
+	for (d = 0; d < depth; d++) {
+		printf("if ");
+		write_cond(g);
+		printf(" then");
+		g->indent++;
+		new_line(g);
+	}
+	write_statement(g, p, 1);
+	for (d = 0; d < depth; d++) {
+		g->indent--;
+		new_line(g);
+		printf("elsif ");
+		write_cond(g);
+		printf(" then");
+		g->indent++;
+		new_line(g);
+		write_statement(g, p, 1);
+		g->indent--;
+		new_line(g);
+		printf("else");
+		g->indent++;
+		new_line(g);
+		write_statement(g, p, 1);
+		g->indent--;
+		new_line(g);
+		printf("end");
+	}
+}
+
+/* Writes an assignment to a variable, or nothing if there is none. */
+
+void write_assign(Gen *g)
+{
+	if (g->nvars == 0) {
+		printf("relax");
+		return;
+	}
+	printf("%s := ", g->vars[pick(g, g->nvars)]);
+	write_expr(g, 0);
+}
+
+/* Writes an integer expression over the variables, the constants, and the
+ * functions that may be called.
+ */
+
+void write_expr(Gen *g, int depth)
+{
+	static const char *ops[] = {"+", "-", "*", "+", "-"};
+	int k;
+
+	k = (depth >= MAX_EXPR_DEPTH ? pick(g, 2) : pick(g, 8));
+	if (k == 0 && g->nvars > 0) {
+		printf("%s", g->vars[pick(g, g->nvars)]);
+	} else if (k <= 1) {
+		printf("%d", pick(g, MAX_CONSTANT));
+	} else if (k == 2) {
+		printf("(");
+		write_expr(g, depth + 1);
+		printf(") %s %d", (pick(g, 2) ? "/" : "rem"), 1 + pick(g, 9));
+	} else if (k == 3 && g->ncallable > 0) {
+		printf("f%d(", pick(g, g->ncallable));
+		write_expr(g, depth + 1);
+		printf(", ");
+		write_expr(g, depth + 1);
+		printf(")");
+	} else if (k == 4) {
+		printf("(-");
+		write_expr(g, MAX_EXPR_DEPTH);
+		printf(")");
+	} else {
+		write_expr(g, depth + 1);
+		printf(" %s ", ops[pick(g, 5)]);
+		write_expr(g, depth + 1);
+	}
+}
+
+/* Writes a condition, which compares two expressions, or joins two such
+ * comparisons.
+ */
+
+void write_cond(Gen *g)
+{
+	static const char *relops[] = {"<", "<=", ">", ">=", "=", "<>"};
+
+	if (pick(g, 4) == 0) {
+		printf("(");
+		write_expr(g, 1);
+		printf(" %s ", relops[pick(g, 6)]);
+		write_expr(g, 1);
+		printf(") %s (", (pick(g, 2) ? "and" : "or"));
+		write_expr(g, 1);
+		printf(" %s ", relops[pick(g, 6)]);
+		write_expr(g, 1);
+		printf(")");
+	} else {
+		write_expr(g, 1);
+		printf(" %s ", relops[pick(g, 6)]);
+		write_expr(g, 1);
+	}
+}
+
+/* Writes a string, or a comment, of printable characters. */
+
+void write_text(Gen *g, int len, Boolean comment)
+{
+	static const char letters[] =
+		"abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789 ,.;:!?";
+	int i;
+
+	putchar(comment ? '{' : '"');
+	for (i = 0; i < len; i++) {
+		putchar(letters[pick(g, (int) sizeof(letters) - 1)]);
+	}
+	putchar(comment ? '}' : '"');
+}
+
+/* Starts a new line at the current indent. */
+
+void new_line(Gen *g)
+{
+	int i;
+
+	putchar('\n');
+	for (i = 0; i < g->indent; i++) {
+		printf("  ");
+	}
+}
+
+/* Returns a pseudo-random number from 0 to n - 1. */
+
+int pick(Gen *g, int n)
+{
+	g->seed = g->seed * 1103515245 + 12345;
+	return (int) ((g->seed >> 16) % (unsigned int) n);
+}
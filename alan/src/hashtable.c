@@ -1,173 +1,164 @@
 /**
  * @file    hashtable.c
  * @brief   A generic hash table.
+ *
+ * The table uses open addressing with Robin Hood probing over one contiguous
+ * array of slots.  Each slot keeps the full hash of its key, so that a probe
+ * rejects almost every mismatch without calling the comparison function, and
+ * rehashing never calls the hash function again.  Under Robin Hood probing, an
+ * entry that is inserted takes the slot of any entry that is closer to its home
+ * slot, which keeps the probe sequences short and lets a search stop as soon as
+ * it meets an entry closer to home than the key would be.
+ *
  * @author  W.H.K. Bester (whkbester@cs.sun.ac.za)
  * @date    2022-08-03
  */
 #include "hashtable.h"
-#include <math.h>
+#include <limits.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#define BUFFER_SIZE 1024
-#define INITIAL_DELTA_INDEX 4
+#define INITIAL_SIZE_BITS 5
+#define MAX_LOADFACTOR 0.9f
 #define PRINT_BUFFER_SIZE 1024
+#define WORD_PRIME_1 0x9E3779B97F4A7C15ULL
+#define WORD_PRIME_2 0xC2B2AE3D27D4EB4FULL
 
-/** an entry in the hash table */
-typedef struct htentry HTentry;
-struct htentry {
-	void *key;         /*<< the key                      */
-	void *value;       /*<< the value                    */
-	HTentry *next_ptr; /*<< the next entry in the bucket */
-};
+/** a slot in the hash table */
 typedef struct {
-	char *id;
-	int num;
-} Name;
+	void *key;         /*<< the key                                       */
+	void *value;       /*<< the value                                     */
+	unsigned int hash; /*<< the full hash of the key                      */
+	unsigned int dist; /*<< the probe distance plus one, or zero if empty */
+} HTslot;
+
 /** a hash table container */
 struct hashtab {
 	/** a pointer to the underlying table                              */
-	HTentry **table;
-	/** the current size of the underlying table                       */
+	HTslot *table;
+	/** the current size of the underlying table, a power of two       */
 	unsigned int size;
+	/** the number of bits in the size of the underlying table         */
+	unsigned int bits;
 	/** the current number of entries                                  */
 	unsigned int num_entries;
+	/** the number of entries at which the underlying table is resized */
+	unsigned int max_entries;
 	/** the maximum load factor before the underlying table is resized */
 	float max_loadfactor;
-	/** the index into the delta array                                 */
-	unsigned short idx;
 	/** a pointer to the hash function                                 */
 	unsigned int (*hash)(void *, unsigned int);
 	/** a pointer to the comparison function                           */
 	int (*cmp)(void *, void *);
+	/** the number of keys looked up, also by insertions               */
+	unsigned long searches;
+	/** the number of slots examined by the look-ups                   */
+	unsigned long probes;
+	/** the number of times that the underlying table has grown        */
+	unsigned long resizes;
 };
 
-unsigned int hash(void *key, unsigned int size);
-int scmp(void *v1, void *v2);
-void val2str(void *key, void *value, char *buffer);
-
 /* --- function prototypes -------------------------------------------------- */
-static int getsize(HashTab *ht);
-static HTentry **talloc(int tsize);
-static void rehash(HashTab *ht);
-static void freekeys(void *k);
-static void freevals(void *k);
 
-/** the array of differences between a power-of-two and the largest prime less
- * than that power-of-two.                                                    */
-unsigned short delta[] = {0,  0, 1, 1, 3, 1, 3, 1,  5, 3,  3, 9,  3,  1, 3,  19,
-						  15, 1, 5, 1, 3, 9, 3, 15, 3, 39, 5, 39, 57, 3, 35, 1};
-
-#define MAX_IDX (sizeof(delta) / sizeof(unsigned short))
+static unsigned int home(HashTab *ht, unsigned int hash);
+static void place(HashTab *ht, HTslot slot);
+static int resize(HashTab *ht, unsigned int bits);
+static uint64_t load_word(const unsigned char *p, size_t n);
 
 /* --- hash table interface ------------------------------------------------- */
 
 HashTab *ht_init(float loadfactor, unsigned int (*hash)(void *, unsigned int),
 				 int (*cmp)(void *, void *))
 {
-	unsigned int i;
-	i = 0;
-	// allocate space for a HashTab variable,
-	HashTab *ht = (HashTab *)malloc(sizeof(HashTab));
+	HashTab *ht;
+
+	if ((ht = malloc(sizeof(HashTab))) == NULL) {
+		return NULL;
+	}
+	ht->table = NULL;
 	ht->num_entries = 0;
-	ht->idx = INITIAL_DELTA_INDEX;
-	ht->size = getsize(ht);
-	ht->table = (HTentry **)calloc(ht->size, sizeof(HTentry *));
-	ht->max_loadfactor = loadfactor;
+	ht->max_loadfactor = (loadfactor < MAX_LOADFACTOR ? loadfactor
+			: MAX_LOADFACTOR);
 	ht->hash = hash;
 	ht->cmp = cmp;
+	ht->searches = ht->probes = ht->resizes = 0;
 
-	if (ht->table == NULL) {
-		free(ht->table);
+	if (resize(ht, INITIAL_SIZE_BITS) != EXIT_SUCCESS) {
 		// Initialization failed.
+		free(ht);
 		return NULL;
 	}
 
-	unsigned int r;
-	// set all table values null
-	for (r = 0; r < ht->size; r++) {
-		ht->table[r] = NULL;
-	}
-
 	return ht;
 }
 
 int ht_insert(HashTab *ht, void *key, void *value)
 {
-	int k;
-	HTentry *p;
-
-	unsigned int N = ht->size;
-	unsigned int ne;
-	float current_loadfactor;
-	p = calloc(1, sizeof(HTentry));
-	talloc(1);
-	p->key = key;
-	p->value = value;
-	k = ht->hash(key, ht->size);
-
-	// if key found
-	if (ht->table[k]) {
-		HTentry *next;
-		HTentry *prev = NULL;
-		/* theres already something in the index*/
-		next = ht->table[k];
-		// use for loop to find next free position
-
-		while (next) {
-			prev = next;
-			next = next->next_ptr;
+	HTslot slot, *p;
+	unsigned int i, dist;
+
+	/* the hash function reduces its result by the size it is given, so the
+	 * full hash is obtained with the largest size */
+	slot.key = key;
+	slot.value = value;
+	slot.hash = ht->hash(key, UINT_MAX);
+
+	/* keys are unique, so look for the key along its probe sequence */
+	ht->searches++;
+	for (i = home(ht, slot.hash), dist = 1; ; i = (i + 1) & (ht->size - 1),
+			dist++) {
+		ht->probes++;
+		p = &ht->table[i];
+		if (p->dist < dist) {
+			break;
+		}
+		if (p->hash == slot.hash && ht->cmp(key, p->key) == 0) {
+			return HASH_TABLE_KEY_VALUE_PAIR_EXISTS;
 		}
-		ht->num_entries++;
-		prev->next_ptr = p;
-		p->next_ptr = NULL;
-	} else {
-		ht->table[k] = p;
-		p->next_ptr = NULL;
-		ht->num_entries++;
 	}
-	ne = ht->num_entries;
-	current_loadfactor = (float)ne / (float)N;
-	if (current_loadfactor > ht->max_loadfactor) {
-		rehash(ht);
+
+	if (ht->num_entries >= ht->max_entries) {
+		if (resize(ht, ht->bits + 1) != EXIT_SUCCESS) {
+			return HASH_TABLE_NO_SPACE_FOR_NODE;
+		}
+		ht->resizes++;
 	}
+	place(ht, slot);
+	ht->num_entries++;
+
 	return EXIT_SUCCESS;
 }
 
 Boolean ht_search(HashTab *ht, void *key, void **value)
 {
-	int k;
-	HTentry *p;
-
-	k = ht->hash(key, ht->size);
-	for (p = ht->table[k]; p; p = p->next_ptr) {
-		if (ht->cmp(key, p->key) == 0) {
+	HTslot *p;
+	unsigned int h, i, dist;
+
+	h = ht->hash(key, UINT_MAX);
+	ht->searches++;
+	for (i = home(ht, h), dist = 1; ; i = (i + 1) & (ht->size - 1), dist++) {
+		ht->probes++;
+		p = &ht->table[i];
+		if (p->dist < dist) {
+			return FALSE;
+		}
+		if (p->hash == h && ht->cmp(key, p->key) == 0) {
 			*value = p->value;
-			break;
+			return TRUE;
 		}
 	}
-
-	return (p ? TRUE : FALSE);
 }
 
 int ht_free(HashTab *ht, void (*freekey)(void *k), void (*freeval)(void *v))
 {
 	unsigned int i;
-	HTentry *p;
-	/* free the table and container */
 
+	/* free the entries, the table, and the container */
 	for (i = 0; i < ht->size; i++) {
-		if (ht->table[i]) {
-			// freekey(ht->table[i]->key);
-			// freeval(ht->table[i]->value);
-			p = ht->table[i];
-			while (p) {
-				freekey(p->key);
-				freeval(p->value);
-				p = p->next_ptr;
-			}
-
-			free(ht->table[i]);
+		if (ht->table[i].dist) {
+			freekey(ht->table[i].key);
+			freeval(ht->table[i].value);
 		}
 	}
 	free(ht->table);
@@ -178,82 +169,179 @@ int ht_free(HashTab *ht, void (*freekey)(void *k), void (*freeval)(void *v))
 void ht_print(HashTab *ht, void (*keyval2str)(void *k, void *v, char *b))
 {
 	unsigned int i;
-	HTentry *p;
+	HTslot *p;
 	char buffer[PRINT_BUFFER_SIZE];
 
 	for (i = 0; i < ht->size; i++) {
+		p = &ht->table[i];
 		printf("bucket[%2i]", i);
-		for (p = ht->table[i]; p != NULL; p = p->next_ptr) {
+		if (p->dist) {
 			keyval2str(p->key, p->value, buffer);
-			printf(" --> %s", buffer);
+			printf(" --> %s (home %u)", buffer, home(ht, p->hash));
 		}
 		printf(" --> NULL\n");
 	}
 }
 
-/* --- utility functions ---------------------------------------------------- */
+void ht_get_stats(HashTab *ht, HTstats *stats)
+{
+	unsigned int i;
+	unsigned long total = 0;
+
+	stats->entries = ht->num_entries;
+	stats->size = ht->size;
+	stats->searches = ht->searches;
+	stats->probes = ht->probes;
+	stats->resizes = ht->resizes;
+	stats->max_probe = 0;
+	for (i = 0; i < ht->size; i++) {
+		if (ht->table[i].dist) {
+			total += ht->table[i].dist;
+			if (ht->table[i].dist > stats->max_probe) {
+				stats->max_probe = ht->table[i].dist;
+			}
+		}
+	}
+	stats->mean_probe = (ht->num_entries ? (double) total / ht->num_entries
+			: 0.0);
+}
+
+/* --- hash functions ------------------------------------------------------- */
 
-static int getsize(HashTab *ht)
+unsigned int ht_hash_fnv1a(void *key, unsigned int size)
 {
-	int k, l, new_size, result;
-	result = 1;
-	k = ht->idx + 1;
-	l = ht->idx + 1;
-	;
-
-	// power function
-	while (k != 0) {
-		result *= 2;
-		--k;
+	const unsigned char *s = (const unsigned char *) key;
+	uint32_t h = 2166136261U;
+
+	while (*s) {
+		h ^= *s++;
+		h *= 16777619U;
 	}
-	ht->idx = l;
-	new_size = result - delta[l];
-	return new_size;
+
+	return h % size;
 }
 
-static HTentry **talloc(int tsize)
+unsigned int ht_hash_words(void *key, unsigned int size)
 {
-	tsize = 0;
-	return NULL;
+	const unsigned char *s = (const unsigned char *) key;
+	size_t n = strlen((const char *) key);
+	uint64_t h = WORD_PRIME_1 ^ n;
+
+	/* eight characters at a time, with a multiply-rotate round per word */
+	for (; n >= 8; s += 8, n -= 8) {
+		h = (h ^ (load_word(s, 8) * WORD_PRIME_2)) * WORD_PRIME_1;
+		h = (h << 31) | (h >> 33);
+	}
+	if (n > 0) {
+		h = (h ^ (load_word(s, n) * WORD_PRIME_2)) * WORD_PRIME_1;
+	}
+
+	/* the final avalanche of MurmurHash3 */
+	h ^= h >> 33;
+	h *= 0xFF51AFD7ED558CCDULL;
+	h ^= h >> 33;
+	h *= 0xC4CEB9FE1A85EC53ULL;
+	h ^= h >> 33;
+
+	return (uint32_t) h % size;
 }
 
-static void rehash(HashTab *ht)
+unsigned int ht_hash_shift(void *key, unsigned int size)
 {
-	/* store reference to the old table */
+	const unsigned char *s = (const unsigned char *) key;
+	uint32_t h = 0;
 
-	HTentry **new_table, **pp, *this, **qq;
-	unsigned int i;
-	unsigned int newidx, new_size, old_size, oldidx;
+	while (*s) {
+		h = (h << 5) | (h >> 27); // 5-bit cyclic shift of the running sum
+		h += *s++;                // add in next character
+	}
 
-	old_size = ht->size;
-	new_size = getsize(ht);
+	return h % size;
+}
 
-	new_table = (HTentry **)calloc(new_size, sizeof(HTentry *));
+/* --- utility functions ---------------------------------------------------- */
+
+/* Loads n (at most eight) characters as a little-endian word, without reading
+ * past them, so that the word of a key does not depend on what follows it.
+ */
 
-	/* nullify the new table */
-	for (i = 0; i < new_size; i++) {
-		new_table[i] = NULL;
+static uint64_t load_word(const unsigned char *p, size_t n)
+{
+	uint64_t w = 0;
+
+	if (n == 8) {
+		memcpy(&w, p, 8);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+		w = __builtin_bswap64(w);
+#endif
+		return w;
+	}
+	while (n-- > 0) {
+		w = (w << 8) | p[n];
 	}
 
-	for (oldidx = 0; oldidx < ht->size; oldidx++) {
-		for (pp = &ht->table[oldidx]; *pp;) {
-			this = *pp;
-			*pp = this->next_ptr;
-			this->next_ptr = NULL;
+	return w;
+}
 
-			newidx = ht->hash(this->key, new_size);
-			for (qq = &new_table[newidx]; *qq; qq = &(*qq)->next_ptr) {
-			}
+/* Returns the home slot of a hash.  Fibonacci hashing spreads the bits of the
+ * hash over the index, so that a weak hash function still fills a table of
+ * which the size is a power of two.
+ */
 
-			*qq = this;
+static unsigned int home(HashTab *ht, unsigned int hash)
+{
+	return (unsigned int) ((hash * 2654435769UL) & 0xffffffffUL)
+		>> (32 - ht->bits);
+}
+
+/* Places an entry that is not in the table, displacing every entry on the way
+ * that is closer to its home slot than the entry being placed.
+ */
+
+static void place(HashTab *ht, HTslot slot)
+{
+	HTslot tmp;
+	unsigned int i;
+
+	slot.dist = 1;
+	for (i = home(ht, slot.hash); ; i = (i + 1) & (ht->size - 1)) {
+		if (ht->table[i].dist == 0) {
+			ht->table[i] = slot;
+			return;
 		}
+		if (ht->table[i].dist < slot.dist) {
+			tmp = ht->table[i];
+			ht->table[i] = slot;
+			slot = tmp;
+		}
+		slot.dist++;
 	}
-
-	ht_free(ht, freekeys, freevals);
-	ht->table = new_table;
-	ht->size = new_size;
 }
-void freekeys(void *k) { free(k); }
 
-void freevals(void *k) { free(k); }
+/* Moves the entries into a new underlying table with 2^bits slots. */
+
+static int resize(HashTab *ht, unsigned int bits)
+{
+	HTslot *old_table = ht->table;
+	unsigned int i, old_size = (old_table ? ht->size : 0);
+
+	if ((ht->table = calloc((size_t) 1 << bits, sizeof(HTslot))) == NULL) {
+		ht->table = old_table;
+		return EXIT_FAILURE;
+	}
+	ht->bits = bits;
+	ht->size = 1U << bits;
+	ht->max_entries = (unsigned int) (ht->size * ht->max_loadfactor);
+	if (ht->max_entries == 0) {
+		ht->max_entries = 1;
+	}
+
+	for (i = 0; i < old_size; i++) {
+		if (old_table[i].dist) {
+			place(ht, old_table[i]);
+		}
+	}
+	free(old_table);
 
+	return EXIT_SUCCESS;
+}
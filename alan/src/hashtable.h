@@ -19,6 +19,17 @@
 /** the container structure for a hash table */
 typedef struct hashtab HashTab;
 
+/** the occupancy statistics of a hash table, and how it has been used */
+typedef struct {
+	unsigned int  entries;    /**< the number of entries                     */
+	unsigned int  size;       /**< the size of the underlying table          */
+	unsigned int  max_probe;  /**< the longest probe sequence of an entry    */
+	double        mean_probe; /**< the mean probe sequence length of entries */
+	unsigned long searches;   /**< the keys looked up, also by insertions    */
+	unsigned long probes;     /**< the slots that the look-ups examined      */
+	unsigned long resizes;    /**< the times that the table has grown        */
+} HTstats;
+
 /* --- function prototypes -------------------------------------------------- */
 
 /**
@@ -29,7 +40,9 @@ typedef struct hashtab HashTab;
  *     underlying table
  * @param[in]   hash
  *     a hash function over the domain of the keys, taking a pointer to the key
- *     and the size of the underlying table as parameters
+ *     and a size by which to reduce the hash as parameters; the table passes
+ *     <code>UINT_MAX</code>, keeps the hash with each key, and maps it to a
+ *     slot itself
  * @param[in]   cmp
  *     a function that compares two values from the domain of values, returning
  *     <code>-1</code>, <code>0</code>, or <code>1</code> if <code>val1</code>
@@ -42,7 +55,8 @@ HashTab *ht_init(float loadfactor,
 
 /**
  * Associates the specified key with the specified value in the specified hash
- * table.  Note: If the insert fails, an error code is returned.
+ * table.  Note: If the insert fails, an error code is returned, and the table
+ * does not take ownership of the key or the value.
  *
  * @param[in]   ht
  *     a pointer to the hash table in which to associate the key with the value
@@ -50,8 +64,11 @@ HashTab *ht_init(float loadfactor,
  *     a pointer to the key
  * @param[in]   value
  *     a pointer to the value
- * @return      <code>EXIT_SUCCESS</code> if the insertion was successful, or
- *              one of the designated error codes if it was not
+ * @return      <code>EXIT_SUCCESS</code> if the insertion was successful,
+ *              <code>HASH_TABLE_KEY_VALUE_PAIR_EXISTS</code> if the key is
+ *              already in the table, or
+ *              <code>HASH_TABLE_NO_SPACE_FOR_NODE</code> if the table could not
+ *              grow
  */
 int ht_insert(HashTab *ht, void *key, void *value);
 
@@ -100,4 +117,53 @@ int ht_free(HashTab *ht,
  */
 void ht_print(HashTab *ht, void (*keyval2str)(void *k, void*v, char *b));
 
+/**
+ * Computes the occupancy statistics of the specified hash table, where the
+ * probe sequence length of an entry is the number of slots that a search for
+ * its key examines, and counts the searches and resizes since it was created.
+ *
+ * @param[in]   ht
+ *     the hash table
+ * @param[out]  stats
+ *     the statistics
+ */
+void ht_get_stats(HashTab *ht, HTstats *stats);
+
+/* --- hash functions over NUL-terminated strings --------------------------- */
+
+/**
+ * Hashes a string with 32-bit FNV-1a, one character at a time.
+ *
+ * @param[in]   key
+ *     a pointer to the string
+ * @param[in]   size
+ *     the size by which to reduce the hash
+ * @return      the hash, reduced modulo <code>size</code>
+ */
+unsigned int ht_hash_fnv1a(void *key, unsigned int size);
+
+/**
+ * Hashes a string eight characters at a time, in the style of wyhash and
+ * xxHash, with a 64-bit multiply-rotate round per word and a final avalanche.
+ *
+ * @param[in]   key
+ *     a pointer to the string
+ * @param[in]   size
+ *     the size by which to reduce the hash
+ * @return      the hash, reduced modulo <code>size</code>
+ */
+unsigned int ht_hash_words(void *key, unsigned int size);
+
+/**
+ * Hashes a string with a 5-bit cyclic shift of the running sum of its
+ * characters.
+ *
+ * @param[in]   key
+ *     a pointer to the string
+ * @param[in]   size
+ *     the size by which to reduce the hash
+ * @return      the hash, reduced modulo <code>size</code>
+ */
+unsigned int ht_hash_shift(void *key, unsigned int size);
+
 #endif /* HASH_TABLE_H */
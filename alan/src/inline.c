@@ -0,0 +1,196 @@
+/**
+ * @file    inline.c
+ * @brief   Inlining of small functions and procedures into their callers.
+ * @date    2026-10-14
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "boolean.h"
+#include "error.h"
+#include "inline.h"
+#include "ir.h"
+#include "valtypes.h"
+
+/* --- type definitions and constants --------------------------------------- */
+
+#define IS_LOCAL(op)                                                           \
+	((op) == JVM_ILOAD || (op) == JVM_ALOAD || (op) == JVM_ISTORE             \
+	 || (op) == JVM_ASTORE || (op) == JVM_IINC)
+
+#define IS_RETURN(op)                                                          \
+	((op) == JVM_RETURN || (op) == JVM_IRETURN || (op) == JVM_ARETURN)
+
+/* --- function prototypes -------------------------------------------------- */
+
+static const char *refuse(Body *callee, int limit, int *size);
+static IRblock *expand(IRfunc *fn, IRblock *bb, IRinsn *call, Body *callee,
+		int base);
+
+/* --- inlining interface --------------------------------------------------- */
+
+void inline_calls(Body *body, const InlineOptions *options,
+		InlineStats *stats)
+{
+	IRfunc *fn = body->ir;
+	IRblock *bb;
+	IRinsn *i;
+	Body *callee;
+	const char *reason;
+	int size;
+
+	for (bb = fn->first; bb; bb = bb->next) {
+		i = bb->first;
+		while (i) {
+			if (i->op != JVM_INVOKESTATIC) {
+				i = i->next;
+				continue;
+			}
+
+			/* the caller itself is not among the bodies yet */
+			if (!ht_search(options->bodies, i->string, (void **) &callee)) {
+				callee = NULL;
+			}
+			if (i->string == body->ref) {
+				reason = "recursive";
+				size = 0;
+			} else if (callee == NULL) {
+				i = i->next;
+				continue;
+			} else {
+				reason = refuse(callee, options->limit, &size);
+			}
+			if (reason) {
+				if (options->report && size > 0) {
+					fprintf(options->report, "%sinline: kept call to %s in "
+							"%s: %s, %d instructions\n", options->prefix,
+							callee->name, body->name, reason, size);
+				} else if (options->report) {
+					fprintf(options->report, "%sinline: kept call to %s in "
+							"%s: %s\n", options->prefix, body->name,
+							body->name, reason);
+				}
+				stats->kept++;
+				i = i->next;
+				continue;
+			}
+
+			if (options->report) {
+				fprintf(options->report, "%sinline: %s into %s, %d "
+						"instructions\n", options->prefix, callee->name,
+						body->name, size);
+			}
+			stats->inlined++;
+
+			/* the copy is not inlined into again, since the callee was */
+			bb = expand(fn, bb, i, callee, body->variables_width);
+			body->variables_width += callee->variables_width;
+			i = bb->first;
+		}
+	}
+
+	ir_build_cfg(fn);
+}
+
+void print_inline_stats(FILE *file, const char *prefix,
+		const InlineStats *stats)
+{
+	if (stats->inlined + stats->kept > 0) {
+		fprintf(file, "%sinline: %lu calls inlined, %lu kept\n", prefix,
+				stats->inlined, stats->kept);
+	}
+}
+
+/* --- utility functions ---------------------------------------------------- */
+
+/* Returns why a callee cannot be inlined, or NULL if it can, and sets the
+ * number of its IR instructions.
+ */
+
+static const char *refuse(Body *callee, int limit, int *size)
+{
+	IRfunc *c = callee->ir;
+	IRblock *bb;
+	IRinsn *i;
+	Boolean recursive = FALSE;
+
+	*size = 0;
+	for (bb = c->first; bb; bb = bb->next) {
+		for (i = bb->first; i; i = i->next) {
+			if (i->op == JVM_INVOKESTATIC && i->string == callee->ref) {
+				recursive = TRUE;
+			}
+			(*size)++;
+		}
+	}
+
+	if (recursive) {
+		return "recursive";
+	}
+	if (*size > limit) {
+		return "too large";
+	}
+
+	/* a copy that could fall off its end would run into the caller */
+	bb = c->last;
+	if ((bb->last == NULL || !IS_TERMINAL(bb->last->op))
+			&& (bb == c->first || bb->npreds > 0)) {
+		return "does not end in a return";
+	}
+
+	return NULL;
+}
+
+/* Replaces a call by a copy of the callee, of which the local variables start
+ * at a base slot, and returns the block that continues after the call.  The
+ * blocks of the callee are numbered, since it was lowered.
+ */
+
+static IRblock *expand(IRfunc *fn, IRblock *bb, IRinsn *call, Body *callee,
+		int base)
+{
+	IRfunc *c = callee->ir;
+	IRblock **copies, *cb, *after, *cont;
+	IRinsn *ci, *i;
+	int n;
+
+	cont = ir_split_block(fn, bb, call);
+	ir_unlink(bb, call);
+
+	/* the arguments are on the stack, the last one on top */
+	for (n = (int) callee->idprop->nparams - 1; n >= 0; n--) {
+		i = arena_alloc(fn->arena, sizeof(IRinsn));
+		i->op = (IS_ARRAY(callee->idprop->params[n]) ? JVM_ASTORE
+				: JVM_ISTORE);
+		i->operand = CODE_INTEGER;
+		i->num = base + n;
+		i->inc = 0;
+		i->line = call->line;
+		ir_link_before(bb, NULL, i);
+	}
+
+	copies = emalloc((c->nblocks + 1) * sizeof(IRblock *));
+	after = bb;
+	for (cb = c->first; cb; cb = cb->next) {
+		copies[cb->id] = after = ir_insert_block(fn, after);
+	}
+	for (cb = c->first; cb; cb = cb->next) {
+		for (ci = cb->first; ci; ci = ci->next) {
+			i = arena_alloc(fn->arena, sizeof(IRinsn));
+			*i = *ci;
+			if (IS_LOCAL(i->op)) {
+				i->num += base;
+			} else if (IS_RETURN(i->op)) {
+				i->op = JVM_GOTO;
+				i->operand = CODE_LABEL;
+				i->target = cont;
+			} else if (i->operand == CODE_LABEL) {
+				i->target = copies[ci->target->id];
+			}
+			ir_link_before(copies[cb->id], NULL, i);
+		}
+	}
+	free(copies);
+
+	return cont;
+}
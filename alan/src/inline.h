@@ -0,0 +1,66 @@
+/**
+ * @file    inline.h
+ * @brief   Inlining of small functions and procedures into their callers.
+ *
+ * A call to a function or procedure that was compiled before its caller, that
+ * does not call itself, and of which the IR is no larger than a limit, is
+ * replaced by a copy of the IR of the callee.  The arguments are stored into
+ * local variable slots of the caller, above its own, where the copy finds its
+ * parameters, and a return jumps to the code after the call, with the result,
+ * if any, on the stack.  The callee is copied as it was optimised, and the
+ * caller is optimised afterwards, as a whole.  This is run at optimisation
+ * level 2 and above.
+ *
+ * @date    2026-10-14
+ */
+
+#ifndef INLINE_H
+#define INLINE_H
+
+#include <stdio.h>
+#include "bytecode.h"
+#include "hashtable.h"
+#include "ir.h"
+
+/** what inlining did */
+typedef struct {
+	unsigned long inlined;  /**< the calls replaced by the callee           */
+	unsigned long kept;     /**< the calls that were left as they were      */
+} InlineStats;
+
+/** the parameters of inlining */
+typedef struct {
+	HashTab    *bodies;     /**< the bodies compiled so far, by reference   */
+	int         limit;      /**< the most IR instructions of a callee       */
+	FILE       *report;     /**< where every decision is written, or NULL   */
+	const char *prefix;     /**< the text that starts every decision        */
+} InlineOptions;
+
+/**
+ * Inlines the calls of a body, of which the local variable width grows by the
+ * slots of the callees.
+ *
+ * @param[in,out]   body
+ *     the body, with its IR and the width of its local variables
+ * @param[in]   options
+ *     the parameters of inlining
+ * @param[in,out]   stats
+ *     the statistics, to which the decisions are added
+ */
+void inline_calls(Body *body, const InlineOptions *options,
+		InlineStats *stats);
+
+/**
+ * Writes what inlining did, on one line.
+ *
+ * @param[in]   file
+ *     the output file
+ * @param[in]   prefix
+ *     the text that starts the line
+ * @param[in]   stats
+ *     the statistics
+ */
+void print_inline_stats(FILE *file, const char *prefix,
+		const InlineStats *stats);
+
+#endif /* INLINE_H */
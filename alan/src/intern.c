@@ -0,0 +1,135 @@
+/**
+ * @file    intern.c
+ * @brief   A pool of interned identifiers for ALAN-2022.
+ * @date    2026-10-14
+ */
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include "compiler.h"
+#include "error.h"
+#include "hashtable.h"
+#include "intern.h"
+#include "stats.h"
+
+/* --- type definitions and constants --------------------------------------- */
+
+/* the hash function for identifiers: on identifier corpora, FNV-1a matches the
+ * word-at-a-time hash in speed and spread, while the cyclic shift gives many
+ * keys the same full hash once identifiers grow long (testhashtable -b) */
+#define NAME_HASH ht_hash_fnv1a
+
+#define INITIAL_NAME_COUNT 256
+
+/** an interned identifier, of which the handle is the name field */
+typedef struct {
+	unsigned int index;   /**< the index of the handle    */
+	char         name[];  /**< the identifier, NUL-ended */
+} Name;
+
+struct intern_pool {
+	HashTab      *table;  /**< the handles, by identifier  */
+	const char  **names;  /**< the handles, by index       */
+	unsigned int  nnames; /**< the number of handles       */
+	unsigned int  cap;    /**< the length of names         */
+};
+
+/* --- function prototypes -------------------------------------------------- */
+
+static Name *new_name(AlanCompiler *ac, const char *name);
+static int name_strcmp(void *val1, void *val2);
+static void free_nothing(void *p);
+
+/* --- interning interface -------------------------------------------------- */
+
+const char *intern(AlanCompiler *ac, const char *name)
+{
+	InternPool *pool = ac->names;
+	Name *n;
+	void *handle;
+
+	if (pool == NULL) {
+		pool = ac->names = emalloc(sizeof(InternPool));
+		memset(pool, 0, sizeof(InternPool));
+		if ((pool->table = ht_init(0.75f, NAME_HASH, name_strcmp)) == NULL) {
+			eprintf("Identifier pool could not be initialised");
+		}
+	}
+
+	if (ht_search(pool->table, (void *) name, &handle)) {
+		return handle;
+	}
+
+	n = new_name(ac, name);
+	if (pool->nnames == pool->cap) {
+		pool->cap = (pool->cap ? 2 * pool->cap : INITIAL_NAME_COUNT);
+		pool->names = erealloc(pool->names, pool->cap * sizeof(char *));
+	}
+	n->index = pool->nnames;
+	pool->names[pool->nnames++] = n->name;
+	if (ht_insert(pool->table, n->name, n->name) != EXIT_SUCCESS) {
+		eprintf("Identifier pool is out of memory");
+	}
+
+	return n->name;
+}
+
+unsigned int intern_index(const char *handle)
+{
+	return ((const Name *) (handle - offsetof(Name, name)))->index;
+}
+
+const char *interned_name(AlanCompiler *ac, unsigned int index)
+{
+	return ac->names->names[index];
+}
+
+unsigned int intern_hash(void *key, unsigned int size)
+{
+	return intern_index((const char *) key) % size;
+}
+
+int intern_cmp(void *val1, void *val2)
+{
+	return (val1 != val2);
+}
+
+void release_names(AlanCompiler *ac)
+{
+	InternPool *pool = ac->names;
+
+	if (pool == NULL) {
+		return;
+	}
+	stats_add_table(ac, pool->table);
+	ht_free(pool->table, free_nothing, free_nothing);
+	free(pool->names);
+	free(pool);
+	ac->names = NULL;
+}
+
+/* --- utility functions ---------------------------------------------------- */
+
+/* Copies an identifier into the arena of the compilation. */
+
+static Name *new_name(AlanCompiler *ac, const char *name)
+{
+	size_t len = strlen(name) + 1;
+	Name *n;
+
+	n = arena_alloc(ac->arena, offsetof(Name, name) + len);
+	memcpy(n->name, name, len);
+
+	return n;
+}
+
+static int name_strcmp(void *val1, void *val2)
+{
+	return strcmp((char *) val1, (char *) val2);
+}
+
+static void free_nothing(void *p)
+{
+	(void) p;
+}
@@ -0,0 +1,85 @@
+/**
+ * @file    intern.h
+ * @brief   A pool of interned identifiers for ALAN-2022.
+ *
+ * Interning maps every distinct identifier of a compilation to one handle: a
+ * NUL-terminated copy of the identifier in the arena of the compilation, which
+ * stays valid until that arena is reset.  Two identifiers are equal exactly
+ * when their handles are, so the symbol table and the code generator compare
+ * and hash identifiers by their handles alone.  Each handle also has a small
+ * index, by which the token buffer records identifiers.
+ *
+ * @date    2026-10-14
+ */
+
+#ifndef INTERN_H
+#define INTERN_H
+
+#include "error.h"
+
+/**
+ * Returns the handle of an identifier, and adds the identifier to the pool of
+ * the compilation if it is not there yet.
+ *
+ * @param[in]   ac
+ *     the compiler context
+ * @param[in]   name
+ *     the identifier
+ * @return      the handle of the identifier
+ */
+const char *intern(AlanCompiler *ac, const char *name);
+
+/**
+ * Returns the index of a handle, which is less than the number of identifiers
+ * in the pool.
+ *
+ * @param[in]   handle
+ *     the handle, as returned by <code>intern</code>
+ * @return      the index of the handle
+ */
+unsigned int intern_index(const char *handle);
+
+/**
+ * Returns the handle with the specified index.
+ *
+ * @param[in]   ac
+ *     the compiler context
+ * @param[in]   index
+ *     the index of the handle, as returned by <code>intern_index</code>
+ * @return      the handle
+ */
+const char *interned_name(AlanCompiler *ac, unsigned int index);
+
+/**
+ * Hashes a handle by its index, for hash tables keyed on handles.
+ *
+ * @param[in]   key
+ *     the handle
+ * @param[in]   size
+ *     the size by which to reduce the hash
+ * @return      the hash, reduced modulo <code>size</code>
+ */
+unsigned int intern_hash(void *key, unsigned int size);
+
+/**
+ * Compares two handles, for hash tables keyed on handles.  Handles are ordered
+ * by their addresses, not by their identifiers.
+ *
+ * @param[in]   val1
+ *     the first handle
+ * @param[in]   val2
+ *     the second handle
+ * @return      <code>0</code> if the handles are equal, or nonzero otherwise
+ */
+int intern_cmp(void *val1, void *val2);
+
+/**
+ * Releases the pool of a compilation.  The handles themselves are released
+ * with the arena of the compilation.
+ *
+ * @param[in]   ac
+ *     the compiler context
+ */
+void release_names(AlanCompiler *ac);
+
+#endif /* INTERN_H */
@@ -0,0 +1,443 @@
+/**
+ * @file    ir.c
+ * @brief   The intermediate representation of function bodies for ALAN-2022.
+ * @date    2026-10-14
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "boolean.h"
+#include "codegen.h"
+#include "error.h"
+#include "ir.h"
+
+/* --- type definitions and constants --------------------------------------- */
+
+#define INITIAL_LABEL_COUNT 64
+
+/* --- function prototypes -------------------------------------------------- */
+
+static IRblock *new_block(IRfunc *fn);
+static IRblock *block_of_label(IRfunc *fn, Label label);
+static void place(IRfunc *fn, IRblock *bb);
+static void add_pred(IRblock *bb, IRblock *pred);
+
+/* --- IR interface --------------------------------------------------------- */
+
+IRfunc *ir_new(Arena *arena, Label first_label)
+{
+	IRfunc *fn;
+
+	fn = arena_alloc(arena, sizeof(IRfunc));
+	memset(fn, 0, sizeof(IRfunc));
+	fn->arena = arena;
+	fn->base = first_label;
+	place(fn, new_block(fn));
+
+	return fn;
+}
+
+IRinsn *ir_emit(IRfunc *fn, Bytecode op, CodeType operand)
+{
+	IRblock *bb = fn->current;
+	IRinsn *i;
+
+	/* whatever follows a branch or return starts a new block */
+	if (bb->last && (IS_BRANCH(bb->last->op) || IS_TERMINAL(bb->last->op))) {
+		bb = new_block(fn);
+		place(fn, bb);
+	}
+
+	i = arena_alloc(fn->arena, sizeof(IRinsn));
+	i->op = op;
+	i->operand = operand;
+	i->num = 0;
+	i->inc = 0;
+	i->line = fn->line;
+	i->next = NULL;
+	i->prev = bb->last;
+	if (bb->last) {
+		bb->last->next = i;
+	} else {
+		bb->first = i;
+	}
+	bb->last = i;
+
+	return i;
+}
+
+IRinsn *ir_emit_branch(IRfunc *fn, Bytecode op, Label label)
+{
+	IRinsn *i;
+
+	i = ir_emit(fn, op, CODE_LABEL);
+	i->target = block_of_label(fn, label);
+
+	return i;
+}
+
+void ir_place_label(IRfunc *fn, Label label)
+{
+	IRblock *bb = fn->current;
+
+	/* an empty block without a label is never a branch target, so the label
+	 * can start its block in its stead */
+	if (bb->first == NULL && bb->label == 0) {
+		if (bb->prev) {
+			bb->prev->next = NULL;
+		} else {
+			fn->first = NULL;
+		}
+		fn->last = bb->prev;
+		fn->nblocks--;
+	}
+	place(fn, block_of_label(fn, label));
+}
+
+void ir_unlink(IRblock *bb, IRinsn *i)
+{
+	if (i->prev) {
+		i->prev->next = i->next;
+	} else {
+		bb->first = i->next;
+	}
+	if (i->next) {
+		i->next->prev = i->prev;
+	} else {
+		bb->last = i->prev;
+	}
+	i->prev = i->next = NULL;
+}
+
+void ir_link_before(IRblock *bb, IRinsn *at, IRinsn *i)
+{
+	i->next = at;
+	i->prev = (at ? at->prev : bb->last);
+	if (i->prev) {
+		i->prev->next = i;
+	} else {
+		bb->first = i;
+	}
+	if (at) {
+		at->prev = i;
+	} else {
+		bb->last = i;
+	}
+}
+
+void ir_unlink_block(IRfunc *fn, IRblock *bb)
+{
+	assert(bb != fn->first);
+	bb->prev->next = bb->next;
+	if (bb->next) {
+		bb->next->prev = bb->prev;
+	} else {
+		fn->last = bb->prev;
+	}
+	if (fn->current == bb) {
+		fn->current = bb->prev;
+	}
+	bb->placed = FALSE;
+	fn->nblocks--;
+}
+
+IRblock *ir_insert_block(IRfunc *fn, IRblock *after)
+{
+	IRblock *bb;
+
+	bb = new_block(fn);
+	bb->placed = TRUE;
+	bb->prev = after;
+	bb->next = after->next;
+	if (after->next) {
+		after->next->prev = bb;
+	} else {
+		fn->last = bb;
+	}
+	after->next = bb;
+	fn->nblocks++;
+
+	return bb;
+}
+
+IRblock *ir_split_block(IRfunc *fn, IRblock *bb, IRinsn *at)
+{
+	IRblock *rest;
+
+	rest = ir_insert_block(fn, bb);
+	if (at->next) {
+		rest->first = at->next;
+		rest->last = bb->last;
+		at->next->prev = NULL;
+		at->next = NULL;
+		bb->last = at;
+	}
+	if (fn->current == bb) {
+		fn->current = rest;
+	}
+
+	return rest;
+}
+
+void ir_move_to_end(IRfunc *fn, IRblock *first, IRblock *last)
+{
+	assert(first != fn->first);
+	if (last != fn->last) {
+		first->prev->next = last->next;
+		last->next->prev = first->prev;
+		first->prev = fn->last;
+		fn->last->next = first;
+		last->next = NULL;
+		fn->last = last;
+	}
+	fn->current = last;
+}
+
+void ir_build_cfg(IRfunc *fn)
+{
+	IRblock *bb;
+	unsigned int id;
+
+	id = 0;
+	for (bb = fn->first; bb; bb = bb->next) {
+		bb->id = id++;
+		bb->npreds = 0;
+		bb->preds = NULL;
+		bb->succ[0] = bb->succ[1] = NULL;
+		if (bb->last && IS_BRANCH(bb->last->op)) {
+			bb->succ[1] = bb->last->target;
+		}
+		if (!bb->last || !IS_TERMINAL(bb->last->op)) {
+			bb->succ[0] = bb->next;
+		}
+		if (bb->succ[1] == bb->succ[0]) {
+			bb->succ[1] = NULL;
+		}
+	}
+	fn->nblocks = id;
+
+	/* count the predecessors before storing them */
+	for (bb = fn->first; bb; bb = bb->next) {
+		if (bb->succ[0]) {
+			bb->succ[0]->npreds++;
+		}
+		if (bb->succ[1]) {
+			bb->succ[1]->npreds++;
+		}
+	}
+	for (bb = fn->first; bb; bb = bb->next) {
+		bb->preds = arena_alloc(fn->arena,
+				(bb->npreds + 1) * sizeof(IRblock *));
+		bb->npreds = 0;
+	}
+	for (bb = fn->first; bb; bb = bb->next) {
+		if (bb->succ[0]) {
+			add_pred(bb->succ[0], bb);
+		}
+		if (bb->succ[1]) {
+			add_pred(bb->succ[1], bb);
+		}
+	}
+}
+
+void ir_lower(IRfunc *fn, Label *next_label, Code **code, int *ncode,
+		int **lines)
+{
+	IRblock *bb;
+	IRinsn *i;
+	Code *c;
+	int n, k, *l;
+
+	ir_build_cfg(fn);
+
+	/* every branch target needs a label, and no other block does, except for
+	 * the labels that the parser placed */
+	n = 0;
+	for (bb = fn->first; bb; bb = bb->next) {
+		for (i = bb->first; i; i = i->next) {
+			if (i->operand == CODE_LABEL && i->target->label == 0) {
+				i->target->label = (*next_label)++;
+			}
+			n += (i->operand ? 2 : 1) + (i->op == JVM_IINC);
+		}
+	}
+	for (bb = fn->first; bb; bb = bb->next) {
+		if (bb->label) {
+			n++;
+		}
+	}
+
+	*code = c = emalloc((n + 1) * sizeof(Code));
+	for (bb = fn->first; bb; bb = bb->next) {
+		if (bb->label) {
+			c->type = CODE_LABEL;
+			c++->label = bb->label;
+		}
+		for (i = bb->first; i; i = i->next) {
+			c->type = CODE_INSTRUCTION;
+			c++->code = i->op;
+			if (i->operand == 0) {
+				continue;
+			}
+			c->type = CODE_OPERAND | i->operand;
+			switch (i->operand) {
+				case CODE_LABEL:
+					c->label = i->target->label;
+					break;
+				case CODE_ARRAY_TYPE:
+					c->atype = i->atype;
+					break;
+				case CODE_INTEGER:
+					c->num = i->num;
+					break;
+				default:
+					c->string = i->string;
+					break;
+			}
+			c++;
+			if (i->op == JVM_IINC) {
+				c->type = CODE_OPERAND | CODE_INTEGER;
+				c++->num = i->inc;
+			}
+		}
+	}
+	assert(c - *code == n);
+	*ncode = n;
+
+	/* the operands of an instruction share its line */
+	if (lines) {
+		*lines = l = emalloc((n + 1) * sizeof(int));
+		for (bb = fn->first; bb; bb = bb->next) {
+			if (bb->label) {
+				*l++ = 0;
+			}
+			for (i = bb->first; i; i = i->next) {
+				for (k = (i->operand ? 2 : 1) + (i->op == JVM_IINC); k > 0;
+						k--) {
+					*l++ = i->line;
+				}
+			}
+		}
+	}
+}
+
+void ir_print(FILE *file, IRfunc *fn)
+{
+	IRblock *bb;
+	IRinsn *i;
+	unsigned int k;
+
+	for (bb = fn->first; bb; bb = bb->next) {
+		fprintf(file, "B%u", bb->id);
+		if (bb->label) {
+			fprintf(file, " (L%u)", bb->label);
+		}
+		fprintf(file, ":");
+		for (k = 0; k < bb->npreds; k++) {
+			fprintf(file, "%s B%u", (k == 0 ? " preds" : ","),
+					bb->preds[k]->id);
+		}
+		fprintf(file, "\n");
+		for (i = bb->first; i; i = i->next) {
+			fprintf(file, "\t%s", get_opcode_string(i->op));
+			switch (i->operand) {
+				case CODE_LABEL:
+					fprintf(file, " B%u", i->target->id);
+					break;
+				case CODE_ARRAY_TYPE:
+					fprintf(file, " %d", (int) i->atype);
+					break;
+				case CODE_INTEGER:
+					fprintf(file, " %d", i->num);
+					if (i->op == JVM_IINC) {
+						fprintf(file, " %d", i->inc);
+					}
+					break;
+				case CODE_STRING:
+					fprintf(file, " \"%s\"", i->string);
+					break;
+				case CODE_REFERENCE:
+					fprintf(file, " %s", i->string);
+					break;
+				default:
+					break;
+			}
+			fprintf(file, "\n");
+		}
+		if (bb->succ[0]) {
+			fprintf(file, "\t-> B%u\n", bb->succ[0]->id);
+		}
+	}
+}
+
+/* --- utility functions ---------------------------------------------------- */
+
+static IRblock *new_block(IRfunc *fn)
+{
+	IRblock *bb;
+
+	bb = arena_alloc(fn->arena, sizeof(IRblock));
+	memset(bb, 0, sizeof(IRblock));
+
+	return bb;
+}
+
+/* Returns the block of a label, creating it if the label has not been seen.
+ * Labels are numbered throughout the class, so the table is indexed from the
+ * first label of the function; it is reallocated from the arena as it grows,
+ * which at most doubles its footprint.
+ */
+
+static IRblock *block_of_label(IRfunc *fn, Label label)
+{
+	IRblock **blocks;
+	Label k, n;
+
+	assert(label >= fn->base);
+	k = label - fn->base;
+	if (k >= fn->nlabels) {
+		n = (fn->nlabels ? fn->nlabels : INITIAL_LABEL_COUNT);
+		while (n <= k) {
+			n *= 2;
+		}
+		blocks = arena_alloc(fn->arena, n * sizeof(IRblock *));
+		if (fn->nlabels > 0) {
+			memcpy(blocks, fn->blocks, fn->nlabels * sizeof(IRblock *));
+		}
+		memset(blocks + fn->nlabels, 0,
+				(n - fn->nlabels) * sizeof(IRblock *));
+		fn->blocks = blocks;
+		fn->nlabels = n;
+	}
+	if (fn->blocks[k] == NULL) {
+		fn->blocks[k] = new_block(fn);
+		fn->blocks[k]->label = label;
+	}
+
+	return fn->blocks[k];
+}
+
+/* Links a block at the end of the layout, and makes it the current block. */
+
+static void place(IRfunc *fn, IRblock *bb)
+{
+	assert(!bb->placed);
+	bb->placed = TRUE;
+	bb->prev = fn->last;
+	bb->next = NULL;
+	if (fn->last) {
+		fn->last->next = bb;
+	} else {
+		fn->first = bb;
+	}
+	fn->last = bb;
+	fn->current = bb;
+	fn->nblocks++;
+}
+
+static void add_pred(IRblock *bb, IRblock *pred)
+{
+	bb->preds[bb->npreds++] = pred;
+}
@@ -0,0 +1,246 @@
+/**
+ * @file    ir.h
+ * @brief   The intermediate representation of function bodies for ALAN-2022.
+ *
+ * As the parser generates the code of a function or procedure, the code is
+ * recorded as a list of basic blocks of stack-machine instructions, which are
+ * linked into a control-flow graph.  This is the form on which the passes that
+ * improve the code work, after which it is lowered into the flat code array of
+ * a body, from which the Jasmin and class-file output is written.
+ *
+ * Instructions are those of the code array, with the operand held in the
+ * instruction itself, and branches refer to the block they jump to rather than
+ * to a label.  Only iinc has a second operand, its increment, which follows
+ * the first in the code array.  All of the IR of a compilation is allocated from its arena.
+ *
+ * @date    2026-10-14
+ */
+
+#ifndef IR_H
+#define IR_H
+
+#include <stdio.h>
+#include "boolean.h"
+#include "bytecode.h"
+#include "error.h"
+
+typedef struct ir_insn IRinsn;
+typedef struct ir_block IRblock;
+typedef struct ir_func IRfunc;
+
+/** an instruction and its operand */
+struct ir_insn {
+	Bytecode     op;        /**< the instruction                            */
+	CodeType     operand;   /**< the data type of the operand, CODE_LABEL for
+	                             a branch target, or 0 if there is none     */
+	union {
+		int       num;      /**< an integer operand                         */
+		char     *string;   /**< a string or reference operand              */
+		JVMatype  atype;    /**< an array type operand                      */
+		IRblock  *target;   /**< the block to which a branch jumps          */
+	};
+	int          inc;       /**< the increment of an iinc, of which the
+	                             integer operand is the local variable      */
+	int          line;      /**< the source line, or 0 if not known         */
+	IRinsn      *prev;      /**< the previous instruction of the block      */
+	IRinsn      *next;      /**< the next instruction of the block          */
+};
+
+/** a basic block: control enters only at the top, and leaves at the bottom */
+struct ir_block {
+	unsigned int id;        /**< the position of the block in the layout    */
+	Label        label;     /**< the label of the block, or 0 if none       */
+	IRinsn      *first;     /**< the first instruction                      */
+	IRinsn      *last;      /**< the last instruction                       */
+	IRblock     *prev;      /**< the previous block in the layout           */
+	IRblock     *next;      /**< the next block in the layout               */
+	IRblock     *succ[2];   /**< the fall-through successor, and the target
+	                             of the branch that ends the block          */
+	IRblock    **preds;     /**< the predecessors                           */
+	unsigned int npreds;    /**< the number of predecessors                 */
+	Boolean      placed;    /**< whether the block is in the layout         */
+};
+
+/** the IR of one function or procedure */
+struct ir_func {
+	Arena       *arena;     /**< the arena that holds the IR                */
+	IRblock     *first;     /**< the entry block                            */
+	IRblock     *last;      /**< the last block in the layout               */
+	IRblock     *current;   /**< the block to which code is appended        */
+	unsigned int nblocks;   /**< the number of blocks in the layout         */
+	IRblock    **blocks;    /**< the blocks of the labels, by label         */
+	Label        nlabels;   /**< the length of the blocks array             */
+	Label        base;      /**< the label of the first entry of blocks     */
+	int          line;      /**< the source line of the code being added,
+	                             or 0 if the lines are not kept             */
+};
+
+/**
+ * Creates the IR of a function, with an empty entry block.
+ *
+ * @param[in]   arena
+ *     the arena from which the IR is allocated
+ * @param[in]   first_label
+ *     the smallest label that the code of the function refers to
+ * @return      a pointer to the new IR
+ */
+IRfunc *ir_new(Arena *arena, Label first_label);
+
+/**
+ * Appends an instruction to the current block.  If the current block ends
+ * with a branch or return, a new block is started for the instruction.  The
+ * instruction is attributed to the current source line of the function.
+ *
+ * @param[in]   fn
+ *     the IR of the function
+ * @param[in]   op
+ *     the instruction
+ * @param[in]   operand
+ *     the data type of the operand, which the caller sets in the returned
+ *     instruction, or 0 if there is none
+ * @return      a pointer to the new instruction
+ */
+IRinsn *ir_emit(IRfunc *fn, Bytecode op, CodeType operand);
+
+/**
+ * Appends a branch to the block of a label, which need not be placed yet.
+ *
+ * @param[in]   fn
+ *     the IR of the function
+ * @param[in]   op
+ *     the branch instruction
+ * @param[in]   label
+ *     the target label
+ * @return      a pointer to the new instruction
+ */
+IRinsn *ir_emit_branch(IRfunc *fn, Bytecode op, Label label);
+
+/**
+ * Places the block of a label after the current block, and makes it the
+ * current block.  Control falls through into it unless the current block ends
+ * with an unconditional transfer.
+ *
+ * @param[in]   fn
+ *     the IR of the function
+ * @param[in]   label
+ *     the label
+ */
+void ir_place_label(IRfunc *fn, Label label);
+
+/**
+ * Removes an instruction from its block.
+ *
+ * @param[in]   bb
+ *     the block
+ * @param[in]   i
+ *     the instruction
+ */
+void ir_unlink(IRblock *bb, IRinsn *i);
+
+/**
+ * Inserts an instruction, which is in no block, before another.
+ *
+ * @param[in]   bb
+ *     the block
+ * @param[in]   at
+ *     the instruction of the block before which to insert, or
+ *     <code>NULL</code> to append to the block
+ * @param[in]   i
+ *     the instruction to insert
+ */
+void ir_link_before(IRblock *bb, IRinsn *at, IRinsn *i);
+
+/**
+ * Removes a block from the layout.  Branches to the block must have been
+ * redirected or removed.
+ *
+ * @param[in]   fn
+ *     the IR of the function
+ * @param[in]   bb
+ *     the block, which must not be the entry block
+ */
+void ir_unlink_block(IRfunc *fn, IRblock *bb);
+
+/**
+ * Creates an empty block, and places it after another in the layout.
+ *
+ * @param[in]   fn
+ *     the IR of the function
+ * @param[in]   after
+ *     the block after which to place the new one
+ * @return      a pointer to the new block
+ */
+IRblock *ir_insert_block(IRfunc *fn, IRblock *after);
+
+/**
+ * Splits a block after one of its instructions.  The instructions that follow
+ * it are moved into a new block, which is placed next in the layout, so that
+ * control falls through into it.
+ *
+ * @param[in]   fn
+ *     the IR of the function
+ * @param[in]   bb
+ *     the block
+ * @param[in]   at
+ *     the last instruction to keep in the block
+ * @return      a pointer to the new block, which is empty if the instruction
+ *              was the last of the block
+ */
+IRblock *ir_split_block(IRfunc *fn, IRblock *bb, IRinsn *at);
+
+/**
+ * Moves a run of blocks to the end of the layout, and makes the last of them
+ * the current block, so that the code that follows is generated after them.
+ *
+ * @param[in]   fn
+ *     the IR of the function
+ * @param[in]   first
+ *     the first block of the run, which must not be the entry block
+ * @param[in]   last
+ *     the last block of the run
+ */
+void ir_move_to_end(IRfunc *fn, IRblock *first, IRblock *last);
+
+/**
+ * Links the blocks of a function into its control-flow graph, and numbers
+ * them in layout order.  This must be called again after a pass changes the
+ * blocks or the branches between them.
+ *
+ * @param[in]   fn
+ *     the IR of the function
+ */
+void ir_build_cfg(IRfunc *fn);
+
+/**
+ * Lowers the IR of a function into a code array.  A branch target that has
+ * no label yet is given the next unused label.  If asked for, the source line
+ * of every code item is given as well, which is 0 for labels and for the
+ * instructions whose line is not known.
+ *
+ * @param[in]   fn
+ *     the IR of the function, of which the control-flow graph is built
+ * @param[in,out]   next_label
+ *     the next unused label
+ * @param[out]  code
+ *     the code array, which must be released with <code>free</code>
+ * @param[out]  ncode
+ *     the number of code items
+ * @param[out]  lines
+ *     the source lines of the code items, which must be released with
+ *     <code>free</code>, or <code>NULL</code> if they are not wanted
+ */
+void ir_lower(IRfunc *fn, Label *next_label, Code **code, int *ncode,
+		int **lines);
+
+/**
+ * Prints the blocks of a function and the edges between them; for debugging
+ * purposes.
+ *
+ * @param[in]   file
+ *     the output file
+ * @param[in]   fn
+ *     the IR of the function
+ */
+void ir_print(FILE *file, IRfunc *fn);
+
+#endif /* IR_H */
@@ -20,11 +20,13 @@ typedef enum {
 	T_LONG
 } JVMatype;
 
-/* JVM bytecodes */
+/* JVM bytecodes, in the order of instruction_set in codegen.c; the conditional
+ * branches, from JVM_IFEQ to JVM_IF_ICMPNE, must stay together */
 typedef enum {
 	JVM_ALOAD,
 	JVM_ARETURN,
 	JVM_ASTORE,
+	JVM_DUP,
 	JVM_GETSTATIC,
 	JVM_GOTO,
 	JVM_IADD,
@@ -33,18 +35,26 @@ typedef enum {
 	JVM_IASTORE,
 	JVM_IDIV,
 	JVM_IFEQ,
+	JVM_IFGE,
+	JVM_IFGT,
+	JVM_IFLE,
+	JVM_IFLT,
+	JVM_IFNE,
 	JVM_IF_ICMPEQ,
 	JVM_IF_ICMPGE,
 	JVM_IF_ICMPGT,
 	JVM_IF_ICMPLE,
 	JVM_IF_ICMPLT,
 	JVM_IF_ICMPNE,
+	JVM_IINC,
 	JVM_ILOAD,
 	JVM_IMUL,
 	JVM_INEG,
 	JVM_INVOKESTATIC,
 	JVM_INVOKEVIRTUAL,
 	JVM_IOR,
+	JVM_ISHL,
+	JVM_ISHR,
 	JVM_ISTORE,
 	JVM_ISUB,
 	JVM_IREM,
@@ -52,8 +62,83 @@ typedef enum {
 	JVM_IXOR,
 	JVM_LDC,
 	JVM_NEWARRAY,
+	JVM_POP,
 	JVM_RETURN,
 	JVM_SWAP
 } Bytecode;
 
+/* JVM opcode values, as encoded in class files */
+typedef enum {
+	OP_NOP = 0x00,
+	OP_ICONST_M1 = 0x02,
+	OP_ICONST_0 = 0x03,
+	OP_ICONST_1 = 0x04,
+	OP_LCONST_1 = 0x0a,
+	OP_BIPUSH = 0x10,
+	OP_SIPUSH = 0x11,
+	OP_LDC = 0x12,
+	OP_LDC_W = 0x13,
+	OP_ILOAD = 0x15,
+	OP_ALOAD = 0x19,
+	OP_ILOAD_0 = 0x1a,
+	OP_ALOAD_0 = 0x2a,
+	OP_IALOAD = 0x2e,
+	OP_LALOAD = 0x2f,
+	OP_AALOAD = 0x32,
+	OP_BALOAD = 0x33,
+	OP_ISTORE = 0x36,
+	OP_ASTORE = 0x3a,
+	OP_ISTORE_0 = 0x3b,
+	OP_ASTORE_0 = 0x4b,
+	OP_IASTORE = 0x4f,
+	OP_LASTORE = 0x50,
+	OP_BASTORE = 0x54,
+	OP_POP = 0x57,
+	OP_DUP = 0x59,
+	OP_DUP_X2 = 0x5b,
+	OP_DUP2 = 0x5c,
+	OP_SWAP = 0x5f,
+	OP_IADD = 0x60,
+	OP_LADD = 0x61,
+	OP_ISUB = 0x64,
+	OP_LSUB = 0x65,
+	OP_IMUL = 0x68,
+	OP_IDIV = 0x6c,
+	OP_IREM = 0x70,
+	OP_INEG = 0x74,
+	OP_ISHL = 0x78,
+	OP_ISHR = 0x7a,
+	OP_IAND = 0x7e,
+	OP_IOR = 0x80,
+	OP_IXOR = 0x82,
+	OP_IINC = 0x84,
+	OP_IFEQ = 0x99,
+	OP_IFNE = 0x9a,
+	OP_IFLT = 0x9b,
+	OP_IFGE = 0x9c,
+	OP_IFGT = 0x9d,
+	OP_IFLE = 0x9e,
+	OP_IF_ICMPEQ = 0x9f,
+	OP_IF_ICMPNE = 0xa0,
+	OP_IF_ICMPLT = 0xa1,
+	OP_IF_ICMPGE = 0xa2,
+	OP_IF_ICMPGT = 0xa3,
+	OP_IF_ICMPLE = 0xa4,
+	OP_GOTO = 0xa7,
+	OP_IRETURN = 0xac,
+	OP_ARETURN = 0xb0,
+	OP_RETURN = 0xb1,
+	OP_GETSTATIC = 0xb2,
+	OP_PUTSTATIC = 0xb3,
+	OP_INVOKEVIRTUAL = 0xb6,
+	OP_INVOKESPECIAL = 0xb7,
+	OP_INVOKESTATIC = 0xb8,
+	OP_NEW = 0xbb,
+	OP_NEWARRAY = 0xbc,
+	OP_ARRAYLENGTH = 0xbe,
+	OP_ATHROW = 0xbf,
+	OP_WIDE = 0xc4,
+	OP_IFNONNULL = 0xc7
+} JVMopcode;
+
 #endif /* JVM_H */
@@ -0,0 +1,576 @@
+/**
+ * @file    loops.c
+ * @brief   Loop-invariant code motion and strength reduction over the IR.
+ * @date    2026-10-14
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "boolean.h"
+#include "codegen.h"
+#include "error.h"
+#include "ir.h"
+#include "loops.h"
+
+/* --- type definitions and constants --------------------------------------- */
+
+#define IS_CONSTANT(i)                                                         \
+	((i) != NULL && (i)->op == JVM_LDC && (i)->operand == CODE_INTEGER)
+
+#define IS_LOAD(i, slot)                                                       \
+	((i) != NULL && (i)->op == JVM_ILOAD && (i)->num == (slot))
+
+#define IS_STORE(op)                                                           \
+	((op) == JVM_ISTORE || (op) == JVM_ASTORE || (op) == JVM_IINC)
+
+#define THROWS(op)                                                             \
+	((op) == JVM_IDIV || (op) == JVM_IREM || (op) == JVM_IALOAD)
+
+/** a loop, as the run of blocks from its head to its tail in the layout */
+typedef struct {
+	unsigned int  head;      /**< the id of the first block                */
+	unsigned int  tail;      /**< the id of the last block                 */
+} Loop;
+
+/** how a loop is entered, and what it changes */
+typedef struct {
+	IRblock      *entry;     /**< the block through which control enters   */
+	IRblock      *pre;       /**< the preheader, from which it does        */
+	int          *nstores;   /**< per slot, the stores in the loop         */
+	IRblock     **defbb;     /**< per slot, the block of a store           */
+	IRinsn      **def;       /**< per slot, a store                        */
+	Boolean      *iv;        /**< per slot, whether it is a basic induction
+	                              variable                                 */
+	int          *step;      /**< per slot, the step of an induction
+	                              variable                                 */
+	Boolean       clobbers;  /**< whether the loop may change an array     */
+} LoopInfo;
+
+/** a value on the operand stack, as the instructions that compute it */
+typedef struct {
+	IRinsn       *first;     /**< the first of the instructions            */
+	IRinsn       *last;      /**< the last of the instructions             */
+	Boolean       invariant; /**< whether the loop does not change it      */
+	Boolean       throws;    /**< whether computing it may throw           */
+	int           nops;      /**< the operations among the instructions    */
+} Value;
+
+/* --- function prototypes -------------------------------------------------- */
+
+static Loop *find_loops(IRfunc *fn, int *nloops);
+static int by_size(const void *a, const void *b);
+static Boolean study_loop(IRblock **blocks, const Loop *loop, int width,
+		LoopInfo *li);
+static void find_induction(LoopInfo *li, int slot);
+static Boolean passes_array(IRinsn *call);
+static void scan_block(IRfunc *fn, LoopInfo *li, IRblock *bb, int *width,
+		LoopStats *stats);
+static void hoist(IRfunc *fn, LoopInfo *li, IRblock *bb, Value *v,
+		Boolean may_throw, int *width, LoopStats *stats);
+static IRinsn *reduce(IRfunc *fn, LoopInfo *li, IRblock *bb, Value *iv,
+		Value *x, IRinsn *mul, int *width);
+static IRinsn *preheader_end(LoopInfo *li);
+static void move_range(IRblock *from, IRinsn *first, IRinsn *last,
+		IRblock *to, IRinsn *at);
+static void copy_range(IRfunc *fn, IRinsn *first, IRinsn *last, IRblock *to,
+		IRinsn *at);
+static IRinsn *add_insn(IRfunc *fn, IRblock *bb, IRinsn *at, Bytecode op,
+		int num);
+
+/* --- loop interface ------------------------------------------------------- */
+
+void optimise_loops(IRfunc *fn, int *width, LoopStats *stats)
+{
+	IRblock *bb, **blocks;
+	Loop *loops;
+	LoopInfo li;
+	int nloops, n;
+	unsigned int k;
+
+	ir_build_cfg(fn);
+	blocks = emalloc((fn->nblocks + 1) * sizeof(IRblock *));
+	for (bb = fn->first; bb; bb = bb->next) {
+		blocks[bb->id] = bb;
+	}
+
+	/* moving code between the blocks changes neither the blocks nor the
+	 * edges between them, so that the loops stay as they were found */
+	loops = find_loops(fn, &nloops);
+	for (n = 0; n < nloops; n++) {
+		if (study_loop(blocks, &loops[n], *width, &li)) {
+			stats->loops++;
+			for (k = loops[n].head; k <= loops[n].tail; k++) {
+				scan_block(fn, &li, blocks[k], width, stats);
+			}
+		}
+		free(li.nstores);
+		free(li.defbb);
+		free(li.def);
+		free(li.iv);
+		free(li.step);
+	}
+
+	free(loops);
+	free(blocks);
+}
+
+void print_loop_stats(FILE *file, const char *prefix, const LoopStats *stats)
+{
+	if (stats->loops > 0) {
+		fprintf(file, "%sloops: %lu loops, %lu invariants hoisted, "
+				"%lu multiplications reduced\n", prefix, stats->loops,
+				stats->hoisted, stats->reduced);
+	}
+}
+
+/* --- utility functions ---------------------------------------------------- */
+
+/* Finds the loops of a function, innermost first.  Every branch back to an
+ * earlier block closes a loop over the blocks in between.
+ */
+
+static Loop *find_loops(IRfunc *fn, int *nloops)
+{
+	IRblock *bb, *head;
+	Loop *loops;
+	int n, s;
+
+	loops = emalloc((fn->nblocks + 1) * sizeof(Loop));
+	*nloops = 0;
+	for (bb = fn->first; bb; bb = bb->next) {
+		for (s = 0; s < 2; s++) {
+			head = bb->succ[s];
+			if (head == NULL || head->id > bb->id) {
+				continue;
+			}
+			for (n = 0; n < *nloops && loops[n].head != head->id; n++)
+				;
+			if (n == *nloops) {
+				loops[n].head = head->id;
+				(*nloops)++;
+			}
+			loops[n].tail = bb->id;
+		}
+	}
+	qsort(loops, *nloops, sizeof(Loop), by_size);
+
+	return loops;
+}
+
+static int by_size(const void *a, const void *b)
+{
+	const Loop *x = a, *y = b;
+
+	if (x->tail - x->head != y->tail - y->head) {
+		return (x->tail - x->head < y->tail - y->head ? -1 : 1);
+	}
+	return (x->head < y->head ? -1 : x->head > y->head);
+}
+
+/* Finds the block through which control enters a loop, and its preheader,
+ * and what the loop stores.  Only a loop that is entered from a single block,
+ * which leads nowhere else, is optimised.  The tables have room for the slots
+ * that the optimisation of the loop may add, at most two per instruction.
+ */
+
+static Boolean study_loop(IRblock **blocks, const Loop *loop, int width,
+		LoopInfo *li)
+{
+	IRblock *bb, *p;
+	IRinsn *i;
+	unsigned int k, n;
+	int nslots, ninsns, v;
+
+	ninsns = 0;
+	for (k = loop->head; k <= loop->tail; k++) {
+		for (i = blocks[k]->first; i; i = i->next) {
+			ninsns++;
+		}
+	}
+	nslots = width + 2 * ninsns + 1;
+	li->nstores = emalloc(nslots * sizeof(int));
+	li->defbb = emalloc(nslots * sizeof(IRblock *));
+	li->def = emalloc(nslots * sizeof(IRinsn *));
+	li->iv = emalloc(nslots * sizeof(Boolean));
+	li->step = emalloc(nslots * sizeof(int));
+	memset(li->nstores, 0, nslots * sizeof(int));
+	memset(li->iv, 0, nslots * sizeof(Boolean));
+	li->entry = li->pre = NULL;
+	li->clobbers = FALSE;
+
+	/* the entry block of the function is entered from outside, too */
+	if (loop->head == 0) {
+		return FALSE;
+	}
+	for (k = loop->head; k <= loop->tail; k++) {
+		bb = blocks[k];
+		for (n = 0; n < bb->npreds; n++) {
+			p = bb->preds[n];
+			if (p->id >= loop->head && p->id <= loop->tail) {
+				continue;
+			}
+			if (li->entry) {
+				return FALSE;
+			}
+			li->entry = bb;
+			li->pre = p;
+		}
+	}
+	if (li->entry == NULL) {
+		return FALSE;
+	}
+	p = li->pre;
+	if ((p->succ[0] && p->succ[0] != li->entry)
+			|| (p->succ[1] && p->succ[1] != li->entry)
+			|| (p->last && IS_BRANCH(p->last->op)
+				&& p->last->op != JVM_GOTO)) {
+		return FALSE;
+	}
+
+	for (k = loop->head; k <= loop->tail; k++) {
+		for (i = blocks[k]->first; i; i = i->next) {
+			if (IS_STORE(i->op)) {
+				li->nstores[i->num]++;
+				li->defbb[i->num] = blocks[k];
+				li->def[i->num] = i;
+			} else if (i->op == JVM_IASTORE
+					|| (i->op == JVM_INVOKESTATIC && passes_array(i))) {
+				li->clobbers = TRUE;
+			}
+		}
+	}
+	for (v = 0; v < width; v++) {
+		find_induction(li, v);
+	}
+
+	return TRUE;
+}
+
+/* Decides whether a variable is a basic induction variable: it is stored
+ * once in the loop, by adding a constant to it.
+ */
+
+static void find_induction(LoopInfo *li, int slot)
+{
+	IRinsn *op, *a, *b;
+
+	if (li->nstores[slot] != 1) {
+		return;
+	}
+	if (li->def[slot]->op == JVM_IINC) {
+		li->iv[slot] = TRUE;
+		li->step[slot] = li->def[slot]->inc;
+		return;
+	}
+
+	op = li->def[slot]->prev;
+	if (op && op->op == JVM_DUP) {
+		op = op->prev;
+	}
+	b = (op ? op->prev : NULL);
+	a = (b ? b->prev : NULL);
+	if (op == NULL || li->def[slot]->op != JVM_ISTORE) {
+		return;
+	}
+	if (op->op == JVM_IADD && IS_LOAD(a, slot) && IS_CONSTANT(b)) {
+		li->step[slot] = b->num;
+	} else if (op->op == JVM_IADD && IS_CONSTANT(a) && IS_LOAD(b, slot)) {
+		li->step[slot] = a->num;
+	} else if (op->op == JVM_ISUB && IS_LOAD(a, slot) && IS_CONSTANT(b)) {
+		li->step[slot] = (int) (0U - (unsigned int) b->num);
+	} else {
+		return;
+	}
+	li->iv[slot] = TRUE;
+}
+
+/* Follows the values on the operand stack through a block of a loop.  A value
+ * grows while it is invariant, and once something else consumes it, or it is
+ * left on the stack at the end of the block, it is hoisted whole.  The values
+ * on the stack on entry to the block are not known.  Until the first call,
+ * array store or instruction that may throw, the block of the entry runs as
+ * if it were the preheader.
+ */
+
+static void scan_block(IRfunc *fn, LoopInfo *li, IRblock *bb, int *width,
+		LoopStats *stats)
+{
+	IRinsn *i, *next;
+	Value *stack, *a, *b;
+	Boolean may_throw;
+	int n, sp, pop, push, arity;
+
+	n = 0;
+	for (i = bb->first; i; i = i->next) {
+		n++;
+	}
+	stack = emalloc((n + 1) * sizeof(Value));
+
+	sp = 0;
+	may_throw = (bb == li->entry);
+	for (i = bb->first; i; i = next) {
+		next = i->next;
+		arity = 0;
+		switch (i->op) {
+			case JVM_LDC:
+			case JVM_ILOAD:
+			case JVM_ALOAD:
+				a = &stack[sp++];
+				a->first = a->last = i;
+				a->invariant = (i->op == JVM_LDC ? i->operand == CODE_INTEGER
+						: li->nstores[i->num] == 0);
+				a->throws = FALSE;
+				a->nops = 0;
+				continue;
+			case JVM_INEG:
+				arity = 1;
+				break;
+			case JVM_IADD:
+			case JVM_IAND:
+			case JVM_IDIV:
+			case JVM_IMUL:
+			case JVM_IOR:
+			case JVM_IREM:
+			case JVM_ISHL:
+			case JVM_ISHR:
+			case JVM_ISUB:
+			case JVM_IXOR:
+				arity = 2;
+				break;
+			case JVM_IALOAD:
+				arity = (li->clobbers ? 0 : 2);
+				break;
+			default:
+				break;
+		}
+
+		if (arity > 0 && sp >= arity) {
+			a = &stack[sp - arity];
+			b = &stack[sp - 1];
+
+			/* i * x, where x is invariant, steps along with i */
+			if (i->op == JVM_IMUL && a->first == a->last
+					&& a->first->op == JVM_ILOAD && li->iv[a->first->num]
+					&& b->invariant && !b->throws) {
+				a->first = a->last = reduce(fn, li, bb, a, b, i, width);
+				a->invariant = FALSE;
+				a->nops = 0;
+				sp--;
+				stats->reduced++;
+				continue;
+			}
+			if (i->op == JVM_IMUL && b->first == b->last
+					&& b->first->op == JVM_ILOAD && li->iv[b->first->num]
+					&& a->invariant && !a->throws) {
+				a->first = a->last = reduce(fn, li, bb, b, a, i, width);
+				a->invariant = FALSE;
+				a->nops = 0;
+				sp--;
+				stats->reduced++;
+				continue;
+			}
+
+			if (a->invariant && b->invariant) {
+				if (a != b) {
+					a->nops += b->nops;
+					a->throws = a->throws || b->throws;
+				}
+				a->last = i;
+				a->nops++;
+				a->throws = a->throws || THROWS(i->op);
+				sp -= arity - 1;
+				continue;
+			}
+		}
+
+		/* anything else consumes its operands as they are */
+		if (i->op == JVM_GETSTATIC || i->op == JVM_INVOKESTATIC
+				|| i->op == JVM_INVOKEVIRTUAL) {
+			pop = sp;
+			push = 0;
+		} else {
+			get_stack_effect(i->op, &pop, &push);
+			pop = (pop < sp ? pop : sp);
+		}
+		for (n = sp - pop; n < sp; n++) {
+			hoist(fn, li, bb, &stack[n], may_throw, width, stats);
+		}
+		if (THROWS(i->op) || i->op == JVM_IASTORE || i->op == JVM_NEWARRAY
+				|| i->op == JVM_INVOKESTATIC || i->op == JVM_INVOKEVIRTUAL) {
+			may_throw = FALSE;
+		}
+		for (sp -= pop; push > 0; push--) {
+			a = &stack[sp++];
+			a->first = a->last = i;
+			a->invariant = FALSE;
+			a->throws = FALSE;
+			a->nops = 0;
+		}
+	}
+	for (n = 0; n < sp; n++) {
+		hoist(fn, li, bb, &stack[n], may_throw, width, stats);
+	}
+
+	free(stack);
+}
+
+/* Moves the computation of an invariant value into the preheader, where it is
+ * stored into a new variable, and loads the variable in its stead.  A value
+ * that may throw is only moved if it would have been computed before anything
+ * else that is seen from outside.
+ */
+
+static void hoist(IRfunc *fn, LoopInfo *li, IRblock *bb, Value *v,
+		Boolean may_throw, int *width, LoopStats *stats)
+{
+	IRinsn *at, *next;
+	int t;
+
+	if (!v->invariant || v->nops == 0 || (v->throws && !may_throw)) {
+		return;
+	}
+
+	t = (*width)++;
+	next = v->last->next;
+	at = preheader_end(li);
+	move_range(bb, v->first, v->last, li->pre, at);
+	add_insn(fn, li->pre, at, JVM_ISTORE, t);
+	v->first = v->last = add_insn(fn, bb, next, JVM_ILOAD, t);
+	v->nops = 0;
+	stats->hoisted++;
+}
+
+/* Replaces the multiplication of an induction variable by an invariant by a
+ * load of a new variable, which the preheader sets to the product, and which
+ * is stepped by the step times the invariant wherever the induction variable
+ * is.  Multiplication distributes over addition with wrap-around, so that the
+ * two agree throughout the loop.
+ */
+
+static IRinsn *reduce(IRfunc *fn, LoopInfo *li, IRblock *bb, Value *iv,
+		Value *x, IRinsn *mul, int *width)
+{
+	IRinsn *at, *next, *after;
+	Boolean constant;
+	int v, t, d, k, c;
+
+	v = iv->first->num;
+	k = li->step[v];
+	constant = (x->first == x->last && IS_CONSTANT(x->first));
+	c = (constant ? x->first->num : 0);
+	at = preheader_end(li);
+	next = mul->next;
+
+	/* the step of the product is computed once, unless it is a constant */
+	d = 0;
+	if (!constant) {
+		d = (*width)++;
+		copy_range(fn, x->first, x->last, li->pre, at);
+		if (k != 1) {
+			add_insn(fn, li->pre, at, JVM_LDC, k);
+			add_insn(fn, li->pre, at, JVM_IMUL, 0);
+		}
+		add_insn(fn, li->pre, at, JVM_ISTORE, d);
+	}
+
+	t = (*width)++;
+	li->nstores[t] = 1;
+	add_insn(fn, li->pre, at, JVM_ILOAD, v);
+	move_range(bb, x->first, x->last, li->pre, at);
+	add_insn(fn, li->pre, at, JVM_IMUL, 0);
+	add_insn(fn, li->pre, at, JVM_ISTORE, t);
+	ir_unlink(bb, iv->first);
+	ir_unlink(bb, mul);
+
+	after = li->def[v]->next;
+	add_insn(fn, li->defbb[v], after, JVM_ILOAD, t);
+	if (constant) {
+		add_insn(fn, li->defbb[v], after, JVM_LDC,
+				(int) ((unsigned int) k * (unsigned int) c));
+	} else {
+		add_insn(fn, li->defbb[v], after, JVM_ILOAD, d);
+	}
+	add_insn(fn, li->defbb[v], after, JVM_IADD, 0);
+	add_insn(fn, li->defbb[v], after, JVM_ISTORE, t);
+
+	return add_insn(fn, bb, next, JVM_ILOAD, t);
+}
+
+/* Tests whether a call is passed an array.  ALAN has no global variables, so a
+ * callee that is not can only change the elements of the arrays it creates.
+ */
+
+static Boolean passes_array(IRinsn *call)
+{
+	const char *d;
+
+	for (d = strchr(call->string, '('); *d != ')'; d++) {
+		if (*d == '[') {
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+/* Returns the instruction of the preheader before which code is added, which
+ * is its jump into the loop, if it has one.
+ */
+
+static IRinsn *preheader_end(LoopInfo *li)
+{
+	IRinsn *last = li->pre->last;
+
+	return (last && last->op == JVM_GOTO ? last : NULL);
+}
+
+static void move_range(IRblock *from, IRinsn *first, IRinsn *last,
+		IRblock *to, IRinsn *at)
+{
+	IRinsn *i, *next;
+
+	for (i = first; ; i = next) {
+		next = i->next;
+		ir_unlink(from, i);
+		ir_link_before(to, at, i);
+		if (i == last) {
+			break;
+		}
+	}
+}
+
+static void copy_range(IRfunc *fn, IRinsn *first, IRinsn *last, IRblock *to,
+		IRinsn *at)
+{
+	IRinsn *i, *copy;
+
+	for (i = first; ; i = i->next) {
+		copy = arena_alloc(fn->arena, sizeof(IRinsn));
+		*copy = *i;
+		ir_link_before(to, at, copy);
+		if (i == last) {
+			break;
+		}
+	}
+}
+
+/* Inserts a new instruction with an integer operand, or none, before another,
+ * or at the end of a block.
+ */
+
+static IRinsn *add_insn(IRfunc *fn, IRblock *bb, IRinsn *at, Bytecode op,
+		int num)
+{
+	IRinsn *i;
+
+	i = arena_alloc(fn->arena, sizeof(IRinsn));
+	i->op = op;
+	i->operand = (op == JVM_IADD || op == JVM_IMUL ? 0 : CODE_INTEGER);
+	i->num = num;
+	i->inc = 0;
+	i->line = (at ? at->line : 0);
+	ir_link_before(bb, at, i);
+
+	return i;
+}
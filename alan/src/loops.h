@@ -0,0 +1,59 @@
+/**
+ * @file    loops.h
+ * @brief   Loop-invariant code motion and strength reduction over the IR.
+ *
+ * Loops are found from the branches back to an earlier block of the layout,
+ * which is how a rotated while loop is laid out, and are optimised innermost
+ * first, provided that control enters them through a single block, from a
+ * block that leads nowhere else.  In that preheader, the loop-invariant
+ * expressions are computed once, into local variables of their own: the pure
+ * arithmetic on variables that the loop does not store, and the elements of
+ * arrays, if the loop neither stores an array element nor passes an array to
+ * a call.  What may throw is only hoisted out of the block through which the
+ * loop is entered, which runs whenever the loop does.  A multiplication of a
+ * basic induction variable, which the loop steps by a constant once, by an
+ * invariant becomes a variable of its own that is stepped along with it.
+ * This is run at optimisation level 2 and above.
+ *
+ * @date    2026-10-14
+ */
+
+#ifndef LOOPS_H
+#define LOOPS_H
+
+#include <stdio.h>
+#include "ir.h"
+
+/** what the loop optimisations did */
+typedef struct {
+	unsigned long loops;      /**< the loops that could be optimised      */
+	unsigned long hoisted;    /**< the invariant expressions hoisted      */
+	unsigned long reduced;    /**< the multiplications strength-reduced  */
+} LoopStats;
+
+/**
+ * Optimises the loops of a function.  The new local variables are allocated
+ * above the existing ones.
+ *
+ * @param[in]   fn
+ *     the IR of the function
+ * @param[in,out]   width
+ *     the number of local variable slots of the function
+ * @param[in,out]   stats
+ *     the statistics, to which the changes are added
+ */
+void optimise_loops(IRfunc *fn, int *width, LoopStats *stats);
+
+/**
+ * Writes what the loop optimisations did, on one line.
+ *
+ * @param[in]   file
+ *     the output file
+ * @param[in]   prefix
+ *     the text that starts the line
+ * @param[in]   stats
+ *     the statistics
+ */
+void print_loop_stats(FILE *file, const char *prefix, const LoopStats *stats);
+
+#endif /* LOOPS_H */
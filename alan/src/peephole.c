@@ -0,0 +1,520 @@
+/**
+ * @file    peephole.c
+ * @brief   A peephole optimiser over the IR of function bodies.
+ * @date    2026-10-14
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include "boolean.h"
+#include "codegen.h"
+#include "ir.h"
+#include "peephole.h"
+#include "runtime.h"
+
+/* --- type definitions and constants --------------------------------------- */
+
+/** a rewriting rule */
+typedef struct {
+	const char *name;      /**< the name of the rule in reports            */
+	Boolean     on_block;  /**< whether the rule applies to a whole block  */
+	int       (*apply)(IRfunc *fn, IRblock *bb, IRinsn *i);
+	                       /**< applies the rule at the last instruction of
+	                            its pattern, or to the end of a block, and
+	                            returns the number of code items removed, or
+	                            -1 if the rule does not apply              */
+} Rule;
+
+/* XXX Note: While a sweep over the blocks is under way, the predecessor
+ * counts are not rebuilt, so the rules that depend on them only rely on the
+ * counts being too high, never too low.  A rule that adds a branch to a block
+ * therefore increments its count, and the graph is rebuilt after every sweep.
+ */
+
+#define IS_PURE_PUSH(op)                                                       \
+	((op) == JVM_LDC || (op) == JVM_ILOAD || (op) == JVM_ALOAD ||              \
+	 (op) == JVM_GETSTATIC)
+
+/* the longest string that printed constants are merged into, which no
+ * constant pool entry can exceed */
+#define MAX_PUT_LENGTH 65535
+
+/* --- function prototypes -------------------------------------------------- */
+
+static int store_load(IRfunc *fn, IRblock *bb, IRinsn *i);
+static int print_swap(IRfunc *fn, IRblock *bb, IRinsn *i);
+static int swap_pushes(IRfunc *fn, IRblock *bb, IRinsn *i);
+static int swap_swap(IRfunc *fn, IRblock *bb, IRinsn *i);
+static int merge_puts(IRfunc *fn, IRblock *bb, IRinsn *i);
+static int branch_chain(IRfunc *fn, IRblock *bb, IRinsn *i);
+static int branch_over_goto(IRfunc *fn, IRblock *bb, IRinsn *i);
+static int goto_next(IRfunc *fn, IRblock *bb, IRinsn *i);
+static int dead_label(IRfunc *fn, IRblock *bb, IRinsn *i);
+static int merge_blocks(IRfunc *fn, IRblock *bb, IRinsn *i);
+static int unreachable(IRfunc *fn, IRblock *bb, IRinsn *i);
+
+static Boolean falls_through(IRblock *bb);
+static unsigned int branch_refs(IRblock *bb);
+static IRblock *final_target(IRfunc *fn, IRblock *bb);
+static void stack_effect(IRinsn *i, int *pop, int *push);
+static Boolean is_runtime_call(IRinsn *i, const char *ref);
+static const char *put_text(IRinsn *call, char *buf);
+
+/* --- global static variables ---------------------------------------------- */
+
+static Rule rules[] = {
+	{"store-load",       FALSE, store_load},
+	{"print-swap",       FALSE, print_swap},
+	{"swap-pushes",      FALSE, swap_pushes},
+	{"swap-swap",        FALSE, swap_swap},
+	{"merge-puts",       FALSE, merge_puts},
+	{"branch-chain",     TRUE,  branch_chain},
+	{"branch-over-goto", TRUE,  branch_over_goto},
+	{"goto-next",        TRUE,  goto_next},
+	{"dead-label",       TRUE,  dead_label},
+	{"merge-blocks",     TRUE,  merge_blocks},
+	{"unreachable",      TRUE,  unreachable}};
+
+#define NRULES (sizeof(rules) / sizeof(Rule))
+
+/* --- peephole interface --------------------------------------------------- */
+
+void peephole(IRfunc *fn, PeepholeStats *stats)
+{
+	IRblock *bb;
+	IRinsn *i, *next;
+	unsigned int r;
+	Boolean changed, again;
+	int n;
+
+	assert(NRULES <= PEEPHOLE_MAX_RULES);
+	ir_build_cfg(fn);
+
+	do {
+		changed = FALSE;
+		for (bb = fn->first; bb; bb = bb->next) {
+			/* the instruction rules only change instructions up to the one at
+			 * which they apply */
+			for (i = bb->first; i; i = next) {
+				next = i->next;
+				for (r = 0; r < NRULES; r++) {
+					if (!rules[r].on_block
+							&& (n = rules[r].apply(fn, bb, i)) >= 0) {
+						stats->applied[r]++;
+						stats->removed[r] += n;
+						changed = TRUE;
+						break;
+					}
+				}
+			}
+
+			/* the block rules change the end of the block, or the block after
+			 * it, so they are repeated until the block settles */
+			do {
+				again = FALSE;
+				for (r = 0; r < NRULES; r++) {
+					if (rules[r].on_block
+							&& (n = rules[r].apply(fn, bb, NULL)) >= 0) {
+						stats->applied[r]++;
+						stats->removed[r] += n;
+						changed = again = TRUE;
+					}
+				}
+			} while (again);
+		}
+		ir_build_cfg(fn);
+	} while (changed);
+}
+
+void print_peephole_stats(FILE *file, const char *prefix,
+		const PeepholeStats *stats)
+{
+	unsigned int r;
+
+	for (r = 0; r < NRULES; r++) {
+		if (stats->applied[r] > 0) {
+			fprintf(file, "%speephole %s: %lu applied, %lu removed\n", prefix,
+					rules[r].name, stats->applied[r], stats->removed[r]);
+		}
+	}
+}
+
+/* --- instruction rules ---------------------------------------------------- */
+
+/* store x; load x => dup; store x */
+
+static int store_load(IRfunc *fn, IRblock *bb, IRinsn *i)
+{
+	IRinsn *p = i->prev;
+
+	(void) fn;
+	(void) bb;
+	if (!p || !((p->op == JVM_ISTORE && i->op == JVM_ILOAD)
+				|| (p->op == JVM_ASTORE && i->op == JVM_ALOAD))
+			|| p->num != i->num) {
+		return -1;
+	}
+	i->op = p->op;
+	p->op = JVM_DUP;
+	p->operand = 0;
+
+	return 0;
+}
+
+/* <value>; getstatic f; swap => getstatic f; <value>
+ *
+ * The value is the code of one expression, found by walking back through the
+ * block until the instructions push exactly one value.  A static field can be
+ * read earlier, since the fields that ALAN reads are final.
+ */
+
+static int print_swap(IRfunc *fn, IRblock *bb, IRinsn *i)
+{
+	IRinsn *g = i->prev, *s;
+	int need, pop, push;
+
+	(void) fn;
+	if (i->op != JVM_SWAP || !g || g->op != JVM_GETSTATIC) {
+		return -1;
+	}
+	need = 1;
+	for (s = g->prev; s; s = s->prev) {
+		stack_effect(s, &pop, &push);
+		if ((need -= push) < 0) {
+			return -1;
+		}
+		if ((need += pop) == 0) {
+			break;
+		}
+	}
+	if (!s) {
+		return -1;
+	}
+	ir_unlink(bb, g);
+	ir_link_before(bb, s, g);
+	ir_unlink(bb, i);
+
+	return 1;
+}
+
+/* <push a>; <push b>; swap => <push b>; <push a> */
+
+static int swap_pushes(IRfunc *fn, IRblock *bb, IRinsn *i)
+{
+	IRinsn *b = i->prev, *a;
+
+	(void) fn;
+	if (i->op != JVM_SWAP || !b || !(a = b->prev) || !IS_PURE_PUSH(a->op)
+			|| !IS_PURE_PUSH(b->op)) {
+		return -1;
+	}
+	ir_unlink(bb, b);
+	ir_link_before(bb, a, b);
+	ir_unlink(bb, i);
+
+	return 1;
+}
+
+/* swap; swap => */
+
+static int swap_swap(IRfunc *fn, IRblock *bb, IRinsn *i)
+{
+	IRinsn *p = i->prev;
+
+	(void) fn;
+	if (i->op != JVM_SWAP || !p || p->op != JVM_SWAP) {
+		return -1;
+	}
+	ir_unlink(bb, p);
+	ir_unlink(bb, i);
+
+	return 2;
+}
+
+/* ldc a; invokestatic write<a>; ldc b; invokestatic write<b>
+ *     => ldc "ab"; invokestatic writeString
+ *
+ * The constants that one or more put statements write one after the other
+ * are written as one string, which the class file holds once however many
+ * times it occurs.  The escape codes of string literals are kept as written,
+ * so the texts are joined as they are.
+ */
+
+static int merge_puts(IRfunc *fn, IRblock *bb, IRinsn *i)
+{
+	char abuf[16], bbuf[16], *s, *ref;
+	const char *a, *b;
+	IRinsn *first;
+	size_t alen, blen, n;
+
+	if (!(b = put_text(i, bbuf)) || !(first = i->prev->prev)
+			|| !(a = put_text(first, abuf))) {
+		return -1;
+	}
+	alen = strlen(a);
+	blen = strlen(b);
+	if (alen + blen > MAX_PUT_LENGTH) {
+		return -1;
+	}
+	s = arena_alloc(fn->arena, alen + blen + 1);
+	memcpy(s, a, alen);
+	memcpy(s + alen, b, blen + 1);
+	first->prev->operand = CODE_STRING;
+	first->prev->string = s;
+
+	/* the reference to writeString is made from that to the other method, in
+	 * the same class, if neither constant is a string */
+	if (is_runtime_call(i, RT_REF_WRITE_STRING)) {
+		first->string = i->string;
+	} else if (!is_runtime_call(first, RT_REF_WRITE_STRING)) {
+		n = (size_t) (strchr(first->string, '/') - first->string);
+		ref = arena_alloc(fn->arena, n + strlen(RT_REF_WRITE_STRING) + 1);
+		memcpy(ref, first->string, n);
+		strcpy(ref + n, RT_REF_WRITE_STRING);
+		first->string = ref;
+	}
+	ir_unlink(bb, i->prev);
+	ir_unlink(bb, i);
+
+	return 2;
+}
+
+/* --- block rules ---------------------------------------------------------- */
+
+/* A branch to an empty block, or to a block that only jumps on, goes to where
+ * control ends up instead.
+ */
+
+static int branch_chain(IRfunc *fn, IRblock *bb, IRinsn *i)
+{
+	IRblock *t;
+
+	(void) i;
+	if (!bb->last || !IS_BRANCH(bb->last->op)) {
+		return -1;
+	}
+	t = final_target(fn, bb->last->target);
+	if (t == bb->last->target) {
+		return -1;
+	}
+	bb->last->target = t;
+	t->npreds++;
+
+	return 0;
+}
+
+/* if<cond> L1; goto L2; L1: => if<not cond> L2; L1: */
+
+static int branch_over_goto(IRfunc *fn, IRblock *bb, IRinsn *i)
+{
+	IRblock *g = bb->next;
+	IRinsn *c = bb->last;
+	int n;
+
+	(void) i;
+	if (!c || !IS_BRANCH(c->op) || c->op == JVM_GOTO || !g || !g->first
+			|| g->first != g->last || g->first->op != JVM_GOTO
+			|| g->npreds != 1 || g->next != c->target) {
+		return -1;
+	}
+	c->op = get_inverse_branch(c->op);
+	c->target = g->first->target;
+	n = 1 + (g->label ? 1 : 0);
+	ir_unlink_block(fn, g);
+
+	return n;
+}
+
+/* goto L; L: => L: */
+
+static int goto_next(IRfunc *fn, IRblock *bb, IRinsn *i)
+{
+	(void) fn;
+	(void) i;
+	if (!bb->last || bb->last->op != JVM_GOTO
+			|| bb->last->target != bb->next) {
+		return -1;
+	}
+	ir_unlink(bb, bb->last);
+
+	return 1;
+}
+
+/* A label to which nothing jumps is dropped. */
+
+static int dead_label(IRfunc *fn, IRblock *bb, IRinsn *i)
+{
+	(void) fn;
+	(void) i;
+	if (bb->label == 0 || branch_refs(bb) > 0) {
+		return -1;
+	}
+	bb->label = 0;
+
+	return 1;
+}
+
+/* A block that is only entered from the one before it joins that block. */
+
+static int merge_blocks(IRfunc *fn, IRblock *bb, IRinsn *i)
+{
+	IRblock *n = bb->next;
+	int removed;
+
+	(void) i;
+	if (!n || !falls_through(bb) || (bb->last && IS_BRANCH(bb->last->op))
+			|| n->npreds != 1) {
+		return -1;
+	}
+	if (n->first) {
+		if (bb->last) {
+			bb->last->next = n->first;
+			n->first->prev = bb->last;
+		} else {
+			bb->first = n->first;
+		}
+		bb->last = n->last;
+	}
+	removed = (n->label ? 1 : 0);
+	ir_unlink_block(fn, n);
+
+	return removed;
+}
+
+/* A block that control cannot reach is removed. */
+
+static int unreachable(IRfunc *fn, IRblock *bb, IRinsn *i)
+{
+	IRblock *n = bb->next;
+	int removed;
+
+	if (!n || n->npreds > 0) {
+		return -1;
+	}
+	removed = (n->label ? 1 : 0);
+	for (i = n->first; i; i = i->next) {
+		removed++;
+	}
+	ir_unlink_block(fn, n);
+
+	return removed;
+}
+
+/* --- utility functions ---------------------------------------------------- */
+
+static Boolean falls_through(IRblock *bb)
+{
+	return (!bb->last || !IS_TERMINAL(bb->last->op));
+}
+
+/* Returns the number of branches to a block, which is the number of its
+ * predecessors, less the block before it if control falls through.
+ */
+
+static unsigned int branch_refs(IRblock *bb)
+{
+	unsigned int n = bb->npreds;
+
+	if (bb->prev && falls_through(bb->prev) && n > 0) {
+		n--;
+	}
+	return n;
+}
+
+/* Follows a block through empty blocks and unconditional jumps to the block in
+ * which control ends up.  A cycle of jumps leaves the block as it is.
+ */
+
+static IRblock *final_target(IRfunc *fn, IRblock *bb)
+{
+	IRblock *t = bb;
+	unsigned int n;
+
+	for (n = 0; n <= fn->nblocks; n++) {
+		if (t->first == NULL && t->next) {
+			t = t->next;
+		} else if (t->first && t->first == t->last
+				&& t->first->op == JVM_GOTO) {
+			t = t->first->target;
+		} else {
+			return t;
+		}
+	}
+	return bb;
+}
+
+/* Works out the stack effect of an instruction, including the calls and field
+ * accesses of which the effect depends on the descriptor.
+ */
+
+static void stack_effect(IRinsn *i, int *pop, int *push)
+{
+	const char *d;
+
+	switch (i->op) {
+		case JVM_GETSTATIC:
+			*pop = 0;
+			*push = 1;
+			break;
+		case JVM_INVOKESTATIC:
+		case JVM_INVOKEVIRTUAL:
+			*pop = (i->op == JVM_INVOKEVIRTUAL ? 1 : 0);
+			d = strchr(i->string, '(');
+			assert(d != NULL);
+			for (d++; *d != ')'; d++) {
+				while (*d == '[') {
+					d++;
+				}
+				if (*d == 'L') {
+					d = strchr(d, ';');
+				}
+				(*pop)++;
+			}
+			*push = (d[1] != 'V');
+			break;
+		default:
+			get_stack_effect(i->op, pop, push);
+			break;
+	}
+}
+
+/* Returns whether an instruction calls a method of the run-time support, of
+ * which the reference ends in the specified name and descriptor.  The
+ * functions of the program are referred to by a dot, never by a slash.
+ */
+
+static Boolean is_runtime_call(IRinsn *i, const char *ref)
+{
+	const char *s;
+
+	if (i->op != JVM_INVOKESTATIC || !(s = strchr(i->string, '/'))) {
+		return FALSE;
+	}
+	return (strcmp(s, ref) == 0);
+}
+
+/* Returns the text that a call to the run-time support writes, if the call
+ * writes a constant that the instruction before it pushes, or NULL otherwise.
+ * The text of an integer is written to a buffer of at least 12 characters.
+ */
+
+static const char *put_text(IRinsn *call, char *buf)
+{
+	IRinsn *p = call->prev;
+
+	if (!p || p->op != JVM_LDC) {
+		return NULL;
+	}
+	if (p->operand == CODE_STRING) {
+		return (is_runtime_call(call, RT_REF_WRITE_STRING) ? p->string : NULL);
+	}
+	if (is_runtime_call(call, RT_REF_WRITE_INTEGER)) {
+		sprintf(buf, "%d", p->num);
+		return buf;
+	}
+	if (is_runtime_call(call, RT_REF_WRITE_BOOLEAN)) {
+		return (p->num ? "true" : "false");
+	}
+	return NULL;
+}
@@ -0,0 +1,52 @@
+/**
+ * @file    peephole.h
+ * @brief   A peephole optimiser over the IR of function bodies.
+ *
+ * The optimiser rewrites short instruction sequences, and the branches and
+ * labels between blocks, by a table of rules, which are applied until none
+ * of them applies any more.  It is run at optimisation level 1 and above.
+ *
+ * @date    2026-10-14
+ */
+
+#ifndef PEEPHOLE_H
+#define PEEPHOLE_H
+
+#include <stdio.h>
+#include "ir.h"
+
+/** the largest number of rules that the statistics have room for */
+#define PEEPHOLE_MAX_RULES 16
+
+/** the number of times that every rule applied, and what it removed */
+typedef struct {
+	unsigned long applied[PEEPHOLE_MAX_RULES]; /**< the applications       */
+	unsigned long removed[PEEPHOLE_MAX_RULES]; /**< the code items removed */
+} PeepholeStats;
+
+/**
+ * Optimises the IR of a function.  The control-flow graph is rebuilt as the
+ * rules change it, and is current when the function returns.
+ *
+ * @param[in]   fn
+ *     the IR of the function
+ * @param[in,out]   stats
+ *     the statistics, to which the rules that applied are added
+ */
+void peephole(IRfunc *fn, PeepholeStats *stats);
+
+/**
+ * Writes the rules that applied, with the number of times and the number of
+ * code items (instructions and labels) they removed, one rule per line.
+ *
+ * @param[in]   file
+ *     the output file
+ * @param[in]   prefix
+ *     the text that starts every line
+ * @param[in]   stats
+ *     the statistics
+ */
+void print_peephole_stats(FILE *file, const char *prefix,
+		const PeepholeStats *stats);
+
+#endif /* PEEPHOLE_H */
@@ -0,0 +1,1270 @@
+/**
+ * @file    runtime.c
+ * @brief   The run-time support that is written into every ALAN class.
+ * @date    2026-10-14
+ */
+
+#include <assert.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include "boolean.h"
+#include "classfile.h"
+#include "dataflow.h"
+#include "error.h"
+#include "jvm.h"
+#include "runtime.h"
+
+/* --- type definitions and constants --------------------------------------- */
+
+/** the size of the input and output buffers, in bytes */
+#define RT_BUFFER_SIZE    65536
+
+/** the most bytes that writeInt adds: a sign and ten digits */
+#define RT_INTEGER_WIDTH  11
+
+/** the first line of a profile, which names the columns of the others */
+#define RT_PROFILE_HEADER "# alanc profile 1: kind name line count ns"
+
+#define RT_MAX_LABELS     16
+#define RT_MAX_BRANCHES   16
+#define RT_MAX_TYPES      128
+
+/** the kinds of entries in the code of a run-time method */
+typedef enum {
+	RT_OP,          /**< an instruction without operands                */
+	RT_LOCAL,       /**< a load or store of one of the first four slots */
+	RT_CONST,       /**< an integer constant, in the shortest form      */
+	RT_STRING,      /**< a string constant                              */
+	RT_IINC,        /**< an increment of a local variable               */
+	RT_FIELD,       /**< an access of a field of the class              */
+	RT_SYSFIELD,    /**< a read of a field of another class             */
+	RT_CALL,        /**< a call of a method of the class                */
+	RT_INVOKE,      /**< a call of a method of another class            */
+	RT_NEW,         /**< the creation of an object                      */
+	RT_ARRAY,       /**< the creation of an array of a primitive type   */
+	RT_NPOINTS,     /**< the number of profiled points, as a constant   */
+	RT_POINTS,      /**< the profiled points, as a string constant      */
+	RT_PATH,        /**< the file name of the profile, as a string      */
+	RT_BRANCH,      /**< a branch to a label                            */
+	RT_LABEL,       /**< a label, with the frame that holds there       */
+	RT_END          /**< the end of the code                            */
+} RTkind;
+
+/** an entry in the code of a run-time method */
+typedef struct {
+	RTkind        kind;     /**< the kind of entry                          */
+	JVMopcode     op;       /**< the opcode, or that of slot 0 for a local  */
+	const char   *name;     /**< the Jasmin mnemonic                        */
+	const char   *arg;      /**< the reference, string, or frame, written
+	                             as the local variable types, a bar, and
+	                             the stack types, as in descriptors         */
+	int           num;      /**< the constant, slot, label, or array type   */
+	int           inc;      /**< the increment of an iinc                   */
+	unsigned int  cond;     /**< the uses that the entry needs, or 0        */
+} RTinsn;
+
+/** a method of the run-time support */
+typedef struct {
+	const char   *name;     /**< the method name                            */
+	const char   *desc;     /**< the method descriptor                      */
+	unsigned int  flags;    /**< the access flags                           */
+	unsigned int  needs;    /**< the uses that need the method, or 0        */
+	int           stack;    /**< the maximum operand stack depth            */
+	int           locals;   /**< the size of the local variable array       */
+	const RTinsn *code;     /**< the code                                   */
+	int           from;     /**< the label where the handler starts, or 0   */
+	int           to;       /**< the label where the handler ends           */
+	int           handler;  /**< the label of the handler                   */
+	const char   *caught;   /**< the class of the exceptions caught         */
+} RTmethod;
+
+/** a field of the run-time support */
+typedef struct {
+	const char   *name;     /**< the field name                             */
+	const char   *desc;     /**< the field descriptor                       */
+	unsigned int  needs;    /**< the uses that need the field               */
+} RTfield;
+
+#define OP(op, name)        {RT_OP, op, name, NULL, 0, 0, 0}
+#define LOCAL(op, name, n)  {RT_LOCAL, op, name, NULL, n, 0, 0}
+#define CONST(n)            {RT_CONST, OP_LDC, "ldc", NULL, n, 0, 0}
+#define STRING(s)           {RT_STRING, OP_LDC, "ldc", s, 0, 0, 0}
+#define IINC(n, k)          {RT_IINC, OP_IINC, "iinc", NULL, n, k, 0}
+#define GET(f)              {RT_FIELD, OP_GETSTATIC, "getstatic", f, 0, 0, 0}
+#define PUT(f)              {RT_FIELD, OP_PUTSTATIC, "putstatic", f, 0, 0, 0}
+#define SYSFIELD(f)         {RT_SYSFIELD, OP_GETSTATIC, "getstatic", f, 0, 0, 0}
+#define CALL(m)             {RT_CALL, OP_INVOKESTATIC, "invokestatic", m, 0,  \
+                             0, 0}
+#define CALL_IF(m, uses)    {RT_CALL, OP_INVOKESTATIC, "invokestatic", m, 0,  \
+                             0, uses}
+#define VIRTUAL(m)          {RT_INVOKE, OP_INVOKEVIRTUAL, "invokevirtual", m, \
+                             0, 0, 0}
+#define SPECIAL(m)          {RT_INVOKE, OP_INVOKESPECIAL, "invokespecial", m, \
+                             0, 0, 0}
+#define SYSCALL(m)          {RT_INVOKE, OP_INVOKESTATIC, "invokestatic", m,   \
+                             0, 0, 0}
+#define NEW(c)              {RT_NEW, OP_NEW, "new", c, 0, 0, 0}
+#define NEWARRAY(t, name)   {RT_ARRAY, OP_NEWARRAY, "newarray", name, t, 0, 0}
+#define NPOINTS             {RT_NPOINTS, OP_LDC, "ldc", NULL, 0, 0, 0}
+#define POINTS              {RT_POINTS, OP_LDC, "ldc", NULL, 0, 0, 0}
+#define PATH                {RT_PATH, OP_LDC, "ldc", NULL, 0, 0, 0}
+#define BRANCH(op, name, l) {RT_BRANCH, op, name, NULL, l, 0, 0}
+#define LABEL(l, frame)     {RT_LABEL, 0, NULL, frame, l, 0, 0}
+#define END                 {RT_END, 0, NULL, NULL, 0, 0, 0}
+
+#define ILOAD(n)            LOCAL(OP_ILOAD_0, "iload", n)
+#define ISTORE(n)           LOCAL(OP_ISTORE_0, "istore", n)
+#define ALOAD(n)            LOCAL(OP_ALOAD_0, "aload", n)
+#define ASTORE(n)           LOCAL(OP_ASTORE_0, "astore", n)
+#define BYTES               NEWARRAY(T_BYTE, "byte")
+
+#define FLUSH               "flushOutput()V"
+#define READ_BYTE           "readByte()I"
+#define PROFILE_INIT        "profInit()V"
+#define PROFILE_DUMP        "profDump()V"
+#define PRINT_STREAM        "java/io/PrintStream"
+#define NANO_TIME           "java/lang/System/nanoTime()J"
+#define MISMATCH            "java/util/InputMismatchException"
+#define NO_SUCH_ELEMENT     "java/util/NoSuchElementException"
+#define BUILDER             "java/lang/StringBuilder"
+#define SPLIT                                                                  \
+	"java/lang/String/split(Ljava/lang/String;)[Ljava/lang/String;"
+#define EQUALS_IGNORE_CASE                                                     \
+	"java/lang/String/equalsIgnoreCase(Ljava/lang/String;)Z"
+
+/** the types of a frame, as one descriptor string */
+typedef struct {
+	char types[RT_MAX_TYPES];
+} Types;
+
+/* --- function prototypes -------------------------------------------------- */
+
+static void dump_method(ByteBuf *out, const char *class_name,
+		const RTmethod *rm, const RTprogram *program);
+static void dump_label(ByteBuf *out, const char *before, int label);
+static void dump_points(ByteBuf *out, const char *points);
+static void emit_method(ClassFile *cf, const char *class_name,
+		const RTmethod *rm, const RTprogram *program);
+static void emit_frame(ClassFile *cf, ByteBuf *smt, Types *prev,
+		const char *frame, long delta);
+static void emit_types(ClassFile *cf, ByteBuf *smt, const char *types);
+static int count_types(const char *types);
+static const char *next_type(const char *d);
+static unsigned int member_ref(ClassFile *cf, const char *class_name,
+		const RTinsn *i);
+static Boolean included(unsigned int needs, unsigned int uses);
+static char *profile_path(const char *class_name);
+
+/* --- the run-time support ------------------------------------------------- */
+
+static const RTfield fields[] = {
+	{"inbuf",  "[B", RT_INPUT},
+	{"inpos",  "I",  RT_INPUT},
+	{"inlen",  "I",  RT_INPUT},
+	{"outbuf", "[B", RT_OUTPUT},
+	{"outpos", "I",  RT_OUTPUT},
+	{"profCount", "[J", RT_PROFILE},
+	{"profTime",  "[J", RT_PROFILE},
+	{"profStart", "[J", RT_PROFILE},
+	{"profDepth", "[I", RT_PROFILE}};
+
+#define NFIELDS (sizeof(fields) / sizeof(RTfield))
+
+/* outbuf = new byte[RT_BUFFER_SIZE]; */
+static const RTinsn clinit_code[] = {
+	CONST(RT_BUFFER_SIZE),
+	BYTES,
+	PUT("outbuf [B"),
+	OP(OP_RETURN, "return"),
+	END};
+
+static const RTinsn init_code[] = {
+	ALOAD(0),
+	SPECIAL("java/lang/Object/<init>()V"),
+	OP(OP_RETURN, "return"),
+	END};
+
+/* profInit(); try { main$(args); } finally { flushOutput(); profDump(); } */
+static const RTinsn main_code[] = {
+	CALL_IF(PROFILE_INIT, RT_PROFILE),
+	LABEL(1, NULL),
+	ALOAD(0),
+	CALL(RT_MAIN_NAME "([Ljava/lang/String;)V"),
+	LABEL(2, NULL),
+	CALL_IF(FLUSH, RT_OUTPUT),
+	CALL_IF(PROFILE_DUMP, RT_PROFILE),
+	OP(OP_RETURN, "return"),
+	LABEL(3, "[Ljava/lang/String;|Ljava/lang/Throwable;"),
+	CALL_IF(FLUSH, RT_OUTPUT),
+	CALL_IF(PROFILE_DUMP, RT_PROFILE),
+	OP(OP_ATHROW, "athrow"),
+	END};
+
+/* System.out.write(outbuf, 0, outpos); System.out.flush(); outpos = 0; */
+static const RTinsn flush_code[] = {
+	SYSFIELD("java/lang/System/out Ljava/io/PrintStream;"),
+	GET("outbuf [B"),
+	CONST(0),
+	GET("outpos I"),
+	VIRTUAL("java/io/PrintStream/write([BII)V"),
+	SYSFIELD("java/lang/System/out Ljava/io/PrintStream;"),
+	VIRTUAL("java/io/PrintStream/flush()V"),
+	CONST(0),
+	PUT("outpos I"),
+	OP(OP_RETURN, "return"),
+	END};
+
+/* for (i = 0, n = s.length(); i < n; i++) {
+ *     if (outpos >= RT_BUFFER_SIZE) flushOutput();
+ *     outbuf[outpos++] = (byte) s.charAt(i);
+ * }
+ * ALAN strings only hold printable ASCII characters. */
+static const RTinsn write_string_code[] = {
+	ALOAD(0),
+	VIRTUAL("java/lang/String/length()I"),
+	ISTORE(2),
+	CONST(0),
+	ISTORE(1),
+	BRANCH(OP_GOTO, "goto", 3),
+	LABEL(1, "Ljava/lang/String;II|"),
+	GET("outpos I"),
+	CONST(RT_BUFFER_SIZE),
+	BRANCH(OP_IF_ICMPLT, "if_icmplt", 2),
+	CALL(FLUSH),
+	LABEL(2, "Ljava/lang/String;II|"),
+	GET("outbuf [B"),
+	GET("outpos I"),
+	OP(OP_DUP, "dup"),
+	CONST(1),
+	OP(OP_IADD, "iadd"),
+	PUT("outpos I"),
+	ALOAD(0),
+	ILOAD(1),
+	VIRTUAL("java/lang/String/charAt(I)C"),
+	OP(OP_BASTORE, "bastore"),
+	IINC(1, 1),
+	LABEL(3, "Ljava/lang/String;II|"),
+	ILOAD(1),
+	ILOAD(2),
+	BRANCH(OP_IF_ICMPLT, "if_icmplt", 1),
+	OP(OP_RETURN, "return"),
+	END};
+
+/* The digits are those of the negated value, so that the smallest integer
+ * needs no special case:
+ *
+ * if (outpos > RT_BUFFER_SIZE - RT_INTEGER_WIDTH) flushOutput();
+ * if (n < 0) outbuf[outpos++] = '-'; else n = -n;
+ * for (k = 1, t = n; t <= -10; k++) t /= 10;
+ * i = outpos += k;
+ * do { outbuf[--i] = '0' - n % 10; } while ((n /= 10) != 0);
+ */
+static const RTinsn write_int_code[] = {
+	GET("outpos I"),
+	CONST(RT_BUFFER_SIZE - RT_INTEGER_WIDTH),
+	BRANCH(OP_IF_ICMPLE, "if_icmple", 1),
+	CALL(FLUSH),
+	LABEL(1, "I|"),
+	ILOAD(0),
+	BRANCH(OP_IFLT, "iflt", 2),
+	ILOAD(0),
+	OP(OP_INEG, "ineg"),
+	ISTORE(0),
+	BRANCH(OP_GOTO, "goto", 3),
+	LABEL(2, "I|"),
+	GET("outbuf [B"),
+	GET("outpos I"),
+	OP(OP_DUP, "dup"),
+	CONST(1),
+	OP(OP_IADD, "iadd"),
+	PUT("outpos I"),
+	CONST('-'),
+	OP(OP_BASTORE, "bastore"),
+	LABEL(3, "I|"),
+	CONST(1),
+	ISTORE(1),
+	ILOAD(0),
+	ISTORE(2),
+	BRANCH(OP_GOTO, "goto", 5),
+	LABEL(4, "III|"),
+	ILOAD(2),
+	CONST(10),
+	OP(OP_IDIV, "idiv"),
+	ISTORE(2),
+	IINC(1, 1),
+	LABEL(5, "III|"),
+	ILOAD(2),
+	CONST(-10),
+	BRANCH(OP_IF_ICMPLE, "if_icmple", 4),
+	GET("outpos I"),
+	ILOAD(1),
+	OP(OP_IADD, "iadd"),
+	OP(OP_DUP, "dup"),
+	PUT("outpos I"),
+	ISTORE(3),
+	LABEL(6, "IIII|"),
+	GET("outbuf [B"),
+	IINC(3, -1),
+	ILOAD(3),
+	CONST('0'),
+	ILOAD(0),
+	CONST(10),
+	OP(OP_IREM, "irem"),
+	OP(OP_ISUB, "isub"),
+	OP(OP_BASTORE, "bastore"),
+	ILOAD(0),
+	CONST(10),
+	OP(OP_IDIV, "idiv"),
+	OP(OP_DUP, "dup"),
+	ISTORE(0),
+	BRANCH(OP_IFNE, "ifne", 6),
+	OP(OP_RETURN, "return"),
+	END};
+
+/* writeString(b ? "true" : "false"); */
+static const RTinsn write_boolean_code[] = {
+	ILOAD(0),
+	BRANCH(OP_IFEQ, "ifeq", 1),
+	STRING("true"),
+	CALL("writeString(Ljava/lang/String;)V"),
+	OP(OP_RETURN, "return"),
+	LABEL(1, "I|"),
+	STRING("false"),
+	CALL("writeString(Ljava/lang/String;)V"),
+	OP(OP_RETURN, "return"),
+	END};
+
+/* Returns the next byte of input, from 0 to 255, or -1 at the end:
+ *
+ * if (inpos >= inlen) {
+ *     flushOutput();
+ *     if (inbuf == null) inbuf = new byte[RT_BUFFER_SIZE];
+ *     inpos = 0;
+ *     if ((inlen = System.in.read(inbuf, 0, RT_BUFFER_SIZE)) <= 0) {
+ *         inlen = 0;
+ *         return -1;
+ *     }
+ * }
+ * return inbuf[inpos++] & 0xff;
+ */
+static const RTinsn read_byte_code[] = {
+	GET("inpos I"),
+	GET("inlen I"),
+	BRANCH(OP_IF_ICMPLT, "if_icmplt", 2),
+	CALL_IF(FLUSH, RT_OUTPUT),
+	GET("inbuf [B"),
+	BRANCH(OP_IFNONNULL, "ifnonnull", 1),
+	CONST(RT_BUFFER_SIZE),
+	BYTES,
+	PUT("inbuf [B"),
+	LABEL(1, "|"),
+	CONST(0),
+	PUT("inpos I"),
+	SYSFIELD("java/lang/System/in Ljava/io/InputStream;"),
+	GET("inbuf [B"),
+	CONST(0),
+	CONST(RT_BUFFER_SIZE),
+	VIRTUAL("java/io/InputStream/read([BII)I"),
+	OP(OP_DUP, "dup"),
+	PUT("inlen I"),
+	BRANCH(OP_IFGT, "ifgt", 2),
+	CONST(0),
+	PUT("inlen I"),
+	CONST(-1),
+	OP(OP_IRETURN, "ireturn"),
+	LABEL(2, "|"),
+	GET("inbuf [B"),
+	GET("inpos I"),
+	OP(OP_DUP, "dup"),
+	CONST(1),
+	OP(OP_IADD, "iadd"),
+	PUT("inpos I"),
+	OP(OP_BALOAD, "baload"),
+	CONST(0xff),
+	OP(OP_IAND, "iand"),
+	OP(OP_IRETURN, "ireturn"),
+	END};
+
+/* Returns the first byte of input that is not white space, or -1. */
+static const RTinsn skip_space_code[] = {
+	LABEL(1, "|"),
+	CALL(READ_BYTE),
+	OP(OP_DUP, "dup"),
+	CONST(' '),
+	BRANCH(OP_IF_ICMPGT, "if_icmpgt", 2),
+	OP(OP_DUP, "dup"),
+	BRANCH(OP_IFLT, "iflt", 2),
+	OP(OP_POP, "pop"),
+	BRANCH(OP_GOTO, "goto", 1),
+	LABEL(2, "|I"),
+	OP(OP_IRETURN, "ireturn"),
+	END};
+
+/* The value is accumulated negated, so that the smallest integer can be read:
+ *
+ * c = skipSpace();
+ * if (c < 0) throw new NoSuchElementException();
+ * neg = 0;
+ * if (c == '-') neg = 1;
+ * if (c == '-' || c == '+') c = readByte();
+ * if (c < '0' || c > '9') throw new InputMismatchException();
+ * n = 0;
+ * do {
+ *     if (n < MIN_VALUE / 10 || n * 10 < MIN_VALUE + c - '0')
+ *         throw new InputMismatchException();
+ *     n = n * 10 + '0' - c;
+ *     c = readByte();
+ * } while (c >= '0' && c <= '9');
+ * if (c > ' ') throw new InputMismatchException();
+ * if (neg == 0 && n == MIN_VALUE) throw new InputMismatchException();
+ * return (neg != 0 ? n : -n);
+ *
+ * As with Scanner.nextInt, the digits must end at white space or at the end of
+ * the input, and a value outside the range of int is a mismatch.  The white
+ * space that ends them is consumed, as skipSpace would consume it anyway.
+ */
+static const RTinsn read_int_code[] = {
+	CALL("skipSpace()I"),
+	ISTORE(0),
+	ILOAD(0),
+	BRANCH(OP_IFLT, "iflt", 8),
+	CONST(0),
+	ISTORE(1),
+	ILOAD(0),
+	CONST('+'),
+	BRANCH(OP_IF_ICMPEQ, "if_icmpeq", 6),
+	ILOAD(0),
+	CONST('-'),
+	BRANCH(OP_IF_ICMPNE, "if_icmpne", 1),
+	CONST(1),
+	ISTORE(1),
+	LABEL(6, "II|"),
+	CALL(READ_BYTE),
+	ISTORE(0),
+	LABEL(1, "II|"),
+	ILOAD(0),
+	CONST('0'),
+	BRANCH(OP_IF_ICMPLT, "if_icmplt", 5),
+	ILOAD(0),
+	CONST('9'),
+	BRANCH(OP_IF_ICMPGT, "if_icmpgt", 5),
+	CONST(0),
+	ISTORE(2),
+	LABEL(2, "III|"),
+	ILOAD(2),
+	CONST(INT_MIN / 10),
+	BRANCH(OP_IF_ICMPLT, "if_icmplt", 5),
+	ILOAD(2),
+	CONST(10),
+	OP(OP_IMUL, "imul"),
+	OP(OP_DUP, "dup"),
+	CONST(INT_MIN),
+	ILOAD(0),
+	OP(OP_IADD, "iadd"),
+	CONST('0'),
+	OP(OP_ISUB, "isub"),
+	BRANCH(OP_IF_ICMPLT, "if_icmplt", 7),
+	CONST('0'),
+	OP(OP_IADD, "iadd"),
+	ILOAD(0),
+	OP(OP_ISUB, "isub"),
+	ISTORE(2),
+	CALL(READ_BYTE),
+	OP(OP_DUP, "dup"),
+	ISTORE(0),
+	CONST('0'),
+	BRANCH(OP_IF_ICMPLT, "if_icmplt", 3),
+	ILOAD(0),
+	CONST('9'),
+	BRANCH(OP_IF_ICMPLE, "if_icmple", 2),
+	LABEL(3, "III|"),
+	ILOAD(0),
+	CONST(' '),
+	BRANCH(OP_IF_ICMPGT, "if_icmpgt", 5),
+	ILOAD(1),
+	BRANCH(OP_IFNE, "ifne", 4),
+	ILOAD(2),
+	CONST(INT_MIN),
+	BRANCH(OP_IF_ICMPEQ, "if_icmpeq", 5),
+	ILOAD(2),
+	OP(OP_INEG, "ineg"),
+	OP(OP_IRETURN, "ireturn"),
+	LABEL(4, "III|"),
+	ILOAD(2),
+	OP(OP_IRETURN, "ireturn"),
+	LABEL(7, "III|I"),
+	OP(OP_POP, "pop"),
+	LABEL(5, "II|"),
+	NEW(MISMATCH),
+	OP(OP_DUP, "dup"),
+	SPECIAL(MISMATCH "/<init>()V"),
+	OP(OP_ATHROW, "athrow"),
+	LABEL(8, "I|"),
+	NEW(NO_SUCH_ELEMENT),
+	OP(OP_DUP, "dup"),
+	SPECIAL(NO_SUCH_ELEMENT "/<init>()V"),
+	OP(OP_ATHROW, "athrow"),
+	END};
+
+/* c = skipSpace();
+ * if (c < 0) throw new NoSuchElementException();
+ * for (sb = new StringBuilder(); c > ' '; c = readByte()) sb.append((char) c);
+ * s = sb.toString();
+ * if (s.equalsIgnoreCase("true")) return true;
+ * if (s.equalsIgnoreCase("false")) return false;
+ * throw new InputMismatchException();
+ */
+static const RTinsn read_boolean_code[] = {
+	CALL("skipSpace()I"),
+	ISTORE(0),
+	ILOAD(0),
+	BRANCH(OP_IFLT, "iflt", 5),
+	NEW(BUILDER),
+	OP(OP_DUP, "dup"),
+	SPECIAL(BUILDER "/<init>()V"),
+	ASTORE(1),
+	BRANCH(OP_GOTO, "goto", 2),
+	LABEL(1, "IL" BUILDER ";|"),
+	ALOAD(1),
+	ILOAD(0),
+	VIRTUAL(BUILDER "/append(C)L" BUILDER ";"),
+	OP(OP_POP, "pop"),
+	CALL(READ_BYTE),
+	ISTORE(0),
+	LABEL(2, "IL" BUILDER ";|"),
+	ILOAD(0),
+	CONST(' '),
+	BRANCH(OP_IF_ICMPGT, "if_icmpgt", 1),
+	ALOAD(1),
+	VIRTUAL(BUILDER "/toString()Ljava/lang/String;"),
+	OP(OP_DUP, "dup"),
+	STRING("true"),
+	VIRTUAL(EQUALS_IGNORE_CASE),
+	BRANCH(OP_IFEQ, "ifeq", 3),
+	OP(OP_POP, "pop"),
+	CONST(1),
+	OP(OP_IRETURN, "ireturn"),
+	LABEL(3, "IL" BUILDER ";|Ljava/lang/String;"),
+	STRING("false"),
+	VIRTUAL(EQUALS_IGNORE_CASE),
+	BRANCH(OP_IFEQ, "ifeq", 4),
+	CONST(0),
+	OP(OP_IRETURN, "ireturn"),
+	LABEL(4, "IL" BUILDER ";|"),
+	NEW(MISMATCH),
+	OP(OP_DUP, "dup"),
+	SPECIAL(MISMATCH "/<init>()V"),
+	OP(OP_ATHROW, "athrow"),
+	LABEL(5, "I|"),
+	NEW(NO_SUCH_ELEMENT),
+	OP(OP_DUP, "dup"),
+	SPECIAL(NO_SUCH_ELEMENT "/<init>()V"),
+	OP(OP_ATHROW, "athrow"),
+	END};
+
+/* profCount = new long[n]; profTime = new long[n]; profStart = new long[n];
+ * profDepth = new int[n]; */
+static const RTinsn profile_init_code[] = {
+	NPOINTS,
+	NEWARRAY(T_LONG, "long"),
+	PUT("profCount [J"),
+	NPOINTS,
+	NEWARRAY(T_LONG, "long"),
+	PUT("profTime [J"),
+	NPOINTS,
+	NEWARRAY(T_LONG, "long"),
+	PUT("profStart [J"),
+	NPOINTS,
+	NEWARRAY(T_INT, "int"),
+	PUT("profDepth [I"),
+	OP(OP_RETURN, "return"),
+	END};
+
+/* A recursive function is timed from its outermost call only:
+ *
+ * profCount[p]++;
+ * d = profDepth[p];
+ * profDepth[p] = d + 1;
+ * if (d == 0) profStart[p] = System.nanoTime();
+ */
+static const RTinsn profile_enter_code[] = {
+	GET("profCount [J"),
+	ILOAD(0),
+	OP(OP_DUP2, "dup2"),
+	OP(OP_LALOAD, "laload"),
+	OP(OP_LCONST_1, "lconst_1"),
+	OP(OP_LADD, "ladd"),
+	OP(OP_LASTORE, "lastore"),
+	GET("profDepth [I"),
+	ILOAD(0),
+	OP(OP_IALOAD, "iaload"),
+	ISTORE(1),
+	GET("profDepth [I"),
+	ILOAD(0),
+	ILOAD(1),
+	CONST(1),
+	OP(OP_IADD, "iadd"),
+	OP(OP_IASTORE, "iastore"),
+	ILOAD(1),
+	BRANCH(OP_IFNE, "ifne", 1),
+	GET("profStart [J"),
+	ILOAD(0),
+	SYSCALL(NANO_TIME),
+	OP(OP_LASTORE, "lastore"),
+	LABEL(1, "II|"),
+	OP(OP_RETURN, "return"),
+	END};
+
+/* if (--profDepth[p] == 0) profTime[p] += System.nanoTime() - profStart[p]; */
+static const RTinsn profile_exit_code[] = {
+	GET("profDepth [I"),
+	ILOAD(0),
+	OP(OP_DUP2, "dup2"),
+	OP(OP_IALOAD, "iaload"),
+	CONST(1),
+	OP(OP_ISUB, "isub"),
+	OP(OP_DUP_X2, "dup_x2"),
+	OP(OP_IASTORE, "iastore"),
+	BRANCH(OP_IFNE, "ifne", 1),
+	GET("profTime [J"),
+	ILOAD(0),
+	OP(OP_DUP2, "dup2"),
+	OP(OP_LALOAD, "laload"),
+	SYSCALL(NANO_TIME),
+	GET("profStart [J"),
+	ILOAD(0),
+	OP(OP_LALOAD, "laload"),
+	OP(OP_LSUB, "lsub"),
+	OP(OP_LADD, "ladd"),
+	OP(OP_LASTORE, "lastore"),
+	LABEL(1, "I|"),
+	OP(OP_RETURN, "return"),
+	END};
+
+/* profCount[p]++; */
+static const RTinsn profile_loop_code[] = {
+	GET("profCount [J"),
+	ILOAD(0),
+	OP(OP_DUP2, "dup2"),
+	OP(OP_LALOAD, "laload"),
+	OP(OP_LCONST_1, "lconst_1"),
+	OP(OP_LADD, "ladd"),
+	OP(OP_LASTORE, "lastore"),
+	OP(OP_RETURN, "return"),
+	END};
+
+/* The points are compiled into the class as one string, of which each line
+ * ends up before the counts of its point:
+ *
+ * k = "<points>".split("\\n");
+ * out = new PrintStream("<class>.prof");
+ * out.println("# alanc profile 1: <kind> <name> <line> <count> <ns>");
+ * for (i = 0; i < k.length; i++) {
+ *     out.print(k[i]); out.print(' '); out.print(profCount[i]);
+ *     out.print(' '); out.println(profTime[i]);
+ * }
+ * out.close();
+ */
+static const RTinsn profile_dump_code[] = {
+	POINTS,
+	STRING("\\n"),
+	VIRTUAL(SPLIT),
+	ASTORE(0),
+	NEW(PRINT_STREAM),
+	OP(OP_DUP, "dup"),
+	PATH,
+	SPECIAL(PRINT_STREAM "/<init>(Ljava/lang/String;)V"),
+	ASTORE(1),
+	ALOAD(1),
+	STRING(RT_PROFILE_HEADER),
+	VIRTUAL(PRINT_STREAM "/println(Ljava/lang/String;)V"),
+	CONST(0),
+	ISTORE(2),
+	BRANCH(OP_GOTO, "goto", 2),
+	LABEL(1, "[Ljava/lang/String;L" PRINT_STREAM ";I|"),
+	ALOAD(1),
+	ALOAD(0),
+	ILOAD(2),
+	OP(OP_AALOAD, "aaload"),
+	VIRTUAL(PRINT_STREAM "/print(Ljava/lang/String;)V"),
+	ALOAD(1),
+	CONST(' '),
+	VIRTUAL(PRINT_STREAM "/print(C)V"),
+	ALOAD(1),
+	GET("profCount [J"),
+	ILOAD(2),
+	OP(OP_LALOAD, "laload"),
+	VIRTUAL(PRINT_STREAM "/print(J)V"),
+	ALOAD(1),
+	CONST(' '),
+	VIRTUAL(PRINT_STREAM "/print(C)V"),
+	ALOAD(1),
+	GET("profTime [J"),
+	ILOAD(2),
+	OP(OP_LALOAD, "laload"),
+	VIRTUAL(PRINT_STREAM "/println(J)V"),
+	IINC(2, 1),
+	LABEL(2, "[Ljava/lang/String;L" PRINT_STREAM ";I|"),
+	ILOAD(2),
+	ALOAD(0),
+	OP(OP_ARRAYLENGTH, "arraylength"),
+	BRANCH(OP_IF_ICMPLT, "if_icmplt", 1),
+	ALOAD(1),
+	VIRTUAL(PRINT_STREAM "/close()V"),
+	OP(OP_RETURN, "return"),
+	END};
+
+#define HELPER (ACC_PRIVATE | ACC_STATIC)
+
+static const RTmethod methods[] = {
+	{"<clinit>", "()V", ACC_STATIC, RT_OUTPUT, 1, 0, clinit_code,
+	 0, 0, 0, NULL},
+	{"<init>", "()V", ACC_PUBLIC, 0, 1, 1, init_code,
+	 0, 0, 0, NULL},
+	{"main", "([Ljava/lang/String;)V", ACC_PUBLIC | ACC_STATIC,
+	 RT_OUTPUT | RT_PROFILE, 1, 1, main_code, 1, 2, 3,
+	 "java/lang/Throwable"},
+	{"flushOutput", "()V", HELPER, RT_OUTPUT, 4, 0, flush_code,
+	 0, 0, 0, NULL},
+	{"writeString", "(Ljava/lang/String;)V", HELPER,
+	 RT_WRITE_STRING | RT_WRITE_BOOLEAN, 4, 3, write_string_code,
+	 0, 0, 0, NULL},
+	{"writeInt", "(I)V", HELPER, RT_WRITE_INTEGER, 5, 4, write_int_code,
+	 0, 0, 0, NULL},
+	{"writeBoolean", "(Z)V", HELPER, RT_WRITE_BOOLEAN, 1, 1,
+	 write_boolean_code, 0, 0, 0, NULL},
+	{"readByte", "()I", HELPER, RT_INPUT, 4, 0, read_byte_code,
+	 0, 0, 0, NULL},
+	{"skipSpace", "()I", HELPER, RT_INPUT, 3, 0, skip_space_code,
+	 0, 0, 0, NULL},
+	{"readInt", "()I", HELPER, RT_READ_INTEGER, 4, 3, read_int_code,
+	 0, 0, 0, NULL},
+	{"readBoolean", "()Z", HELPER, RT_READ_BOOLEAN, 3, 2, read_boolean_code,
+	 0, 0, 0, NULL},
+	{"profInit", "()V", HELPER, RT_PROFILE, 1, 0, profile_init_code,
+	 0, 0, 0, NULL},
+	{"profEnter", "(I)V", HELPER, RT_PROFILE, 6, 2,
+	 profile_enter_code, 0, 0, 0, NULL},
+	{"profExit", "(I)V", HELPER, RT_PROFILE, 8, 1,
+	 profile_exit_code, 0, 0, 0, NULL},
+	{"profLoop", "(I)V", HELPER, RT_PROFILE, 6, 1,
+	 profile_loop_code, 0, 0, 0, NULL},
+	{"profDump", "()V", HELPER, RT_PROFILE, 3, 3, profile_dump_code,
+	 0, 0, 0, NULL}};
+
+#define NMETHODS (sizeof(methods) / sizeof(RTmethod))
+
+/* --- run-time support interface ------------------------------------------- */
+
+void dump_runtime(ByteBuf *out, const char *class_name,
+		const RTprogram *program)
+{
+	unsigned int k;
+
+	for (k = 0; k < NFIELDS; k++) {
+		if (included(fields[k].needs, program->uses)) {
+			bb_text(out, ".field private static ");
+			bb_text(out, fields[k].name);
+			bb_u1(out, ' ');
+			bb_text(out, fields[k].desc);
+			bb_u1(out, '\n');
+		}
+	}
+	bb_u1(out, '\n');
+
+	for (k = 0; k < NMETHODS; k++) {
+		if (included(methods[k].needs, program->uses)) {
+			dump_method(out, class_name, &methods[k], program);
+		}
+	}
+}
+
+void emit_runtime(ClassFile *cf, const char *class_name,
+		const RTprogram *program)
+{
+	unsigned int k;
+
+	for (k = 0; k < NFIELDS; k++) {
+		if (included(fields[k].needs, program->uses)) {
+			cf_add_field(cf, ACC_PRIVATE | ACC_STATIC, fields[k].name,
+					fields[k].desc);
+		}
+	}
+
+	for (k = 0; k < NMETHODS; k++) {
+		if (included(methods[k].needs, program->uses)) {
+			emit_method(cf, class_name, &methods[k], program);
+		}
+	}
+}
+
+/* --- Jasmin output -------------------------------------------------------- */
+
+/* Writes a run-time method in Jasmin, which works out the frames itself. */
+
+static void dump_method(ByteBuf *out, const char *class_name,
+		const RTmethod *rm, const RTprogram *program)
+{
+	const RTinsn *i;
+	char *path;
+	int n;
+
+	bb_text(out, ".method ");
+	bb_text(out, (rm->flags & ACC_PUBLIC ? "public " : ""));
+	bb_text(out, (rm->flags & ACC_PRIVATE ? "private " : ""));
+	bb_text(out, (rm->flags & ACC_STATIC ? "static " : ""));
+	bb_text(out, rm->name);
+	bb_text(out, rm->desc);
+	bb_text(out, "\n.limit stack ");
+	bb_decimal(out, rm->stack);
+	bb_text(out, "\n.limit locals ");
+	bb_decimal(out, rm->locals);
+	bb_u1(out, '\n');
+	if (rm->handler) {
+		bb_text(out, ".catch ");
+		bb_text(out, rm->caught);
+		dump_label(out, " from R", rm->from);
+		dump_label(out, " to R", rm->to);
+		dump_label(out, " using R", rm->handler);
+		bb_u1(out, '\n');
+	}
+
+	for (i = rm->code; i->kind != RT_END; i++) {
+		if (!included(i->cond, program->uses)) {
+			continue;
+		}
+		if (i->kind != RT_LABEL) {
+			bb_u1(out, '\t');
+		}
+		switch (i->kind) {
+			case RT_OP:
+				bb_text(out, i->name);
+				break;
+			case RT_LOCAL:
+				bb_text(out, i->name);
+				bb_u1(out, '_');
+				bb_decimal(out, i->num);
+				break;
+			case RT_CONST:
+			case RT_NPOINTS:
+				n = (i->kind == RT_CONST ? i->num : program->npoints);
+				if (n == -1) {
+					bb_text(out, "iconst_m1");
+				} else if (n >= 0 && n <= 5) {
+					bb_text(out, "iconst_");
+				} else if (n >= -128 && n <= 127) {
+					bb_text(out, "bipush ");
+				} else if (n >= -32768 && n <= 32767) {
+					bb_text(out, "sipush ");
+				} else {
+					bb_text(out, "ldc ");
+				}
+				if (n != -1) {
+					bb_decimal(out, n);
+				}
+				break;
+			case RT_STRING:
+				bb_text(out, "ldc \"");
+				bb_text(out, i->arg);
+				bb_u1(out, '"');
+				break;
+			case RT_POINTS:
+				bb_text(out, "ldc \"");
+				dump_points(out, program->points);
+				bb_u1(out, '"');
+				break;
+			case RT_PATH:
+				path = profile_path(class_name);
+				bb_text(out, "ldc \"");
+				bb_text(out, path);
+				bb_u1(out, '"');
+				free(path);
+				break;
+			case RT_IINC:
+				bb_text(out, "iinc ");
+				bb_decimal(out, i->num);
+				bb_u1(out, ' ');
+				bb_decimal(out, i->inc);
+				break;
+			case RT_FIELD:
+			case RT_CALL:
+				bb_text(out, i->name);
+				bb_u1(out, ' ');
+				bb_text(out, class_name);
+				bb_u1(out, '/');
+				bb_text(out, i->arg);
+				break;
+			case RT_SYSFIELD:
+			case RT_INVOKE:
+			case RT_NEW:
+				bb_text(out, i->name);
+				bb_u1(out, ' ');
+				bb_text(out, i->arg);
+				break;
+			case RT_ARRAY:
+				bb_text(out, "newarray ");
+				bb_text(out, i->arg);
+				break;
+			case RT_BRANCH:
+				bb_text(out, i->name);
+				dump_label(out, " R", i->num);
+				break;
+			case RT_LABEL:
+				dump_label(out, "R", i->num);
+				bb_u1(out, ':');
+				break;
+			case RT_END:
+				break;
+		}
+		bb_u1(out, '\n');
+	}
+
+	bb_text(out, ".end method\n\n");
+}
+
+/* Writes a label of a run-time method, after a text that leads up to it. */
+
+static void dump_label(ByteBuf *out, const char *before, int label)
+{
+	bb_text(out, before);
+	bb_decimal(out, label);
+}
+
+/* Writes the profiled points as the text of a Jasmin string, in which the
+ * line breaks are escaped.
+ */
+
+static void dump_points(ByteBuf *out, const char *points)
+{
+	const char *p;
+
+	for (p = points; *p; p++) {
+		if (*p == '\n') {
+			bb_text(out, "\\n");
+		} else {
+			bb_u1(out, *p);
+		}
+	}
+}
+
+/* --- class file output ---------------------------------------------------- */
+
+/* Adds a run-time method to a class file.  Branches are patched once their
+ * labels are placed, and a frame is written at every label that has one.
+ */
+
+static void emit_method(ClassFile *cf, const char *class_name,
+		const RTmethod *rm, const RTprogram *program)
+{
+	CFmethod *m;
+	ByteBuf *bc, smt = { NULL, 0, 0 };
+	const RTinsn *i;
+	const char *d;
+	long label_at[RT_MAX_LABELS], last;
+	size_t branch_at[RT_MAX_BRANCHES];
+	int branch_to[RT_MAX_BRANCHES], nbranches, nframes, n;
+	char *t, *path;
+	Types prev;
+
+	m = cf_begin_method(cf, rm->flags, rm->name, rm->desc);
+	bc = cf_code(m);
+
+	/* the frame on entry holds the parameters, with the small integer types
+	 * as int */
+	t = prev.types;
+	for (d = rm->desc + 1; *d != ')'; d = next_type(d)) {
+		if (strchr("BCSZ", *d)) {
+			*t++ = 'I';
+		} else {
+			n = (int) (next_type(d) - d);
+			assert(t + n < prev.types + RT_MAX_TYPES);
+			memcpy(t, d, n);
+			t += n;
+		}
+	}
+	*t = '\0';
+
+	/* the number of frames is patched in when it is known */
+	bb_u2(&smt, 0);
+	nbranches = nframes = 0;
+	last = -1;
+	for (i = rm->code; i->kind != RT_END; i++) {
+		if (!included(i->cond, program->uses)) {
+			continue;
+		}
+		switch (i->kind) {
+			case RT_OP:
+				bb_u1(bc, i->op);
+				break;
+			case RT_LOCAL:
+				assert(i->num <= 3);
+				bb_u1(bc, i->op + i->num);
+				break;
+			case RT_CONST:
+			case RT_NPOINTS:
+				n = (i->kind == RT_CONST ? i->num : program->npoints);
+				if (n >= -1 && n <= 5) {
+					bb_u1(bc, OP_ICONST_0 + n);
+				} else if (n >= -128 && n <= 127) {
+					bb_u1(bc, OP_BIPUSH);
+					bb_u1(bc, (unsigned int) (n & 0xff));
+				} else if (n >= -32768 && n <= 32767) {
+					bb_u1(bc, OP_SIPUSH);
+					bb_u2(bc, (unsigned int) (n & 0xffff));
+				} else {
+					bb_u1(bc, OP_LDC_W);
+					bb_u2(bc, cf_integer(cf, n));
+				}
+				break;
+			case RT_STRING:
+				bb_u1(bc, OP_LDC_W);
+				bb_u2(bc, cf_string(cf, i->arg));
+				break;
+			case RT_POINTS:
+				bb_u1(bc, OP_LDC_W);
+				bb_u2(bc, cf_string(cf, program->points));
+				break;
+			case RT_PATH:
+				path = profile_path(class_name);
+				bb_u1(bc, OP_LDC_W);
+				bb_u2(bc, cf_string(cf, path));
+				free(path);
+				break;
+			case RT_IINC:
+				bb_u1(bc, OP_IINC);
+				bb_u1(bc, i->num);
+				bb_u1(bc, (unsigned int) (i->inc & 0xff));
+				break;
+			case RT_FIELD:
+			case RT_SYSFIELD:
+			case RT_CALL:
+			case RT_INVOKE:
+				bb_u1(bc, i->op);
+				bb_u2(bc, member_ref(cf, class_name, i));
+				break;
+			case RT_NEW:
+				bb_u1(bc, OP_NEW);
+				bb_u2(bc, cf_class(cf, i->arg));
+				break;
+			case RT_ARRAY:
+				bb_u1(bc, OP_NEWARRAY);
+				bb_u1(bc, i->num);
+				break;
+			case RT_BRANCH:
+				assert(nbranches < RT_MAX_BRANCHES);
+				branch_at[nbranches] = bc->len;
+				branch_to[nbranches++] = i->num;
+				bb_u1(bc, i->op);
+				bb_u2(bc, 0);
+				break;
+			case RT_LABEL:
+				assert(i->num < RT_MAX_LABELS);
+				label_at[i->num] = (long) bc->len;
+				if (i->arg) {
+					emit_frame(cf, &smt, &prev, i->arg,
+							(last < 0 ? (long) bc->len
+							 : (long) bc->len - last - 1));
+					last = (long) bc->len;
+					nframes++;
+				}
+				break;
+			case RT_END:
+				break;
+		}
+	}
+
+	for (n = 0; n < nbranches; n++) {
+		bb_patch_u2(bc, branch_at[n] + 1, (unsigned int)
+				((label_at[branch_to[n]] - (long) branch_at[n]) & 0xffff));
+	}
+	if (rm->handler) {
+		cf_add_handler(m, label_at[rm->from], label_at[rm->to],
+				label_at[rm->handler], cf_class(cf, rm->caught));
+	}
+	if (nframes > 0) {
+		bb_patch_u2(&smt, 0, nframes);
+		cf_add_code_attribute(cf, m, "StackMapTable", &smt);
+	}
+	free(smt.data);
+
+	cf_end_method(m, rm->stack, rm->locals);
+}
+
+/* Writes a stack map frame, in the most compact form that describes it in
+ * terms of the frame before it.
+ */
+
+static void emit_frame(ClassFile *cf, ByteBuf *smt, Types *prev,
+		const char *frame, long delta)
+{
+	Types locals;
+	const char *stack;
+	size_t n, nprev;
+	int nstack;
+
+	stack = strchr(frame, '|');
+	assert(stack != NULL && (size_t) (stack - frame) < RT_MAX_TYPES);
+	n = (size_t) (stack - frame);
+	memcpy(locals.types, frame, n);
+	locals.types[n] = '\0';
+	stack++;
+	nstack = count_types(stack);
+	nprev = strlen(prev->types);
+
+	if (nstack == 0 && strcmp(locals.types, prev->types) == 0) {
+		if (delta <= 63) {
+			bb_u1(smt, delta);                      /* same_frame */
+		} else {
+			bb_u1(smt, 251);                        /* same_frame_extended */
+			bb_u2(smt, delta);
+		}
+	} else if (nstack == 1 && strcmp(locals.types, prev->types) == 0) {
+		if (delta <= 63) {
+			bb_u1(smt, 64 + delta);     /* same_locals_1_stack_item_frame */
+		} else {
+			bb_u1(smt, 247);   /* same_locals_1_stack_item_frame_extended */
+			bb_u2(smt, delta);
+		}
+		emit_types(cf, smt, stack);
+	} else if (nstack == 0 && n > nprev
+			&& strncmp(locals.types, prev->types, nprev) == 0
+			&& count_types(locals.types + nprev) <= 3) {
+		bb_u1(smt, 251 + count_types(locals.types + nprev)); /* append */
+		bb_u2(smt, delta);
+		emit_types(cf, smt, locals.types + nprev);
+	} else if (nstack == 0 && n < nprev
+			&& strncmp(locals.types, prev->types, n) == 0
+			&& count_types(prev->types + n) <= 3) {
+		bb_u1(smt, 251 - count_types(prev->types + n));      /* chop */
+		bb_u2(smt, delta);
+	} else {
+		bb_u1(smt, 255);                            /* full_frame */
+		bb_u2(smt, delta);
+		bb_u2(smt, count_types(locals.types));
+		emit_types(cf, smt, locals.types);
+		bb_u2(smt, nstack);
+		emit_types(cf, smt, stack);
+	}
+
+	*prev = locals;
+}
+
+/* Writes the verification types of a list of descriptors. */
+
+static void emit_types(ClassFile *cf, ByteBuf *smt, const char *types)
+{
+	char name[RT_MAX_TYPES];
+	const char *d, *e;
+
+	for (d = types; *d; d = e) {
+		e = next_type(d);
+		if (*d == 'I') {
+			bb_u1(smt, VT_INTEGER);
+			continue;
+		}
+		bb_u1(smt, VT_OBJECT);
+		if (*d == 'L') {
+			memcpy(name, d + 1, e - d - 2);
+			name[e - d - 2] = '\0';
+		} else {
+			memcpy(name, d, e - d);
+			name[e - d] = '\0';
+		}
+		bb_u2(smt, cf_class(cf, name));
+	}
+}
+
+/* --- utility functions ---------------------------------------------------- */
+
+static int count_types(const char *types)
+{
+	int n = 0;
+
+	for (; *types; types = next_type(types)) {
+		n++;
+	}
+
+	return n;
+}
+
+/* Returns the character after the field descriptor at the start of a string. */
+
+static const char *next_type(const char *d)
+{
+	while (*d == '[') {
+		d++;
+	}
+	if (*d == 'L') {
+		d = strchr(d, ';');
+	}
+
+	return d + 1;
+}
+
+/* Returns the pool index of the field or method to which an instruction
+ * refers.  A member of the class itself is written as its name and descriptor,
+ * and that of another class is preceded by the class name and a slash.
+ */
+
+static unsigned int member_ref(ClassFile *cf, const char *class_name,
+		const RTinsn *i)
+{
+	char *owner, *name, *desc, *sep;
+	Boolean field = (i->kind == RT_FIELD || i->kind == RT_SYSFIELD);
+	unsigned int idx;
+
+	owner = estrdup(i->arg);
+	desc = strchr(owner, (field ? ' ' : '('));
+	assert(desc != NULL);
+	if (i->kind == RT_FIELD || i->kind == RT_CALL) {
+		name = owner;
+	} else {
+		for (name = sep = owner; sep < desc; sep++) {
+			if (*sep == '/') {
+				name = sep;
+			}
+		}
+		assert(name != owner);
+		*name++ = '\0';
+	}
+
+	if (field) {
+		*desc++ = '\0';
+		idx = cf_fieldref(cf, (name == owner ? class_name : owner), name,
+				desc);
+	} else {
+		desc = estrdup(desc);
+		*strchr(name, '(') = '\0';
+		idx = cf_methodref(cf, (name == owner ? class_name : owner), name,
+				desc);
+		free(desc);
+	}
+
+	free(owner);
+	return idx;
+}
+
+/* Tests whether a part of the run-time support that is needed by some uses, or
+ * by all programs if none are given, is included for the uses of a program.
+ */
+
+static Boolean included(unsigned int needs, unsigned int uses)
+{
+	return (needs == 0 || (needs & uses) != 0);
+}
+
+/* Returns the name of the file to which the profile of a class is written,
+ * which the caller must free.
+ */
+
+static char *profile_path(const char *class_name)
+{
+	char *path;
+
+	path = emalloc(strlen(class_name) + sizeof(RT_PROFILE_EXT));
+	strcpy(path, class_name);
+	strcat(path, RT_PROFILE_EXT);
+
+	return path;
+}
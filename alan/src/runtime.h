@@ -0,0 +1,101 @@
+/**
+ * @file    runtime.h
+ * @brief   The run-time support that is written into every ALAN class.
+ *
+ * Input is read from a byte buffer over <code>System.in</code>, which is only
+ * allocated when the program first reads, and integers and booleans are
+ * parsed from it directly.  Output is collected in a byte buffer that is
+ * written to <code>System.out</code> when it fills up, before the program
+ * waits for input, and when main returns or throws; for the last, main is
+ * compiled under another name, and called from a main that flushes.  Only the
+ * parts of the support that the program uses are included.
+ *
+ * A program that is compiled with <code>--profile</code> counts the calls of
+ * each function and the iterations of each loop, and times each function from
+ * its outermost entry to its exit.  When main returns or throws, the counts
+ * are written to <code>&lt;class&gt;.prof</code>, after a header line, as one
+ * line per profiled point:
+ *
+ * <pre>
+ * function &lt;name&gt; &lt;line&gt; &lt;calls&gt; &lt;nanoseconds&gt;
+ * loop &lt;function&gt; &lt;line&gt; &lt;iterations&gt; 0
+ * </pre>
+ *
+ * where the line is that at which the body or the loop starts, so that a
+ * point keeps its name while the code around it changes.  The calls that are
+ * still running when the program throws are not timed.
+ *
+ * The methods are described once, as tables, from which both the Jasmin text
+ * and the class file, with its stack map frames, are written.
+ *
+ * @date    2026-10-14
+ */
+
+#ifndef RUNTIME_H
+#define RUNTIME_H
+
+#include "classfile.h"
+
+/* the parts of the run-time support that a program may use */
+#define RT_READ_INTEGER   0x01
+#define RT_READ_BOOLEAN   0x02
+#define RT_WRITE_INTEGER  0x04
+#define RT_WRITE_BOOLEAN  0x08
+#define RT_WRITE_STRING   0x10
+#define RT_PROFILE        0x20
+
+#define RT_INPUT          (RT_READ_INTEGER | RT_READ_BOOLEAN)
+#define RT_OUTPUT         (RT_WRITE_INTEGER | RT_WRITE_BOOLEAN | RT_WRITE_STRING)
+
+/* the methods that the compiled code calls, after the class name */
+#define RT_REF_READ_INTEGER   "/readInt()I"
+#define RT_REF_READ_BOOLEAN   "/readBoolean()Z"
+#define RT_REF_WRITE_INTEGER  "/writeInt(I)V"
+#define RT_REF_WRITE_BOOLEAN  "/writeBoolean(Z)V"
+#define RT_REF_WRITE_STRING   "/writeString(Ljava/lang/String;)V"
+#define RT_REF_PROFILE_ENTER  "/profEnter(I)V"
+#define RT_REF_PROFILE_EXIT   "/profExit(I)V"
+#define RT_REF_PROFILE_LOOP   "/profLoop(I)V"
+
+/** the name of the main body if the program writes output or is profiled,
+ * which no ALAN identifier can clash with */
+#define RT_MAIN_NAME          "main$"
+
+/** the extension of the file to which the profile is written */
+#define RT_PROFILE_EXT        ".prof"
+
+/** what the run-time support is written for */
+typedef struct {
+	unsigned int  uses;     /**< the parts of the support that are used     */
+	const char   *points;   /**< the profiled points, a line each, without
+	                             the counts, or NULL if not profiled       */
+	int           npoints;  /**< the number of profiled points              */
+} RTprogram;
+
+/**
+ * Writes the fields and methods of the run-time support in Jasmin.
+ *
+ * @param[in]   out
+ *     the buffer to which the text is appended
+ * @param[in]   class_name
+ *     the name of the class
+ * @param[in]   program
+ *     the parts of the support that the program uses, and its profile
+ */
+void dump_runtime(ByteBuf *out, const char *class_name,
+		const RTprogram *program);
+
+/**
+ * Adds the fields and methods of the run-time support to a class file.
+ *
+ * @param[in]   cf
+ *     the class file
+ * @param[in]   class_name
+ *     the name of the class
+ * @param[in]   program
+ *     the parts of the support that the program uses, and its profile
+ */
+void emit_runtime(ClassFile *cf, const char *class_name,
+		const RTprogram *program);
+
+#endif /* RUNTIME_H */
@@ -5,82 +5,311 @@
  * @date    2022-08-03
  */
 
+#include <assert.h>
 #include <ctype.h>
 #include <limits.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "boolean.h"
+#include "compiler.h"
 #include "error.h"
+#include "intern.h"
 #include "scanner.h"
+#include "stats.h"
 #include "token.h"
 
+#if defined(__GNUC__) && defined(__SSE2__)
+#define SCAN_SSE2
+#include <emmintrin.h>
+#if defined(__x86_64__)
+#define SCAN_AVX2
+#include <immintrin.h>
+#endif
+#elif defined(__GNUC__) && defined(__aarch64__) && defined(__ARM_NEON)
+#define SCAN_NEON
+#include <arm_neon.h>
+#endif
+
 /* --- type definitions and constants --------------------------------------- */
 
 typedef struct {
 	char      *word;                   /* the reserved word, i.e., the lexeme */
+	size_t     len;                    /* the length of the reserved word     */
 	TokenType  type;                   /* the associated token type           */
 } ReservedWord;
 
+/* The reserved words are placed by a perfect hash on the first and last
+ * characters and the length of a word, so that classifying a word takes one
+ * table lookup and at most one comparison.  The constants were found by a
+ * search over small multipliers for a collision-free table of 64 slots; if a
+ * reserved word is added, the search must be repeated. */
+#define KEYWORD_SLOTS          64
+#define KEYWORD_MIN_LEN        2
+#define KEYWORD_MAX_LEN        8
+#define KEYWORD_HASH(s, n)                                                     \
+	(((unsigned char) (s)[0] + 3 * (unsigned char) (s)[(n) - 1] + 3 * (n))     \
+	 & (KEYWORD_SLOTS - 1))
+
 /* --- global static variables ---------------------------------------------- */
 
-static FILE *src_file;                 /* the source file pointer             */
-static int   ch;                       /* the next source character           */
-static int   column_number;            /* the current column number           */
+static const ReservedWord reserved[KEYWORD_SLOTS] = {
+	[ 1] = {"boolean", 7, TOKEN_BOOLEAN},   [ 2] = {"rem", 3, TOKEN_REMAINDER},
+	[ 7] = {"to", 2, TOKEN_TO},             [ 8] = {"function", 8, TOKEN_FUNCTION},
+	[10] = {"then", 4, TOKEN_THEN},         [11] = {"or", 2, TOKEN_OR},
+	[12] = {"get", 3, TOKEN_GET},           [19] = {"not", 3, TOKEN_NOT},
+	[20] = {"integer", 7, TOKEN_INTEGER},   [21] = {"put", 3, TOKEN_PUT},
+	[22] = {"and", 3, TOKEN_AND},           [26] = {"end", 3, TOKEN_END},
+	[27] = {"array", 5, TOKEN_ARRAY},       [32] = {"else", 4, TOKEN_ELSE},
+	[33] = {"if", 2, TOKEN_IF},             [36] = {"false", 5, TOKEN_FALSE},
+	[38] = {"elsif", 5, TOKEN_ELSIF},       [41] = {"relax", 5, TOKEN_RELAX},
+	[42] = {"leave", 5, TOKEN_LEAVE},       [47] = {"true", 4, TOKEN_TRUE},
+	[51] = {"call", 4, TOKEN_CALL},         [52] = {"source", 6, TOKEN_SOURCE},
+	[53] = {"while", 5, TOKEN_WHILE},       [55] = {"do", 2, TOKEN_DO},
+	[59] = {"begin", 5, TOKEN_BEGIN}
+};
 
-static ReservedWord reserved[] = {     /* reserved words                      */
+/* The run classes of characters: a character that belongs to a class continues
+ * a run of that class.  The classes are bit flags, so that one table serves
+ * all the kernels. */
+#define RUN_SPACE              0x01    /* whitespace                          */
+#define RUN_WORD               0x02    /* letters, digits, and underscores    */
+#define RUN_DIGIT              0x04    /* digits                              */
+#define RUN_COMMENT            0x08    /* anything but braces                 */
+#define RUN_STRING             0x10    /* printable, but not '"' or '\\'      */
 
-	{"and", TOKEN_AND}, {"array", TOKEN_ARRAY}, {"begin", TOKEN_BEGIN},
-	{"boolean", TOKEN_BOOLEAN}, {"call", TOKEN_CALL}, {"do", TOKEN_DO},
-	{"else", TOKEN_ELSE}, {"elsif", TOKEN_ELSIF}, {"end", TOKEN_END},
-	{"false", TOKEN_FALSE}, {"function", TOKEN_FUNCTION}, {"get", TOKEN_GET},
-	{"if", TOKEN_IF}, {"integer", TOKEN_INTEGER}, {"leave", TOKEN_LEAVE},
-	{"not", TOKEN_NOT}, {"or", TOKEN_OR}, {"put", TOKEN_PUT},
-	{"relax", TOKEN_RELAX}, {"rem", TOKEN_REMAINDER}, {"source", TOKEN_SOURCE},
-	{"then", TOKEN_THEN}, {"to", TOKEN_TO}, {"true", TOKEN_TRUE},
-	{"while", TOKEN_WHILE}
+/* a kernel that finds the end of a run of characters of one class */
+typedef size_t (*RunKernel)(const char *s, size_t i, size_t n, int run);
 
-};
+#define SOURCE_BLOCK_SIZE      (64 * 1024)
+#define INITIAL_TOKEN_COUNT    (1024)
 
-#define NUM_RESERVED_WORDS     (sizeof(reserved) / sizeof(ReservedWord))
-#define MAX_INITIAL_STRING_LEN (1024)
+static unsigned char   run_class[256];         /* the run classes         */
+static RunKernel       scan_run;               /* the selected kernel     */
+static const char     *scan_kernel_name;       /* the name of the kernel  */
+static pthread_once_t  kernel_once = PTHREAD_ONCE_INIT;
 
 /* --- function prototypes -------------------------------------------------- */
 
-static void next_char(void);
-static void process_number(Token *token);
-static void process_string(Token *token);
-static void process_word(Token *token);
-static void skip_comment(void);
+static void next_char(AlanCompiler *ac);
+static void process_number(AlanCompiler *ac, Token *token);
+static void process_string(AlanCompiler *ac, Token *token);
+static void process_word(AlanCompiler *ac, Token *token);
+static void skip_comment(AlanCompiler *ac);
+static void start(AlanCompiler *ac);
+static void skip_to(AlanCompiler *ac, size_t next);
+static void scan_token(AlanCompiler *ac, Token *token);
+static void free_tokens(AlanCompiler *ac);
+static size_t scalar_run(const char *s, size_t i, size_t n, int run);
+#ifdef SCAN_SSE2
+static __m128i sse2_in_range(__m128i x, int lo, int hi);
+static unsigned int sse2_stop(const char *p, int run);
+static size_t sse2_run(const char *s, size_t i, size_t n, int run);
+#endif
+#ifdef SCAN_AVX2
+static __m256i avx2_in_range(__m256i x, int lo, int hi);
+static unsigned int avx2_stop(const char *p, int run);
+static size_t avx2_run(const char *s, size_t i, size_t n, int run);
+#endif
+#ifdef SCAN_NEON
+static uint8x16_t neon_in_range(uint8x16_t x, int lo, int hi);
+static size_t neon_run(const char *s, size_t i, size_t n, int run);
+#endif
+static void select_kernel(void);
 
 /* --- scanner interface ---------------------------------------------------- */
 
-void init_scanner(FILE *in_file)
+void init_scanner(AlanCompiler *ac, FILE *in_file)
+{
+	struct stat st;
+	void *map;
+	size_t n, cap;
+	char *buf;
+
+	release_scanner(ac);
+
+	/* a regular file is mapped into memory as a whole */
+	if (fstat(fileno(in_file), &st) == 0 && S_ISREG(st.st_mode)
+			&& st.st_size > 0 && ftell(in_file) == 0) {
+		map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fileno(in_file),
+				0);
+		if (map != MAP_FAILED) {
+			ac->src_buf = map;
+			ac->src_len = st.st_size;
+			ac->src_mapped = TRUE;
+			start(ac);
+			return;
+		}
+	}
+
+	/* otherwise, such as for pipes, the stream is read in large blocks */
+	cap = SOURCE_BLOCK_SIZE;
+	buf = emalloc(cap);
+	n = 0;
+	while (!feof(in_file) && !ferror(in_file)) {
+		if (n == cap) {
+			cap *= 2;
+			buf = erealloc(buf, cap);
+		}
+		n += fread(buf + n, 1, cap - n, in_file);
+	}
+	if (ferror(in_file)) {
+		free(buf);
+		ceprintf(ac, "source could not be read:");
+	}
+	ac->src_buf = buf;
+	ac->src_len = n;
+	ac->src_mapped = FALSE;
+	start(ac);
+}
+
+void init_scanner_buffer(AlanCompiler *ac, const char *buf, size_t len)
+{
+	release_scanner(ac);
+	ac->src_buf = buf;
+	ac->src_len = len;
+	ac->src_borrowed = TRUE;
+	start(ac);
+}
+
+void release_scanner(AlanCompiler *ac)
+{
+	free_tokens(ac);
+	if (ac->src_buf == NULL) {
+		return;
+	}
+	if (ac->src_mapped) {
+		munmap((void *) ac->src_buf, ac->src_len);
+	} else if (!ac->src_borrowed) {
+		free((void *) ac->src_buf);
+	}
+	ac->src_buf = NULL;
+	ac->src_len = 0;
+	ac->src_mapped = ac->src_borrowed = FALSE;
+}
+
+
+void get_token(AlanCompiler *ac, Token *token)
 {
-	src_file = in_file;
-	position.line = 1;
-	position.col = column_number = 0;
-	next_char();
+	TokenBuffer *tb = ac->tokens;
+	Phase phase;
+	int i;
+
+	/* without the buffer, the scanner is timed token by token */
+	if (tb == NULL) {
+		if (ac->stats) {
+			phase = stats_phase(ac, PHASE_SCAN);
+			scan_token(ac, token);
+			ac->stats->tokens++;
+			stats_phase(ac, phase);
+		} else {
+			scan_token(ac, token);
+		}
+		return;
+	}
+
+	/* deliver the next token from the buffer, and stay at end-of-file */
+	i = tb->next;
+	if (tb->types[i] != TOKEN_EOF) {
+		tb->next++;
+	}
+	token->type = tb->types[i];
+	ac->position.offset = tb->offsets[i];
+	if (token->type == TOKEN_ID) {
+		memcpy(token->lexeme, ac->src_buf + tb->offsets[i], tb->lengths[i]);
+		token->lexeme[tb->lengths[i]] = '\0';
+		token->id = interned_name(ac, (unsigned int) tb->values[i]);
+	} else if (token->type == TOKEN_NUMBER) {
+		token->value = tb->values[i];
+	} else if (token->type == TOKEN_STRING) {
+		token->string = tb->strings[tb->values[i]];
+	}
 }
 
+void tokenize(AlanCompiler *ac)
+{
+	TokenBuffer *tb;
+	Token token;
+	size_t end;
+	int i;
+
+	tb = emalloc(sizeof(TokenBuffer));
+	memset(tb, 0, sizeof(TokenBuffer));
+	free_tokens(ac);
+	ac->tokens = tb;
+
+	/* the buffer belongs to the context from the start, in case of errors */
+	do {
+		scan_token(ac, &token);
+		if (ac->stats) {
+			ac->stats->tokens++;
+		}
+		if (tb->ntokens == tb->cap) {
+			tb->cap = (tb->cap ? 2 * tb->cap : INITIAL_TOKEN_COUNT);
+			tb->types = erealloc(tb->types, tb->cap * sizeof(unsigned char));
+			tb->offsets = erealloc(tb->offsets, tb->cap * sizeof(size_t));
+			tb->lengths = erealloc(tb->lengths, tb->cap * sizeof(unsigned int));
+			tb->values = erealloc(tb->values, tb->cap * sizeof(int));
+		}
+		i = tb->ntokens++;
+		end = (ac->ch == EOF ? ac->src_len : ac->offset);
+		tb->types[i] = (unsigned char) token.type;
+		tb->offsets[i] = ac->position.offset;
+		tb->lengths[i] = (unsigned int) (end - ac->position.offset);
+		tb->values[i] = 0;
+		if (token.type == TOKEN_NUMBER) {
+			tb->values[i] = token.value;
+		} else if (token.type == TOKEN_ID) {
+			tb->values[i] = (int) intern_index(token.id);
+		} else if (token.type == TOKEN_STRING) {
+			if (tb->nstrings == tb->capstrings) {
+				tb->capstrings = (tb->capstrings ? 2 * tb->capstrings
+						: INITIAL_TOKEN_COUNT);
+				tb->strings = erealloc(tb->strings,
+						tb->capstrings * sizeof(char *));
+			}
+			tb->values[i] = tb->nstrings;
+			tb->strings[tb->nstrings++] = token.string;
+		}
+	} while (token.type != TOKEN_EOF);
+}
+
+TokenType peek_token(AlanCompiler *ac, int k)
+{
+	TokenBuffer *tb = ac->tokens;
+	int i;
+
+	assert(tb != NULL && k >= 0);
+	i = tb->next - 1 + k;
+	if (i < 0) {
+		i = 0;
+	} else if (i >= tb->ntokens) {
+		i = tb->ntokens - 1;
+	}
+
+	return tb->types[i];
+}
 
 /* Retrieves the next token
  * - Provided that the character is valid
  */
-void get_token(Token * token)
+static void scan_token(AlanCompiler *ac, Token *token)
 {
 /* removes whitespace */
-if (isspace(ch)) {
-	while (isspace(ch))
-		next_char();
+if (isspace(ac->ch)) {
+	skip_to(ac, scan_run(ac->src_buf, ac->offset + 1, ac->src_len,
+				RUN_SPACE));
 }
 
-if (ch == '\n') {
-	next_char();
+if (ac->ch == '\n') {
+	next_char(ac);
 }
 
-if (!isascii(ch) && ch != EOF) {
-	position.col = column_number;
-	leprintf("illegal character '%c' (ASCII #%d)", ch, ch);
+if (!isascii(ac->ch) && ac->ch != EOF) {
+	ac->position.offset = ac->offset;
+	leprintf(ac, "illegal character '%c' (ASCII #%d)", ac->ch, ac->ch);
 
 }
 
@@ -88,46 +317,44 @@ if (!isascii(ch) && ch != EOF) {
 int temp;
 
 /* remember token start */
-position.col = column_number;
+ac->position.offset = ac->offset;
 
 /* get the next token */
-if (ch != EOF) {
-	if (isalpha(ch) || ch == '_') {
+if (ac->ch != EOF) {
+	if (isalpha(ac->ch) || ac->ch == '_') {
 
 		/* process a word */
-		process_word(token);
+		process_word(ac, token);
 
-	} else if (isdigit(ch)) {
+	} else if (isdigit(ac->ch)) {
 
 		/* process a number */
-		process_number(token);
+		process_number(ac, token);
 
-	} else switch (ch) {
+	} else switch (ac->ch) {
 
 	/* process a string */
 	case '"':
-		position.col = column_number;
-		next_char();
-		process_string(token);
+		next_char(ac);
+		process_string(ac, token);
 		break;
 
 	/* skip comments */
 	case '{':
-		skip_comment();
-		get_token(token);
+		skip_comment(ac);
+		scan_token(ac, token);
 		break;
 
 	case '=':
 		token -> type = TOKEN_EQUAL;
-		next_char();
+		next_char(ac);
 		break;
 
 	case '>':
-		next_char();
-		if (ch == '=') {
+		next_char(ac);
+		if (ac->ch == '=') {
 			token -> type = TOKEN_GREATER_EQUAL;
-			next_char();
-			position.col = position.col-1;
+			next_char(ac);
 			break;
 
 		} else
@@ -135,17 +362,15 @@ if (ch != EOF) {
 		break;
 
 	case '<':
-		next_char();
-		if (ch == '=') {
+		next_char(ac);
+		if (ac->ch == '=') {
 			token -> type = TOKEN_LESS_EQUAL;
-			next_char();
-			position.col = position.col-1;
+			next_char(ac);
 			break;
 
-		} else if (ch == '>') {
+		} else if (ac->ch == '>') {
 			token -> type = TOKEN_NOT_EQUAL;
-			next_char();
-			position.col = position.col-1;
+			next_char(ac);
 			break;
 
 		} else
@@ -154,111 +379,109 @@ if (ch != EOF) {
 
 	case '-':
 		token -> type = TOKEN_MINUS;
-		next_char();
+		next_char(ac);
 		break;
 
 	case '+':
 		token -> type = TOKEN_PLUS;
-		next_char();
+		next_char(ac);
 		break;
 
 	case '/':
 		token -> type = TOKEN_DIVIDE;
-		next_char();
+		next_char(ac);
 		break;
 
 	case '*':
 		token -> type = TOKEN_MULTIPLY;
-		next_char();
+		next_char(ac);
 		break;
 
 	case ']':
 		token -> type = TOKEN_CLOSE_BRACKET;
-		next_char();
+		next_char(ac);
 		break;
 
 	case ')':
 		token -> type = TOKEN_CLOSE_PARENTHESIS;
-		next_char();
+		next_char(ac);
 		break;
 
 	case ',':
 		token -> type = TOKEN_COMMA;
-		next_char();
+		next_char(ac);
 		break;
 
 	case '.':
 		token -> type = TOKEN_CONCATENATE;
-		next_char();
+		next_char(ac);
 		break;
 
 	case ':':
-		temp=ch;
-		next_char();
-		if (ch == '=') {
+		temp=ac->ch;
+		next_char(ac);
+		if (ac->ch == '=') {
 			token -> type = TOKEN_GETS;
-			next_char();
-			position.col = position.col-1;
+			next_char(ac);
 			break;
 
 		} else {
-			position.col = position.col;
-			leprintf("illegal character '%c' (ASCII #%d)", temp, temp);
+			leprintf(ac, "illegal character '%c' (ASCII #%d)", temp, temp);
 			break;
 		}
 	case '[':
 		token -> type = TOKEN_OPEN_BRACKET;
-		next_char();
+		next_char(ac);
 		break;
 
 	case '(':
 		token -> type = TOKEN_OPEN_PARENTHESIS;
-		next_char();
+		next_char(ac);
 		break;
 
 	case ';':
 		token -> type = TOKEN_SEMICOLON;
-		next_char();
+		next_char(ac);
 		break;
 
 	case '}':
-		leprintf("illegal character '%c' (ASCII #%d)", ch, ch);
+		leprintf(ac, "illegal character '%c' (ASCII #%d)", ac->ch, ac->ch);
 		break;
 
 	case '!':
-		leprintf("illegal character '%c' (ASCII #%d)", ch, ch);
+		leprintf(ac, "illegal character '%c' (ASCII #%d)", ac->ch, ac->ch);
 		break;
 
 	case '#':
-		leprintf("illegal character '%c' (ASCII #%d)", ch, ch);
+		leprintf(ac, "illegal character '%c' (ASCII #%d)", ac->ch, ac->ch);
 		break;
 
 	case '$':
-		leprintf("illegal character '%c' (ASCII #%d)", ch, ch);
+		leprintf(ac, "illegal character '%c' (ASCII #%d)", ac->ch, ac->ch);
 		break;
 
 	case '%':
-		leprintf("illegal character '%c' (ASCII #%d)", ch, ch);
+		leprintf(ac, "illegal character '%c' (ASCII #%d)", ac->ch, ac->ch);
 		break;
 
 	case '&':
-		leprintf("illegal character '%c' (ASCII #%d)", ch, ch);
+		leprintf(ac, "illegal character '%c' (ASCII #%d)", ac->ch, ac->ch);
 		break;
 
 	case '@':
-		leprintf("illegal character '%c' (ASCII #%d)", ch, ch);
+		leprintf(ac, "illegal character '%c' (ASCII #%d)", ac->ch, ac->ch);
 		break;
 
 	case '|':
-		leprintf("illegal character '%c' (ASCII #%d)", ch, ch);
+		leprintf(ac, "illegal character '%c' (ASCII #%d)", ac->ch, ac->ch);
 		break;
 
 	case '~':
-		leprintf("illegal character '%c' (ASCII #%d)", ch, ch);
+		leprintf(ac, "illegal character '%c' (ASCII #%d)", ac->ch, ac->ch);
 		break;
 
 	case '`':
-		leprintf("illegal character '%c' (ASCII #%d)", ch, ch);
+		leprintf(ac, "illegal character '%c' (ASCII #%d)", ac->ch, ac->ch);
 		break;
 	}
 } else {
@@ -266,38 +489,85 @@ if (ch != EOF) {
 }
 }
 
+TokenType get_word_type(const char *word, size_t len)
+{
+	const ReservedWord *r;
+
+	if (len < KEYWORD_MIN_LEN || len > KEYWORD_MAX_LEN) {
+		return TOKEN_ID;
+	}
+	r = &reserved[KEYWORD_HASH(word, len)];
+
+	return (r->len == len && memcmp(r->word, word, len) == 0
+			? r->type : TOKEN_ID);
+}
+
+const char *get_scan_kernel(void)
+{
+	pthread_once(&kernel_once, select_kernel);
+	return scan_kernel_name;
+}
+
 /* --- utility functions ---------------------------------------------------- */
 
 /* Fetches the next char
- * - Next char fetched from source file
- * - Sets position numbers
+ * - Next char fetched from the source buffer
+ * - Only the offset is kept; lines and columns are worked out from it when a
+ *   diagnostic needs them
  */
 
-void next_char(void)
+void next_char(AlanCompiler *ac)
 {
-	position.col = column_number;
-	static char last_read = '\0';
-
-	 if (ch == EOF) {
-		return;
+	if (ac->src_next < ac->src_len) {
+		ac->offset = ac->src_next;
+		ac->ch = (unsigned char) ac->src_buf[ac->src_next++];
+	} else {
+		ac->ch = EOF;
 	}
+}
 
-	ch = fgetc(src_file);
+/* Releases the tokens scanned up front, if any. */
+
+static void free_tokens(AlanCompiler *ac)
+{
+	TokenBuffer *tb = ac->tokens;
 
-	  if (ch == EOF) {
+	if (tb == NULL) {
 		return;
 	}
+	free(tb->types);
+	free(tb->offsets);
+	free(tb->lengths);
+	free(tb->values);
+	free(tb->strings);
+	free(tb);
+	ac->tokens = NULL;
+}
 
-	   if (last_read == '\n') {
-		column_number = 0;
-		position.line += 1;
-		last_read = '\0';
-	}
-	column_number += 1;
+/* Continues scanning at the specified offset, as if next_char had been called
+ * for every character before it.
+ */
 
-	 if (ch == '\n') {
-		last_read = '\n';
+static void skip_to(AlanCompiler *ac, size_t next)
+{
+	ac->offset = next - 1;
+	ac->src_next = next;
+	next_char(ac);
+}
+
+/* Starts scanning at the beginning of the source buffer. */
+
+static void start(AlanCompiler *ac)
+{
+	pthread_once(&kernel_once, select_kernel);
+	if (ac->stats) {
+		ac->stats->bytes += ac->src_len;
 	}
+	ac->ch = '\0';
+	ac->src_next = 0;
+	ac->offset = 0;
+	ac->position.offset = 0;
+	next_char(ac);
 }
 
 /* Process numbers
@@ -305,194 +575,396 @@ void next_char(void)
  * - Stores the value in the number token field.
  */
 
-void process_number(Token * token)
+void process_number(AlanCompiler *ac, Token *token)
 {
-	SourcePos start_pos;
-	start_pos.col = column_number;
-
-	int k;
-	k = column_number;
-	int number = ch - '0';
+	size_t start = ac->offset;
+	size_t end = scan_run(ac->src_buf, start + 1, ac->src_len, RUN_DIGIT);
+	const char *digit = ac->src_buf + start;
+	int number = 0;
 	int newnum;
-	while (isdigit(ch)) {
-		next_char();
 
-		if (!isdigit(ch)) {
-			break;
-		}
-		newnum = ch - '0';
+	for (; digit < ac->src_buf + end; digit++) {
+		newnum = *digit - '0';
 		if (INT_MAX / 10 < number ||
 			(INT_MAX / 10 == number && newnum > INT_MAX % 10)) {
 			//integer overflow error
-			position.col = k;
-			leprintf("number too large");
+			ac->position.offset = start;
+			leprintf(ac, "number too large");
 		}
 		number = 10 * number + newnum;
 	}
+	skip_to(ac, end);
 	token -> type = TOKEN_NUMBER;
 	token -> value = number;
-	position.col = start_pos.col;
+	ac->position.offset = start;
 }
 
 /* Process string literals
- * - Allocate heap space of the size of the maximum initial string length.
- * - If a string is *about* to overflow while scanning it, double the amount
- *   of space available.
+ * - Checks each run of plain characters as a whole, and stops only at escape
+ *   codes, the closing quote, and characters that are not allowed.
+ * - Allocates the string from the arena of the compilation, where it lasts
+ *   until the code has been emitted.
  */
 
-void process_string(Token * token)
+void process_string(AlanCompiler *ac, Token *token)
 {
-	SourcePos start_pos;
-	start_pos.col = column_number;
-	int count = 1;
-	int k;
-	char add;
-	k = column_number;
-	size_t i, nstring = MAX_INITIAL_STRING_LEN;
-	i = 0;
-
-	//allocate initial heap space
-	char * line = (char *) malloc(MAX_INITIAL_STRING_LEN);
-
-	while (ch != '"') {
-		add = ch;
-
-		if (ch == '\\') {
-			strncat(line, & add, 1);
-			next_char();
-			if (ch != 'n' && ch != 't' && ch != '"' && ch != '\\') {
-				position.col = column_number - 1;
-				leprintf("illegal escape code '\\%c' in string", ch);
-			} else {
-				add = ch;
+	size_t start = ac->position.offset;
+	size_t first = (ac->ch == EOF ? ac->src_len : ac->offset);
+	size_t end, i = first;
+	const char *s = ac->src_buf;
+	char *line;
+
+	for (;;) {
+		end = scan_run(s, i, ac->src_len, RUN_STRING);
+		if (end == ac->src_len) {
+			ac->position.offset = start;
+			leprintf(ac, "string not closed");
+		} else if (s[end] == '"') {
+			break;
+		} else if (s[end] == '\\') {
+			if (end + 1 == ac->src_len || (s[end + 1] != 'n'
+					&& s[end + 1] != 't' && s[end + 1] != '"'
+					&& s[end + 1] != '\\')) {
+				ac->position.offset = end;
+				leprintf(ac, "illegal escape code '\\%c' in string",
+						end + 1 == ac->src_len ? EOF : s[end + 1]);
 			}
-		}
-		strncat(line, & add, 1);
-		next_char();
-		count++;
-		if (ch == EOF) {
-			position.col = k - 1;
-			leprintf("string not closed");
-		}
-
-		if (!isascii(ch) || ch =='\n' || !isprint(ch)) {
-			position.col = position.col+1;
-			leprintf("non-printable character (ASCII #%d) in string", ch);
-		}
-
-		if (count > 1023) {
-			count = 0;
-			nstring = nstring * 2;
-			line = realloc(line, nstring);
+			i = end + 2;
+		} else {
+			ac->position.offset = end;
+			leprintf(ac, "non-printable character (ASCII #%d) in string",
+					(unsigned char) s[end]);
 		}
 	}
+
+	/* escape codes are kept as written, so the string is the text between the
+	 * quotes, copied once into storage of its exact size */
+	line = arena_alloc(ac->arena, end - first + 1);
+	memcpy(line, s + first, end - first);
+	line[end - first] = '\0';
 	token -> type = TOKEN_STRING;
 	token -> string = line;
-   // free(line);
 
-	next_char();
-	position.col = start_pos.col-1;
+	skip_to(ac, end + 1);
+	ac->position.offset = start;
 }
 
 /* Process words
- * - Uses binary search to determine if word is reserved
+ * - Finds the end of the word in the source buffer, without copying it
+ * - Classifies it with get_word_type
+ * - Interns identifiers, so that the parser receives their handles
  */
 
-void process_word(Token * token)
+void process_word(AlanCompiler *ac, Token *token)
 {
-	SourcePos start_pos;
-	start_pos.col = column_number;
-
-	char lexeme[MAX_ID_LENGTH + 1] = "";
-	char add;
-	int i, cmp, low, mid, high;
-	i = 0;
-	cmp = 0;
-	int k;
-
-	k = column_number;
-	high = NUM_RESERVED_WORDS;
-
-	while (isalpha(ch) || ch == '_' || isdigit(ch)) {
-		add = ch;
-		i += 1;
-
-		/* check that the id length is less than the maximum */
-		if (i > MAX_ID_LENGTH) {
-			position.col = k;
-			leprintf("identifier too long");
-			break;
-		}
-
-		strncat(lexeme, & add, 1);
-		next_char();
+	size_t start = ac->offset;
+	const char *word = ac->src_buf + start;
+	size_t n = scan_run(ac->src_buf, start + 1, ac->src_len, RUN_WORD) - start;
+
+	/* check that the id length is less than the maximum */
+	if (n > MAX_ID_LENGTH) {
+		ac->position.offset = start;
+		leprintf(ac, "identifier too long");
 	}
-	strncat(lexeme, & add, '\0');
 
-	low = 0;
-	high = NUM_RESERVED_WORDS - 1;
-	do {
-		//binary search
-		mid = (low + high) / 2; //finding the mid of the array
-		if ((strcmp(lexeme, reserved[mid].word))<0) //compare the word with mid
-			high = mid - 1; //if small then decrement high
-		else if ((strcmp(lexeme, reserved[mid].word))>0)
-			low = mid + 1; //if greater then increment low
-	/*repeat the process till low doesn't becomes high and string is found */
-	} while ((strcmp(lexeme, reserved[mid].word)!= 0) && low <= high);
-	if ((strcmp(lexeme, reserved[mid].word))==0) { //if string is found
-		token -> type = reserved[mid].type;
-		position.col = start_pos.col;
-	}
-/* if id was not recognised as a reserved word, it is an identifier */
-	else {
-		token -> type = TOKEN_ID;
-		strcpy(token -> lexeme, lexeme);
-		position.col = start_pos.col;
+	token -> type = get_word_type(word, n);
+	if (token -> type == TOKEN_ID) {
+		memcpy(token -> lexeme, word, n);
+		token -> lexeme[n] = '\0';
+		token -> id = intern(ac, token -> lexeme);
 	}
+	skip_to(ac, start + n);
+	ac->position.offset = start;
 }
 
 /* Skip nested comments
- * - Skip nested comments recursively strategies
- *   are not allowed.
- * - Terminates with an error if comments are not nested properly.
+ * - Jumps from brace to brace, and counts the nesting depth.
+ * - Terminates with an error if comments are not nested properly, at the
+ *   innermost comment that is still open.
  */
 
-void skip_comment(void)
+void skip_comment(AlanCompiler *ac)
 {
-	SourcePos start_pos;
-	start_pos.col = column_number;
-	start_pos.line=position.line;
-	//int line_num = position.line;
-
-	/* temp int for error checking*/
-	int temp1;
-	int temp2;
-	temp1=column_number;
-	temp2=position.line;
-	next_char();
-
-	if (ch == EOF) {
-		position.col = start_pos.col;
-		leprintf("comment not closed");
+	const char *s = ac->src_buf;
+	size_t i = ac->offset + 1;
+	int depth = 1, balance = 0;
+
+	while (depth > 0) {
+		i = scan_run(s, i, ac->src_len, RUN_COMMENT);
+		if (i == ac->src_len) {
+			/* find the innermost open comment, from the end */
+			while (s[--i] != '{' || balance-- > 0) {
+				balance += (s[i] == '}');
+			}
+			ac->position.offset = i;
+			leprintf(ac, "comment not closed");
+		}
+		depth += (s[i++] == '{' ? 1 : -1);
 	}
+	skip_to(ac, i);
+}
+
+/* --- character-run kernels ------------------------------------------------ */
+
+/* Each kernel returns the offset of the first character at or after offset i,
+ * and before n, that is not in the run class, or n if there is none.  The
+ * vector kernels examine 16 or 32 characters at a time, and leave the tail of
+ * the buffer to the scalar kernel, so that they never read past the end of a
+ * mapped file.
+ */
+
+static size_t scalar_run(const char *s, size_t i, size_t n, int run)
+{
+	while (i < n && (run_class[(unsigned char) s[i]] & run)) {
+		i++;
+	}
+
+	return i;
+}
+
+#ifdef SCAN_SSE2
 
-	while (ch != '}') {
-		if (ch == '{') {
-			start_pos.col = column_number;
-			skip_comment();
+/* Returns a mask of the bytes of x in the range [lo, hi]. */
+
+static __m128i sse2_in_range(__m128i x, int lo, int hi)
+{
+	__m128i d = _mm_sub_epi8(x, _mm_set1_epi8((char) lo));
+	return _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8((char) (hi - lo))), d);
+}
+
+/* Returns a mask of the characters at p, of 16, that end a run. */
+
+static unsigned int sse2_stop(const char *p, int run)
+{
+	__m128i x, keep;
+
+	x = _mm_loadu_si128((const __m128i *) p);
+	switch (run) {
+		case RUN_SPACE:
+			keep = _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8(' ')),
+					sse2_in_range(x, '\t', '\r'));
+			break;
+		case RUN_WORD:
+			keep = _mm_or_si128(
+					_mm_or_si128(sse2_in_range(x, '0', '9'),
+						_mm_cmpeq_epi8(x, _mm_set1_epi8('_'))),
+					sse2_in_range(_mm_or_si128(x, _mm_set1_epi8(0x20)),
+						'a', 'z'));
+			break;
+		case RUN_DIGIT:
+			keep = sse2_in_range(x, '0', '9');
+			break;
+		case RUN_COMMENT:
+			keep = _mm_xor_si128(_mm_set1_epi8(-1),
+					_mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('{')),
+						_mm_cmpeq_epi8(x, _mm_set1_epi8('}'))));
+			break;
+		default:
+			keep = _mm_andnot_si128(
+					_mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('"')),
+						_mm_cmpeq_epi8(x, _mm_set1_epi8('\\'))),
+					sse2_in_range(x, ' ', '~'));
+			break;
+	}
+
+	return ~(unsigned int) _mm_movemask_epi8(keep) & 0xFFFF;
+}
+
+static size_t sse2_run(const char *s, size_t i, size_t n, int run)
+{
+	unsigned int stop;
+
+	for (; i + 16 <= n; i += 16) {
+		if ((stop = sse2_stop(s + i, run)) != 0) {
+			return i + __builtin_ctz(stop);
 		}
-		if (ch=='}') {
+	}
+
+	return scalar_run(s, i, n, run);
+}
+
+#endif /* SCAN_SSE2 */
+
+#ifdef SCAN_AVX2
+
+/* Returns a mask of the bytes of x in the range [lo, hi]. */
+
+__attribute__((target("avx2")))
+static __m256i avx2_in_range(__m256i x, int lo, int hi)
+{
+	__m256i d = _mm256_sub_epi8(x, _mm256_set1_epi8((char) lo));
+	return _mm256_cmpeq_epi8(
+			_mm256_min_epu8(d, _mm256_set1_epi8((char) (hi - lo))), d);
+}
+
+/* Returns a mask of the characters at p, of 32, that end a run. */
+
+__attribute__((target("avx2")))
+static unsigned int avx2_stop(const char *p, int run)
+{
+	__m256i x, keep;
+
+	x = _mm256_loadu_si256((const __m256i *) p);
+	switch (run) {
+		case RUN_SPACE:
+			keep = _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8(' ')),
+					avx2_in_range(x, '\t', '\r'));
+			break;
+		case RUN_WORD:
+			keep = _mm256_or_si256(
+					_mm256_or_si256(avx2_in_range(x, '0', '9'),
+						_mm256_cmpeq_epi8(x, _mm256_set1_epi8('_'))),
+					avx2_in_range(_mm256_or_si256(x, _mm256_set1_epi8(0x20)),
+						'a', 'z'));
+			break;
+		case RUN_DIGIT:
+			keep = avx2_in_range(x, '0', '9');
 			break;
+		case RUN_COMMENT:
+			keep = _mm256_xor_si256(_mm256_set1_epi8(-1),
+					_mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('{')),
+						_mm256_cmpeq_epi8(x, _mm256_set1_epi8('}'))));
+			break;
+		default:
+			keep = _mm256_andnot_si256(
+					_mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8('"')),
+						_mm256_cmpeq_epi8(x, _mm256_set1_epi8('\\'))),
+					avx2_in_range(x, ' ', '~'));
+			break;
+	}
+
+	return ~(unsigned int) _mm256_movemask_epi8(keep);
+}
+
+/* Most runs are short, so the first 16 characters are examined with SSE2, and
+ * only a longer run goes on 32 characters at a time.
+ */
+
+__attribute__((target("avx2")))
+static size_t avx2_run(const char *s, size_t i, size_t n, int run)
+{
+	unsigned int stop;
+
+	if (i + 16 <= n) {
+		if ((stop = sse2_stop(s + i, run)) != 0) {
+			return i + __builtin_ctz(stop);
 		}
-		if (ch == EOF) {
-			position.col = temp1;
-			position.line=temp2;
-			leprintf("comment not closed");
+		i += 16;
+	}
+	for (; i + 32 <= n; i += 32) {
+		if ((stop = avx2_stop(s + i, run)) != 0) {
+			return i + __builtin_ctz(stop);
 		}
-		next_char();
 	}
-	next_char();
-	return;
+
+	return sse2_run(s, i, n, run);
+}
+
+#endif /* SCAN_AVX2 */
+
+#ifdef SCAN_NEON
+
+/* Returns a mask of the bytes of x in the range [lo, hi]. */
+
+static uint8x16_t neon_in_range(uint8x16_t x, int lo, int hi)
+{
+	return vandq_u8(vcgeq_u8(x, vdupq_n_u8(lo)), vcleq_u8(x, vdupq_n_u8(hi)));
 }
 
+static size_t neon_run(const char *s, size_t i, size_t n, int run)
+{
+	uint8x16_t x, keep;
+	uint64_t stop;
+
+	for (; i + 16 <= n; i += 16) {
+		x = vld1q_u8((const uint8_t *) (s + i));
+		switch (run) {
+			case RUN_SPACE:
+				keep = vorrq_u8(vceqq_u8(x, vdupq_n_u8(' ')),
+						neon_in_range(x, '\t', '\r'));
+				break;
+			case RUN_WORD:
+				keep = vorrq_u8(
+						vorrq_u8(neon_in_range(x, '0', '9'),
+							vceqq_u8(x, vdupq_n_u8('_'))),
+						neon_in_range(vorrq_u8(x, vdupq_n_u8(0x20)),
+							'a', 'z'));
+				break;
+			case RUN_DIGIT:
+				keep = neon_in_range(x, '0', '9');
+				break;
+			case RUN_COMMENT:
+				keep = vmvnq_u8(vorrq_u8(vceqq_u8(x, vdupq_n_u8('{')),
+							vceqq_u8(x, vdupq_n_u8('}'))));
+				break;
+			default:
+				keep = vbicq_u8(neon_in_range(x, ' ', '~'),
+						vorrq_u8(vceqq_u8(x, vdupq_n_u8('"')),
+							vceqq_u8(x, vdupq_n_u8('\\'))));
+				break;
+		}
+
+		/* narrow the byte mask to four bits per byte */
+		stop = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(
+						vreinterpretq_u16_u8(vmvnq_u8(keep)), 4)), 0);
+		if (stop != 0) {
+			return i + (__builtin_ctzll(stop) >> 2);
+		}
+	}
+
+	return scalar_run(s, i, n, run);
+}
+
+#endif /* SCAN_NEON */
+
+/* Fills in the run classes, and selects the fastest kernel that the processor
+ * supports, unless ALAN_SCAN_KERNEL names another available kernel.
+ */
+
+static void select_kernel(void)
+{
+	static const struct {
+		const char *name;
+		RunKernel   kernel;
+	} kernels[] = {
+		{"scalar", scalar_run},
+#ifdef SCAN_SSE2
+		{"sse2", sse2_run},
+#endif
+#ifdef SCAN_AVX2
+		{"avx2", avx2_run},
+#endif
+#ifdef SCAN_NEON
+		{"neon", neon_run},
+#endif
+	};
+	int c, i, nkernels;
+	const char *want;
+
+	for (c = 0; c < 256; c++) {
+		run_class[c] = (!isascii(c) ? 0 : (isspace(c) ? RUN_SPACE : 0)
+				| (isalnum(c) || c == '_' ? RUN_WORD : 0)
+				| (isdigit(c) ? RUN_DIGIT : 0)
+				| (isprint(c) && c != '"' && c != '\\' ? RUN_STRING : 0))
+			| (c != '{' && c != '}' ? RUN_COMMENT : 0);
+	}
+
+	/* the kernels are listed from the slowest to the fastest */
+	nkernels = sizeof(kernels) / sizeof(kernels[0]);
+#ifdef SCAN_AVX2
+	if (!__builtin_cpu_supports("avx2")) {
+		nkernels--;
+	}
+#endif
+
+	i = nkernels - 1;
+	if ((want = getenv("ALAN_SCAN_KERNEL")) != NULL) {
+		for (c = 0; c < nkernels; c++) {
+			if (strcmp(kernels[c].name, want) == 0) {
+				i = c;
+			}
+		}
+	}
+	scan_run = kernels[i].kernel;
+	scan_kernel_name = kernels[i].name;
+}
@@ -10,22 +10,95 @@
 #define SCANNER_H
 
 #include <stdio.h>
+#include "error.h"
 #include "token.h"
 
 /**
- * Initialises the scanner.
+ * Initialises the scanner to read a source file.  A regular file is mapped into
+ * memory, and any other stream, such as a pipe, is read in large blocks, so
+ * that the scanner works from a buffer either way.
  *
+ * @param[in]   ac
+ *     the compiler context
  * @param[in]   in_file
  *     the (already open) source file
  */
-void init_scanner(FILE *in_file);
+void init_scanner(AlanCompiler *ac, FILE *in_file);
 
 /**
- * Gets the next token from the input (source) file.
+ * Initialises the scanner to read a source text that is already in memory.
+ * The text is not copied, and must outlive the scan.
  *
+ * @param[in]   ac
+ *     the compiler context
+ * @param[in]   buf
+ *     the source text
+ * @param[in]   len
+ *     the length of the source text
+ */
+void init_scanner_buffer(AlanCompiler *ac, const char *buf, size_t len);
+
+/**
+ * Classifies a word as a reserved word or an identifier.
+ *
+ * @param[in]   word
+ *     the characters of the word, which need not be NUL-terminated
+ * @param[in]   len
+ *     the length of the word
+ * @return      the token type of the reserved word, or <code>TOKEN_ID</code>
+ */
+TokenType get_word_type(const char *word, size_t len);
+
+/**
+ * Returns the name of the kernel that finds runs of whitespace, word, comment,
+ * and string characters: "avx2", "sse2", "neon", or "scalar".  The fastest
+ * kernel that the processor supports is selected the first time a source is
+ * scanned, unless the environment variable ALAN_SCAN_KERNEL names another.
+ *
+ * @return      the name of the selected kernel
+ */
+const char *get_scan_kernel(void);
+
+/**
+ * Releases the source text and the tokens held by the scanner.
+ *
+ * @param[in]   ac
+ *     the compiler context
+ */
+void release_scanner(AlanCompiler *ac);
+
+/**
+ * Scans the whole source up front into a token buffer, from which
+ * <code>get_token</code> then delivers the tokens.  Any scanning error is
+ * therefore reported before parsing starts.
+ *
+ * @param[in]   ac
+ *     the compiler context
+ */
+void tokenize(AlanCompiler *ac);
+
+/**
+ * Returns the type of a token ahead of the current one, which is free once the
+ * source has been tokenized up front.
+ *
+ * @param[in]   ac
+ *     the compiler context, of which the source has been tokenized
+ * @param[in]   k
+ *     how far to look ahead: <code>0</code> for the current token,
+ *     <code>1</code> for the next one, and so on
+ * @return      the type of the token, or <code>TOKEN_EOF</code> past the end
+ */
+TokenType peek_token(AlanCompiler *ac, int k);
+
+/**
+ * Gets the next token from the input (source) file, or from the token buffer
+ * if the source has been tokenized up front.
+ *
+ * @param[in]   ac
+ *     the compiler context
  * @param[out]  token
  *     contains the token just scanned
  */
-void get_token(Token *token);
+void get_token(AlanCompiler *ac, Token *token);
 
 #endif /* SCANNER_H */
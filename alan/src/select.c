@@ -0,0 +1,195 @@
+/**
+ * @file    select.c
+ * @brief   Instruction selection over the IR of function bodies.
+ * @date    2026-10-14
+ */
+
+#include <stdio.h>
+#include "boolean.h"
+#include "ir.h"
+#include "select.h"
+
+/* --- type definitions and constants --------------------------------------- */
+
+#define IS_CONSTANT(i)                                                         \
+	((i) != NULL && (i)->op == JVM_LDC && (i)->operand == CODE_INTEGER)
+
+#define IS_POWER_OF_TWO(i)                                                     \
+	(IS_CONSTANT(i) && (i)->num >= 2 && ((i)->num & ((i)->num - 1)) == 0)
+
+#define IS_LOAD(i, slot)                                                       \
+	((i) != NULL && (i)->op == JVM_ILOAD && (i)->num == (slot))
+
+/* --- function prototypes -------------------------------------------------- */
+
+static Boolean select_increment(IRblock *bb, IRinsn *store);
+static Boolean select_shift(IRblock *bb, IRinsn *mul);
+static Boolean select_zero_test(IRblock *bb, IRinsn *cmp);
+static Bytecode zero_test(Bytecode op, Boolean swapped);
+
+/* --- selection interface -------------------------------------------------- */
+
+void select_instructions(IRfunc *fn, SelectStats *stats)
+{
+	IRblock *bb;
+	IRinsn *i, *next;
+
+	for (bb = fn->first; bb; bb = bb->next) {
+		for (i = bb->first; i; i = next) {
+			next = i->next;
+			switch (i->op) {
+				case JVM_ISTORE:
+					if (select_increment(bb, i)) {
+						stats->increments++;
+					}
+					break;
+				case JVM_IMUL:
+					if (select_shift(bb, i)) {
+						stats->shifts++;
+					}
+					break;
+				case JVM_IF_ICMPEQ:
+				case JVM_IF_ICMPGE:
+				case JVM_IF_ICMPGT:
+				case JVM_IF_ICMPLE:
+				case JVM_IF_ICMPLT:
+				case JVM_IF_ICMPNE:
+					if (select_zero_test(bb, i)) {
+						stats->zero_tests++;
+					}
+					break;
+				default:
+					break;
+			}
+		}
+	}
+}
+
+void print_select_stats(FILE *file, const char *prefix,
+		const SelectStats *stats)
+{
+	if (stats->increments + stats->shifts + stats->zero_tests > 0) {
+		fprintf(file, "%sselect: %lu increments, %lu shifts, "
+				"%lu tests against zero\n", prefix, stats->increments,
+				stats->shifts, stats->zero_tests);
+	}
+}
+
+/* --- utility functions ---------------------------------------------------- */
+
+/* Turns x := x + c, or x := x - c, into an increment, if c fits into a byte.
+ * Where the peephole optimiser left the new value on the stack, with a dup
+ * before the store, the variable is loaded again after the increment.
+ */
+
+static Boolean select_increment(IRblock *bb, IRinsn *store)
+{
+	IRinsn *dup, *op, *a, *b;
+	int slot = store->num, inc;
+
+	dup = (store->prev && store->prev->op == JVM_DUP ? store->prev : NULL);
+	op = (dup ? dup->prev : store->prev);
+	if (op == NULL || slot > 0xff) {
+		return FALSE;
+	}
+	b = op->prev;
+	a = (b ? b->prev : NULL);
+
+	if (op->op == JVM_IADD && IS_LOAD(a, slot) && IS_CONSTANT(b)) {
+		inc = b->num;
+	} else if (op->op == JVM_IADD && IS_CONSTANT(a) && IS_LOAD(b, slot)) {
+		inc = a->num;
+	} else if (op->op == JVM_ISUB && IS_LOAD(a, slot) && IS_CONSTANT(b)
+			&& b->num > -128) {
+		inc = -b->num;
+	} else {
+		return FALSE;
+	}
+	if (inc < -128 || inc > 127) {
+		return FALSE;
+	}
+
+	ir_unlink(bb, a);
+	ir_unlink(bb, b);
+	ir_unlink(bb, op);
+	store->op = JVM_IINC;
+	store->inc = inc;
+	if (dup) {
+		ir_unlink(bb, dup);
+		dup->op = JVM_ILOAD;
+		dup->operand = CODE_INTEGER;
+		dup->num = slot;
+		ir_link_before(bb, store->next, dup);
+	}
+
+	return TRUE;
+}
+
+/* Turns a multiplication by a positive power of two into a left shift, which
+ * wraps around in the same way.  A constant on the left is moved to the right
+ * when the other operand is a load, so that the two may swap.  Division is not
+ * shifted, since a shift rounds negative numbers down rather than to zero.
+ */
+
+static Boolean select_shift(IRblock *bb, IRinsn *mul)
+{
+	IRinsn *a, *b;
+	int k;
+
+	b = mul->prev;
+	a = (b ? b->prev : NULL);
+	if (IS_POWER_OF_TWO(a) && b->op == JVM_ILOAD) {
+		ir_unlink(bb, a);
+		ir_link_before(bb, mul, a);
+		b = a;
+	} else if (!IS_POWER_OF_TWO(b)) {
+		return FALSE;
+	}
+
+	for (k = 0; (1 << k) != b->num; k++)
+		;
+	b->num = k;
+	mul->op = JVM_ISHL;
+
+	return TRUE;
+}
+
+/* Turns a comparison with a constant zero into a test against zero.  With the
+ * zero on the left, the other operand must be a single load, so that the zero
+ * can be dropped from under it; the sense of the comparison is then swapped.
+ */
+
+static Boolean select_zero_test(IRblock *bb, IRinsn *cmp)
+{
+	IRinsn *a, *b;
+
+	b = cmp->prev;
+	a = (b ? b->prev : NULL);
+	if (IS_CONSTANT(b) && b->num == 0) {
+		ir_unlink(bb, b);
+		cmp->op = zero_test(cmp->op, FALSE);
+	} else if (IS_CONSTANT(a) && a->num == 0 && b->op == JVM_ILOAD) {
+		ir_unlink(bb, a);
+		cmp->op = zero_test(cmp->op, TRUE);
+	} else {
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* Returns the test against zero for a comparison; if swapped, the operands of
+ * the comparison are taken in the reverse order.
+ */
+
+static Bytecode zero_test(Bytecode op, Boolean swapped)
+{
+	switch (op) {
+		case JVM_IF_ICMPEQ: return JVM_IFEQ;
+		case JVM_IF_ICMPNE: return JVM_IFNE;
+		case JVM_IF_ICMPLT: return (swapped ? JVM_IFGT : JVM_IFLT);
+		case JVM_IF_ICMPGE: return (swapped ? JVM_IFLE : JVM_IFGE);
+		case JVM_IF_ICMPGT: return (swapped ? JVM_IFLT : JVM_IFGT);
+		default:            return (swapped ? JVM_IFGE : JVM_IFLE);
+	}
+}
@@ -0,0 +1,52 @@
+/**
+ * @file    select.h
+ * @brief   Instruction selection over the IR of function bodies.
+ *
+ * After the other passes, the IR is rewritten into cheaper instructions: an
+ * update of a local variable by a small constant becomes an increment, a
+ * multiplication by a power of two becomes a shift, and a comparison with zero
+ * becomes a test against zero.  This is run at optimisation level 1 and above.
+ * The compact encodings of constants and of the first four local variables are
+ * chosen when the code is written out, at every level.
+ *
+ * @date    2026-10-14
+ */
+
+#ifndef SELECT_H
+#define SELECT_H
+
+#include <stdio.h>
+#include "ir.h"
+
+/** what instruction selection did */
+typedef struct {
+	unsigned long increments;  /**< the updates turned into iinc           */
+	unsigned long shifts;      /**< the multiplications turned into ishl   */
+	unsigned long zero_tests;  /**< the comparisons with zero turned into
+	                                tests against zero                     */
+} SelectStats;
+
+/**
+ * Selects cheaper instructions for the IR of a function.
+ *
+ * @param[in]   fn
+ *     the IR of the function
+ * @param[in,out]   stats
+ *     the statistics, to which the rewrites are added
+ */
+void select_instructions(IRfunc *fn, SelectStats *stats);
+
+/**
+ * Writes what instruction selection did, on one line.
+ *
+ * @param[in]   file
+ *     the output file
+ * @param[in]   prefix
+ *     the text that starts the line
+ * @param[in]   stats
+ *     the statistics
+ */
+void print_select_stats(FILE *file, const char *prefix,
+		const SelectStats *stats);
+
+#endif /* SELECT_H */
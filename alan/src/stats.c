@@ -0,0 +1,216 @@
+/**
+ * @file    stats.c
+ * @brief   The time and work that a compilation takes, for <code>--stats</code>.
+ * @date    2026-10-14
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+#include "boolean.h"
+#include "compiler.h"
+#include "error.h"
+#include "hashtable.h"
+#include "stats.h"
+
+#define INITIAL_BODY_COUNT 16
+
+/* the names of the phases in the output, of which the first is not shown */
+static const char *phase_names[NPHASES] = {
+	NULL, "scan", "parse", "codegen", "emit", "assemble"
+};
+
+/* --- function prototypes -------------------------------------------------- */
+
+static void read_clocks(struct timespec *wall, struct timespec *cpu);
+static unsigned long ns_between(const struct timespec *from,
+		const struct timespec *to);
+static void print_time(FILE *out, const char *name, unsigned long wall_ns,
+		unsigned long cpu_ns);
+static void print_string(FILE *out, const char *s);
+
+/* --- statistics interface ------------------------------------------------- */
+
+void init_stats(AlanCompiler *ac)
+{
+	AlanStats *s;
+
+	release_stats(ac);
+	s = emalloc(sizeof(AlanStats));
+	memset(s, 0, sizeof(AlanStats));
+	get_alloc_counts(&s->allocs);
+	s->phase = PHASE_NONE;
+	read_clocks(&s->wall, &s->cpu);
+	ac->stats = s;
+}
+
+Phase stats_phase(AlanCompiler *ac, Phase phase)
+{
+	AlanStats *s = ac->stats;
+	struct timespec wall, cpu;
+	Phase left;
+
+	if (s == NULL) {
+		return phase;
+	}
+	read_clocks(&wall, &cpu);
+	s->wall_ns[s->phase] += ns_between(&s->wall, &wall);
+	s->cpu_ns[s->phase] += ns_between(&s->cpu, &cpu);
+	s->wall = wall;
+	s->cpu = cpu;
+	left = s->phase;
+	s->phase = phase;
+
+	return left;
+}
+
+void stats_add_table(AlanCompiler *ac, HashTab *ht)
+{
+	HTstats hs;
+
+	if (ac->stats == NULL || ht == NULL) {
+		return;
+	}
+	ht_get_stats(ht, &hs);
+	ac->stats->tables.searches += hs.searches;
+	ac->stats->tables.probes += hs.probes;
+	ac->stats->tables.resizes += hs.resizes;
+}
+
+void stats_add_body(AlanCompiler *ac, const char *name, int code,
+		int max_stack, int locals)
+{
+	AlanStats *s = ac->stats;
+	BodyStats *b;
+
+	if (s == NULL) {
+		return;
+	}
+	if (s->nbodies == s->capbodies) {
+		s->capbodies = (s->capbodies ? 2 * s->capbodies : INITIAL_BODY_COUNT);
+		s->bodies = erealloc(s->bodies, s->capbodies * sizeof(BodyStats));
+	}
+	b = &s->bodies[s->nbodies++];
+	b->name = name;
+	b->code = code;
+	b->max_stack = max_stack;
+	b->locals = locals;
+}
+
+void print_stats(AlanCompiler *ac, Boolean cached)
+{
+	AlanStats *s = ac->stats;
+	FILE *out = (ac->diag ? ac->diag : stderr);
+	AllocCounts now;
+	struct rusage usage;
+	unsigned long wall_ns, cpu_ns;
+	int i, max_code;
+
+	if (s == NULL) {
+		return;
+	}
+	stats_phase(ac, PHASE_NONE);
+	get_alloc_counts(&now);
+	getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+	usage.ru_maxrss /= 1024;
+#endif
+
+	fprintf(out, "{\"source\": ");
+	print_string(out, ac->src_name);
+	fprintf(out, ", \"cached\": %s, \"optimise\": %d, \"time\": {",
+			(cached ? "true" : "false"), ac->options.optimise);
+	wall_ns = cpu_ns = 0;
+	for (i = 0; i < NPHASES; i++) {
+		if (phase_names[i]) {
+			print_time(out, phase_names[i], s->wall_ns[i], s->cpu_ns[i]);
+			fprintf(out, ", ");
+		}
+		wall_ns += s->wall_ns[i];
+		cpu_ns += s->cpu_ns[i];
+	}
+	print_time(out, "total", wall_ns, cpu_ns);
+
+	fprintf(out, "}, \"scanner\": {\"bytes\": %lu, \"tokens\": %lu}",
+			s->bytes, s->tokens);
+	fprintf(out, ", \"symbols\": {\"lookups\": %lu, \"bindings\": %lu}",
+			s->lookups, s->bindings);
+	fprintf(out, ", \"hash\": {\"searches\": %lu, \"probes\": %lu"
+			", \"resizes\": %lu}", s->tables.searches, s->tables.probes,
+			s->tables.resizes);
+	fprintf(out, ", \"memory\": {\"allocated\": %lu, \"reallocs\": %lu"
+			", \"max_rss_kb\": %ld}", now.allocated - s->allocs.allocated,
+			now.reallocs - s->allocs.reallocs, (long) usage.ru_maxrss);
+
+	fprintf(out, ", \"bodies\": [");
+	for (i = 0, max_code = 0; i < s->nbodies; i++) {
+		fprintf(out, "%s{\"name\": ", (i ? ", " : ""));
+		print_string(out, s->bodies[i].name);
+		fprintf(out, ", \"code\": %d, \"max_stack\": %d, \"locals\": %d}",
+				s->bodies[i].code, s->bodies[i].max_stack,
+				s->bodies[i].locals);
+		if (s->bodies[i].code > max_code) {
+			max_code = s->bodies[i].code;
+		}
+	}
+	fprintf(out, "], \"max_code\": %d}\n", max_code);
+}
+
+void release_stats(AlanCompiler *ac)
+{
+	if (ac->stats == NULL) {
+		return;
+	}
+	free(ac->stats->bodies);
+	free(ac->stats);
+	ac->stats = NULL;
+}
+
+/* --- utility functions ---------------------------------------------------- */
+
+/* Reads the monotonic clock, and the processor time of the calling thread. */
+
+static void read_clocks(struct timespec *wall, struct timespec *cpu)
+{
+	clock_gettime(CLOCK_MONOTONIC, wall);
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, cpu);
+}
+
+/* Returns the nanoseconds from one reading of a clock to a later one. */
+
+static unsigned long ns_between(const struct timespec *from,
+		const struct timespec *to)
+{
+	return (unsigned long) ((to->tv_sec - from->tv_sec) * 1000000000L
+			+ (to->tv_nsec - from->tv_nsec));
+}
+
+/* Writes the times of a phase as a member of an object, in microseconds. */
+
+static void print_time(FILE *out, const char *name, unsigned long wall_ns,
+		unsigned long cpu_ns)
+{
+	fprintf(out, "\"%s\": {\"wall_us\": %lu, \"cpu_us\": %lu}", name,
+			wall_ns / 1000, cpu_ns / 1000);
+}
+
+/* Writes a string as a JSON string, escaping what must be escaped. */
+
+static void print_string(FILE *out, const char *s)
+{
+	const unsigned char *c;
+
+	fputc('"', out);
+	for (c = (const unsigned char *) s; *c; c++) {
+		if (*c == '"' || *c == '\\') {
+			fprintf(out, "\\%c", *c);
+		} else if (*c < 0x20) {
+			fprintf(out, "\\u%04x", *c);
+		} else {
+			fputc(*c, out);
+		}
+	}
+	fputc('"', out);
+}
@@ -0,0 +1,131 @@
+/**
+ * @file    stats.h
+ * @brief   The time and work that a compilation takes, for <code>--stats</code>.
+ *
+ * The wall-clock and processor time of a compilation is charged to the phase
+ * that it is in: scanning, parsing and type checking, code generation (the
+ * optimisation and lowering of each body), the emission of the class file or
+ * the Jasmin text, and assembly.  Time outside these phases, such as the
+ * cache look-up and the release of the compiler units, only counts towards the
+ * total.  Unless the source is scanned up front, the scanner runs whenever the
+ * parser needs a token, so that it is timed token by token, and the reading of
+ * the clocks adds to the times.  The counters are kept by the units
+ * themselves, and only when the statistics are kept.  Each compilation is
+ * reported as one JSON object, on a line of its own.
+ *
+ * @date    2026-10-14
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <time.h>
+#include "boolean.h"
+#include "compiler.h"
+#include "hashtable.h"
+
+/** the phases of a compilation, to which its time is charged */
+typedef enum {
+	PHASE_NONE,      /**< outside every phase                */
+	PHASE_SCAN,      /**< reading and scanning the source    */
+	PHASE_PARSE,     /**< parsing and type checking          */
+	PHASE_CODEGEN,   /**< optimising and lowering the bodies */
+	PHASE_EMIT,      /**< writing the class file or Jasmin   */
+	PHASE_ASSEMBLE,  /**< running the assembler              */
+	NPHASES          /**< the number of phases               */
+} Phase;
+
+/** the code of one body, as it was generated */
+typedef struct {
+	const char *name;      /**< the name of the function or procedure */
+	int         code;      /**< the items of its code array           */
+	int         max_stack; /**< the depth of its operand stack        */
+	int         locals;    /**< the slots of its local variables      */
+} BodyStats;
+
+struct alan_stats {
+	unsigned long   wall_ns[NPHASES]; /**< the wall-clock time per phase    */
+	unsigned long   cpu_ns[NPHASES];  /**< the processor time per phase     */
+	Phase           phase;            /**< the phase being timed            */
+	struct timespec wall;             /**< when the phase was entered       */
+	struct timespec cpu;              /**< the processor time at that point */
+	AllocCounts     allocs;           /**< the counts at the start          */
+	unsigned long   bytes;            /**< the bytes of source read         */
+	unsigned long   tokens;           /**< the tokens scanned               */
+	unsigned long   lookups;          /**< the calls of find_name           */
+	unsigned long   bindings;         /**< the bindings that they examined  */
+	HTstats         tables;           /**< the uses of the hash tables      */
+	BodyStats      *bodies;           /**< the bodies, in generation order  */
+	int             nbodies;          /**< the number of bodies             */
+	int             capbodies;        /**< the capacity of the bodies array */
+};
+
+/**
+ * Starts keeping the statistics of a compilation, outside every phase.
+ *
+ * @param[in]   ac
+ *     the compiler context
+ */
+void init_stats(AlanCompiler *ac);
+
+/**
+ * Charges the time since the last switch to the current phase, and enters
+ * another.  Nothing is done, unless the statistics are kept.
+ *
+ * @param[in]   ac
+ *     the compiler context
+ * @param[in]   phase
+ *     the phase to enter
+ * @return      the phase that was left, to which to return afterwards
+ */
+Phase stats_phase(AlanCompiler *ac, Phase phase);
+
+/**
+ * Adds the searches, probes, and resizes of a hash table, which is about to be
+ * freed, to the statistics.
+ *
+ * @param[in]   ac
+ *     the compiler context
+ * @param[in]   ht
+ *     the hash table
+ */
+void stats_add_table(AlanCompiler *ac, HashTab *ht);
+
+/**
+ * Records the size of a body once its code array has been made.
+ *
+ * @param[in]   ac
+ *     the compiler context
+ * @param[in]   name
+ *     the name of the body, which must outlive the statistics
+ * @param[in]   code
+ *     the items of its code array
+ * @param[in]   max_stack
+ *     the depth of its operand stack
+ * @param[in]   locals
+ *     the slots of its local variables
+ */
+void stats_add_body(AlanCompiler *ac, const char *name, int code,
+		int max_stack, int locals);
+
+/**
+ * Writes the statistics of the compilation to the diagnostic stream, as one
+ * line of JSON.  The peak resident set size is that of the whole process, so
+ * far.
+ *
+ * @param[in]   ac
+ *     the compiler context
+ * @param[in]   cached
+ *     whether the output was restored from the cache instead of compiled
+ */
+void print_stats(AlanCompiler *ac, Boolean cached);
+
+/**
+ * Stops keeping the statistics, and releases them.
+ *
+ * @param[in]   ac
+ *     the compiler context
+ */
+void release_stats(AlanCompiler *ac);
+
+#endif /* STATS_H */
@@ -11,121 +11,251 @@
 #include <string.h>
 
 #include "boolean.h"
+#include "compiler.h"
 #include "error.h"
-#include "hashtable.h"
+#include "intern.h"
+#include "stats.h"
 #include "symboltable.h"
 #include "token.h"
 #include "valtypes.h"
 
-/* --- global static variables ---------------------------------------------- */
+/* --- type definitions and constants --------------------------------------- */
 
-static HashTab *table, *saved_table;
-static unsigned int curr_offset;
+#define INITIAL_BINDING_COUNT 256
+#define INITIAL_SCOPE_COUNT   8
+
+/** a name declared in a scope, which hides any binding of the same name */
+typedef struct {
+	const char   *id;        /**< the interned handle of the name       */
+	IDprop       *prop;      /**< the properties of the name            */
+	int           shadowed;  /**< the binding hidden by this one, or -1 */
+} Binding;
+
+/** an open scope, of which the bindings are on top of the binding stack */
+typedef struct {
+	int           base;      /**< the first binding of the scope        */
+	unsigned int  next_slot; /**< the next local variable slot          */
+	Arena        *arena;     /**< the objects of the scope              */
+} Scope;
+
+struct symbol_table {
+	int          *top;         /**< the innermost binding of each name, by
+	                                intern index, or -1                 */
+	unsigned int  ntop;        /**< the length of top                   */
+	Binding      *bindings;    /**< the binding stack                   */
+	int           nbindings;   /**< the number of bindings              */
+	int           capbindings; /**< the allocated length of bindings    */
+	Scope        *scopes;      /**< the scope stack, global scope first */
+	int           nscopes;     /**< the number of open scopes           */
+	int           capscopes;   /**< the allocated length of scopes      */
+};
 
 /* --- function prototypes -------------------------------------------------- */
 
-static void valstr(void *key, void *p, char *str);
-static void freeprop(void *p);
-static unsigned int shift_hash(void *key, unsigned int size);
-static int key_strcmp(void *val1, void *val2);
+static void open_scope(AlanCompiler *ac, unsigned int first_slot);
+static void close_scope(AlanCompiler *ac);
+static int *top_of(SymbolTable *st, const char *id);
+static Boolean visible(SymbolTable *st, Binding *b);
 
 /* --- symbol table interface ----------------------------------------------- */
 
-void init_symbol_table(void)
+void init_symbol_table(AlanCompiler *ac)
 {
-	saved_table = NULL;
-	if ((table = ht_init(0.75f, shift_hash, key_strcmp)) == NULL) {
-		eprintf("Symbol table could not be initialised");
-	}
-	curr_offset = 1;
+	ac->symbols = emalloc(sizeof(SymbolTable));
+	memset(ac->symbols, 0, sizeof(SymbolTable));
+
+	/* slot 0 of the main method holds its argument array */
+	open_scope(ac, 1);
 }
 
-Boolean open_subroutine(char *id, IDprop *prop)
+Boolean open_subroutine(AlanCompiler *ac, const char *id, IDprop *prop)
 {
-	if (ht_insert(table, id, prop) == 0) {
-		return TRUE;
-	} else {
+	if (!insert_name(ac, id, prop)) {
 		return FALSE;
 	}
-	// must insert table properties
-	saved_table = table;
 
-	table = NULL;
-	if ((table = ht_init(0.75f, shift_hash, key_strcmp)) == NULL) {
-		eprintf("Symbol table could not be initialised");
-	}
-	curr_offset = 1;
+	/* the parameters take the first slots of the subroutine */
+	open_scope(ac, 0);
+
+	return TRUE;
 }
 
-void close_subroutine(void)
+void close_subroutine(AlanCompiler *ac)
 {
-	ht_free(table, free, freeprop);
-	table = saved_table;
+	close_scope(ac);
 }
 
-Boolean insert_name(char *id, IDprop *prop)
+Boolean insert_name(AlanCompiler *ac, const char *id, IDprop *prop)
 {
-	if ((!find_name(id, &prop)) && (ht_insert(table, id, prop) == 0)) {
-		return TRUE;
-	} else {
+	SymbolTable *st = ac->symbols;
+	Scope *sc = &st->scopes[st->nscopes - 1];
+	IDprop *found;
+	Binding *b;
+	int *top;
+
+	if (find_name(ac, id, &found)) {
 		return FALSE;
 	}
-	free(id);
-	free(prop);
+
+	if (st->nbindings == st->capbindings) {
+		st->capbindings = (st->capbindings ? 2 * st->capbindings
+				: INITIAL_BINDING_COUNT);
+		st->bindings = erealloc(st->bindings,
+				st->capbindings * sizeof(Binding));
+	}
+	top = top_of(st, id);
+	b = &st->bindings[st->nbindings];
+	b->id = id;
+	b->prop = prop;
+	b->shadowed = *top;
+	*top = st->nbindings++;
+
+	/* a name is resolved here, once, to its scope and slot */
+	prop->scope = (unsigned int) (st->nscopes - 1);
+	if (!IS_CALLABLE_TYPE(prop->type)) {
+		prop->offset = sc->next_slot++;
+	}
+
+	return TRUE;
 }
 
-Boolean find_name(char *id, IDprop **prop)
+Boolean find_name(AlanCompiler *ac, const char *id, IDprop **prop)
 {
-	Boolean found;
-	found = ht_search(table, id, (void **)prop);
-	if (!found && saved_table) {
-		found = ht_search(saved_table, id, (void **)prop);
-		if (found && !IS_CALLABLE_TYPE((*prop)->type)) {
-			found = FALSE;
+	SymbolTable *st = ac->symbols;
+	unsigned int index = intern_index(id);
+	int i;
+
+	if (ac->stats) {
+		ac->stats->lookups++;
+	}
+	if (index >= st->ntop) {
+		return FALSE;
+	}
+	for (i = st->top[index]; i >= 0; i = st->bindings[i].shadowed) {
+		if (ac->stats) {
+			ac->stats->bindings++;
+		}
+		if (visible(st, &st->bindings[i])) {
+			*prop = st->bindings[i].prop;
+			return TRUE;
 		}
 	}
 
-	return found;
+	return FALSE;
 }
 
-int get_variables_width(void) { return curr_offset; }
+int get_variables_width(AlanCompiler *ac)
+{
+	SymbolTable *st = ac->symbols;
+
+	return (int) st->scopes[st->nscopes - 1].next_slot;
+}
+
+void release_symbol_table(AlanCompiler *ac)
+{
+	SymbolTable *st = ac->symbols;
+
+	if (st == NULL) {
+		return;
+	}
+	while (st->nscopes > 0) {
+		close_scope(ac);
+	}
+	free(st->top);
+	free(st->bindings);
+	free(st->scopes);
+	free(st);
+	ac->symbols = NULL;
+	ac->scope = NULL;
+}
 
-void release_symbol_table(void) { ht_free(table, free, freeprop); }
+void print_symbol_table(AlanCompiler *ac)
+{
+	SymbolTable *st = ac->symbols;
+	Binding *b;
+	int i;
 
-void print_symbol_table(void) { ht_print(table, valstr); }
+	for (i = st->scopes[st->nscopes - 1].base; i < st->nbindings; i++) {
+		b = &st->bindings[i];
+		printf("%s@%u.%u[%s]\n", b->id, b->prop->scope, b->prop->offset,
+				get_valtype_string(b->prop->type));
+	}
+}
 
 /* --- utility functions ---------------------------------------------------- */
 
-static void valstr(void *key, void *p, char *str)
+/* Opens a scope of which the variables are numbered from first_slot.  The
+ * global scope allocates from the arena of the compilation, and every other
+ * scope from a sub-arena of its own.
+ */
+
+static void open_scope(AlanCompiler *ac, unsigned int first_slot)
 {
-	char *keystr = (char *)key;
-	IDprop *idpp = (IDprop *)p;
+	SymbolTable *st = ac->symbols;
+	Scope *sc;
 
-	sprintf(str, "%s.%d", keystr, idpp->offset);
-	sprintf(str, "%s@%d[%s]", keystr, idpp->offset,
-			get_valtype_string(idpp->type));
+	if (st->nscopes == st->capscopes) {
+		st->capscopes = (st->capscopes ? 2 * st->capscopes
+				: INITIAL_SCOPE_COUNT);
+		st->scopes = erealloc(st->scopes, st->capscopes * sizeof(Scope));
+	}
+	sc = &st->scopes[st->nscopes++];
+	sc->base = st->nbindings;
+	sc->next_slot = first_slot;
+	sc->arena = (st->nscopes == 1 ? ac->arena : arena_new(ac->arena));
+	ac->scope = sc->arena;
 }
 
-static void freeprop(void *p) { free((IDprop *)p); }
+/* Closes the innermost scope, by popping its bindings and restoring the ones
+ * that they hid, and releases everything allocated from the scope at once.
+ */
 
-static unsigned int shift_hash(void *key, unsigned int size)
+static void close_scope(AlanCompiler *ac)
 {
-	char *temp;
-	size = size - 1;
-	unsigned int final;
-	temp = (char *)key;
-
-	int h = 0;
-	for (int i = 0; i < (int)strlen(temp); i++) {
-		h = (h << 5) | (h >> 27); // 5-bit cyclic shift of the running sum
-		h += (int)temp[i];        // add in next character
+	SymbolTable *st = ac->symbols;
+	Scope *sc = &st->scopes[st->nscopes - 1];
+	Binding *b;
+
+	assert(st->nscopes > 0);
+	while (st->nbindings > sc->base) {
+		b = &st->bindings[--st->nbindings];
+		*top_of(st, b->id) = b->shadowed;
 	}
-	final = h % size;
-	return final;
+	if (sc->arena != ac->arena) {
+		arena_free(sc->arena);
+	}
+	st->nscopes--;
+	ac->scope = (st->nscopes > 0 ? st->scopes[st->nscopes - 1].arena : NULL);
 }
 
-static int key_strcmp(void *val1, void *val2)
+/* Returns the entry of the innermost binding of a name, growing the table
+ * to cover the intern index of the name.
+ */
+
+static int *top_of(SymbolTable *st, const char *id)
 {
-	return strcmp((char *)val1, (char *)val2);
+	unsigned int index = intern_index(id), n;
+
+	if (index >= st->ntop) {
+		n = (st->ntop ? st->ntop : INITIAL_BINDING_COUNT);
+		while (n <= index) {
+			n *= 2;
+		}
+		st->top = erealloc(st->top, n * sizeof(int));
+		memset(st->top + st->ntop, 0xff, (n - st->ntop) * sizeof(int));
+		st->ntop = n;
+	}
+
+	return &st->top[index];
 }
 
+/* Returns whether a binding can be seen from the current scope: the variables
+ * of a subroutine are private to it, but the subroutines of any enclosing
+ * scope can be called.
+ */
+
+static Boolean visible(SymbolTable *st, Binding *b)
+{
+	return ((int) b->prop->scope == st->nscopes - 1
+			|| IS_CALLABLE_TYPE(b->prop->type));
+}
@@ -9,86 +9,122 @@
 #define SYMBOLTABLE_H
 
 #include "boolean.h"
+#include "error.h"
 #include "token.h"
 #include "valtypes.h"
 
 typedef struct {
 	ValType       type;     /*<< variable type or function return type     */
-	unsigned int  offset;   /*<< local variable offset for code generation */
+	unsigned int  scope;    /*<< depth of the declaring scope; 0 is global */
+	unsigned int  offset;   /*<< local variable slot for code generation   */
 	unsigned int  nparams;  /*<< number of parameters; 0 for variables     */
 	ValType      *params;   /*<< array of parameter types; NULL for vars   */
 } IDprop;
 
 /**
- * Initialises the global symbol table.
+ * Initialises the global symbol table.  The names of all scopes live in one
+ * table, indexed by their interned handles, that maps every name to its
+ * innermost binding, and each binding remembers the binding that it hides.
+ * Opening a scope costs nothing, and closing one restores the bindings that
+ * it hid in time proportional to the number of names that it declared.
+ *
+ * @param[in]   ac
+ *     the compiler context
  */
-void init_symbol_table(void);
+void init_symbol_table(AlanCompiler *ac);
 
 /**
  * Opens a new function or procedure (subroutine) context by (1) inserting the
  * subroutine name and properties into the global symbol table, (2) preserving
  * the global symbol table for later re-use, and (3) initialising a new local
- * symbol table for the subroutine as current symbol table.
+ * symbol table for the subroutine as current symbol table, with a sub-arena of
+ * its own as the current scope.  The properties of the subroutine itself must
+ * have been allocated from the enclosing scope.
  *
+ * @param[in]   ac
+ *     the compiler context
  * @param[in]   id
- *     the identifier of the new function or procedure
+ *     the interned handle of the identifier of the new function or procedure
  * @param[in]   prop
  *     the identifier properties of the new function or procedure
  * @return      <code>TRUE</code> if the local subroutine context was set up
  *              successfully, or <code>FALSE</code> otherwise
  */
-Boolean open_subroutine(char *id, IDprop *prop);
+Boolean open_subroutine(AlanCompiler *ac, const char *id, IDprop *prop);
 
 /**
  * Closes the current subroutine context by (1) releasing memory resources
- * associated with the current local symbol table, and (2) setting the preserved
- * global symbol table as the current symbol table.
+ * associated with the current local symbol table, including everything
+ * allocated from its scope, at once, and (2) setting the preserved global
+ * symbol table as the current symbol table.
+ *
+ * @param[in]   ac
+ *     the compiler context
  */
-void close_subroutine(void);
+void close_subroutine(AlanCompiler *ac);
 
 /**
  * Inserts the specified identifier with the specified properties into the
- * current symbol table.  This function "steals" the <code>id</code> and
- * <code>prop</code> pointers, and assumes responsibility for their
- * deallocation.
+ * current symbol table.  The properties must be allocated from the current
+ * scope, <code>ac->scope</code>, so that they are released with it.  A variable
+ * is given the next local variable slot of its subroutine, which is recorded,
+ * together with the depth of the scope, in its properties.
  *
+ * @param[in]   ac
+ *     the compiler context
  * @param[in]   id
- *     the identifier to insert
+ *     the interned handle of the identifier to insert
  * @param[in]   prop
  *     the properties to be associated with the new identifier
  * @return      <code>FALSE</code> if the identifier is already in the current
  *              symbol table, or if there was not enough space for a new entry,
  *              or <code>TRUE</code> otherwise
  */
-Boolean insert_name(char *id, IDprop *prop);
+Boolean insert_name(AlanCompiler *ac, const char *id, IDprop *prop);
 
 /**
  * Retrieves the properties associated with the specified identifier from the
- * current symbol table.
+ * current symbol table.  The variables of an enclosing scope are not visible,
+ * but its functions and procedures are.
  *
+ * @param[in]   ac
+ *     the compiler context
  * @param[in]   id
- *     the identifier to look up in the current symbol table
+ *     the interned handle of the identifier to look up in the current symbol
+ *     table
  * @param[out]  prop
  *     the pointer to the pointer to which the pointer to the properties
  *     structure, associated with the identifier, will be copied
  * @return      <code>TRUE</code> if the identifier exists in the current symbol
  *              table, or <code>FALSE</code> otherwise
  */
-Boolean find_name(char *id, IDprop **prop);
+Boolean find_name(AlanCompiler *ac, const char *id, IDprop **prop);
 
 /**
- * Returns the number of the identifiers stored in the current symbol table.
+ * Returns the number of local variable slots used by the current subroutine,
+ * including those of its parameters, or, at the global level, those of the
+ * main method and its argument array.
+ *
+ * @param[in]   ac
+ *     the compiler context
+ * @return      the number of local variable slots
  */
-int get_variables_width(void);
+int get_variables_width(AlanCompiler *ac);
 
 /**
  * Releases the memory resources associated with the global symbol table.
+ *
+ * @param[in]   ac
+ *     the compiler context
  */
-void release_symbol_table(void);
+void release_symbol_table(AlanCompiler *ac);
 
 /**
  * Prints the current symbol table to the standard output stream.
+ *
+ * @param[in]   ac
+ *     the compiler context
  */
-void print_symbol_table(void);
+void print_symbol_table(AlanCompiler *ac);
 
 #endif /* SYMBOLTABLE_H */
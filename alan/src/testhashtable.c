@@ -5,9 +5,12 @@
  * @date    2022-08-03
  */
 
+#include <ctype.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include "error.h"
 #include "hashtable.h"
 
@@ -19,22 +22,56 @@ typedef struct {
 } Name;
 
 #define BUFFER_SIZE 1024
+#define BENCH_NAMES  20000   /* the number of generated identifiers         */
+#define BENCH_OPS    2000000 /* the minimum number of timed hashes per test */
+
+/** a hash function under test */
+typedef struct {
+	const char   *name;
+	unsigned int (*hash)(void *key, unsigned int size);
+} HashFunc;
+
+/** a corpus of distinct identifiers */
+typedef struct {
+	char   **ids;
+	size_t   n, cap;
+} Corpus;
+
+static const HashFunc hash_funcs[] = {
+	{"fnv1a", ht_hash_fnv1a}, {"words", ht_hash_words}, {"shift", ht_hash_shift}
+};
+
+#define NUM_HASH_FUNCS (sizeof(hash_funcs) / sizeof(hash_funcs[0]))
 
 /* --- function prototypes -------------------------------------------------- */
 
 unsigned int hash(void *key, unsigned int size);
 int scmp(void *v1, void *v2);
 void val2str(void *key, void *value, char *buffer);
+void run_benchmark(int nfiles, char *files[]);
+void add_id(Corpus *c, HashTab *seen, const char *id, size_t len);
+void read_corpus(Corpus *c, HashTab *seen, const char *filename);
+void make_corpus(Corpus *c, HashTab *seen);
+void bench_hash(const HashFunc *f, Corpus *c);
+int ucmp(const void *a, const void *b);
+void nofree(void *p);
 
 /* --- main routine --------------------------------------------------------- */
 
-int main()
+int main(int argc, char *argv[])
 {
 	char buffer[BUFFER_SIZE];
 	int i = 1, ret;
 	Name *np;
 	HashTab *ht;
 
+	if (argc >= 2 && strcmp(argv[1], "-b") == 0) {
+		setprogname(argv[0]);
+		run_benchmark(argc - 2, argv + 2);
+		freeprogname();
+		return EXIT_SUCCESS;
+	}
+
 	ht = ht_init(0.75f, hash, scmp);
 	printf("Type \"search <Enter>\" to stop inserting and start searching.\n");
 	printf(">> ");
@@ -75,6 +112,213 @@ int main()
 	return EXIT_SUCCESS;
 }
 
+/* --- benchmark ------------------------------------------------------------ */
+
+/* Compares the hash functions on the distinct identifiers of the specified
+ * files, or on generated identifiers if there are none.  For each function,
+ * reports the time per hash and per table operation, the number of keys that
+ * share a full 32-bit hash with another key, the probe sequence lengths in the
+ * hash table, and the chains that the keys would form in a chained table of
+ * the prime size that the earlier implementation used, with the ratio of
+ * their cost to that of uniform hashing (1.00 is ideal).
+ */
+
+void run_benchmark(int nfiles, char *files[])
+{
+	Corpus c = {NULL, 0, 0};
+	HashTab *seen;
+	size_t i, total;
+	int f;
+
+	seen = ht_init(0.75f, ht_hash_fnv1a, scmp);
+	for (f = 0; f < nfiles; f++) {
+		read_corpus(&c, seen, files[f]);
+	}
+	if (nfiles == 0) {
+		make_corpus(&c, seen);
+	}
+	if (c.n == 0) {
+		eprintf("no identifiers found");
+	}
+
+	for (i = total = 0; i < c.n; i++) {
+		total += strlen(c.ids[i]);
+	}
+	printf("%lu distinct identifiers, %.1f characters on average\n\n",
+			(unsigned long) c.n, (double) total / c.n);
+	printf("%-6s %9s %9s %6s %7s %7s %7s %7s\n", "hash", "ns/hash", "ns/op",
+			"equal", "probe", "max", "chain", "cost");
+	for (i = 0; i < NUM_HASH_FUNCS; i++) {
+		bench_hash(&hash_funcs[i], &c);
+	}
+
+	ht_free(seen, nofree, nofree);
+	for (i = 0; i < c.n; i++) {
+		free(c.ids[i]);
+	}
+	free(c.ids);
+}
+
+void add_id(Corpus *c, HashTab *seen, const char *id, size_t len)
+{
+	char *s;
+
+	s = emalloc(len + 1);
+	memcpy(s, id, len);
+	s[len] = '\0';
+	if (ht_insert(seen, s, s) != EXIT_SUCCESS) {
+		free(s);
+		return;
+	}
+	if (c->n == c->cap) {
+		c->cap = (c->cap ? 2 * c->cap : BUFFER_SIZE);
+		c->ids = erealloc(c->ids, c->cap * sizeof(char *));
+	}
+	c->ids[c->n++] = s;
+}
+
+/* Collects the identifiers of a file, as the ALAN scanner would see them. */
+
+void read_corpus(Corpus *c, HashTab *seen, const char *filename)
+{
+	FILE *in;
+	char buffer[BUFFER_SIZE];
+	int ch;
+	size_t len = 0;
+
+	if ((in = fopen(filename, "r")) == NULL) {
+		eprintf("file '%s' could not be opened:", filename);
+	}
+	do {
+		ch = getc(in);
+		if (ch != EOF && (isalpha(ch) || ch == '_'
+					|| (len > 0 && isdigit(ch)))) {
+			if (len < BUFFER_SIZE) {
+				buffer[len++] = (char) ch;
+			}
+		} else if (len > 0) {
+			add_id(c, seen, buffer, len);
+			len = 0;
+		}
+	} while (ch != EOF);
+	fclose(in);
+}
+
+/* Generates identifiers in the styles of people and of code generators. */
+
+void make_corpus(Corpus *c, HashTab *seen)
+{
+	static const char *stems[] = {
+		"i", "j", "n", "x", "tmp", "count", "total", "index", "value", "result",
+		"buffer_length", "is_valid", "max_depth", "node", "left_child"
+	};
+	char buffer[BUFFER_SIZE];
+	size_t i, nstems = sizeof(stems) / sizeof(stems[0]);
+
+	for (i = 0; c->n < BENCH_NAMES; i++) {
+		sprintf(buffer, "%s%lu", stems[i % nstems], (unsigned long) (i / nstems));
+		add_id(c, seen, buffer, strlen(buffer));
+		if (i % 3 == 0) {
+			sprintf(buffer, "_t%lu", (unsigned long) i);
+			add_id(c, seen, buffer, strlen(buffer));
+		}
+	}
+}
+
+void bench_hash(const HashFunc *f, Corpus *c)
+{
+	HashTab *ht;
+	HTstats stats;
+	unsigned int *hashes, *chains, prime, sink = 0;
+	size_t i, r, rounds, equal;
+	double cost, chain_cost, hash_time, op_time;
+	unsigned int max_chain;
+	void *v;
+	clock_t t;
+
+	rounds = BENCH_OPS / c->n + 1;
+
+	/* the time per hash */
+	t = clock();
+	for (r = 0; r < rounds; r++) {
+		for (i = 0; i < c->n; i++) {
+			sink += f->hash(c->ids[i], UINT_MAX);
+		}
+	}
+	hash_time = (double) (clock() - t) / CLOCKS_PER_SEC;
+
+	/* the time per insertion and search in the hash table */
+	t = clock();
+	for (r = 0; r < rounds; r++) {
+		ht = ht_init(0.75f, f->hash, scmp);
+		for (i = 0; i < c->n; i++) {
+			ht_insert(ht, c->ids[i], c->ids[i]);
+		}
+		for (i = 0; i < c->n; i++) {
+			sink += ht_search(ht, c->ids[i], &v);
+		}
+		if (r + 1 < rounds) {
+			ht_free(ht, nofree, nofree);
+		}
+	}
+	op_time = (double) (clock() - t) / CLOCKS_PER_SEC;
+	ht_get_stats(ht, &stats);
+	ht_free(ht, nofree, nofree);
+
+	/* the keys that share a full hash */
+	hashes = emalloc(c->n * sizeof(unsigned int));
+	for (i = 0; i < c->n; i++) {
+		hashes[i] = f->hash(c->ids[i], UINT_MAX);
+	}
+	qsort(hashes, c->n, sizeof(unsigned int), ucmp);
+	for (i = 1, equal = 0; i < c->n; i++) {
+		equal += (hashes[i] == hashes[i - 1]);
+	}
+	free(hashes);
+
+	/* the chains in a prime-sized table at a load factor of 0.75, the largest
+	 * prime below a power of two, as the earlier implementation used */
+	for (prime = 32; prime * 3 / 4 < c->n; prime *= 2)
+		;
+	for (prime--; ; prime -= 2) {
+		for (r = 3; r * r <= prime && prime % r != 0; r += 2)
+			;
+		if (r * r > prime) {
+			break;
+		}
+	}
+	chains = emalloc(prime * sizeof(unsigned int));
+	memset(chains, 0, prime * sizeof(unsigned int));
+	for (i = 0; i < c->n; i++) {
+		chains[f->hash(c->ids[i], prime)]++;
+	}
+	for (i = 0, cost = 0, max_chain = 0; i < prime; i++) {
+		cost += chains[i] * (chains[i] + 1.0) / 2;
+		if (chains[i] > max_chain) {
+			max_chain = chains[i];
+		}
+	}
+	chain_cost = cost / ((c->n / (2.0 * prime)) * (c->n + 2.0 * prime - 1));
+	free(chains);
+
+	printf("%-6s %9.1f %9.1f %6lu %7.2f %7u %7u %7.2f%s\n", f->name,
+			hash_time * 1e9 / (rounds * c->n),
+			op_time * 1e9 / (2 * rounds * c->n), (unsigned long) equal,
+			stats.mean_probe, stats.max_probe, max_chain, chain_cost,
+			(sink == 0 ? " " : ""));
+}
+
+int ucmp(const void *a, const void *b)
+{
+	unsigned int x = *(const unsigned int *) a, y = *(const unsigned int *) b;
+	return (x > y) - (x < y);
+}
+
+void nofree(void *p)
+{
+	(void) p;
+}
+
 /* --- hash helper functions ------------------------------------------------ */
 
 unsigned int hash(void *key, unsigned int size)
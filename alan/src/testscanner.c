@@ -5,20 +5,44 @@
  * @date    2022-08-03
  */
 
+#include <ctype.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "compiler.h"
 #include "error.h"
+#include "intern.h"
 #include "scanner.h"
 #include "token.h"
 
+/* --- type definitions and constants --------------------------------------- */
+
+#define BENCH_SIZE   (8 * 1024 * 1024)  /* the size of the generated source  */
+#define BENCH_ROUNDS 5                  /* the number of scans of the source */
+
+/* the reserved words in sorted order, for the reference classifier */
+static const char *sorted_words[] = {
+	"and", "array", "begin", "boolean", "call", "do", "else", "elsif", "end",
+	"false", "function", "get", "if", "integer", "leave", "not", "or", "put",
+	"relax", "rem", "source", "then", "to", "true", "while"
+};
+
+#define NUM_SORTED_WORDS (sizeof(sorted_words) / sizeof(sorted_words[0]))
+
 /* --- function prototypes -------------------------------------------------- */
 
 void print_token(Token *token);
+void run_benchmark(const char *filename);
+char *make_bench_source(size_t *len);
+int search_word(const char *word);
+double seconds_since(clock_t start);
 
 /* --- main routine --------------------------------------------------------- */
 
 int main(int argc, char *argv[])
 {
+	AlanCompiler *ac;
 	Token token;
 	FILE *in_file;
 
@@ -27,29 +51,41 @@ int main(int argc, char *argv[])
 	token.string = NULL;
 
 	/* check command-line argument and open file */
-	if (argc != 2) {
-		eprintf("usage: %s <filename>", getprogname());
+	if (argc == 2 && strcmp(argv[1], "-b") == 0) {
+		run_benchmark(NULL);
+		freeprogname();
+		return EXIT_SUCCESS;
+	} else if (argc == 3 && strcmp(argv[1], "-b") == 0) {
+		run_benchmark(argv[2]);
+		freeprogname();
+		return EXIT_SUCCESS;
+	} else if (argc != 2) {
+		eprintf("usage: %s [-b] <filename>\n       %s -b", getprogname(),
+				getprogname());
 	}
 
-	setsrcname(argv[1]);
+	ac = alan_new();
+	alan_set_source_name(ac, argv[1]);
 
 	if ((in_file = fopen(argv[1], "r")) == NULL) {
 		eprintf("file '%s' could not be opened:", argv[1]);
 	}
 
 	/* initialise scanner */
-	init_scanner(in_file);
+	init_scanner(ac, in_file);
 
 	/* iterate over tokens in the input file */
-	get_token(&token);
+	get_token(ac, &token);
 	while (token.type != TOKEN_EOF) {
 		print_token(&token);
-		get_token(&token);
+		get_token(ac, &token);
 	}
 
 	/* free names */
 	freeprogname();
-	freesrcname();
+	release_scanner(ac);
+	release_names(ac);
+	alan_free(ac);
 	fclose(in_file);
 
 	/* tell Linux we're happy */
@@ -69,9 +105,169 @@ void print_token(Token *token)
 			break;
 		case TOKEN_STRING:
 			printf("String: \"%s\"\n", token->string);
-			free(token->string);
 			break;
 		default:
 			printf("%s\n", get_token_string(token->type));
 	}
 }
+
+/* Measures the throughput of the scanner on identifier-heavy text, which is
+ * generated unless a source file is given.  The classification of the words
+ * is timed separately against a binary search over the sorted reserved words,
+ * the method that the scanner used before its perfect hash.
+ */
+
+void run_benchmark(const char *filename)
+{
+	AlanCompiler *ac;
+	Token token;
+	FILE *in_file;
+	char *src;
+	size_t len, i, j, nwords;
+	unsigned long ntokens, nkeywords;
+	clock_t t;
+	double scan_time, search_time, hash_time;
+	int r;
+
+	if (filename == NULL) {
+		src = make_bench_source(&len);
+	} else {
+		if ((in_file = fopen(filename, "r")) == NULL) {
+			eprintf("file '%s' could not be opened:", filename);
+		}
+		fseek(in_file, 0, SEEK_END);
+		len = ftell(in_file);
+		rewind(in_file);
+		src = emalloc(len + 1);
+		if (fread(src, 1, len, in_file) != len) {
+			eprintf("file '%s' could not be read:", filename);
+		}
+		fclose(in_file);
+	}
+
+	/* scan the whole source */
+	ac = alan_new();
+	alan_set_source_name(ac, filename == NULL ? "<bench>" : filename);
+	ntokens = 0;
+	t = clock();
+	for (r = 0; r < BENCH_ROUNDS; r++) {
+		init_scanner_buffer(ac, src, len);
+		do {
+			get_token(ac, &token);
+			ntokens++;
+		} while (token.type != TOKEN_EOF);
+		release_scanner(ac);
+		release_names(ac);
+		arena_reset(ac->arena);
+	}
+	scan_time = seconds_since(t);
+	alan_free(ac);
+
+	/* classify every word of the source, with both methods */
+	nwords = nkeywords = 0;
+	search_time = hash_time = 0;
+	for (r = 0; r < BENCH_ROUNDS; r++) {
+		t = clock();
+		for (i = 0; i < len; i = j + 1) {
+			for (j = i; j < len && (isalnum((unsigned char) src[j])
+						|| src[j] == '_'); j++)
+				;
+			if (j > i && isalpha((unsigned char) src[i])) {
+				char word[MAX_ID_LENGTH + 1];
+				size_t n = (j - i > MAX_ID_LENGTH ? MAX_ID_LENGTH : j - i);
+				memcpy(word, src + i, n);
+				word[n] = '\0';
+				nkeywords += (search_word(word) >= 0);
+			}
+		}
+		search_time += seconds_since(t);
+
+		t = clock();
+		for (i = 0; i < len; i = j + 1) {
+			for (j = i; j < len && (isalnum((unsigned char) src[j])
+						|| src[j] == '_'); j++)
+				;
+			if (j > i && isalpha((unsigned char) src[i])) {
+				nkeywords -= (get_word_type(src + i, j - i) != TOKEN_ID);
+				nwords++;
+			}
+		}
+		hash_time += seconds_since(t);
+	}
+
+	if (nkeywords != 0) {
+		eprintf("the classifiers disagree on %lu words", nkeywords);
+	}
+
+	printf("kernel:           %s\n", get_scan_kernel());
+	printf("source:           %lu bytes, %lu rounds\n",
+			(unsigned long) len, (unsigned long) BENCH_ROUNDS);
+	printf("scanner:          %.1f MB/s, %.1f Mtokens/s\n",
+			len * BENCH_ROUNDS / 1e6 / scan_time, ntokens / 1e6 / scan_time);
+	printf("binary search:    %.1f ns/word\n", search_time * 1e9 / nwords);
+	printf("perfect hash:     %.1f ns/word\n", hash_time * 1e9 / nwords);
+
+	free(src);
+}
+
+/* Generates a source of identifiers and reserved words, in about equal
+ * measure, since identifiers must miss every comparison of the binary search.
+ */
+
+char *make_bench_source(size_t *len)
+{
+	static const char *ids[] = {
+		"x", "count", "total_sum", "index2", "elements", "tmp", "is_done",
+		"average_value", "n", "buffer_length"
+	};
+	char *src;
+	size_t n, k, w;
+	unsigned int seed;
+
+	src = emalloc(BENCH_SIZE + MAX_ID_LENGTH + 2);
+	seed = 1;
+	for (n = 0; n < BENCH_SIZE; ) {
+		seed = seed * 1103515245 + 12345;
+		k = (seed >> 16) % (NUM_SORTED_WORDS + 10);
+		w = (k < NUM_SORTED_WORDS
+				? strlen(strcpy(src + n, sorted_words[k]))
+				: strlen(strcpy(src + n, ids[k - NUM_SORTED_WORDS])));
+		n += w;
+		src[n++] = ((seed >> 8) % 8 == 0 ? '\n' : ' ');
+	}
+	*len = n;
+
+	return src;
+}
+
+/* Looks up a word in the sorted reserved words, and returns its index, or -1
+ * if it is not reserved.
+ */
+
+int search_word(const char *word)
+{
+	int low, mid, high, cmp;
+
+	low = 0;
+	high = NUM_SORTED_WORDS - 1;
+	while (low <= high) {
+		mid = (low + high) / 2;
+		cmp = strcmp(word, sorted_words[mid]);
+		if (cmp == 0) {
+			return mid;
+		} else if (cmp < 0) {
+			high = mid - 1;
+		} else {
+			low = mid + 1;
+		}
+	}
+
+	return -1;
+}
+
+/* Returns the processor time since the specified clock value, in seconds. */
+
+double seconds_since(clock_t start)
+{
+	return (double) (clock() - start) / CLOCKS_PER_SEC;
+}
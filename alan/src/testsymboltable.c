@@ -9,17 +9,23 @@
 #include <stdlib.h>
 #include <string.h>
 #include "boolean.h"
+#include "compiler.h"
+#include "error.h"
+#include "intern.h"
 #include "symboltable.h"
 
 #define BUFFER_SIZE 1024
 
 int main()
 {
-	char buffer[BUFFER_SIZE], *id;
+	char buffer[BUFFER_SIZE];
+	const char *id;
 	Boolean main_is_active;
 	IDprop *propts;
+	AlanCompiler *ac;
 
-	init_symbol_table();
+	ac = alan_new();
+	init_symbol_table(ac);
 	main_is_active = TRUE;
 
 	printf("type \"search <Enter>\" to stop inserting and start searching.\n");
@@ -45,18 +51,16 @@ int main()
 				continue;
 			}
 
-			id = strdup(buffer);
-			propts = malloc(sizeof(IDprop));
+			id = intern(ac, buffer);
+			propts = arena_alloc(ac->scope, sizeof(IDprop));
 			propts->type = TYPE_CALLABLE | TYPE_INTEGER;
 			propts->nparams = 0;
 			propts->params = NULL;
 
-			if (open_subroutine(id, propts)) {
+			if (open_subroutine(ac, id, propts)) {
 				main_is_active = FALSE;
 			} else {
 				printf("Subroutine already exists ... not added.\n");
-				free(id);
-				free(propts);
 			}
 
 		} else if (strcmp(buffer, "close") == 0) {
@@ -66,32 +70,30 @@ int main()
 				continue;
 			}
 
-			close_subroutine();
+			close_subroutine(ac);
 			main_is_active = TRUE;
 
 		} else if (strcmp(buffer, "print") == 0) {
 
-			print_symbol_table();
+			print_symbol_table(ac);
 
 		} else if (strcmp(buffer, "insert") == 0) {
 
 			scanf("%s", buffer);
-			id = strdup(buffer);
-			propts = malloc(sizeof(IDprop));
+			id = intern(ac, buffer);
+			propts = arena_alloc(ac->scope, sizeof(IDprop));
 			propts->type = TYPE_INTEGER;
 			propts->nparams = 0;
 			propts->params = NULL;
 
-			if (!insert_name(id, propts)) {
+			if (!insert_name(ac, id, propts)) {
 				printf("Identifier already exists ... not added.\n");
-				free(id);
-				free(propts);
 			}
 
 		} else if (strcmp(buffer, "find") == 0) {
 
 			scanf("%s", buffer);
-			if (find_name(buffer, &propts)) {
+			if (find_name(ac, intern(ac, buffer), &propts)) {
 				printf("\"%s\" at offset %i.\n", buffer,
 						propts->offset);
 			} else {
@@ -101,7 +103,7 @@ int main()
 		} else if (strcmp(buffer, "quit") == 0) {
 
 			if (!main_is_active) {
-				close_subroutine();
+				close_subroutine(ac);
 				printf("Closed subroutine.\n");
 			}
 			break;
@@ -112,7 +114,9 @@ int main()
 	}
 
 	printf("Goodbye!\n");
-	release_symbol_table();
+	release_symbol_table(ac);
+	release_names(ac);
+	alan_free(ac);
 
 	return EXIT_SUCCESS;
 }
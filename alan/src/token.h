@@ -9,6 +9,8 @@
 #ifndef TOKEN_H
 #define TOKEN_H
 
+#include <stddef.h>
+
 /** the maximum length of an identifier */
 #define MAX_ID_LENGTH 32
 
@@ -88,8 +90,28 @@ typedef struct {
 		char   lexeme[MAX_ID_LENGTH+1];    /**< lexeme for identifiers       */
 		char  *string;                     /**< string (for write)           */
 	};
+	const char    *id;                      /**< interned identifier handle   */
 } Token;
 
+/**
+ * A whole source file, scanned up front, with the fields of its tokens stored
+ * in parallel arrays rather than as an array of <code>Token</code> structures,
+ * so that a pass over one field touches only that field.
+ */
+typedef struct {
+	int             ntokens;   /**< the number of tokens, including EOF     */
+	int             cap;       /**< the allocated length of the arrays      */
+	int             next;      /**< the index of the next token to deliver  */
+	unsigned char  *types;     /**< the token types                         */
+	size_t         *offsets;   /**< the source offsets of the tokens        */
+	unsigned int   *lengths;   /**< the source lengths of the tokens        */
+	int            *values;    /**< number values, string indices, or
+	                                identifier indices                      */
+	char          **strings;   /**< the string literals, in the arena       */
+	int             nstrings;  /**< the number of string literals           */
+	int             capstrings;/**< the allocated length of strings         */
+} TokenBuffer;
+
 /**
  * Returns a string representation of the specified token type.
  *
@@ -20,9 +20,9 @@ typedef enum valtype {
 #define IS_ARRAY_TYPE(type) (type & TYPE_ARRAY)
 #define IS_BOOLEAN_TYPE(type) (type & TYPE_BOOLEAN)
 #define IS_CALLABLE_TYPE(type) (type & TYPE_CALLABLE)
-#define IS_FUNCTION(type) (IS_CALLABLE_TYPE(type))
+#define IS_FUNCTION(type) (IS_CALLABLE_TYPE(type) && (type) != TYPE_CALLABLE)
 #define IS_INTEGER_TYPE(type) (type && TYPE_INTEGER)
-#define IS_PROCEDURE(type) (IS_CALLABLE_TYPE(type) && !IS_FUNCTION(type))
+#define IS_PROCEDURE(type) ((type) == TYPE_CALLABLE)
 #define IS_VARIABLE(type)
 
 #define SET_AS_ARRAY(type) ((type) |= TYPE_ARRAY)